@@ -28,7 +28,8 @@ APA102::APA102(gpio_num_t sclk_gpio,
       mosi_gpio_(mosi_gpio),
       spi_host_(spi_host),
       spi_device_(nullptr),
-      led_frame_(nullptr) {
+      led_frame_(nullptr),
+      trans_queued_(false) {
   std::memset(&trans_desc_, 0, sizeof(trans_desc_));
 }
 
@@ -95,9 +96,22 @@ esp_err_t APA102::Initialize() {
 }
 
 esp_err_t APA102::Set(Color color) {
+  if (trans_queued_) {
+    // The previous frame may still be sent from |led_frame_|, and its result
+    // must be collected or the transaction queue fills.
+    spi_transaction_t* trans;
+    esp_err_t err =
+        spi_device_get_trans_result(spi_device_, &trans, portMAX_DELAY);
+    if (err != ESP_OK)
+      return err;
+    trans_queued_ = false;
+  }
   LEDFrames* frame = static_cast<LEDFrames*>(led_frame_);
   frame->led_frame = color;
   trans_desc_.length = sizeof(LEDFrames) * kBitsPerByte,
   trans_desc_.tx_buffer = led_frame_;
-  return spi_device_queue_trans(spi_device_, &trans_desc_, portMAX_DELAY);
+  esp_err_t err =
+      spi_device_queue_trans(spi_device_, &trans_desc_, portMAX_DELAY);
+  trans_queued_ = err == ESP_OK;
+  return err;
 }
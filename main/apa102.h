@@ -41,6 +41,11 @@ class APA102 {
   ~APA102();
 
   esp_err_t Initialize();
+  /**
+   * Set the LED color.
+   *
+   * Waits for the previous frame to be sent, which takes ~100 usec.
+   */
   esp_err_t Set(Color color);
 
  private:
@@ -50,4 +55,5 @@ class APA102 {
   spi_device_handle_t spi_device_;
   void* led_frame_;
   spi_transaction_t trans_desc_;
+  bool trans_queued_;  // |trans_desc_| is queued and its result not taken.
 };
@@ -10,6 +10,20 @@ struct Config {
     std::string client_id;
     std::string client_secret;
   } spotify;
+  struct {
+    bool nkro = true;  // N-key rollover (else 6-key boot layout) reports.
+    std::string scan_profile = "balanced";  // See ScanProfile.
+    std::string macro;  // Text typed by the TYPE_MACRO key.
+  } keyboard;
+  struct {
+    bool host_channel = false;  // Host pushed now playing data (HostChannel).
+  } usb;
+  struct {
+    bool trackpad = false;  // Start with the touch panel as a trackpad.
+  } touch;
+  struct {
+    bool notify_benchmark = false;  // Log task wake latency at boot.
+  } debug;
   struct {
     std::string timezone;
     std::string ntp_server;
@@ -31,6 +31,34 @@ int handler(void* user,
     else
       return 1;  // Unknown key.
   }
+  if (streq(section, "keyboard")) {
+    if (streq(name, "report_mode"))
+      config->keyboard.nkro = !streq(value, "boot");
+    else if (streq(name, "scan_profile"))
+      config->keyboard.scan_profile = value;
+    else if (streq(name, "macro"))
+      config->keyboard.macro = value;
+    else
+      return 1;  // Unknown key.
+  }
+  if (streq(section, "usb")) {
+    if (streq(name, "host_channel"))
+      config->usb.host_channel = streq(value, "true");
+    else
+      return 1;  // Unknown key.
+  }
+  if (streq(section, "touch")) {
+    if (streq(name, "mode"))
+      config->touch.trackpad = streq(value, "trackpad");
+    else
+      return 1;  // Unknown key.
+  }
+  if (streq(section, "debug")) {
+    if (streq(name, "notify_benchmark"))
+      config->debug.notify_benchmark = streq(value, "true");
+    else
+      return 1;  // Unknown key.
+  }
   if (streq(section, "time")) {
     if (streq(name, "ntp_server"))
       config->time.ntp_server = value;
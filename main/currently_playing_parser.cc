@@ -0,0 +1,55 @@
+#include "currently_playing_parser.h"
+
+#include <cstdlib>
+#include <utility>
+
+bool CurrentlyPlayingParser::WantString(const std::string& path) {
+  return path == "item.name" || path == "item.artists[].name" ||
+         path == "item.album.images[].url";
+}
+
+void CurrentlyPlayingParser::OnValue(const std::string& path,
+                                     ValueType type,
+                                     const std::string& text) {
+  if (type == ValueType::Number) {
+    const uint32_t value = strtoul(text.c_str(), nullptr, 10);
+    if (path == "progress_ms")
+      data_->times.progress_ms = value;
+    else if (path == "item.duration_ms")
+      data_->times.duration_ms = value;
+    else if (path == "item.album.images[].width")
+      image_width_ = value;
+  } else if (type == ValueType::Bool) {
+    if (path == "is_playing")
+      data_->is_playing = text == "true";
+  } else if (type == ValueType::String) {
+    if (path == "item.name") {
+      data_->song_title = text;
+    } else if (path == "item.artists[].name") {
+      if (!data_->artist_name.empty())
+        data_->artist_name += ", ";
+      data_->artist_name += text;
+    } else if (path == "item.album.images[].url") {
+      image_url_ = text;
+    }
+  }
+}
+
+void CurrentlyPlayingParser::OnObjectEnd(const std::string& path) {
+  if (path != "item.album.images[]")
+    return;
+  // The url and width may come in either order.
+  switch (image_width_) {
+    case 640:
+      data_->image.url_640 = std::move(image_url_);
+      break;
+    case 300:
+      data_->image.url_300 = std::move(image_url_);
+      break;
+    case 64:
+      data_->image.url_64 = std::move(image_url_);
+      break;
+  }
+  image_url_.clear();
+  image_width_ = 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "json_stream.h"
+
+/**
+ * Fills a RequestData from a Spotify currently-playing response as it
+ * downloads, skipping everything else (such as the large available_markets
+ * arrays).
+ */
+class CurrentlyPlayingParser : public JSONStreamClient {
+ public:
+  /**
+   * The values used from a currently-playing response.
+   */
+  struct RequestData {
+    struct {
+      uint32_t progress_ms;
+      uint32_t duration_ms;
+    } times;
+    bool is_playing;
+    bool is_player_active;
+    std::string artist_name;  // All the track's artists, comma separated.
+    std::string song_title;
+    struct {
+      std::string url_640;
+      std::string url_300;
+      std::string url_64;
+    } image;
+  };
+
+  explicit CurrentlyPlayingParser(RequestData* data) : data_(data) {}
+
+  // JSONStreamClient:
+  bool WantString(const std::string& path) override;
+  void OnValue(const std::string& path,
+               ValueType type,
+               const std::string& text) override;
+  void OnObjectEnd(const std::string& path) override;
+
+ private:
+  RequestData* data_;
+  std::string image_url_;  // Of the current image.
+  uint32_t image_width_ = 0;
+};
@@ -1,16 +1,20 @@
 #pragma once
 
-#include <freertos/include/freertos/FreeRTOS.h>
+#include <cstdint>
 
-#include <freertos/include/freertos/event_groups.h>
+#include <esp_bit_defs.h>
 
-constexpr EventBits_t EVENT_NETWORK_GOT_IP = BIT0;
-constexpr EventBits_t EVENT_NETWORK_DISCONNECTED = BIT1;
-constexpr EventBits_t EVENT_SPOTIFY_GOT_AUTHORIZATION_CODE = BIT2;
-constexpr EventBits_t EVENT_SPOTIFY_ACCESS_TOKEN_GOOD = BIT3;
-constexpr EventBits_t EVENT_SPOTIFY_ACCESS_TOKEN_FAILURE = BIT4;
-constexpr EventBits_t EVENT_SPOTIFY_ACCESS_TOKEN_EXPIRE = BIT5;
-constexpr EventBits_t EVENT_ALL = BIT0 | BIT1 | BIT2 | BIT3 | BIT4 | BIT5;
+// MainTask TaskNotifier bits.
+constexpr uint32_t EVENT_NETWORK_GOT_IP = BIT0;
+constexpr uint32_t EVENT_NETWORK_DISCONNECTED = BIT1;
+constexpr uint32_t EVENT_SPOTIFY_GOT_AUTHORIZATION_CODE = BIT2;
+constexpr uint32_t EVENT_SPOTIFY_ACCESS_TOKEN_GOOD = BIT3;
+constexpr uint32_t EVENT_SPOTIFY_ACCESS_TOKEN_FAILURE = BIT4;
+constexpr uint32_t EVENT_SPOTIFY_ACCESS_TOKEN_EXPIRE = BIT5;
+constexpr uint32_t EVENT_USB_POWER_STATE = BIT6;
+constexpr uint32_t EVENT_SPOTIFY_POLL = BIT7;
+constexpr uint32_t EVENT_MEDIA_KEY = BIT8;
+constexpr uint32_t EVENT_HTTP_IDLE_SWEEP = BIT9;
 
 enum class WiFiStatus {
   Offline,
@@ -1,17 +1,127 @@
 #include "http_client.h"
 
+#include <cstdlib>
+#include <strings.h>
+#include <utility>
+
 #define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
 #include <esp-tls/esp_tls.h>
+#include <esp_idf_version.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/include/freertos/FreeRTOS.h>
+#include <freertos/include/freertos/semphr.h>
 #include <mbedtls/esp_crt_bundle/include/esp_crt_bundle.h>
 
+// esp_http_client can keep the TLS session of its last connection, and
+// offer it when reconnecting.
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0) && \
+    defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+#define TLS_SESSION_CACHE
+#endif
+
+/**
+ * An esp_http_client handle, and the connection it holds open.
+ */
+struct HTTPClient::Connection {
+  void Reset() {
+    handle = nullptr;
+    origin.clear();
+    header_names.clear();
+    used = false;
+    has_session = false;
+    idle_closed = false;
+  }
+
+  esp_http_client_handle_t handle = nullptr;
+  std::string origin;  // Scheme, host and port of |handle|.
+  std::vector<std::string> header_names;  // Set by the last request.
+  HTTPClient* client = nullptr;  // Making the current request.
+  int64_t idle_since_us = 0;     // When the last request finished.
+  bool in_use = false;           // Making a request.
+  bool pooled = true;            // Else closed once the request is done.
+  bool used = false;  // Has made a request, so may hold an open connection.
+  bool has_session = false;  // Holds a TLS session to offer on reconnecting.
+  bool idle_closed = false;  // Closed for being idle, keeping the session.
+};
+
 namespace {
+
 constexpr char TAG[] = "HTTPClient";
+
+// Each (TLS) connection holds a few tens of KB of buffers. One each for the
+// Spotify API, Spotify accounts, and artwork hosts.
+constexpr size_t kMaxPooledConnections = 3;
+
+// A stale reused connection is retried once on a new connection.
+constexpr int kMaxAttempts = 2;
+
+#ifdef TLS_SESSION_CACHE
+constexpr bool kTLSSessionCache = true;
+#else
+constexpr bool kTLSSessionCache = false;
+#endif
+
+// Time to open HTTPS connections (DNS, TCP and TLS handshake), with and
+// without a TLS session to resume. Guarded by PoolMutex().
+struct ConnectStats {
+  uint32_t count;
+  int64_t total_us;
+};
+ConnectStats g_full_connects = {0, 0};
+ConnectStats g_resumed_connects = {0, 0};
+
+SemaphoreHandle_t PoolMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+/**
+ * The scheme, host and port of |url|, the part of the URL which must match
+ * to reuse a connection.
+ */
+std::string GetOrigin(const std::string& url) {
+  const size_t scheme_end = url.find("://");
+  if (scheme_end == std::string::npos)
+    return url;
+  return url.substr(0, url.find('/', scheme_end + 3));
+}
+
+void RecordConnect(bool resumed, int64_t usec) {
+  if (xSemaphoreTake(PoolMutex(), portMAX_DELAY) != pdTRUE)
+    return;
+  ConnectStats& stats = resumed ? g_resumed_connects : g_full_connects;
+  stats.count++;
+  stats.total_us += usec;
+  const ConnectStats full = g_full_connects;
+  const ConnectStats resumable = g_resumed_connects;
+  xSemaphoreGive(PoolMutex());
+
+  ESP_LOGI(TAG,
+           "HTTPS connects: %u full handshake (avg %lld usec), %u offering a "
+           "session (avg %lld usec).",
+           full.count, full.count ? full.total_us / full.count : 0,
+           resumable.count,
+           resumable.count ? resumable.total_us / resumable.count : 0);
+}
+
+const char* MethodName(esp_http_client_method_t method) {
+  switch (method) {
+    case HTTP_METHOD_GET:
+      return "GET";
+    case HTTP_METHOD_POST:
+      return "POST";
+    default:
+      return "?";
+  }
+}
+
 }  // namespace
 
+// static
 esp_http_client_config_t HTTPClient::CreateClientConfig(
     const std::string& url,
-    esp_http_client_method_t method) {
+    Connection* connection) {
   esp_http_client_config_t config = {
     .url = url.c_str(),
     .host = 0,
@@ -25,7 +135,7 @@ esp_http_client_config_t HTTPClient::CreateClientConfig(
     .client_cert_pem = nullptr,
     .client_key_pem = nullptr,
     .user_agent = nullptr,
-    .method = method,
+    .method = HTTP_METHOD_GET,
     .timeout_ms = 0,
     .disable_auto_redirect = false,
     .max_redirection_count = 0,
@@ -34,7 +144,7 @@ esp_http_client_config_t HTTPClient::CreateClientConfig(
     .transport_type = HTTP_TRANSPORT_UNKNOWN,
     .buffer_size = 0,
     .buffer_size_tx = 0,
-    .user_data = this,
+    .user_data = connection,
     .is_async = false,
     .use_global_ca_store = false,
     .skip_cert_common_name_check = false,
@@ -46,28 +156,192 @@ esp_http_client_config_t HTTPClient::CreateClientConfig(
     .if_name = nullptr,
 #endif  // ESP-IDF 4.3.0
   };
+#ifdef TLS_SESSION_CACHE
+  config.save_client_session = true;
+#endif
   return config;
 }
 
+// static
+HTTPClient::Connection* HTTPClient::pool() {
+  static Connection connections[kMaxPooledConnections];
+  return connections;
+}
+
+// static
+void HTTPClient::ResetPoolForTesting() {
+  for (size_t i = 0; i < kMaxPooledConnections; i++) {
+    Connection* c = &pool()[i];
+    if (c->handle)
+      esp_http_client_cleanup(c->handle);
+    *c = Connection();
+  }
+  g_full_connects = {0, 0};
+  g_resumed_connects = {0, 0};
+}
+
+// static
+void HTTPClient::CloseIdleConnections(int64_t min_idle_us) {
+  std::vector<esp_http_client_handle_t> closing;
+  if (xSemaphoreTake(PoolMutex(), portMAX_DELAY) != pdTRUE)
+    return;
+  SweepIdleConnections(esp_timer_get_time(), min_idle_us, &closing);
+  xSemaphoreGive(PoolMutex());
+
+  for (esp_http_client_handle_t handle : closing)
+    esp_http_client_cleanup(handle);
+}
+
+// static
+void HTTPClient::SweepIdleConnections(
+    int64_t now,
+    int64_t min_idle_us,
+    std::vector<esp_http_client_handle_t>* closing) {
+  for (size_t i = 0; i < kMaxPooledConnections; i++) {
+    Connection* c = &pool()[i];
+    if (c->in_use || !c->handle || c->idle_closed ||
+        now - c->idle_since_us < min_idle_us) {
+      continue;
+    }
+    if (c->has_session) {
+      // Free the connection's TLS buffers, but keep the handle and its
+      // session for the next connection to this origin.
+      esp_http_client_close(c->handle);
+      c->idle_closed = true;
+    } else {
+      closing->push_back(c->handle);
+      c->Reset();
+    }
+  }
+}
+
+// static
+HTTPClient::Connection* HTTPClient::AcquireConnection(const std::string& url) {
+  const std::string origin = GetOrigin(url);
+  const int64_t now = esp_timer_get_time();
+  std::vector<esp_http_client_handle_t> closing;
+  Connection* connection = nullptr;
+  Connection* free_slot = nullptr;  // Empty, else least recently used.
+
+  if (xSemaphoreTake(PoolMutex(), portMAX_DELAY) != pdTRUE)
+    return nullptr;
+  SweepIdleConnections(now, kIdleTimeoutUsec, &closing);
+  for (size_t i = 0; i < kMaxPooledConnections; i++) {
+    Connection* c = &pool()[i];
+    if (c->in_use)
+      continue;
+    if (c->handle && c->origin == origin) {
+      connection = c;
+      break;
+    }
+    if (!free_slot || (free_slot->handle && !c->handle) ||
+        (free_slot->handle && c->idle_since_us < free_slot->idle_since_us)) {
+      free_slot = c;
+    }
+  }
+  if (!connection && free_slot) {
+    if (free_slot->handle) {
+      closing.push_back(free_slot->handle);
+      free_slot->Reset();
+    }
+    connection = free_slot;
+  }
+  if (connection) {
+    connection->in_use = true;
+    connection->idle_closed = false;
+  }
+  xSemaphoreGive(PoolMutex());
+
+  for (esp_http_client_handle_t handle : closing)
+    esp_http_client_cleanup(handle);
+
+  if (!connection) {
+    // Every pooled connection is making a request.
+    connection = new Connection();
+    connection->pooled = false;
+    connection->in_use = true;
+  }
+  if (!connection->handle) {
+    const esp_http_client_config_t config = CreateClientConfig(url, connection);
+    connection->handle = esp_http_client_init(&config);
+    if (!connection->handle) {
+      ReleaseConnection(connection, /*keep=*/false);
+      return nullptr;
+    }
+    connection->origin = origin;
+  }
+  return connection;
+}
+
+// static
+void HTTPClient::ReleaseConnection(Connection* connection, bool keep) {
+  connection->client = nullptr;
+  if (!keep && connection->has_session && connection->pooled) {
+    // Reconnect on this handle next time, to resume its TLS session.
+    esp_http_client_close(connection->handle);
+    keep = true;
+  }
+  if (!connection->pooled) {
+    if (connection->handle)
+      esp_http_client_cleanup(connection->handle);
+    delete connection;
+    return;
+  }
+
+  esp_http_client_handle_t closing = nullptr;
+  if (xSemaphoreTake(PoolMutex(), portMAX_DELAY) != pdTRUE)
+    return;
+  if (!keep) {
+    closing = connection->handle;
+    connection->Reset();
+  }
+  connection->idle_since_us = esp_timer_get_time();
+  connection->in_use = false;
+  xSemaphoreGive(PoolMutex());
+
+  if (closing)
+    esp_http_client_cleanup(closing);
+}
+
 // static
 esp_err_t HTTPClient::EventHandler(esp_http_client_event_t* evt) {
-  HTTPClient* client = static_cast<HTTPClient*>(evt->user_data);
+  HTTPClient* client = static_cast<Connection*>(evt->user_data)->client;
+  if (!client)
+    return ESP_OK;  // Not making a request, e.g. closing.
+
+  client->HandleEvent(evt);
+  if (evt->event_id == HTTP_EVENT_ON_DATA) {
+    ESP_LOGV(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
+    if (client->data_callback_)
+      return client->data_callback_(evt->data, evt->data_len);
+  }
+  return ESP_OK;
+}
 
+void HTTPClient::HandleEvent(const esp_http_client_event_t* evt) {
+  const int64_t now = esp_timer_get_time();
   switch (evt->event_id) {
-    case HTTP_EVENT_ERROR:
-      break;
     case HTTP_EVENT_ON_CONNECTED:
+      connected_us_ = now;
+      break;
+    case HTTP_EVENT_HEADER_SENT:
+      header_sent_us_ = now;
       break;
+    case HTTP_EVENT_ON_HEADER:
+      if (!strcasecmp(evt->header_key, "Retry-After"))
+        retry_after_secs_ = strtoul(evt->header_value, nullptr, 10);
+      else if (!strcasecmp(evt->header_key, "Content-Type"))
+        content_type_ = evt->header_value;
+      // fallthrough
     case HTTP_EVENT_ON_DATA:
-      ESP_LOGV(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-      if (client->data_callback_)
-        return client->data_callback_(evt->data, evt->data_len);
+      got_response_ = true;
+      if (!first_header_us_)
+        first_header_us_ = now;
       break;
     default:
       // fallthrough
       break;
   }
-  return ESP_OK;
 }
 
 HTTPClient::HTTPClient() = default;
@@ -84,29 +358,8 @@ esp_err_t HTTPClient::DoGET(const std::string& url,
                             const std::vector<HeaderValue>& header_values,
                             DataCallback data_callback,
                             int* status_code) {
-  const esp_http_client_config_t config =
-      CreateClientConfig(url, HTTP_METHOD_GET);
-  esp_http_client_handle_t client = esp_http_client_init(&config);
-  if (!client)
-    return ESP_FAIL;
-  esp_err_t err = ESP_OK;
-  for (const auto& value : header_values) {
-    err = esp_http_client_set_header(client, value.first.c_str(),
-                                     value.second.c_str());
-    if (err != ESP_OK)
-      goto exit;
-  }
-  data_callback_ = data_callback;
-  err = esp_http_client_perform(client);
-  data_callback_ = nullptr;
-
-exit:
-  if (err == ESP_OK)
-    *status_code = esp_http_client_get_status_code(client);
-  esp_err_t e = esp_http_client_cleanup(client);
-  if (err == ESP_OK)
-    err = e;
-  return err;
+  return Perform(url, HTTP_METHOD_GET, /*content=*/nullptr, header_values,
+                 std::move(data_callback), status_code);
 }
 
 esp_err_t HTTPClient::DoPOST(const std::string& url,
@@ -114,29 +367,112 @@ esp_err_t HTTPClient::DoPOST(const std::string& url,
                              const std::vector<HeaderValue>& header_values,
                              DataCallback data_callback,
                              int* status_code) {
-  data_callback_ = data_callback;
-  const esp_http_client_config_t config =
-      CreateClientConfig(url, HTTP_METHOD_POST);
-  esp_http_client_handle_t client = esp_http_client_init(&config);
-  if (!client)
-    return ESP_FAIL;
-  esp_err_t err = ESP_OK;
+  return Perform(url, HTTP_METHOD_POST, &content, header_values,
+                 std::move(data_callback), status_code);
+}
+
+esp_err_t HTTPClient::Perform(const std::string& url,
+                              esp_http_client_method_t method,
+                              const std::string* content,
+                              const std::vector<HeaderValue>& header_values,
+                              DataCallback data_callback,
+                              int* status_code) {
+  timing_ = {};
+  const int64_t start_us = esp_timer_get_time();
+  esp_err_t err = ESP_FAIL;
+  for (int attempt = 0; attempt < kMaxAttempts; attempt++) {
+    Connection* connection = AcquireConnection(url);
+    if (!connection)
+      return ESP_ERR_NO_MEM;
+    connection->client = this;
+    data_callback_ = data_callback;
+    err = PerformOnce(connection, url, method, content, header_values);
+    data_callback_ = nullptr;
+    if (err == ESP_OK)
+      *status_code = esp_http_client_get_status_code(connection->handle);
+    // A connection the server closed while idle fails without connecting or
+    // receiving anything, so nothing was delivered to |data_callback|.
+    const bool stale = err != ESP_OK && connection->used && !connected_us_ &&
+                       !got_response_;
+    connection->used = true;
+    ReleaseConnection(connection, /*keep=*/err == ESP_OK);
+    if (!stale)
+      break;
+    ESP_LOGD(TAG, "Reused connection failed (%s), reconnecting.",
+             esp_err_to_name(err));
+    timing_.retries++;
+  }
+  timing_.total_us = esp_timer_get_time() - start_us;
+
+  ESP_LOGI(TAG,
+           "%s %s: %s, connect %lld, ttfb %lld, body %lld, total %lld usec.",
+           MethodName(method), url.c_str(),
+           timing_.reused ? "reused" : timing_.resumed ? "resumed" : "new",
+           timing_.connect_us,
+           timing_.ttfb_us, timing_.body_us, timing_.total_us);
+  return err;
+}
+
+esp_err_t HTTPClient::PerformOnce(
+    Connection* connection,
+    const std::string& url,
+    esp_http_client_method_t method,
+    const std::string* content,
+    const std::vector<HeaderValue>& header_values) {
+  esp_http_client_handle_t handle = connection->handle;
+  // Same origin, so the connection is kept open.
+  esp_err_t err = esp_http_client_set_url(handle, url.c_str());
+  if (err != ESP_OK)
+    return err;
+  err = esp_http_client_set_method(handle, method);
+  if (err != ESP_OK)
+    return err;
+
+  // Headers persist on the handle, remove the previous request's.
+  for (const std::string& name : connection->header_names)
+    esp_http_client_delete_header(handle, name.c_str());
+  connection->header_names.clear();
   for (const auto& value : header_values) {
-    err = esp_http_client_set_header(client, value.first.c_str(),
+    err = esp_http_client_set_header(handle, value.first.c_str(),
                                      value.second.c_str());
     if (err != ESP_OK)
-      goto exit;
+      return err;
+    connection->header_names.push_back(value.first);
+  }
+  if (content) {
+    err = esp_http_client_set_post_field(handle, content->data(),
+                                         content->length());
+  } else {
+    err = esp_http_client_set_post_field(handle, nullptr, 0);
   }
-  err =
-      esp_http_client_set_post_field(client, content.data(), content.length());
   if (err != ESP_OK)
-    goto exit;
-  err = esp_http_client_perform(client);
-
-exit:
-  data_callback_ = nullptr;
-  esp_http_client_cleanup(client);
-  if (err == ESP_OK)
-    *status_code = esp_http_client_get_status_code(client);
+    return err;
+
+  const bool resuming = connection->has_session;
+  connected_us_ = 0;
+  header_sent_us_ = 0;
+  first_header_us_ = 0;
+  got_response_ = false;
+  retry_after_secs_ = 0;
+  content_type_.clear();
+  const int64_t start_us = esp_timer_get_time();
+  err = esp_http_client_perform(handle);
+  const int64_t end_us = esp_timer_get_time();
+
+  timing_.reused = !connected_us_;
+  timing_.resumed = connected_us_ && resuming;
+  timing_.connect_us = connected_us_ ? connected_us_ - start_us : 0;
+  if (connected_us_ && connection->origin.compare(0, 8, "https://") == 0) {
+    RecordConnect(resuming, timing_.connect_us);
+    connection->has_session = kTLSSessionCache;
+  }
+  if (first_header_us_) {
+    timing_.ttfb_us =
+        first_header_us_ - (header_sent_us_ ? header_sent_us_ : start_us);
+    timing_.body_us = end_us - first_header_us_;
+  } else {
+    timing_.ttfb_us = 0;
+    timing_.body_us = 0;
+  }
   return err;
 }
@@ -8,11 +8,46 @@
 #include <esp_err.h>
 #include <esp_http_client/include/esp_http_client.h>
 
+/**
+ * Makes HTTP(S) requests over a small shared pool of persistent connections.
+ *
+ * A connection is kept open after a request and reused by the next request
+ * (from any HTTPClient) to the same scheme, host and port, saving the TCP and
+ * TLS handshakes. Connections idle for kIdleTimeoutUsec are closed by the
+ * next request, or by CloseIdleConnections(), which the application calls
+ * periodically so idle TLS buffers are freed without further requests. A
+ * request which fails on a reused connection, before any response, is
+ * retried once on a new connection as the server may have closed it
+ * meanwhile.
+ *
+ * When a closed connection is reopened its last TLS session (ticket or ID)
+ * is offered to the server, which can then resume it with an abbreviated
+ * handshake. Sessions are only held in RAM, one per pooled origin.
+ *
+ * @note Each HTTPClient makes one request at a time, separate instances may
+ *       be used concurrently.
+ */
 class HTTPClient {
  public:
   using HeaderValue = std::pair<std::string, std::string>;
   using DataCallback = std::function<esp_err_t(const void*, int)>;
 
+  /**
+   * Duration of each phase of a request, in microseconds. Phases which did
+   * not happen (such as connecting on a reused connection) are zero.
+   */
+  struct Timing {
+    bool reused = false;     // Sent on an already open connection.
+    bool resumed = false;    // Connected offering a cached TLS session.
+    int retries = 0;         // Retries after a reused connection failed.
+    int64_t connect_us = 0;  // DNS lookup, TCP and TLS handshakes.
+    int64_t ttfb_us = 0;     // Request sent to first response header.
+    int64_t body_us = 0;     // First response header to end of response.
+    int64_t total_us = 0;    // Including any retry.
+  };
+
+  static constexpr int64_t kIdleTimeoutUsec = 30 * 1000 * 1000;
+
   HTTPClient();
   ~HTTPClient();
 
@@ -29,11 +64,70 @@ class HTTPClient {
 
   esp_err_t DoSSLCheck();
 
+  /**
+   * Timing of the last request.
+   */
+  const Timing& timing() const { return timing_; }
+
+  /**
+   * The Retry-After (in seconds) of the last response, or zero if it had
+   * none. HTTP-date values are not supported.
+   */
+  uint32_t retry_after_secs() const { return retry_after_secs_; }
+
+  /**
+   * The Content-Type of the last response, empty if it had none.
+   */
+  const std::string& content_type() const { return content_type_; }
+
+  /**
+   * Close pooled connections idle for at least |min_idle_us|, freeing their
+   * buffers. TLS sessions are kept to resume when reconnecting.
+   */
+  static void CloseIdleConnections(int64_t min_idle_us = kIdleTimeoutUsec);
+
+  /**
+   * Close every pooled connection, forgetting their TLS sessions, and reset
+   * the connect statistics. Only for tests, with no request in progress.
+   */
+  static void ResetPoolForTesting();
+
  private:
+  struct Connection;
+
+  static Connection* pool();
   static esp_err_t EventHandler(esp_http_client_event_t* evt);
+  static esp_http_client_config_t CreateClientConfig(const std::string& url,
+                                                     Connection* connection);
+  // Closes connections as CloseIdleConnections(), adding the handles to
+  // clean up (outside of PoolMutex()) to |closing|. Call holding the mutex.
+  static void SweepIdleConnections(
+      int64_t now,
+      int64_t min_idle_us,
+      std::vector<esp_http_client_handle_t>* closing);
+  static Connection* AcquireConnection(const std::string& url);
+  static void ReleaseConnection(Connection* connection, bool keep);
 
-  esp_http_client_config_t CreateClientConfig(const std::string& url,
-                                              esp_http_client_method_t method);
+  esp_err_t Perform(const std::string& url,
+                    esp_http_client_method_t method,
+                    const std::string* content,
+                    const std::vector<HeaderValue>& header_values,
+                    DataCallback data_callback,
+                    int* status_code);
+  esp_err_t PerformOnce(Connection* connection,
+                        const std::string& url,
+                        esp_http_client_method_t method,
+                        const std::string* content,
+                        const std::vector<HeaderValue>& header_values);
+  void HandleEvent(const esp_http_client_event_t* evt);
 
   DataCallback data_callback_;
+  Timing timing_;
+  // Event times (esp_timer_get_time()) of the current attempt.
+  int64_t connected_us_ = 0;
+  int64_t header_sent_us_ = 0;
+  int64_t first_header_us_ = 0;
+  bool got_response_ = false;  // Any response header or data received.
+  uint32_t retry_after_secs_ = 0;
+  std::string content_type_;
 };
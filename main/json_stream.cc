@@ -0,0 +1,298 @@
+#include "json_stream.h"
+
+#include <cstring>
+
+namespace {
+
+// Longer numbers aren't valid for any value we parse.
+constexpr size_t kMaxLiteralLen = 32;
+
+constexpr uint32_t kReplacementChar = 0xfffd;
+
+bool IsWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool IsNumber(const std::string& text) {
+  if (text.empty() || (text[0] != '-' && (text[0] < '0' || text[0] > '9')))
+    return false;
+  for (char c : text) {
+    if ((c < '0' || c > '9') && !strchr("+-.eE", c))
+      return false;
+  }
+  return true;
+}
+
+void AppendUTF8(uint32_t code_point, std::string* out) {
+  if (code_point < 0x80) {
+    *out += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    *out += static_cast<char>(0xc0 | (code_point >> 6));
+    *out += static_cast<char>(0x80 | (code_point & 0x3f));
+  } else if (code_point < 0x10000) {
+    *out += static_cast<char>(0xe0 | (code_point >> 12));
+    *out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    *out += static_cast<char>(0x80 | (code_point & 0x3f));
+  } else {
+    *out += static_cast<char>(0xf0 | (code_point >> 18));
+    *out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+    *out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    *out += static_cast<char>(0x80 | (code_point & 0x3f));
+  }
+}
+
+}  // namespace
+
+JSONStream::JSONStream(JSONStreamClient* client) : client_(client) {}
+
+esp_err_t JSONStream::Feed(const char* data, size_t len) {
+  for (size_t i = 0; i < len && err_ == ESP_OK; i++)
+    err_ = Parse(data[i]);
+  return err_;
+}
+
+esp_err_t JSONStream::Finish() const {
+  if (err_ != ESP_OK)
+    return err_;
+  return state_ == State::Done ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t JSONStream::Parse(char c) {
+  switch (state_) {
+    case State::Value:
+      if (IsWhitespace(c))
+        return ESP_OK;
+      return StartValue(c);
+    case State::ValueOrEnd:
+      if (IsWhitespace(c))
+        return ESP_OK;
+      if (c == ']')
+        return EndContainer(/*is_array=*/true);
+      return StartValue(c);
+    case State::KeyOrEnd:
+      if (c == '}')
+        return EndContainer(/*is_array=*/false);
+      // fallthrough
+    case State::Key:
+      if (IsWhitespace(c))
+        return ESP_OK;
+      if (c != '"')
+        return ESP_FAIL;
+      path_.resize(containers_[depth_ - 1].path_len);
+      if (!path_.empty())
+        path_ += '.';
+      high_surrogate_ = 0;
+      state_ = State::KeyString;
+      return ESP_OK;
+    case State::KeyString:
+      if (c == '"' && !escape_ && unicode_digits_ < 0) {
+        state_ = State::Colon;
+        return ESP_OK;
+      }
+      return ParseStringChar(c, &path_);
+    case State::Colon:
+      if (IsWhitespace(c))
+        return ESP_OK;
+      if (c != ':')
+        return ESP_FAIL;
+      state_ = State::Value;
+      return ESP_OK;
+    case State::AfterValue: {
+      if (IsWhitespace(c))
+        return ESP_OK;
+      const Container& container = containers_[depth_ - 1];
+      if (c == ',') {
+        if (container.is_array) {
+          path_.resize(container.path_len + 2);  // "[]"
+          state_ = State::Value;
+        } else {
+          state_ = State::Key;
+        }
+        return ESP_OK;
+      }
+      if (c == ']' || c == '}')
+        return EndContainer(c == ']');
+      return ESP_FAIL;
+    }
+    case State::String:
+      if (c == '"' && !escape_ && unicode_digits_ < 0) {
+        if (want_string_) {
+          if (high_surrogate_)
+            AppendUTF8(kReplacementChar, &value_);
+          client_->OnValue(path_, JSONStreamClient::ValueType::String, value_);
+        }
+        ValueDone();
+        return ESP_OK;
+      }
+      return ParseStringChar(c, want_string_ ? &value_ : nullptr);
+    case State::Literal:
+      if (IsWhitespace(c) || c == ',' || c == ']' || c == '}') {
+        const esp_err_t err = EndLiteral();
+        if (err != ESP_OK)
+          return err;
+        return Parse(c);
+      }
+      if (value_.size() == kMaxLiteralLen)
+        return ESP_ERR_INVALID_SIZE;
+      value_ += c;
+      return ESP_OK;
+    case State::Done:
+      return IsWhitespace(c) ? ESP_OK : ESP_FAIL;
+  }
+  return ESP_FAIL;
+}
+
+esp_err_t JSONStream::ParseStringChar(char c, std::string* out) {
+  if (unicode_digits_ >= 0) {
+    const int digit = HexValue(c);
+    if (digit < 0)
+      return ESP_FAIL;
+    unicode_ = (unicode_ << 4) | digit;
+    if (--unicode_digits_ > 0)
+      return ESP_OK;
+    unicode_digits_ = -1;
+    if (!out)
+      return ESP_OK;
+    if (unicode_ >= 0xd800 && unicode_ < 0xdc00) {
+      if (high_surrogate_)
+        AppendUTF8(kReplacementChar, out);
+      high_surrogate_ = unicode_;
+    } else if (unicode_ >= 0xdc00 && unicode_ < 0xe000) {
+      uint32_t code_point = kReplacementChar;
+      if (high_surrogate_) {
+        code_point =
+            0x10000 + ((high_surrogate_ - 0xd800) << 10) + (unicode_ - 0xdc00);
+      }
+      AppendUTF8(code_point, out);
+      high_surrogate_ = 0;
+    } else {
+      if (high_surrogate_)
+        AppendUTF8(kReplacementChar, out);
+      high_surrogate_ = 0;
+      AppendUTF8(unicode_, out);
+    }
+    return ESP_OK;
+  }
+
+  if (escape_) {
+    escape_ = false;
+    if (c == 'u') {
+      unicode_digits_ = 4;
+      unicode_ = 0;
+      return ESP_OK;
+    }
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        break;
+      case 'b':
+        c = '\b';
+        break;
+      case 'f':
+        c = '\f';
+        break;
+      case 'n':
+        c = '\n';
+        break;
+      case 'r':
+        c = '\r';
+        break;
+      case 't':
+        c = '\t';
+        break;
+      default:
+        return ESP_FAIL;
+    }
+  } else if (c == '\\') {
+    escape_ = true;
+    return ESP_OK;
+  } else if (static_cast<unsigned char>(c) < 0x20) {
+    return ESP_FAIL;  // Control characters must be escaped.
+  }
+
+  if (out) {
+    if (high_surrogate_)
+      AppendUTF8(kReplacementChar, out);
+    high_surrogate_ = 0;
+    *out += c;
+  }
+  return ESP_OK;
+}
+
+esp_err_t JSONStream::StartValue(char c) {
+  switch (c) {
+    case '{':
+      return StartContainer(/*is_array=*/false);
+    case '[':
+      return StartContainer(/*is_array=*/true);
+    case '"':
+      want_string_ = client_->WantString(path_);
+      value_.clear();
+      high_surrogate_ = 0;
+      state_ = State::String;
+      return ESP_OK;
+    default:
+      if (c != '-' && (c < '0' || c > '9') && c != 't' && c != 'f' &&
+          c != 'n') {
+        return ESP_FAIL;
+      }
+      value_.assign(1, c);
+      state_ = State::Literal;
+      return ESP_OK;
+  }
+}
+
+esp_err_t JSONStream::StartContainer(bool is_array) {
+  if (depth_ == kMaxDepth)
+    return ESP_ERR_INVALID_SIZE;
+  containers_[depth_++] = {is_array, static_cast<uint16_t>(path_.size())};
+  if (is_array) {
+    path_ += "[]";
+    state_ = State::ValueOrEnd;
+  } else {
+    state_ = State::KeyOrEnd;
+  }
+  return ESP_OK;
+}
+
+esp_err_t JSONStream::EndContainer(bool is_array) {
+  const Container& container = containers_[depth_ - 1];
+  if (container.is_array != is_array)
+    return ESP_FAIL;
+  depth_--;
+  path_.resize(container.path_len);
+  if (!is_array)
+    client_->OnObjectEnd(path_);
+  ValueDone();
+  return ESP_OK;
+}
+
+esp_err_t JSONStream::EndLiteral() {
+  JSONStreamClient::ValueType type;
+  if (value_ == "true" || value_ == "false")
+    type = JSONStreamClient::ValueType::Bool;
+  else if (value_ == "null")
+    type = JSONStreamClient::ValueType::Null;
+  else if (IsNumber(value_))
+    type = JSONStreamClient::ValueType::Number;
+  else
+    return ESP_FAIL;
+  client_->OnValue(path_, type, value_);
+  ValueDone();
+  return ESP_OK;
+}
+
+void JSONStream::ValueDone() {
+  state_ = depth_ ? State::AfterValue : State::Done;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <esp_err.h>
+
+/**
+ * Implemented to receive the values found by a JSONStream.
+ *
+ * Values are identified by their path from the root: object keys joined by
+ * '.', with "[]" for any array element. For example the "url" of each album
+ * image in:
+ *
+ *   {"item": {"album": {"images": [{"url": "..."}]}}}
+ *
+ * is at "item.album.images[].url".
+ */
+class JSONStreamClient {
+ public:
+  enum class ValueType {
+    String,
+    Number,
+    Bool,
+    Null,
+  };
+
+  /**
+   * Is the string value at |path| wanted? Strings which aren't are skipped
+   * without being stored.
+   */
+  virtual bool WantString(const std::string& path) = 0;
+
+  /**
+   * A scalar value, or a wanted string, was parsed.
+   *
+   * @param text The decoded string, or the literal text of a number, "true",
+   *             "false", or "null".
+   */
+  virtual void OnValue(const std::string& path,
+                       ValueType type,
+                       const std::string& text) = 0;
+
+  /**
+   * The object at |path| ended.
+   */
+  virtual void OnObjectEnd(const std::string& path) = 0;
+
+ protected:
+  JSONStreamClient() = default;
+  ~JSONStreamClient() = default;
+};
+
+/**
+ * Incremental JSON parser, fed a document in chunks of any size.
+ *
+ * No document tree is built. Only the current path, wanted strings and
+ * literals are held, so memory use does not grow with the document.
+ */
+class JSONStream {
+ public:
+  static constexpr size_t kMaxDepth = 16;
+
+  explicit JSONStream(JSONStreamClient* client);
+
+  /**
+   * Parse the next |len| bytes of the document.
+   *
+   * After an error all further input is ignored.
+   */
+  esp_err_t Feed(const char* data, size_t len);
+
+  /**
+   * Check the document is complete.
+   *
+   * @return ESP_OK if a complete value was parsed, ESP_ERR_INVALID_SIZE if
+   *         the document ended early, else the parse error.
+   */
+  esp_err_t Finish() const;
+
+ private:
+  enum class State {
+    Value,          // Expecting a value.
+    ValueOrEnd,     // After '[', expecting a value or ']'.
+    KeyOrEnd,       // After '{', expecting a key or '}'.
+    Key,            // Expecting a key after ','.
+    KeyString,      // In a key.
+    Colon,          // After a key.
+    AfterValue,     // Expecting ',' or the end of the container.
+    String,         // In a string value.
+    Literal,        // In a number, true, false or null.
+    Done,           // Top level value parsed.
+  };
+
+  struct Container {
+    bool is_array;
+    uint16_t path_len;  // Length of the container's own path.
+  };
+
+  esp_err_t Parse(char c);
+  esp_err_t ParseStringChar(char c, std::string* out);
+  esp_err_t StartValue(char c);
+  esp_err_t StartContainer(bool is_array);
+  esp_err_t EndContainer(bool is_array);
+  esp_err_t EndLiteral();
+  void ValueDone();
+
+  JSONStreamClient* client_;
+  State state_ = State::Value;
+  esp_err_t err_ = ESP_OK;
+  std::string path_;   // Path of the current value.
+  std::string value_;  // Current wanted string value, or literal.
+  bool want_string_ = false;
+  bool escape_ = false;          // Previous string character was '\'.
+  int8_t unicode_digits_ = -1;   // \u hex digits still to come, if >= 0.
+  uint32_t unicode_ = 0;         // The \u code unit so far.
+  uint32_t high_surrogate_ = 0;  // Waiting for the low half of a pair.
+  Container containers_[kMaxDepth];
+  size_t depth_ = 0;
+};
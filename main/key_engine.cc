@@ -0,0 +1,177 @@
+#include "key_engine.h"
+
+#include <algorithm>
+
+#include <class/hid/hid.h>
+
+namespace {
+
+bool IsModifier(uint8_t keycode) {
+  return keycode >= HID_KEY_CONTROL_LEFT && keycode <= HID_KEY_GUI_RIGHT;
+}
+
+uint8_t GetOneShotFlag(uint8_t code) {
+  return 1u << (code - Keymap::kKeyOneShotBase);
+}
+
+}  // namespace
+
+KeyEngine::KeyEngine(KeyActionClient* client)
+    : client_(client), timer_wheel_(kTimerTickUsec) {
+  for (size_t i = 0; i < keys_.size(); i++)
+    keys_[i].timer.id = i;
+  one_shot_timer_.id = kOneShotTimerID;
+  Reset();
+}
+
+void KeyEngine::Reset() {
+  for (Key& key : keys_) {
+    timer_wheel_.Cancel(&key.timer);
+    key.code = HID_KEY_NONE;
+    key.hold = HID_KEY_NONE;
+    key.phase = Phase::Released;
+  }
+  timer_wheel_.Cancel(&one_shot_timer_);
+  pending_key_ = nullptr;
+  one_shot_held_ = 0;
+  one_shot_used_ = 0;
+  one_shot_armed_ = 0;
+  layer_held_.fill(0);
+  keymap_.SetActiveLayer(0);
+}
+
+void KeyEngine::HandleEvent(uint8_t event_id, bool pressed, int64_t time_us) {
+  Key& key = keys_[event_id % keys_.size()];
+
+  if (pressed) {
+    if (key.phase != Phase::Released)
+      return;
+    // Any other key going down decides a pending dual-role key.
+    if (pending_key_)
+      ResolveAsHold(pending_key_);
+
+    key.code = keymap_.Lookup(event_id);
+    key.hold = keymap_.LookupHold(event_id);
+    if (key.hold != HID_KEY_NONE) {
+      key.phase = Phase::Pending;
+      pending_key_ = &key;
+      timer_wheel_.Schedule(&key.timer, time_us + kTapTermUsec);
+      return;
+    }
+    key.phase = Phase::Pressed;
+    Press(key.code);
+    return;
+  }
+
+  // Release what the key was pressed as, the layer may have changed since.
+  switch (key.phase) {
+    case Phase::Released:
+      return;
+    case Phase::Pressed:
+      Release(key.code, time_us);
+      break;
+    case Phase::Pending:
+      timer_wheel_.Cancel(&key.timer);
+      pending_key_ = nullptr;
+      Press(key.code);
+      Release(key.code, time_us);
+      break;
+    case Phase::Held:
+      Release(key.hold, time_us);
+      break;
+  }
+  key.phase = Phase::Released;
+}
+
+void KeyEngine::HandleTimers(int64_t now_us) {
+  timer_wheel_.Advance(now_us,
+                       [this](TimerWheel::Timer* timer) { OnTimer(timer); });
+}
+
+void KeyEngine::OnTimer(TimerWheel::Timer* timer) {
+  if (timer->id == kOneShotTimerID) {
+    ReleaseOneShots();
+    return;
+  }
+  Key& key = keys_[timer->id];
+  if (key.phase == Phase::Pending)
+    ResolveAsHold(&key);
+}
+
+void KeyEngine::ResolveAsHold(Key* key) {
+  timer_wheel_.Cancel(&key->timer);
+  pending_key_ = nullptr;
+  key->phase = Phase::Held;
+  Press(key->hold);
+}
+
+void KeyEngine::Press(uint8_t code) {
+  if (code == HID_KEY_NONE)
+    return;
+  if (Keymap::IsLayerKey(code)) {
+    layer_held_[Keymap::GetLayer(code)]++;
+    UpdateActiveLayer();
+    return;
+  }
+  if (Keymap::IsOneShotKey(code)) {
+    one_shot_held_ |= GetOneShotFlag(code);
+    client_->KeyAction(Keymap::GetOneShotModifier(code), true);
+    return;
+  }
+
+  client_->KeyAction(code, true);
+  if (IsModifier(code))
+    return;
+  one_shot_used_ |= one_shot_held_;
+  ReleaseOneShots();
+}
+
+void KeyEngine::Release(uint8_t code, int64_t time_us) {
+  if (code == HID_KEY_NONE)
+    return;
+  if (Keymap::IsLayerKey(code)) {
+    uint8_t& held = layer_held_[Keymap::GetLayer(code)];
+    if (held)
+      held--;
+    UpdateActiveLayer();
+    return;
+  }
+  if (Keymap::IsOneShotKey(code)) {
+    const uint8_t flag = GetOneShotFlag(code);
+    one_shot_held_ &= ~flag;
+    if (one_shot_used_ & flag) {
+      one_shot_used_ &= ~flag;
+      client_->KeyAction(Keymap::GetOneShotModifier(code), false);
+    } else {
+      // Keep the modifier pressed for the next key.
+      one_shot_armed_ |= flag;
+      timer_wheel_.Schedule(&one_shot_timer_, time_us + kOneShotTimeoutUsec);
+    }
+    return;
+  }
+
+  client_->KeyAction(code, false);
+}
+
+void KeyEngine::UpdateActiveLayer() {
+  // The highest held layer wins, the base layer if none are held.
+  uint8_t layer = std::min<size_t>(keymap_.num_layers(), layer_held_.size());
+  while (layer > 1 && !layer_held_[layer - 1])
+    layer--;
+  keymap_.SetActiveLayer(layer ? layer - 1 : 0);
+}
+
+void KeyEngine::ReleaseOneShots() {
+  if (!one_shot_armed_)
+    return;
+  timer_wheel_.Cancel(&one_shot_timer_);
+  // Those held again are released with the key instead.
+  const uint8_t release = one_shot_armed_ & ~one_shot_held_;
+  for (uint8_t i = 0; i < 8; i++) {
+    if (release & (1u << i)) {
+      client_->KeyAction(
+          Keymap::GetOneShotModifier(Keymap::kKeyOneShotBase + i), false);
+    }
+  }
+  one_shot_armed_ = 0;
+}
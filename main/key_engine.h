@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "keymap.h"
+#include "timer_wheel.h"
+
+/**
+ * Clients of KeyEngine implement this interface to receive the resolved
+ * HID key transitions.
+ */
+class KeyActionClient {
+ public:
+  /**
+   * Called when HID keycode |keycode| is pressed or released.
+   */
+  virtual void KeyAction(uint8_t keycode, bool pressed) = 0;
+
+ protected:
+  KeyActionClient() = default;
+  ~KeyActionClient() = default;
+};
+
+/**
+ * Turns keyboard IC key events into HID key transitions.
+ *
+ * In addition to keymap lookup and layer switching this resolves:
+ *
+ * Dual-role keys: a key with a hold code is pending when pressed. It is a
+ * tap (press and release of the layer code) if released within kTapTermUsec,
+ * and held (acting as the hold code) if that time passes or another key is
+ * pressed first. As any key press resolves a pending key at most one key is
+ * ever pending.
+ *
+ * Layer keys: while any are held the highest held layer is active, so
+ * releasing one layer key returns to the layer of any still held.
+ *
+ * One-shot modifiers: tapping one applies the modifier to the next non-
+ * modifier key press only. Held while another key is pressed it acts as a
+ * normal modifier. An unused one-shot modifier is released after
+ * kOneShotTimeoutUsec.
+ *
+ * All timeouts share a single TimerWheel, and each event does a bounded
+ * amount of work independent of the number of keys held.
+ */
+class KeyEngine {
+ public:
+  static constexpr uint32_t kTimerTickUsec = 10 * 1000;
+  static constexpr int64_t kTapTermUsec = 200 * 1000;
+  static constexpr int64_t kOneShotTimeoutUsec = 1000 * 1000;
+
+  explicit KeyEngine(KeyActionClient* client);
+
+  /**
+   * Handle a single key event from the keyboard IC.
+   *
+   * @param time_us esp_timer_get_time() of the event.
+   */
+  void HandleEvent(uint8_t event_id, bool pressed, int64_t time_us);
+
+  /**
+   * Expire all timeouts due at or before |now_us|.
+   *
+   * Must be called periodically, every kTimerTickUsec, while
+   * timers_pending() is true.
+   */
+  void HandleTimers(int64_t now_us);
+
+  /**
+   * Forget all key state without sending any key transitions.
+   */
+  void Reset();
+
+  bool timers_pending() const { return !timer_wheel_.empty(); }
+
+  Keymap& keymap() { return keymap_; }
+
+ private:
+  // Timer ID of |one_shot_timer_|, key timer IDs are event IDs.
+  static constexpr uint8_t kOneShotTimerID = 0xFF;
+
+  enum class Phase : uint8_t {
+    Released,
+    Pressed,  // Sending |code|.
+    Pending,  // Dual-role key, not yet resolved.
+    Held,     // Dual-role key, sending |hold|.
+  };
+
+  struct Key {
+    TimerWheel::Timer timer;  // Tap term of a pending dual-role key.
+    uint8_t code;             // Code when pressed, tap code if dual-role.
+    uint8_t hold;             // Hold code if dual-role.
+    Phase phase;
+  };
+
+  void Press(uint8_t code);
+  void Release(uint8_t code, int64_t time_us);
+  void ResolveAsHold(Key* key);
+  void UpdateActiveLayer();
+  void ReleaseOneShots();
+  void OnTimer(TimerWheel::Timer* timer);
+
+  KeyActionClient* client_;
+  Keymap keymap_;
+  TimerWheel timer_wheel_;
+  std::array<Key, Keymap::kNumEvents> keys_;
+  Key* pending_key_;                  // The unresolved dual-role key.
+  TimerWheel::Timer one_shot_timer_;  // Timeout of armed one-shot keys.
+  // Masks of one-shot keys, bit N is code Keymap::kKeyOneShotBase + N.
+  uint8_t one_shot_held_;   // Physically held.
+  uint8_t one_shot_used_;   // Held while another key was pressed.
+  uint8_t one_shot_armed_;  // Tapped, waiting for the next key press.
+  // Number of keys holding each layer active.
+  std::array<uint8_t, Keymap::kMaxLayers> layer_held_;
+};
@@ -0,0 +1,82 @@
+#include "key_state.h"
+
+#include <class/hid/hid.h>
+
+namespace {
+
+bool IsModifier(uint8_t keycode) {
+  return keycode >= HID_KEY_CONTROL_LEFT && keycode <= HID_KEY_GUI_RIGHT;
+}
+
+// HID_KEY_CONTROL_LEFT..HID_KEY_GUI_RIGHT are in the same order as the
+// KEYBOARD_MODIFIER_* bits, so the modifier flag is a shift away.
+uint8_t GetModifierFlag(uint8_t keycode) {
+  return 1u << (keycode - HID_KEY_CONTROL_LEFT);
+}
+
+static_assert(HID_KEY_GUI_RIGHT - HID_KEY_CONTROL_LEFT == 7);
+static_assert(KEYBOARD_MODIFIER_LEFTCTRL == 1u << 0);
+static_assert(KEYBOARD_MODIFIER_RIGHTGUI == 1u << 7);
+
+}  // namespace
+
+KeyState::KeyState() : keys_({0}), modifiers_(0) {}
+
+bool KeyState::operator==(const KeyState& other) const {
+  return modifiers_ == other.modifiers_ && keys_ == other.keys_;
+}
+
+void KeyState::Clear() {
+  keys_.fill(0);
+  modifiers_ = 0;
+}
+
+bool KeyState::Set(uint8_t keycode, bool pressed) {
+  if (IsModifier(keycode)) {
+    const uint8_t prev = modifiers_;
+    if (pressed)
+      modifiers_ |= GetModifierFlag(keycode);
+    else
+      modifiers_ &= ~GetModifierFlag(keycode);
+    return modifiers_ != prev;
+  }
+
+  uint32_t& word = keys_[keycode / kBitsPerWord];
+  const uint32_t prev = word;
+  const uint32_t mask = 1u << (keycode % kBitsPerWord);
+  if (pressed)
+    word |= mask;
+  else
+    word &= ~mask;
+  return word != prev;
+}
+
+bool KeyState::IsPressed(uint8_t keycode) const {
+  if (IsModifier(keycode))
+    return modifiers_ & GetModifierFlag(keycode);
+  return keys_[keycode / kBitsPerWord] & (1u << (keycode % kBitsPerWord));
+}
+
+void KeyState::Merge(const KeyState& other) {
+  for (size_t w = 0; w < kNumWords; w++)
+    keys_[w] |= other.keys_[w];
+  modifiers_ |= other.modifiers_;
+}
+
+size_t KeyState::GetKeyCodes(uint8_t* keycodes, size_t max_keycodes) const {
+  size_t num_pressed = 0;
+  for (size_t w = 0; w < kNumWords; w++) {
+    uint32_t word = keys_[w];
+    while (word) {
+      if (num_pressed < max_keycodes) {
+        const uint32_t bit = __builtin_ctz(word);
+        keycodes[num_pressed] = w * kBitsPerWord + bit;
+      }
+      num_pressed++;
+      word &= word - 1;  // Clear lowest set bit.
+    }
+  }
+  for (size_t i = num_pressed; i < max_keycodes; i++)
+    keycodes[i] = HID_KEY_NONE;
+  return num_pressed;
+}
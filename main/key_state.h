@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Packed pressed/released state of every HID keycode.
+ *
+ * Non-modifier keys are held in a 256-bit bitmap indexed by HID keycode.
+ * Modifier keys (HID_KEY_CONTROL_LEFT..HID_KEY_GUI_RIGHT) are held separately
+ * in a KEYBOARD_MODIFIER_* mask, which is the form the HID report uses.
+ */
+class KeyState {
+ public:
+  static constexpr size_t kNumKeyCodes = 256;
+  static constexpr size_t kBitsPerWord = 32;
+  static constexpr size_t kNumWords = kNumKeyCodes / kBitsPerWord;
+
+  KeyState();
+
+  bool operator==(const KeyState& other) const;
+  bool operator!=(const KeyState& other) const { return !(*this == other); }
+
+  /**
+   * Release all keys.
+   */
+  void Clear();
+
+  /**
+   * Set the pressed state of a single key.
+   *
+   * @param keycode The TinyUSB HID_KEY_* keycode.
+   * @param pressed true if the key is depressed.
+   *
+   * @return true if the state changed.
+   */
+  bool Set(uint8_t keycode, bool pressed);
+
+  bool IsPressed(uint8_t keycode) const;
+
+  /**
+   * Press every key pressed in |other|.
+   */
+  void Merge(const KeyState& other);
+
+  /**
+   * Fill a boot protocol keycode array with the pressed non-modifier keys.
+   *
+   * @param keycodes Destination array, unused entries set to HID_KEY_NONE.
+   * @param max_keycodes Capacity of |keycodes|.
+   *
+   * @return The total number of pressed non-modifier keys, which may be
+   *         larger than |max_keycodes|.
+   */
+  size_t GetKeyCodes(uint8_t* keycodes, size_t max_keycodes) const;
+
+  // The KEYBOARD_MODIFIER_* mask of pressed modifier keys.
+  uint8_t modifiers() const { return modifiers_; }
+
+  // The non-modifier key bitmap, bit N of the bitmap is HID keycode N.
+  const std::array<uint32_t, kNumWords>& keys() const { return keys_; }
+
+ private:
+  std::array<uint32_t, kNumWords> keys_;
+  uint8_t modifiers_;
+};
@@ -6,17 +6,17 @@
 #include <utility>
 
 #define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
-#include <class/hid/hid.h>
 #include <esp_err.h>
 #include <esp_log.h>
 #include <esp_task_wdt.h>
+#include <esp_timer.h>
 #include <i2clib/address.h>
 #include <i2clib/master.h>
 #include <i2clib/operation.h>
 #include <kbdlib/adp5589.h>
 
 #include "gpio_pins.h"
-#include "usb_hid.h"
+#include "keystroke_latency.h"
 
 using kbd::adp5589::CoreFrequency;
 using kbd::adp5589::EventID;
@@ -26,151 +26,27 @@ namespace {
 constexpr char TAG[] = "Keyboard";
 constexpr uint8_t kSlaveAddress = 0x34;  // I2C address of ADP5589 IC.
 constexpr i2c::Address::Size kI2CAddressSize = i2c::Address::Size::bit7;
-// Table generated by genmap.py.
-constexpr std::array<uint8_t, 128> kEventID2KeyCode = {
-    HID_KEY_NONE,          // 0: NONE
-    HID_KEY_E,             // 1: R0_C0
-    HID_KEY_W,             // 2: R0_C1
-    HID_KEY_Q,             // 3: R0_C2
-    HID_KEY_SHIFT_LEFT,    // 4: R0_C3
-    HID_KEY_NONE,          // 5: R0_C4
-    HID_KEY_NONE,          // 6: R0_C5
-    HID_KEY_NONE,          // 7: R0_C6
-    HID_KEY_NONE,          // 8: R0_C7
-    HID_KEY_NONE,          // 9: R0_C8
-    HID_KEY_NONE,          // 10: R0_C9
-    HID_KEY_NONE,          // 11: R0_C10
-    HID_KEY_NONE,          // 12: R1_C0
-    HID_KEY_S,             // 13: R1_C1
-    HID_KEY_A,             // 14: R1_C2
-    HID_KEY_CONTROL_LEFT,  // 15: R1_C3
-    HID_KEY_NONE,          // 16: R1_C4
-    HID_KEY_NONE,          // 17: R1_C5
-    HID_KEY_NONE,          // 18: R1_C6
-    HID_KEY_NONE,          // 19: R1_C7
-    HID_KEY_NONE,          // 20: R1_C8
-    HID_KEY_NONE,          // 21: R1_C9
-    HID_KEY_NONE,          // 22: R1_C10
-    HID_KEY_NONE,          // 23: R2_C0
-    HID_KEY_NONE,          // 24: R2_C1
-    HID_KEY_NONE,          // 25: R2_C2
-    HID_KEY_NONE,          // 26: R2_C3
-    HID_KEY_NONE,          // 27: R2_C4
-    HID_KEY_NONE,          // 28: R2_C5
-    HID_KEY_NONE,          // 29: R2_C6
-    HID_KEY_NONE,          // 30: R2_C7
-    HID_KEY_NONE,          // 31: R2_C8
-    HID_KEY_NONE,          // 32: R2_C9
-    HID_KEY_NONE,          // 33: R2_C10
-    HID_KEY_NONE,          // 34: R3_C0
-    HID_KEY_NONE,          // 35: R3_C1
-    HID_KEY_NONE,          // 36: R3_C2
-    HID_KEY_NONE,          // 37: R3_C3
-    HID_KEY_NONE,          // 38: R3_C4
-    HID_KEY_NONE,          // 39: R3_C5
-    HID_KEY_NONE,          // 40: R3_C6
-    HID_KEY_NONE,          // 41: R3_C7
-    HID_KEY_NONE,          // 42: R3_C8
-    HID_KEY_NONE,          // 43: R3_C9
-    HID_KEY_NONE,          // 44: R3_C10
-    HID_KEY_NONE,          // 45: R4_C0
-    HID_KEY_NONE,          // 46: R4_C1
-    HID_KEY_NONE,          // 47: R4_C2
-    HID_KEY_NONE,          // 48: R4_C3
-    HID_KEY_NONE,          // 49: R4_C4
-    HID_KEY_NONE,          // 50: R4_C5
-    HID_KEY_NONE,          // 51: R4_C6
-    HID_KEY_NONE,          // 52: R4_C7
-    HID_KEY_NONE,          // 53: R4_C8
-    HID_KEY_NONE,          // 54: R4_C9
-    HID_KEY_NONE,          // 55: R4_C10
-    HID_KEY_NONE,          // 56: R5_C0
-    HID_KEY_NONE,          // 57: R5_C1
-    HID_KEY_NONE,          // 58: R5_C2
-    HID_KEY_NONE,          // 59: R5_C3
-    HID_KEY_NONE,          // 60: R5_C4
-    HID_KEY_NONE,          // 61: R5_C5
-    HID_KEY_NONE,          // 62: R5_C6
-    HID_KEY_NONE,          // 63: R5_C7
-    HID_KEY_NONE,          // 64: R5_C8
-    HID_KEY_NONE,          // 65: R5_C9
-    HID_KEY_NONE,          // 66: R5_C10
-    HID_KEY_NONE,          // 67: R6_C0
-    HID_KEY_NONE,          // 68: R6_C1
-    HID_KEY_NONE,          // 69: R6_C2
-    HID_KEY_NONE,          // 70: R6_C3
-    HID_KEY_NONE,          // 71: R6_C4
-    HID_KEY_NONE,          // 72: R6_C5
-    HID_KEY_NONE,          // 73: R6_C6
-    HID_KEY_NONE,          // 74: R6_C7
-    HID_KEY_NONE,          // 75: R6_C8
-    HID_KEY_NONE,          // 76: R6_C9
-    HID_KEY_NONE,          // 77: R6_C10
-    HID_KEY_NONE,          // 78: R7_C0
-    HID_KEY_NONE,          // 79: R7_C1
-    HID_KEY_NONE,          // 80: R7_C2
-    HID_KEY_NONE,          // 81: R7_C3
-    HID_KEY_NONE,          // 82: R7_C4
-    HID_KEY_NONE,          // 83: R7_C5
-    HID_KEY_NONE,          // 84: R7_C6
-    HID_KEY_NONE,          // 85: R7_C7
-    HID_KEY_NONE,          // 86: R7_C8
-    HID_KEY_NONE,          // 87: R7_C9
-    HID_KEY_NONE,          // 88: R7_C10
-    HID_KEY_NONE,          // 89: R0_GND
-    HID_KEY_NONE,          // 90: R1_GND
-    HID_KEY_NONE,          // 91: R2_GND
-    HID_KEY_NONE,          // 92: R3_GND
-    HID_KEY_NONE,          // 93: R4_GND
-    HID_KEY_NONE,          // 94: R5_GND
-    HID_KEY_NONE,          // 95: R6_GND
-    HID_KEY_NONE,          // 96: R7_GND
-    HID_KEY_NONE,          // 97: GPI1
-    HID_KEY_NONE,          // 98: GPI2
-    HID_KEY_NONE,          // 99: GPI3
-    HID_KEY_NONE,          // 100: GPI4
-    HID_KEY_NONE,          // 101: GPI5
-    HID_KEY_NONE,          // 102: GPI6
-    HID_KEY_NONE,          // 103: GPI7
-    HID_KEY_NONE,          // 104: GPI8
-    HID_KEY_NONE,          // 105: GPI9
-    HID_KEY_NONE,          // 106: GPI10
-    HID_KEY_NONE,          // 107: GPI11
-    HID_KEY_NONE,          // 108: GPI12
-    HID_KEY_NONE,          // 109: GPI13
-    HID_KEY_NONE,          // 110: GPI14
-    HID_KEY_NONE,          // 111: GPI15
-    HID_KEY_NONE,          // 112: GPI16
-    HID_KEY_NONE,          // 113: GPI17
-    HID_KEY_NONE,          // 114: GPI18
-    HID_KEY_NONE,          // 115: GPI19
-    HID_KEY_NONE,          // 116: LOGIC_1
-    HID_KEY_NONE,          // 117: LOGIC_2
-    HID_KEY_NONE,          // 118: UNUSED_0
-    HID_KEY_NONE,          // 119: UNUSED_1
-    HID_KEY_NONE,          // 120: UNUSED_2
-    HID_KEY_NONE,          // 121: UNUSED_3
-    HID_KEY_NONE,          // 122: UNUSED_4
-    HID_KEY_NONE,          // 123: UNUSED_5
-    HID_KEY_NONE,          // 124: UNUSED_6
-    HID_KEY_NONE,          // 125: UNUSED_7
-    HID_KEY_NONE,          // 126: UNUSED_8
-    HID_KEY_NONE,          // 127: UNLOCK_WILDCARD
-};
-
-#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
-
-/**
- * @brief Convert an ADP5589 Keyboard event ID to a TinyUSB HID keycode.
- *
- * See ADP5589 datasheet table 11 for description of EventID values.
- *
- * @param event_id The code returned by the keyboard IC.
- *
- * @return The TinyUSB HID keycode. HID_KEY_NONE if no mapping.
- */
-uint8_t KeyboardKeyIDToHIDKeyCode(EventID event_id) {
-  return kEventID2KeyCode[static_cast<uint8_t>(event_id)];
+
+CoreFrequency ToCoreFrequency(uint16_t khz) {
+  if (khz >= 500)
+    return CoreFrequency::kHz500;
+  if (khz >= 200)
+    return CoreFrequency::kHz200;
+  if (khz >= 100)
+    return CoreFrequency::kHz100;
+  return CoreFrequency::kHz50;
+}
+
+kbd::adp5589::reg::GENERAL_CFG_B GeneralConfig(const ScanProfile& profile) {
+  return {
+      .OSC_EN = true,  // Enable oscillator.
+      .CORE_FREQ = ToCoreFrequency(profile.core_frequency_khz),
+      .LCK_TRK_LOGIC = 1,  // 1 = do not track.
+      .LCK_TRK_GPI = 1,    // 1 = do not track.
+      .Unused = 0,
+      .INT_CFG = 0,  // INT stays asserted until INT_STATUS is cleared.
+      .RST_CFG = 0,  // ADP5589 reset if RST is low.
+  };
 }
 
 esp_err_t ResetKeyboard(gpio_num_t reset_pin) {
@@ -187,31 +63,13 @@ esp_err_t ResetKeyboard(gpio_num_t reset_pin) {
   return ESP_OK;
 }
 
-uint8_t GetModifierFlag(uint8_t keycode) {
-  switch (keycode) {
-    case HID_KEY_SHIFT_LEFT:
-      return KEYBOARD_MODIFIER_LEFTSHIFT;
-    case HID_KEY_SHIFT_RIGHT:
-      return KEYBOARD_MODIFIER_RIGHTSHIFT;
-    case HID_KEY_CONTROL_LEFT:
-      return KEYBOARD_MODIFIER_LEFTCTRL;
-    case HID_KEY_CONTROL_RIGHT:
-      return KEYBOARD_MODIFIER_RIGHTCTRL;
-    case HID_KEY_ALT_LEFT:
-      return KEYBOARD_MODIFIER_LEFTALT;
-    case HID_KEY_ALT_RIGHT:
-      return KEYBOARD_MODIFIER_RIGHTALT;
-    case HID_KEY_GUI_LEFT:
-      return KEYBOARD_MODIFIER_LEFTGUI;
-    case HID_KEY_GUI_RIGHT:
-      return KEYBOARD_MODIFIER_RIGHTGUI;
-  }
-  return 0x0;
-}
 }  // namespace
 
-Keyboard::Keyboard(i2c::Master i2c_master)
-    : i2c_master_(std::move(i2c_master)), key_states_({false}) {}
+Keyboard::Keyboard(i2c::Master i2c_master, KeyboardReportSink* report_sink)
+    : i2c_master_(std::move(i2c_master)),
+      report_sink_(report_sink),
+      scan_profile_(&ScanProfile::Default()),
+      key_engine_(this) {}
 
 Keyboard::~Keyboard() = default;
 
@@ -236,7 +94,10 @@ esp_err_t Keyboard::Reset() {
   err = Read(&reg_id);
   if (err != ESP_OK)
     return err;
-  key_states_.fill(false);
+  initialized_ = false;
+  // Leave |queued_key_state_| alone, it reflects what the host was sent.
+  key_state_.Clear();
+  key_engine_.Reset();
   ESP_LOGI(TAG, "Keyboard reset, mfr: %u, rev: %u", reg_id.MAN, reg_id.REV);
 
   return ESP_OK;
@@ -347,24 +208,16 @@ esp_err_t Keyboard::Initialize() {
   if (!op.ready())
     return ESP_FAIL;
 
-  {
-    constexpr kbd::adp5589::reg::GENERAL_CFG_B reg = {
-        .OSC_EN = true,  // Enable oscillator.
-        .CORE_FREQ = CoreFrequency::kHz500,
-        .LCK_TRK_LOGIC = 1,  // 1 = do not track.
-        .LCK_TRK_GPI = 1,    // 1 = do not track.
-        .Unused = 0,
-        .INT_CFG = 1,  // deassert for 50 µs, reassert if interrupt is pending.
-        .RST_CFG = 0,  // ADP5589 reset if RST is low.
-    };
-    if (!op.WriteByte(reg))
-      return ESP_FAIL;
-  }
+  if (!op.WriteByte(GeneralConfig(*scan_profile_)))
+    return ESP_FAIL;
 
   err = InitializeInterrupts(op);
   if (err != ESP_OK)
     return err;
   err = InitializeKeys(op);
+  if (err != ESP_OK)
+    return err;
+  err = WriteScanTiming(op, *scan_profile_);
   if (err != ESP_OK)
     return err;
 
@@ -385,126 +238,277 @@ esp_err_t Keyboard::Initialize() {
     }
   }
 
+  num_i2c_transactions_++;
   if (!op.Execute())
     return ESP_FAIL;
 
-  ESP_LOGI(TAG, "Keyboard initialized.");
+  initialized_ = true;
+  ESP_LOGI(TAG, "Keyboard initialized, scan profile: %s.",
+           scan_profile_->name);
   return ESP_OK;
 }
 
-esp_err_t Keyboard::ReportHIDEvents() {
-  uint8_t next_key_idx = 0;
-  uint8_t keycodes[6] = {HID_KEY_NONE};
-  uint8_t modifier = 0;
-  uint8_t num_pressed_keys = 0;  // number of non-modifier keys.
-
-  for (uint8_t keycode = 0; keycode < key_states_.size(); keycode++) {
-    if (!key_states_[keycode])
-      continue;
-    uint8_t modifier_bit = GetModifierFlag(keycode);
-    if (modifier_bit) {
-      modifier |= modifier_bit;
-    } else {
-      num_pressed_keys++;
-      if (next_key_idx < ARRAY_SIZE(keycodes))
-        keycodes[next_key_idx++] = keycode;
+esp_err_t Keyboard::WriteScanTiming(i2c::Operation& op,
+                                    const ScanProfile& profile) {
+  // KEY_POLL_TIME[1:0]: 0 = 10 ms ... 3 = 40 ms.
+  uint8_t poll_time = (profile.key_poll_time_ms + 5) / 10;
+  poll_time = poll_time ? poll_time - 1 : 0;
+  if (poll_time > 3)
+    poll_time = 3;
+  if (!op.RestartReg(static_cast<uint8_t>(RegNum::POLL_TIME_CFG),
+                     i2c::Address::Mode::WRITE) ||
+      !op.WriteByte(poll_time)) {
+    return ESP_FAIL;
+  }
+
+  // Each bit disables debounce of one row (A), or column (B, C) pin.
+  const uint8_t debounce_dis = profile.debounce ? 0x0 : 0xFF;
+  constexpr std::array<RegNum, 3> kDebounceRegisters = {
+      RegNum::DEBOUNCE_DIS_A, RegNum::DEBOUNCE_DIS_B, RegNum::DEBOUNCE_DIS_C,
+  };
+  for (auto reg : kDebounceRegisters) {
+    if (!op.RestartReg(static_cast<uint8_t>(reg), i2c::Address::Mode::WRITE) ||
+        !op.WriteByte(debounce_dis)) {
+      return ESP_FAIL;
     }
   }
+  return ESP_OK;
+}
+
+esp_err_t Keyboard::SetScanProfile(const ScanProfile& profile) {
+  if (!initialized_) {
+    scan_profile_ = &profile;
+    return ESP_OK;
+  }
+
+  // Only the scan registers are written, key and interrupt configuration
+  // and pending events are unaffected.
+  i2c::Operation op = i2c_master_.CreateWriteOp(
+      kSlaveAddress, kI2CAddressSize,
+      static_cast<uint8_t>(RegNum::GENERAL_CFG_B), "kbd-profile");
+  if (!op.ready())
+    return ESP_FAIL;
+  if (!op.WriteByte(GeneralConfig(profile)))
+    return ESP_FAIL;
+  esp_err_t err = WriteScanTiming(op, profile);
+  if (err != ESP_OK)
+    return err;
+  num_i2c_transactions_++;
+  if (!op.Execute())
+    return ESP_FAIL;
+
+  ESP_LOGI(TAG, "Scan profile changed from %s to %s.", scan_profile_->name,
+           profile.name);
+  scan_profile_ = &profile;
+  return ESP_OK;
+}
+
+esp_err_t Keyboard::QueueHIDReport(int64_t interrupt_time_us,
+                                   int64_t read_time_us) {
+  if (key_state_ == queued_key_state_)
+    return ESP_OK;
 
-  if (num_pressed_keys > ARRAY_SIZE(keycodes)) {
-    ESP_LOGW(TAG, "Unable to report all keys. %u pressed, max %u",
-             num_pressed_keys, ARRAY_SIZE(keycodes));
+  esp_err_t err = report_sink_->QueueKeyboardReport(
+      key_state_, interrupt_time_us, read_time_us);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "HID report queue full.");
+    return err;
   }
-  return usb::HID::KeyboardReport(usb::REPORT_ID_KEYBOARD, modifier, keycodes);
+  queued_key_state_ = key_state_;
+  return ESP_OK;
 }
 
-esp_err_t Keyboard::HandleEvents() {
+esp_err_t Keyboard::HandleEvents(int64_t interrupt_time_us) {
   esp_err_t err;
 
   ESP_LOGV(TAG, "Reading keyboard events.");
 
   kbd::adp5589::reg::INT_STATUS interrupt_status;
-  err = Read(&interrupt_status);
+  kbd::adp5589::reg::Status status_reg;
+  uint8_t fifo[kMaxFIFOEntries];
+
+  const uint32_t start_transactions = num_i2c_transactions_;
+  err = ReadEvents(&interrupt_status, &status_reg, fifo);
   if (err != ESP_OK) {
-    ESP_LOGE(TAG, "Failure reading INT_STATUS");
+    ESP_LOGE(TAG, "Failure reading keyboard events");
     return err;
   }
+  const int64_t read_time_us = esp_timer_get_time();
   // Write back the INT_STATUS register to clear the INT flags.
   err = WriteByte(RegNum::INT_STATUS, interrupt_status);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "Failure writing INT_STATUS");
   }
-  if (interrupt_status.OVRFLOW_INT) {
-    ESP_LOGE(TAG, "Keyboard FIFO overflow.");
-    return ESP_FAIL;
-  }
-
-  kbd::adp5589::reg::Status status_reg;
-  err = Read(&status_reg);
-  if (err != ESP_OK) {
-    ESP_LOGE(TAG, "Failure reading status register");
-    return err;
-  }
+  if (interrupt_status.OVRFLOW_INT)
+    return RecoverFromOverflow(interrupt_time_us);
 
   if (!status_reg.EC) {
     ESP_LOGV(TAG, "No keyboard events.");
     return ESP_OK;
   }
 
-  constexpr uint8_t kMaxFIFOEntries = 16;
-  kbd::adp5589::reg::FIFO fifo[kMaxFIFOEntries];
+  const uint8_t num_events =
+      status_reg.EC < kMaxFIFOEntries ? status_reg.EC : kMaxFIFOEntries;
+  KeystrokeLatency::Record(KeystrokeLatency::Stage::InterruptToRead,
+                           read_time_us - interrupt_time_us);
+  // For recording traces to replay with scripts/kbdtrace.py --from-log.
+  for (uint8_t i = 0; i < num_events; i++)
+    ESP_LOGV(TAG, "event %lld 0x%02x", interrupt_time_us, fifo[i]);
+
+  err = HandleFIFO(fifo, num_events, interrupt_time_us, read_time_us);
+  ESP_LOGV(TAG, "    Done reading %u keyboard events in %u I2C transactions.",
+           num_events, num_i2c_transactions_ - start_transactions);
+  return err;
+}
 
-  for (uint8_t i = 0; i < status_reg.EC; i++) {
-    event_number_++;
-    err = Read(&fifo[i]);
-    if (err != ESP_OK) {
-      ESP_LOGE(TAG, "Error reading FIFO entry %u", i);
-      return err;
-    }
-  }
+esp_err_t Keyboard::ReadEventCount(uint8_t* count) {
+  kbd::adp5589::reg::Status status_reg;
+  esp_err_t err = Read(&status_reg);
+  if (err != ESP_OK)
+    return err;
+  *count = status_reg.EC;
+  return ESP_OK;
+}
 
-  for (uint8_t i = 0; i < status_reg.EC; i++) {
+esp_err_t Keyboard::HandleFIFO(const uint8_t* fifo,
+                               uint8_t num_events,
+                               int64_t interrupt_time_us,
+                               int64_t read_time_us) {
+  if (num_events > kMaxFIFOEntries)
+    num_events = kMaxFIFOEntries;
+  event_number_ += num_events;
+
+  // Timeouts due before these events happened must be resolved first.
+  event_time_us_ = interrupt_time_us;
+  read_time_us_ = read_time_us;
+  key_engine_.HandleTimers(interrupt_time_us);
+
+  for (uint8_t i = 0; i < num_events; i++) {
+    kbd::adp5589::reg::FIFO event;
+    Decode(fifo[i], &event);
 #ifdef ONLY_LOG_EVENTS
-    const char key_state = fifo[i].Event_State ? 'D' : 'U';
+    const char key_state = event.Event_State ? 'D' : 'U';
     ESP_LOGI(TAG, "keyboard event[%u/%u] (0x%02x) id %s:%c", i + 1,
-             status_reg.EC, fifo[i].Event_State,
-             adp5589::EventToName(static_cast<EventID>(fifo[i].IDENTIFIER)),
+             num_events, event.Event_State,
+             adp5589::EventToName(static_cast<EventID>(event.IDENTIFIER)),
              key_state);
 #else
-    const uint8_t hid_keycode = KeyboardKeyIDToHIDKeyCode(fifo[i].IDENTIFIER);
-    if (hid_keycode < key_states_.size()) {
-      const bool key_pressed = fifo[i].Event_State & 0b10000000;
-      key_states_[hid_keycode] = key_pressed;
-    }
+    key_engine_.HandleEvent(static_cast<uint8_t>(event.IDENTIFIER),
+                            event.Event_State, interrupt_time_us);
 #endif
   }
 
-  ESP_LOGV(TAG, "    Done reading keyboard.");
-  return ReportHIDEvents();
+  // If the queue was full the final state is retried with the next batch.
+  return QueueHIDReport(interrupt_time_us, read_time_us);
 }
 
-esp_err_t Keyboard::Read(kbd::adp5589::reg::Status* reg) {
-  uint8_t b;
-  esp_err_t err = ReadByte(RegNum::Status, &b);
+esp_err_t Keyboard::HandleTimers(int64_t now_us) {
+  event_time_us_ = now_us;
+  read_time_us_ = now_us;
+  key_engine_.HandleTimers(now_us);
+  return QueueHIDReport(now_us, now_us);
+}
+
+void Keyboard::KeyAction(uint8_t keycode, bool pressed) {
+  if (Keymap::IsMediaKey(keycode)) {
+    MediaKeyAction(Keymap::GetMediaUsage(keycode), pressed);
+    return;
+  }
+  if (Keymap::IsFunctionKey(keycode)) {
+    if (pressed && function_key_client_)
+      function_key_client_->FunctionKeyPressed(Keymap::GetFunction(keycode));
+    return;
+  }
+  // Queue a report per transition so a press and release within the same
+  // FIFO batch are both seen by the host.
+  if (key_state_.Set(keycode, pressed))
+    QueueHIDReport(event_time_us_, read_time_us_);
+}
+
+void Keyboard::MediaKeyAction(uint16_t usage, bool pressed) {
+  if (pressed) {
+    consumer_usage_ = usage;
+  } else {
+    // Releasing a key other than the one reported changes nothing.
+    if (usage != consumer_usage_)
+      return;
+    consumer_usage_ = 0;
+  }
+  esp_err_t err = report_sink_->QueueConsumerReport(consumer_usage_);
+  if (err != ESP_OK)
+    ESP_LOGW(TAG, "Failure queuing consumer report: %s", esp_err_to_name(err));
+}
+
+esp_err_t Keyboard::RecoverFromOverflow(int64_t interrupt_time_us) {
+  const int64_t start_time_us = esp_timer_get_time();
+  num_overflows_++;
+  ESP_LOGE(TAG, "Keyboard FIFO overflow #%u, resynchronizing.",
+           num_overflows_);
+
+  // Events were lost, so the key state can't be trusted. Resetting the IC
+  // discards the FIFO, and once scanning restarts any keys still held are
+  // reported again as new key press events.
+  esp_err_t err = Reset();
+  if (err != ESP_OK)
+    return err;
+  err = Initialize();
   if (err != ESP_OK)
     return err;
 
+  // Release every key the host may think is pressed.
+  err = QueueHIDReport(interrupt_time_us, esp_timer_get_time());
+  if (consumer_usage_)
+    MediaKeyAction(consumer_usage_, /*pressed=*/false);
+
+  ESP_LOGW(TAG, "Resynchronized after FIFO overflow in %lld usec.",
+           esp_timer_get_time() - start_time_us);
+  return err;
+}
+
+esp_err_t Keyboard::ReadEvents(kbd::adp5589::reg::INT_STATUS* int_status,
+                               kbd::adp5589::reg::Status* status,
+                               uint8_t* fifo) {
+  // INT_STATUS, Status, and FIFO_1..FIFO_16 are contiguous, so a single
+  // auto-incrementing read retrieves the interrupt state and every event.
+  static_assert(static_cast<uint8_t>(RegNum::Status) ==
+                static_cast<uint8_t>(RegNum::INT_STATUS) + 1);
+  static_assert(static_cast<uint8_t>(RegNum::FIFO_1) ==
+                static_cast<uint8_t>(RegNum::Status) + 1);
+  constexpr size_t kIntStatusIdx = 0;
+  constexpr size_t kStatusIdx = 1;
+  constexpr size_t kFIFOIdx = 2;
+  uint8_t buffer[kFIFOIdx + kMaxFIFOEntries];
+
+  i2c::Operation op = i2c_master_.CreateReadOp(
+      kSlaveAddress, kI2CAddressSize,
+      static_cast<uint8_t>(RegNum::INT_STATUS), "kbd-events");
+  if (!op.ready())
+    return ESP_FAIL;
+  if (!op.Read(buffer, sizeof(buffer)))
+    return ESP_FAIL;
+  num_i2c_transactions_++;
+  if (!op.Execute())
+    return ESP_FAIL;
+
+  Decode(buffer[kIntStatusIdx], int_status);
+  Decode(buffer[kStatusIdx], status);
+  std::memcpy(fifo, &buffer[kFIFOIdx], kMaxFIFOEntries);
+
+  return ESP_OK;
+}
+
+// static
+void Keyboard::Decode(uint8_t b, kbd::adp5589::reg::Status* reg) {
   // clang-format off
   reg->LOGIC2_STAT = b & 0b10000000 ? 1 : 0;
   reg->LOGIC1_STAT = b & 0b01000000 ? 1 : 0;
   reg->LOCK_STAT   = b & 0b00100000 ? 1 : 0;
   reg->EC          = b & 0b00011111;
   // clang-format on
-
-  return ESP_OK;
 }
 
-esp_err_t Keyboard::Read(kbd::adp5589::reg::INT_STATUS* reg) {
-  uint8_t b;
-  esp_err_t err = ReadByte(RegNum::INT_STATUS, &b);
-  if (err != ESP_OK)
-    return err;
-
+// static
+void Keyboard::Decode(uint8_t b, kbd::adp5589::reg::INT_STATUS* reg) {
   // clang-format off
   reg->LOGIC2_INT  = b & 0b00100000 ? 1 : 0;
   reg->LOGIC1_INT  = b & 0b00010000 ? 1 : 0;
@@ -513,7 +517,31 @@ esp_err_t Keyboard::Read(kbd::adp5589::reg::INT_STATUS* reg) {
   reg->GPI_INT     = b & 0b00000010 ? 1 : 0;
   reg->EVENT_INT   = b & 0b00000001;
   // clang-format on
+}
+
+// static
+void Keyboard::Decode(uint8_t b, kbd::adp5589::reg::FIFO* reg) {
+  reg->Event_State = b & 0b10000000 ? 1 : 0;
+  reg->IDENTIFIER = static_cast<EventID>(b & 0b01111111);
+}
+
+esp_err_t Keyboard::Read(kbd::adp5589::reg::Status* reg) {
+  uint8_t b;
+  esp_err_t err = ReadByte(RegNum::Status, &b);
+  if (err != ESP_OK)
+    return err;
 
+  Decode(b, reg);
+  return ESP_OK;
+}
+
+esp_err_t Keyboard::Read(kbd::adp5589::reg::INT_STATUS* reg) {
+  uint8_t b;
+  esp_err_t err = ReadByte(RegNum::INT_STATUS, &b);
+  if (err != ESP_OK)
+    return err;
+
+  Decode(b, reg);
   return ESP_OK;
 }
 
@@ -523,9 +551,7 @@ esp_err_t Keyboard::Read(kbd::adp5589::reg::FIFO* reg) {
   if (err != ESP_OK)
     return err;
 
-  reg->Event_State = b & 0b10000000 ? 1 : 0;
-  reg->IDENTIFIER = static_cast<EventID>(b & 0b01111111);
-
+  Decode(b, reg);
   return ESP_OK;
 }
 
@@ -542,6 +568,7 @@ esp_err_t Keyboard::Read(kbd::adp5589::reg::ID* reg) {
 }
 
 esp_err_t Keyboard::ReadByte(RegNum reg, uint8_t* value) {
+  num_i2c_transactions_++;
   return i2c_master_.ReadRegister(kSlaveAddress, kI2CAddressSize,
                                   static_cast<uint8_t>(reg), value)
              ? ESP_OK
@@ -549,6 +576,7 @@ esp_err_t Keyboard::ReadByte(RegNum reg, uint8_t* value) {
 }
 
 esp_err_t Keyboard::WriteByte(RegNum reg, uint8_t value) {
+  num_i2c_transactions_++;
   return i2c_master_.WriteRegister(kSlaveAddress, kI2CAddressSize,
                                    static_cast<uint8_t>(reg), value)
              ? ESP_OK
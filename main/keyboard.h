@@ -6,12 +6,18 @@
 #include <i2clib/master.h>
 #include <i2clib/operation.h>
 
+#include "key_engine.h"
+#include "key_state.h"
+#include "keymap.h"
+#include "scan_profile.h"
+
 namespace kbd {
 namespace adp5589 {
 enum class RegNum : uint8_t;
 
 namespace reg {
 struct FIFO;
+struct GENERAL_CFG_B;
 struct ID;
 struct INT_STATUS;
 struct PIN_CONFIG_A;
@@ -22,14 +28,60 @@ struct Status;
 }  // namespace adp5589
 }  // namespace kbd
 
-// Maximum number of HID_KEY_* key codes.
-constexpr size_t kNumHIDKeyCodes = 0xff;
+/**
+ * Receives the keyboard reports generated by Keyboard.
+ */
+class KeyboardReportSink {
+ public:
+  /**
+   * Queue a report of |key_state| for the host.
+   *
+   * @param interrupt_time_us When the keyboard interrupt fired.
+   * @param read_time_us      When the keyboard IC events were read.
+   */
+  virtual esp_err_t QueueKeyboardReport(const KeyState& key_state,
+                                        int64_t interrupt_time_us,
+                                        int64_t read_time_us) = 0;
+
+  /**
+   * Queue a Consumer Control report for the host.
+   *
+   * @param usage The HID Consumer page usage pressed, zero for none.
+   */
+  virtual esp_err_t QueueConsumerReport(uint16_t usage) = 0;
+
+ protected:
+  KeyboardReportSink() = default;
+  ~KeyboardReportSink() = default;
+};
+
+/**
+ * Implemented to act on keymap function keys (see Keymap::Function).
+ */
+class FunctionKeyClient {
+ public:
+  /**
+   * Called on the keyboard task when a function key is pressed.
+   */
+  virtual void FunctionKeyPressed(Keymap::Function function) = 0;
+
+ protected:
+  FunctionKeyClient() = default;
+  ~FunctionKeyClient() = default;
+};
 
-class Keyboard {
+class Keyboard : public KeyActionClient {
  public:
-  explicit Keyboard(i2c::Master i2c_master);
+  Keyboard(i2c::Master i2c_master, KeyboardReportSink* report_sink);
   ~Keyboard();
 
+  /**
+   * Set the client which acts on function keys, nullptr to ignore them.
+   */
+  void SetFunctionKeyClient(FunctionKeyClient* client) {
+    function_key_client_ = client;
+  }
+
   /**
    * Reset the keyboard IC to manufacturer default values.
    */
@@ -42,34 +94,139 @@ class Keyboard {
    */
   esp_err_t Initialize();
 
+  /**
+   * Change the key scanning settings.
+   *
+   * Takes effect immediately, without resetting the keyboard IC, if already
+   * initialized. |profile| must outlive this object.
+   */
+  esp_err_t SetScanProfile(const ScanProfile& profile);
+
+  const ScanProfile& scan_profile() const { return *scan_profile_; }
+
+  /**
+   * Replace the built-in keymap with the one in the file at |path|.
+   */
+  esp_err_t LoadKeymap(const char* path) {
+    return key_engine_.keymap().Load(path);
+  }
+
   /**
    * Handle any keyboard events.
    *
    * Call this function, either polled or when interrupt pin indicates, to
    * handle any queued keyboard events.
+   *
+   * @param interrupt_time_us esp_timer_get_time() when the interrupt fired
+   *                          (or the poll started).
+   */
+  esp_err_t HandleEvents(int64_t interrupt_time_us);
+
+  /**
+   * Read the number of events in the keyboard IC's FIFO.
    */
-  esp_err_t HandleEvents();
+  esp_err_t ReadEventCount(uint8_t* count);
+
+  /**
+   * Handle keyboard IC FIFO entries read by the caller.
+   *
+   * Same as HandleEvents() once the FIFO has been read. Does no I2C.
+   *
+   * @param fifo Raw FIFO register values, at most kMaxFIFOEntries.
+   */
+  esp_err_t HandleFIFO(const uint8_t* fifo,
+                       uint8_t num_events,
+                       int64_t interrupt_time_us,
+                       int64_t read_time_us);
+
+  /**
+   * Handle any expired key timeouts (e.g. tap-hold).
+   *
+   * Call every KeyEngine::kTimerTickUsec while timers_pending() is true.
+   */
+  esp_err_t HandleTimers(int64_t now_us);
+
+  bool timers_pending() const { return key_engine_.timers_pending(); }
+
+  /**
+   * The number of I2C transactions issued to the keyboard IC.
+   */
+  uint32_t num_i2c_transactions() const { return num_i2c_transactions_; }
+
+  /**
+   * The number of event FIFO overflows recovered from.
+   */
+  uint32_t num_overflows() const { return num_overflows_; }
+
+  // Maximum number of entries in the keyboard IC's event FIFO.
+  static constexpr uint8_t kMaxFIFOEntries = 16;
 
  private:
+  // KeyActionClient:
+  void KeyAction(uint8_t keycode, bool pressed) override;
+
+  static void Decode(uint8_t b, kbd::adp5589::reg::FIFO* reg);
+  static void Decode(uint8_t b, kbd::adp5589::reg::INT_STATUS* reg);
+  static void Decode(uint8_t b, kbd::adp5589::reg::Status* reg);
+
   /**
-   * Report all HID events to the USB host.
+   * Queue the current key state for the USB host if it has changed since
+   * the last successfully queued report.
    */
-  esp_err_t ReportHIDEvents();
+  esp_err_t QueueHIDReport(int64_t interrupt_time_us, int64_t read_time_us);
+
+  /**
+   * Handle a media key transition. Only one usage is reported at a time,
+   * the most recently pressed.
+   */
+  void MediaKeyAction(uint16_t usage, bool pressed);
   esp_err_t WriteByte(kbd::adp5589::RegNum reg, uint8_t value);
   esp_err_t ReadByte(kbd::adp5589::RegNum reg, uint8_t* value);
   esp_err_t Read(kbd::adp5589::reg::FIFO* reg);
   esp_err_t Read(kbd::adp5589::reg::ID* reg);
   esp_err_t Read(kbd::adp5589::reg::INT_STATUS* reg);
   esp_err_t Read(kbd::adp5589::reg::Status* reg);
+
+  /**
+   * Read INT_STATUS, Status, and all FIFO entries in one I2C transaction.
+   *
+   * @param fifo Array of at least kMaxFIFOEntries raw FIFO register values.
+   *             Only the first |status->EC| entries are valid.
+   */
+  esp_err_t ReadEvents(kbd::adp5589::reg::INT_STATUS* int_status,
+                       kbd::adp5589::reg::Status* status,
+                       uint8_t* fifo);
   esp_err_t InitializeKeys(i2c::Operation& op);
-  esp_err_t InitializeInterrupts(i2c::Operation& op);
 
-  i2c::Master i2c_master_;
+  /**
+   * Recover from a keyboard IC event FIFO overflow.
+   *
+   * Resets and reinitializes the keyboard IC, and queues a single report
+   * releasing all keys. Keys still held are re-reported by the IC. The cost
+   * is bounded by the reset delays and a fixed number of I2C transactions.
+   */
+  esp_err_t RecoverFromOverflow(int64_t interrupt_time_us);
+  esp_err_t InitializeInterrupts(i2c::Operation& op);
 
   /**
-   * Array used to map TinyUSB's HID KEYCODE value to the button
-   * pressed/depressed state.
+   * Add the writes of the scan profile registers other than GENERAL_CFG_B
+   * to |op|.
    */
-  std::array<bool, kNumHIDKeyCodes> key_states_;  // true if depressed.
+  esp_err_t WriteScanTiming(i2c::Operation& op, const ScanProfile& profile);
+
+  i2c::Master i2c_master_;
+  KeyboardReportSink* report_sink_;
+  FunctionKeyClient* function_key_client_ = nullptr;
+  const ScanProfile* scan_profile_;
+  bool initialized_ = false;
+
+  KeyState key_state_;           // Current state of every HID keycode.
+  KeyState queued_key_state_;    // State last queued for the USB host.
+  uint16_t consumer_usage_ = 0;  // Media key usage reported as pressed.
+  KeyEngine key_engine_;         // Event ID to HID key transitions.
+  int64_t event_time_us_ = 0;    // Interrupt time of events being handled.
+  int64_t read_time_us_ = 0;     // Read time of events being handled.
   uint32_t event_number_ = 0;
+  uint32_t num_i2c_transactions_ = 0;
+  uint32_t num_overflows_ = 0;
 };
@@ -4,10 +4,13 @@
 
 #define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
 #include <esp_log.h>
+#include <esp_timer.h>
 
 #include "gpio_pins.h"
+#include "keystroke_latency.h"
 #include "usb_device.h"
 #include "usb_hid.h"
+#include "usb_text_injector.h"
 
 namespace {
 constexpr char TAG[] = "KbdTask";
@@ -16,43 +19,129 @@ constexpr char TAG[] = "KbdTask";
 // Combination of  ESP_INTR_FLAG_* flags.
 constexpr int ESP_INTR_FLAG_DEFAULT = 0x0;  // No flags set.
 
-constexpr EventBits_t EVENT_KEYBOARD_EVENT = BIT0;
-constexpr EventBits_t EVENT_ALL = BIT0;
-}  // namespace
+constexpr uint32_t EVENT_KEYBOARD_EVENT = BIT0;
+constexpr uint32_t EVENT_SCAN_PROFILE = BIT1;  // Scan profile requested.
+
+constexpr uint64_t kLatencyLogPeriodUsec = 60 * 1000 * 1000;
+
+// How often to check the INT line for a missed interrupt.
+constexpr TickType_t kWatchdogPeriod = pdMS_TO_TICKS(50);
+// INT asserted this long without an interrupt is a missed interrupt.
+constexpr int64_t kMissedInterruptUsec = 50 * 1000;
+// Interrupts handled later than this after they fire are counted as late.
+constexpr int64_t kLateInterruptUsec = 5 * 1000;
+KeyboardTask* g_keyboard_task = nullptr;
+MediaKeyClient* g_media_key_client = nullptr;
+
+/**
+ * Sends the keyboard's reports to the USB HID.
+ */
+class USBReportSink : public KeyboardReportSink {
+ public:
+  esp_err_t QueueKeyboardReport(const KeyState& key_state,
+                                int64_t interrupt_time_us,
+                                int64_t read_time_us) override {
+    esp_err_t err = usb::HID::QueueKeyboardReport(key_state, interrupt_time_us);
+    if (err != ESP_OK)
+      return err;
+    KeystrokeLatency::Record(KeystrokeLatency::Stage::ReadToQueue,
+                             esp_timer_get_time() - read_time_us);
+    return ESP_OK;
+  }
+
+  esp_err_t QueueConsumerReport(uint16_t usage) override {
+    if (usage && g_media_key_client)
+      g_media_key_client->MediaKeyPressed(usage);
+    return usb::HID::QueueConsumerReport(usage);
+  }
+};
 
-KeyboardTask::KeyboardTask()
-    : event_group_(xEventGroupCreate()),
-      keyboard_(i2c::Master(kKeyboardPort, /*mutex=*/nullptr)),
-      mutex_(xSemaphoreCreateMutex()) {}
+USBReportSink g_usb_report_sink;
+}  // namespace
 
-KeyboardTask::~KeyboardTask() {
-  if (event_group_)
-    vEventGroupDelete(event_group_);
+KeyboardTask::KeyboardTask(const std::string& macro)
+    : keyboard_(i2c::Master(kKeyboardPort, /*mutex=*/nullptr),
+                &g_usb_report_sink),
+      mutex_(xSemaphoreCreateMutex()),
+      requested_profile_(nullptr),
+      macro_(macro) {
+  keyboard_.SetFunctionKeyClient(this);
 }
 
-// static
-esp_err_t KeyboardTask::Start() {
-  static KeyboardTask* task = nullptr;
+KeyboardTask::~KeyboardTask() = default;
 
+// static
+esp_err_t KeyboardTask::Start(const std::string& scan_profile,
+                              const std::string& macro) {
   ESP_LOGD(TAG, "Starting Keyboard task");
-  if (task)
+  if (g_keyboard_task)
     return ESP_FAIL;
 
-  task = new KeyboardTask();
-  return task->Initialize();
+  g_keyboard_task = new KeyboardTask(macro);
+  const ScanProfile* profile = ScanProfile::Find(scan_profile.c_str());
+  if (!profile) {
+    ESP_LOGW(TAG, "Unknown scan profile \"%s\".", scan_profile.c_str());
+    profile = &ScanProfile::Default();
+  }
+  g_keyboard_task->keyboard_.SetScanProfile(*profile);
+  KeystrokeLatency::SetLabel(profile->name);
+  return g_keyboard_task->Initialize();
+}
+
+// static
+esp_err_t KeyboardTask::SetScanProfile(const char* name) {
+  if (!g_keyboard_task)
+    return ESP_ERR_INVALID_STATE;
+  const ScanProfile* profile = ScanProfile::Find(name);
+  if (!profile)
+    return ESP_ERR_NOT_FOUND;
+  g_keyboard_task->RequestScanProfile(*profile);
+  return ESP_OK;
+}
+
+void KeyboardTask::RequestScanProfile(const ScanProfile& profile) {
+  requested_profile_ = &profile;
+  notifier_.Notify(EVENT_SCAN_PROFILE);
+}
+
+void KeyboardTask::FunctionKeyPressed(Keymap::Function function) {
+  switch (function) {
+    case Keymap::Function::NextScanProfile: {
+      // Not applied here, as the keyboard IC's events are being handled.
+      const ScanProfile* requested = requested_profile_.load();
+      RequestScanProfile(ScanProfile::Next(
+          requested ? *requested : keyboard_.scan_profile()));
+    } break;
+    case Keymap::Function::TypeMacro: {
+      if (macro_.empty()) {
+        ESP_LOGW(TAG, "No keyboard macro in the config.");
+        break;
+      }
+      const esp_err_t err = usb::TextInjector::Inject(macro_.c_str());
+      if (err != ESP_OK)
+        ESP_LOGW(TAG, "Failure typing macro: %s.", esp_err_to_name(err));
+    } break;
+    case Keymap::Function::NumFunctions:
+      break;
+  }
+}
+
+// static
+void KeyboardTask::SetMediaKeyClient(MediaKeyClient* client) {
+  g_media_key_client = client;
 }
 
 esp_err_t KeyboardTask::Initialize() {
   // https://www.freertos.org/FAQMem.html#StackSize
   constexpr uint32_t kStackDepthWords = 2048;
 
-  if (!event_group_)
-    return ESP_FAIL;
-
   esp_err_t err = InstallKeyboardISR();
   if (err != ESP_OK)
     return err;
 
+  // The built-in keymap is used if there is no valid keymap file.
+  keyboard_.LoadKeymap(Keymap::kDefaultPath);
+
   err = keyboard_.Reset();
   if (err != ESP_OK)
     return err;
@@ -61,28 +150,121 @@ esp_err_t KeyboardTask::Initialize() {
   if (err != ESP_OK)
     return err;
 
+  ESP_ERROR_CHECK_WITHOUT_ABORT(
+      KeystrokeLatency::StartPeriodicLog(kLatencyLogPeriodUsec));
+
 #if 0
   err = CreateKeyLogTimer();
   if (err != ESP_OK)
     return err;
 #endif
 
-  return xTaskCreate(TaskFunc, TAG, kStackDepthWords, this,
-                     tskIDLE_PRIORITY + 1, &task_) == pdPASS
-             ? ESP_OK
-             : ESP_FAIL;
+  if (xTaskCreate(TaskFunc, TAG, kStackDepthWords, this, tskIDLE_PRIORITY + 1,
+                  &task_) != pdPASS) {
+    return ESP_FAIL;
+  }
+  notifier_.SetTask(task_);
+  return ESP_OK;
 }
 
 void IRAM_ATTR KeyboardTask::Run() {
   ESP_LOGW(TAG, "In keyboard task.");
   while (true) {
-    EventBits_t bits =
-        xEventGroupWaitBits(event_group_, EVENT_ALL, /*xClearOnExit=*/pdTRUE,
-                            /*xWaitForAllBits=*/pdFALSE, portMAX_DELAY);
-    if (bits & EVENT_KEYBOARD_EVENT) {
-      keyboard_.HandleEvents();
+    // Wake every timer tick while key timeouts are pending, else just often
+    // enough for the INT line watchdog.
+    const TickType_t timeout =
+        keyboard_.timers_pending()
+            ? pdMS_TO_TICKS(KeyEngine::kTimerTickUsec / 1000)
+            : kWatchdogPeriod;
+    const uint32_t bits = notifier_.Wait(timeout);
+    if (bits & EVENT_SCAN_PROFILE) {
+      const ScanProfile* profile = requested_profile_.exchange(nullptr);
+      if (profile)
+        ApplyScanProfile(*profile);
     }
+    if (bits & EVENT_KEYBOARD_EVENT)
+      HandleInterrupt();
+    else
+      CheckInterruptLine();
+    if (keyboard_.timers_pending())
+      keyboard_.HandleTimers(esp_timer_get_time());
+  }
+}
+
+void KeyboardTask::HandleInterrupt() {
+  const int64_t interrupt_time_us = TakeInterruptTime();
+  num_interrupts_++;
+  if (esp_timer_get_time() - interrupt_time_us > kLateInterruptUsec) {
+    num_late_interrupts_++;
+    LogInterruptStats();
+  }
+  // On failure INT is likely still asserted, so leave the interrupt masked
+  // and let CheckInterruptLine() retry rather than interrupting at once.
+  if (keyboard_.HandleEvents(interrupt_time_us) == ESP_OK)
+    RearmInterrupt();
+}
+
+void KeyboardTask::CheckInterruptLine() {
+  if (gpio_get_level(kKeyboardINTGPIO)) {
+    RearmInterrupt();
+    return;
+  }
+  const int64_t now = esp_timer_get_time();
+  if (!int_low_since_us_) {
+    int_low_since_us_ = now;
+    return;
+  }
+  if (now - int_low_since_us_ < kMissedInterruptUsec)
+    return;
+
+  // INT is asserted but no interrupt was seen, so poll the keyboard IC.
+  uint8_t event_count = 0;
+  if (keyboard_.ReadEventCount(&event_count) == ESP_OK && event_count) {
+    num_missed_interrupts_++;
+    LogInterruptStats();
   }
+  // Handle events even if there are none to clear the INT flags. On failure
+  // try again on the next watchdog period, as in HandleInterrupt().
+  if (keyboard_.HandleEvents(int_low_since_us_) == ESP_OK)
+    RearmInterrupt();
+}
+
+void KeyboardTask::RearmInterrupt() {
+  int_low_since_us_ = 0;
+  // If INT is still asserted this immediately interrupts again.
+  gpio_intr_enable(kKeyboardINTGPIO);
+}
+
+void KeyboardTask::ApplyScanProfile(const ScanProfile& profile) {
+  if (&profile == &keyboard_.scan_profile())
+    return;
+  // Each profile's latency is measured separately.
+  KeystrokeLatency::Log();
+  esp_err_t err = keyboard_.SetScanProfile(profile);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failure setting scan profile %s: %s.", profile.name,
+             esp_err_to_name(err));
+    return;
+  }
+  KeystrokeLatency::Reset();
+  KeystrokeLatency::SetLabel(profile.name);
+  ESP_LOGI(TAG, "Scan profile %s.", profile.name);
+}
+
+void KeyboardTask::LogInterruptStats() const {
+  ESP_LOGW(TAG, "Keyboard interrupts: %u, late: %u, missed: %u.",
+           num_interrupts_, num_late_interrupts_, num_missed_interrupts_);
+}
+
+/**
+ * Return the time of the first interrupt since this was last called.
+ */
+int64_t KeyboardTask::TakeInterruptTime() {
+  taskENTER_CRITICAL(&interrupt_time_lock_);
+  const int64_t interrupt_time_us = interrupt_time_us_;
+  interrupt_time_us_ = 0;
+  taskEXIT_CRITICAL(&interrupt_time_lock_);
+  return interrupt_time_us ? interrupt_time_us : esp_timer_get_time();
 }
 
 // static
@@ -92,19 +274,18 @@ void IRAM_ATTR KeyboardTask::TaskFunc(void* arg) {
 
 // static
 void IRAM_ATTR KeyboardTask::KeyboardISR(void* arg) {
-  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-  BaseType_t xResult = xEventGroupSetBitsFromISR(
-      static_cast<KeyboardTask*>(arg)->event_group_, EVENT_KEYBOARD_EVENT,
-      &xHigherPriorityTaskWoken);
-
-  if (xResult != pdFAIL) {
-    // See https://www.freertos.org/xEventGroupSetBitsFromISR.html
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-#else
-    portYIELD_FROM_ISR();
-#endif
-  }
+  KeyboardTask* task = static_cast<KeyboardTask*>(arg);
+
+  // The interrupt is level triggered, so mask it until the task has drained
+  // the keyboard IC's FIFO and INT is deasserted.
+  gpio_intr_disable(kKeyboardINTGPIO);
+
+  taskENTER_CRITICAL_ISR(&task->interrupt_time_lock_);
+  if (!task->interrupt_time_us_)
+    task->interrupt_time_us_ = esp_timer_get_time();
+  taskEXIT_CRITICAL_ISR(&task->interrupt_time_lock_);
+
+  task->notifier_.NotifyFromISR(EVENT_KEYBOARD_EVENT);
 }
 
 esp_err_t KeyboardTask::InstallKeyboardISR() {
@@ -114,7 +295,7 @@ esp_err_t KeyboardTask::InstallKeyboardISR() {
       .mode = GPIO_MODE_INPUT,
       .pull_up_en = GPIO_PULLUP_ENABLE,
       .pull_down_en = GPIO_PULLDOWN_DISABLE,
-      .intr_type = GPIO_INTR_NEGEDGE,
+      .intr_type = GPIO_INTR_LOW_LEVEL,
   };
 
   esp_err_t err = gpio_config(&io_conf);
@@ -1,35 +1,119 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <string>
+
 #include <freertos/include/freertos/FreeRTOS.h>
-#include <freertos/include/freertos/event_groups.h>
 #include <freertos/include/freertos/semphr.h>
 #include <freertos/include/freertos/task.h>
 
 #include <esp_err.h>
 
 #include "keyboard.h"
+#include "scan_profile.h"
+#include "task_notifier.h"
+
+/**
+ * Implemented to be told when a media key is pressed.
+ */
+class MediaKeyClient {
+ public:
+  /**
+   * Called on the keyboard task when a media key is pressed.
+   *
+   * @param usage The HID Consumer page usage of the key.
+   *
+   * @warning Must not block.
+   */
+  virtual void MediaKeyPressed(uint16_t usage) = 0;
+
+ protected:
+  MediaKeyClient() = default;
+  ~MediaKeyClient() = default;
+};
 
 /**
  * Task responsible for detecting keyboard events from the IC
  * and dispatching them to the USB HID.
  */
-class KeyboardTask {
+class KeyboardTask : public FunctionKeyClient {
  public:
-  static esp_err_t Start();
+  /**
+   * Start the keyboard task.
+   *
+   * @param scan_profile Name of the initial ScanProfile, the default
+   *                     profile is used if unknown.
+   * @param macro        Text typed by the TypeMacro function key.
+   */
+  static esp_err_t Start(const std::string& scan_profile,
+                         const std::string& macro);
+
+  /**
+   * Switch to the ScanProfile named |name|.
+   *
+   * The switch is made asynchronously by the keyboard task. The
+   * NextScanProfile function key also switches profile.
+   */
+  static esp_err_t SetScanProfile(const char* name);
+
+  /**
+   * Set the client told of media key presses.
+   *
+   * @note Call before Start().
+   */
+  static void SetMediaKeyClient(MediaKeyClient* client);
 
  private:
   static void IRAM_ATTR TaskFunc(void* arg);
   static void IRAM_ATTR KeyboardISR(void* arg);
 
-  KeyboardTask();
+  explicit KeyboardTask(const std::string& macro);
   ~KeyboardTask();
 
+  // FunctionKeyClient:
+  void FunctionKeyPressed(Keymap::Function function) override;
+
   esp_err_t InstallKeyboardISR();
   esp_err_t Initialize();
   void IRAM_ATTR Run();
 
-  EventGroupHandle_t event_group_;  // Application events.
-  TaskHandle_t task_ = nullptr;     // This task.
-  Keyboard keyboard_;               // All interaction with keyboard.
+  int64_t TakeInterruptTime();
+
+  /**
+   * Handle the keyboard interrupt and re-arm it.
+   */
+  void HandleInterrupt();
+
+  /**
+   * Recover from a missed interrupt if INT has been asserted too long.
+   */
+  void CheckInterruptLine();
+
+  void RearmInterrupt();
+  void LogInterruptStats() const;
+
+  /**
+   * Switch to |profile|, logging the latency measured with the previous
+   * profile.
+   */
+  void ApplyScanProfile(const ScanProfile& profile);
+
+  /**
+   * Have the keyboard task switch to |profile| on its next loop.
+   */
+  void RequestScanProfile(const ScanProfile& profile);
+
+  TaskNotifier notifier_;        // Application events.
+  TaskHandle_t task_ = nullptr;  // This task.
+  Keyboard keyboard_;            // All interaction with keyboard.
   SemaphoreHandle_t mutex_;
+  portMUX_TYPE interrupt_time_lock_ = portMUX_INITIALIZER_UNLOCKED;
+  int64_t interrupt_time_us_ = 0;  // Time of first unhandled interrupt.
+  int64_t int_low_since_us_ = 0;   // When INT was first seen asserted.
+  uint32_t num_interrupts_ = 0;
+  uint32_t num_late_interrupts_ = 0;    // Handled after kLateInterruptUsec.
+  uint32_t num_missed_interrupts_ = 0;  // Found by polling the INT line.
+  std::atomic<const ScanProfile*> requested_profile_;
+  const std::string macro_;  // Typed by the TypeMacro function key.
 };
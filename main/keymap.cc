@@ -0,0 +1,259 @@
+#include "keymap.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+#include <class/hid/hid.h>
+#include <esp_log.h>
+
+namespace {
+constexpr char TAG[] = "Keymap";
+constexpr char kFileMagic[4] = {'K', 'M', 'A', 'P'};
+
+struct FileHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t num_layers;
+  uint8_t num_events;
+  uint8_t reserved;
+};
+static_assert(sizeof(FileHeader) == 8);
+
+// Used when no keymap file is present.
+constexpr std::array<uint8_t, 128> kDefaultLayer = {
+    HID_KEY_NONE,          // 0: NONE
+    HID_KEY_E,             // 1: R0_C0
+    HID_KEY_W,             // 2: R0_C1
+    HID_KEY_Q,             // 3: R0_C2
+    HID_KEY_SHIFT_LEFT,    // 4: R0_C3
+    HID_KEY_NONE,          // 5: R0_C4
+    HID_KEY_NONE,          // 6: R0_C5
+    HID_KEY_NONE,          // 7: R0_C6
+    HID_KEY_NONE,          // 8: R0_C7
+    HID_KEY_NONE,          // 9: R0_C8
+    HID_KEY_NONE,          // 10: R0_C9
+    HID_KEY_NONE,          // 11: R0_C10
+    HID_KEY_NONE,          // 12: R1_C0
+    HID_KEY_S,             // 13: R1_C1
+    HID_KEY_A,             // 14: R1_C2
+    HID_KEY_CONTROL_LEFT,  // 15: R1_C3
+    HID_KEY_NONE,          // 16: R1_C4
+    HID_KEY_NONE,          // 17: R1_C5
+    HID_KEY_NONE,          // 18: R1_C6
+    HID_KEY_NONE,          // 19: R1_C7
+    HID_KEY_NONE,          // 20: R1_C8
+    HID_KEY_NONE,          // 21: R1_C9
+    HID_KEY_NONE,          // 22: R1_C10
+    HID_KEY_NONE,          // 23: R2_C0
+    HID_KEY_NONE,          // 24: R2_C1
+    HID_KEY_NONE,          // 25: R2_C2
+    HID_KEY_NONE,          // 26: R2_C3
+    HID_KEY_NONE,          // 27: R2_C4
+    HID_KEY_NONE,          // 28: R2_C5
+    HID_KEY_NONE,          // 29: R2_C6
+    HID_KEY_NONE,          // 30: R2_C7
+    HID_KEY_NONE,          // 31: R2_C8
+    HID_KEY_NONE,          // 32: R2_C9
+    HID_KEY_NONE,          // 33: R2_C10
+    HID_KEY_NONE,          // 34: R3_C0
+    HID_KEY_NONE,          // 35: R3_C1
+    HID_KEY_NONE,          // 36: R3_C2
+    HID_KEY_NONE,          // 37: R3_C3
+    HID_KEY_NONE,          // 38: R3_C4
+    HID_KEY_NONE,          // 39: R3_C5
+    HID_KEY_NONE,          // 40: R3_C6
+    HID_KEY_NONE,          // 41: R3_C7
+    HID_KEY_NONE,          // 42: R3_C8
+    HID_KEY_NONE,          // 43: R3_C9
+    HID_KEY_NONE,          // 44: R3_C10
+    HID_KEY_NONE,          // 45: R4_C0
+    HID_KEY_NONE,          // 46: R4_C1
+    HID_KEY_NONE,          // 47: R4_C2
+    HID_KEY_NONE,          // 48: R4_C3
+    HID_KEY_NONE,          // 49: R4_C4
+    HID_KEY_NONE,          // 50: R4_C5
+    HID_KEY_NONE,          // 51: R4_C6
+    HID_KEY_NONE,          // 52: R4_C7
+    HID_KEY_NONE,          // 53: R4_C8
+    HID_KEY_NONE,          // 54: R4_C9
+    HID_KEY_NONE,          // 55: R4_C10
+    HID_KEY_NONE,          // 56: R5_C0
+    HID_KEY_NONE,          // 57: R5_C1
+    HID_KEY_NONE,          // 58: R5_C2
+    HID_KEY_NONE,          // 59: R5_C3
+    HID_KEY_NONE,          // 60: R5_C4
+    HID_KEY_NONE,          // 61: R5_C5
+    HID_KEY_NONE,          // 62: R5_C6
+    HID_KEY_NONE,          // 63: R5_C7
+    HID_KEY_NONE,          // 64: R5_C8
+    HID_KEY_NONE,          // 65: R5_C9
+    HID_KEY_NONE,          // 66: R5_C10
+    HID_KEY_NONE,          // 67: R6_C0
+    HID_KEY_NONE,          // 68: R6_C1
+    HID_KEY_NONE,          // 69: R6_C2
+    HID_KEY_NONE,          // 70: R6_C3
+    HID_KEY_NONE,          // 71: R6_C4
+    HID_KEY_NONE,          // 72: R6_C5
+    HID_KEY_NONE,          // 73: R6_C6
+    HID_KEY_NONE,          // 74: R6_C7
+    HID_KEY_NONE,          // 75: R6_C8
+    HID_KEY_NONE,          // 76: R6_C9
+    HID_KEY_NONE,          // 77: R6_C10
+    HID_KEY_NONE,          // 78: R7_C0
+    HID_KEY_NONE,          // 79: R7_C1
+    HID_KEY_NONE,          // 80: R7_C2
+    HID_KEY_NONE,          // 81: R7_C3
+    HID_KEY_NONE,          // 82: R7_C4
+    HID_KEY_NONE,          // 83: R7_C5
+    HID_KEY_NONE,          // 84: R7_C6
+    HID_KEY_NONE,          // 85: R7_C7
+    HID_KEY_NONE,          // 86: R7_C8
+    HID_KEY_NONE,          // 87: R7_C9
+    HID_KEY_NONE,          // 88: R7_C10
+    HID_KEY_NONE,          // 89: R0_GND
+    HID_KEY_NONE,          // 90: R1_GND
+    HID_KEY_NONE,          // 91: R2_GND
+    HID_KEY_NONE,          // 92: R3_GND
+    HID_KEY_NONE,          // 93: R4_GND
+    HID_KEY_NONE,          // 94: R5_GND
+    HID_KEY_NONE,          // 95: R6_GND
+    HID_KEY_NONE,          // 96: R7_GND
+    HID_KEY_NONE,          // 97: GPI1
+    HID_KEY_NONE,          // 98: GPI2
+    HID_KEY_NONE,          // 99: GPI3
+    HID_KEY_NONE,          // 100: GPI4
+    HID_KEY_NONE,          // 101: GPI5
+    HID_KEY_NONE,          // 102: GPI6
+    HID_KEY_NONE,          // 103: GPI7
+    HID_KEY_NONE,          // 104: GPI8
+    HID_KEY_NONE,          // 105: GPI9
+    HID_KEY_NONE,          // 106: GPI10
+    HID_KEY_NONE,          // 107: GPI11
+    HID_KEY_NONE,          // 108: GPI12
+    HID_KEY_NONE,          // 109: GPI13
+    HID_KEY_NONE,          // 110: GPI14
+    HID_KEY_NONE,          // 111: GPI15
+    HID_KEY_NONE,          // 112: GPI16
+    HID_KEY_NONE,          // 113: GPI17
+    HID_KEY_NONE,          // 114: GPI18
+    HID_KEY_NONE,          // 115: GPI19
+    HID_KEY_NONE,          // 116: LOGIC_1
+    HID_KEY_NONE,          // 117: LOGIC_2
+    HID_KEY_NONE,          // 118: UNUSED_0
+    HID_KEY_NONE,          // 119: UNUSED_1
+    HID_KEY_NONE,          // 120: UNUSED_2
+    HID_KEY_NONE,          // 121: UNUSED_3
+    HID_KEY_NONE,          // 122: UNUSED_4
+    HID_KEY_NONE,          // 123: UNUSED_5
+    HID_KEY_NONE,          // 124: UNUSED_6
+    HID_KEY_NONE,          // 125: UNUSED_7
+    HID_KEY_NONE,          // 126: UNUSED_8
+    HID_KEY_NONE,          // 127: UNLOCK_WILDCARD
+};
+
+static_assert(kDefaultLayer.size() == Keymap::kNumEvents);
+
+}  // namespace
+
+constexpr char Keymap::kDefaultPath[];
+
+Keymap::Keymap()
+    : layers_(new Layer[1]{kDefaultLayer}),
+      num_layers_(1),
+      active_layer_idx_(0),
+      active_layer_(&layers_[0]) {
+  holds_.fill(HID_KEY_NONE);
+}
+
+Keymap::~Keymap() = default;
+
+esp_err_t Keymap::Load(const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    ESP_LOGW(TAG, "No keymap at \"%s\".", path);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  FileHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) ||
+      !header.version || header.version > kFileVersion || !header.num_layers ||
+      header.num_layers > kMaxLayers || header.num_events != kNumEvents) {
+    ESP_LOGE(TAG, "Invalid keymap header in \"%s\".", path);
+    fclose(f);
+    return ESP_ERR_INVALID_VERSION;
+  }
+
+  std::unique_ptr<Layer[]> layers(new Layer[header.num_layers]);
+  Layer holds = {HID_KEY_NONE};
+  bool truncated = fread(layers.get(), sizeof(Layer), header.num_layers, f) !=
+                   header.num_layers;
+  if (!truncated && header.version >= 2)
+    truncated = fread(holds.data(), sizeof(holds), 1, f) != 1;
+  fclose(f);
+  if (truncated) {
+    ESP_LOGE(TAG, "Truncated keymap \"%s\".", path);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  // Flatten: resolve transparent entries against the (already flattened)
+  // layer below so that every layer is a complete table.
+  for (uint8_t l = 0; l < header.num_layers; l++) {
+    for (size_t i = 0; i < kNumEvents; i++) {
+      uint8_t& code = layers[l][i];
+      if (code == kKeyTransparent) {
+        code = l ? layers[l - 1][i] : HID_KEY_NONE;
+      } else if (IsLayerKey(code) && GetLayer(code) >= header.num_layers) {
+        ESP_LOGW(TAG, "Layer %u event %zu: invalid code 0x%02x.", l, i, code);
+        code = HID_KEY_NONE;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < kNumEvents; i++) {
+    const bool valid_hold =
+        holds[i] < kKeyOneShotBase || IsMediaKey(holds[i]) ||
+        (IsLayerKey(holds[i]) && GetLayer(holds[i]) < header.num_layers);
+    if (!valid_hold) {
+      ESP_LOGW(TAG, "Event %zu: invalid hold 0x%02x.", i, holds[i]);
+      holds[i] = HID_KEY_NONE;
+    }
+  }
+
+  layers_ = std::move(layers);
+  holds_ = holds;
+  num_layers_ = header.num_layers;
+  active_layer_idx_ = 0;
+  active_layer_ = &layers_[0];
+  ESP_LOGI(TAG, "Loaded %u layer keymap from \"%s\".", num_layers_, path);
+  return ESP_OK;
+}
+
+// static
+uint8_t Keymap::GetOneShotModifier(uint8_t code) {
+  return code - kKeyOneShotBase + HID_KEY_CONTROL_LEFT;
+}
+
+// static
+uint16_t Keymap::GetMediaUsage(uint8_t code) {
+  // In the order of scripts/keymap.py MEDIA_KEYS.
+  constexpr uint16_t kMediaUsages[kNumMediaKeys] = {
+      HID_USAGE_CONSUMER_PLAY_PAUSE,
+      HID_USAGE_CONSUMER_SCAN_NEXT,
+      HID_USAGE_CONSUMER_SCAN_PREVIOUS,
+      HID_USAGE_CONSUMER_STOP,
+      HID_USAGE_CONSUMER_MUTE,
+      HID_USAGE_CONSUMER_VOLUME_INCREMENT,
+      HID_USAGE_CONSUMER_VOLUME_DECREMENT,
+  };
+  return kMediaUsages[code - kKeyMediaBase];
+}
+
+void Keymap::SetActiveLayer(uint8_t layer) {
+  if (layer >= num_layers_)
+    return;
+  active_layer_idx_ = layer;
+  active_layer_ = &layers_[layer];
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <esp_err.h>
+
+/**
+ * Maps keyboard IC event IDs to HID keycodes, with support for layers.
+ *
+ * A keymap file (compiled by scripts/keymap.py) holds one or more layers.
+ * On load every layer is flattened into its own complete lookup table, with
+ * transparent entries resolved against the layers below, so a lookup is a
+ * single indexed load and selecting a layer only swaps a pointer.
+ *
+ * Keymap file format (all values are uint8_t):
+ *
+ *   magic[4]        "KMAP"
+ *   version         kFileVersion
+ *   num_layers      1..kMaxLayers
+ *   num_events      kNumEvents
+ *   reserved        0
+ *   codes[num_layers][num_events]
+ *   holds[num_events]                 (version 2 and later)
+ *
+ * Each code is a HID keycode, kKeyTransparent, kKeyLayerBase + N to
+ * momentarily activate layer N while held, kKeyOneShotBase + N for a
+ * one-shot HID_KEY_CONTROL_LEFT + N modifier, kKeyMediaBase + N for
+ * media key N (see GetMediaUsage()), or kKeyFunctionBase + N for keyboard
+ * Function N.
+ *
+ * A non-zero hold makes the key dual-role: tapping it sends its layer code,
+ * holding it acts as the hold code (a HID keycode, layer, or media key)
+ * instead. Holds apply to the physical key in every layer.
+ */
+class Keymap {
+ public:
+  static constexpr size_t kNumEvents = 128;  // ADP5589 event ID range.
+  static constexpr size_t kMaxLayers = 8;
+  static constexpr uint8_t kFileVersion = 2;
+  static constexpr char kDefaultPath[] = "/spiffs/keymap.bin";
+
+  // Codes 0xE8..0xFF are reserved in the HID keyboard usage page, so are
+  // free to use for keymap specific actions.
+  static constexpr uint8_t kKeyOneShotBase = 0xE8;
+  static constexpr uint8_t kKeyLayerBase = 0xF0;
+  static constexpr uint8_t kKeyMediaBase = 0xF8;
+  static constexpr uint8_t kNumMediaKeys = 7;
+  static constexpr uint8_t kKeyTransparent = 0xFF;
+  static_assert(kKeyLayerBase + kMaxLayers == kKeyMediaBase);
+  static_assert(kKeyMediaBase + kNumMediaKeys == kKeyTransparent);
+
+  // Codes 0xA5..0xAF are reserved too, and hold keys acted on by the
+  // keyboard itself rather than sent to the host.
+  static constexpr uint8_t kKeyFunctionBase = 0xA5;
+  enum class Function : uint8_t {
+    NextScanProfile,  // Switch to the next ScanProfile.
+    TypeMacro,        // Type the configured macro text.
+    NumFunctions,
+  };
+  static_assert(kKeyFunctionBase +
+                    static_cast<uint8_t>(Function::NumFunctions) <=
+                0xB0);
+
+  using Layer = std::array<uint8_t, kNumEvents>;
+
+  /**
+   * Create a keymap holding the single built-in layer.
+   */
+  Keymap();
+  ~Keymap();
+
+  /**
+   * Replace all layers with those in the keymap file at |path|.
+   *
+   * On failure the current layers are left unchanged.
+   */
+  esp_err_t Load(const char* path);
+
+  /**
+   * Map |event_id| to a code using the active layer.
+   */
+  uint8_t Lookup(uint8_t event_id) const {
+    return (*active_layer_)[event_id % kNumEvents];
+  }
+
+  /**
+   * The hold code of |event_id|, HID_KEY_NONE if not a dual-role key.
+   */
+  uint8_t LookupHold(uint8_t event_id) const {
+    return holds_[event_id % kNumEvents];
+  }
+
+  /**
+   * Make |layer| the active layer. Out of range layers are ignored.
+   */
+  void SetActiveLayer(uint8_t layer);
+
+  static bool IsLayerKey(uint8_t code) {
+    return code >= kKeyLayerBase && code < kKeyLayerBase + kMaxLayers;
+  }
+
+  static uint8_t GetLayer(uint8_t code) { return code - kKeyLayerBase; }
+
+  static bool IsOneShotKey(uint8_t code) {
+    return code >= kKeyOneShotBase && code < kKeyOneShotBase + 8;
+  }
+
+  // The modifier keycode of a one-shot key.
+  static uint8_t GetOneShotModifier(uint8_t code);
+
+  static bool IsMediaKey(uint8_t code) {
+    return code >= kKeyMediaBase && code < kKeyMediaBase + kNumMediaKeys;
+  }
+
+  // The HID Consumer page usage of a media key.
+  static uint16_t GetMediaUsage(uint8_t code);
+
+  static bool IsFunctionKey(uint8_t code) {
+    return code >= kKeyFunctionBase &&
+           code < kKeyFunctionBase +
+                      static_cast<uint8_t>(Function::NumFunctions);
+  }
+
+  static Function GetFunction(uint8_t code) {
+    return static_cast<Function>(code - kKeyFunctionBase);
+  }
+
+  uint8_t num_layers() const { return num_layers_; }
+  uint8_t active_layer() const { return active_layer_idx_; }
+
+ private:
+  std::unique_ptr<Layer[]> layers_;
+  Layer holds_;
+  uint8_t num_layers_;
+  uint8_t active_layer_idx_;
+  const Layer* active_layer_;
+};
@@ -0,0 +1,102 @@
+#include "keystroke_latency.h"
+
+#include <array>
+#include <atomic>
+
+#define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+#include <esp_idf_version.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "latency_histogram.h"
+
+namespace {
+
+constexpr char TAG[] = "Latency";
+
+std::array<LatencyHistogram,
+           static_cast<size_t>(KeystrokeLatency::Stage::NumStages)>
+    g_histograms = {
+        LatencyHistogram("ISR->read"),
+        LatencyHistogram("read->queue"),
+        LatencyHistogram("queue->submit"),
+        LatencyHistogram("submit->complete"),
+        LatencyHistogram("ISR->complete"),
+};
+
+// Set by Reset(), cleared by the recording task once it clears the
+// histogram, so a histogram is only ever written by one task.
+std::array<std::atomic<bool>,
+           static_cast<size_t>(KeystrokeLatency::Stage::NumStages)>
+    g_reset_requested = {};
+
+esp_timer_handle_t g_log_timer = nullptr;
+const char* g_label = nullptr;
+uint32_t g_last_logged_count = 0;
+
+void LogTimerCb(void* /*arg*/) {
+  const size_t idx = static_cast<size_t>(KeystrokeLatency::Stage::Total);
+  if (g_reset_requested[idx])
+    return;
+  const uint32_t count = g_histograms[idx].count();
+  if (count == g_last_logged_count)
+    return;
+  g_last_logged_count = count;
+  KeystrokeLatency::Log();
+}
+
+}  // namespace
+
+// static
+void KeystrokeLatency::Record(Stage stage, int64_t usec) {
+  const size_t idx = static_cast<size_t>(stage);
+  if (g_reset_requested[idx].load(std::memory_order_relaxed) &&
+      g_reset_requested[idx].exchange(false)) {
+    g_histograms[idx].Reset();
+  }
+  g_histograms[idx].Record(usec);
+}
+
+// static
+void KeystrokeLatency::Log() {
+  if (g_label)
+    ESP_LOGI(TAG, "Keystroke latency (%s):", g_label);
+  else
+    ESP_LOGI(TAG, "Keystroke latency:");
+  for (size_t i = 0; i < g_histograms.size(); i++) {
+    // Not yet cleared, but no longer of interest.
+    if (!g_reset_requested[i])
+      g_histograms[i].Log(TAG);
+  }
+}
+
+// static
+void KeystrokeLatency::Reset() {
+  for (std::atomic<bool>& reset_requested : g_reset_requested)
+    reset_requested = true;
+  g_last_logged_count = 0;
+}
+
+// static
+void KeystrokeLatency::SetLabel(const char* label) {
+  g_label = label;
+}
+
+// static
+esp_err_t KeystrokeLatency::StartPeriodicLog(uint64_t period_usec) {
+  if (g_log_timer)
+    return ESP_ERR_INVALID_STATE;
+  const esp_timer_create_args_t timer_args = {
+    .callback = LogTimerCb,
+    .arg = nullptr,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "KeystrokeLatency",
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+    .skip_unhandled_events = true,
+#endif
+  };
+  esp_err_t err = esp_timer_create(&timer_args, &g_log_timer);
+  if (err != ESP_OK)
+    return err;
+  return esp_timer_start_periodic(g_log_timer, period_usec);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+#include <esp_err.h>
+
+/**
+ * Latency of each stage of a keystroke, from the keyboard interrupt to the
+ * completion of the USB IN transfer carrying the HID report.
+ *
+ * All times are from esp_timer_get_time().
+ */
+class KeystrokeLatency {
+ public:
+  enum class Stage {
+    InterruptToRead,   // Keyboard ISR to keyboard IC events read.
+    ReadToQueue,       // Keyboard IC events read to HID report queued.
+    QueueToSubmit,     // HID report queued to given to TinyUSB.
+    SubmitToComplete,  // HID report given to TinyUSB to transfer complete.
+    Total,             // Keyboard ISR to transfer complete.
+    NumStages,
+  };
+
+  KeystrokeLatency() = delete;
+  ~KeystrokeLatency() = delete;
+
+  /**
+   * Record the duration of a single stage.
+   *
+   * @note Each stage must only be recorded from one task.
+   */
+  static void Record(Stage stage, int64_t usec);
+
+  /**
+   * Write all stage histograms to the log.
+   */
+  static void Log();
+
+  /**
+   * Clear all stage histograms.
+   *
+   * Can be called from any task. Each histogram is cleared by the task
+   * recording it, before its next Record().
+   */
+  static void Reset();
+
+  /**
+   * Set the label, such as the scan profile, logged with the histograms.
+   *
+   * @param label Must outlive all logging, nullptr for none.
+   */
+  static void SetLabel(const char* label);
+
+  /**
+   * Periodically log all stage histograms if there are new samples.
+   */
+  static esp_err_t StartPeriodicLog(uint64_t period_usec);
+};
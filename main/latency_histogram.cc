@@ -0,0 +1,55 @@
+#include "latency_histogram.h"
+
+#define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+#include <esp_log.h>
+
+LatencyHistogram::LatencyHistogram(const char* name) : name_(name) {
+  Reset();
+}
+
+void LatencyHistogram::Reset() {
+  buckets_.fill(0);
+  count_ = 0;
+  total_usec_ = 0;
+  max_usec_ = 0;
+}
+
+// static
+uint32_t LatencyHistogram::BucketLimit(size_t idx) {
+  if (idx >= kNumBuckets - 1)
+    return 0;
+  return kFirstBucketUsec << idx;
+}
+
+void LatencyHistogram::Record(int64_t usec) {
+  if (usec < 0)
+    usec = 0;
+  const uint32_t value = usec > UINT32_MAX ? UINT32_MAX : usec;
+
+  size_t idx = 0;
+  while (idx < kNumBuckets - 1 && value >= BucketLimit(idx))
+    idx++;
+
+  buckets_[idx]++;
+  count_++;
+  total_usec_ += value;
+  if (value > max_usec_)
+    max_usec_ = value;
+}
+
+void LatencyHistogram::Log(const char* tag) const {
+  if (!count_) {
+    ESP_LOGI(tag, "%s: no samples", name_);
+    return;
+  }
+  ESP_LOGI(tag, "%s: n=%u, mean=%llu usec, max=%u usec", name_, count_,
+           total_usec_ / count_, max_usec_);
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    if (!buckets_[i])
+      continue;
+    if (BucketLimit(i))
+      ESP_LOGI(tag, "  < %6u usec: %u", BucketLimit(i), buckets_[i]);
+    else
+      ESP_LOGI(tag, "  >=%6u usec: %u", BucketLimit(i - 1), buckets_[i]);
+  }
+}
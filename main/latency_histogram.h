@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fixed bucket histogram of latency values.
+ *
+ * Bucket 0 counts values below kFirstBucketUsec, each following bucket is
+ * twice as wide as the previous, and the last bucket counts everything
+ * larger. Recording is constant time and never allocates.
+ *
+ * @note Record() must only be called from one task. Reading from another
+ *       task is safe, but may see a partially updated histogram.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr uint32_t kFirstBucketUsec = 32;
+  static constexpr size_t kNumBuckets = 16;
+
+  explicit LatencyHistogram(const char* name);
+
+  void Record(int64_t usec);
+  void Reset();
+
+  /**
+   * Write the histogram to the log.
+   */
+  void Log(const char* tag) const;
+
+  const char* name() const { return name_; }
+  uint32_t count() const { return count_; }
+
+  /**
+   * The exclusive upper bound (in usec) of bucket |idx|, zero for the
+   * last (unbounded) bucket.
+   */
+  static uint32_t BucketLimit(size_t idx);
+
+ private:
+  const char* name_;
+  std::array<uint32_t, kNumBuckets> buckets_;
+  uint32_t count_;
+  uint64_t total_usec_;
+  uint32_t max_usec_;
+};
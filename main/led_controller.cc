@@ -24,6 +24,7 @@ namespace {
 
 constexpr char TAG[] = "LED";
 constexpr uint64_t kLEDOffDelayUsec = 50 * 1000;
+constexpr uint8_t kIdleIntensity = 32;  // RGB LED when no lock is on.
 LEDController* g_led_controller;  // For testing.
 
 }  // namespace
@@ -31,12 +32,16 @@ LEDController* g_led_controller;  // For testing.
 LEDController::LEDController(gpio_num_t activity_gpio)
     : activity_gpio_(activity_gpio),
       led_off_timer_(nullptr),
+      lock_state_timer_(nullptr),
+      lock_state_(0),
       rgbled_(GPIO_NUM_45, GPIO_NUM_40, HSPI_HOST) {
   g_led_controller = this;
 }
 
 LEDController::~LEDController() {
   esp_timer_stop(led_off_timer_);
+  if (lock_state_timer_)
+    esp_timer_delete(lock_state_timer_);
   gpio_set_level(activity_gpio_, 0);
   g_led_controller = nullptr;
 }
@@ -46,6 +51,11 @@ void IRAM_ATTR LEDController::ActivityTimerCb(void* param) {
   gpio_set_level(static_cast<LEDController*>(param)->activity_gpio_, 0);
 }
 
+// static:
+void LEDController::LockStateTimerCb(void* param) {
+  static_cast<LEDController*>(param)->ShowLockState();
+}
+
 // static:
 LEDController* LEDController::GetForTesting() {
   return g_led_controller;
@@ -73,11 +83,27 @@ esp_err_t LEDController::Initialize() {
     return err;
 #endif
   err = gpio_set_level(activity_gpio_, 0);
+  if (err != ESP_OK)
+    return err;
+  err = CreateLockStateTimer();
   if (err != ESP_OK)
     return err;
   return CreateActivityTimer();
 }
 
+esp_err_t LEDController::CreateLockStateTimer() {
+  const esp_timer_create_args_t timer_args = {
+    .callback = LockStateTimerCb,
+    .arg = this,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "LockStateTimer",
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+    .skip_unhandled_events = true,
+#endif
+  };
+  return esp_timer_create(&timer_args, &lock_state_timer_);
+}
+
 esp_err_t LEDController::CreateActivityTimer() {
   const esp_timer_create_args_t timer_args = {
     .callback = ActivityTimerCb,
@@ -105,3 +131,22 @@ void LEDController::SetRGBLED(uint8_t red,
   ESP_ERROR_CHECK_WITHOUT_ABORT(
       rgbled_.Set(APA102::Color(red, green, blue, intensity >> 3)));
 }
+
+void LEDController::LockStateChanged(uint8_t lock_state) {
+  lock_state_ = lock_state;
+  // Fails harmlessly if already started, the callback reads the latest state.
+  if (lock_state_timer_)
+    esp_timer_start_once(lock_state_timer_, 0);
+}
+
+void LEDController::ShowLockState() {
+  const uint8_t lock_state = lock_state_;
+  if (!lock_state) {
+    SetRGBLED(0, 255, 0, kIdleIntensity);
+    return;
+  }
+  // One color channel per lock: Caps = red, Scroll = green, Num = blue.
+  SetRGBLED(lock_state & KEYBOARD_LED_CAPSLOCK ? 255 : 0,
+            lock_state & KEYBOARD_LED_SCROLLLOCK ? 255 : 0,
+            lock_state & KEYBOARD_LED_NUMLOCK ? 255 : 0);
+}
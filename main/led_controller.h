@@ -13,14 +13,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+
 #include <driver/gpio.h>
 #include <esp_attr.h>
 #include <esp_err.h>
 #include <esp_timer.h>
 
 #include "apa102.h"
+#include "usb_hid.h"
 
-class LEDController {
+/**
+ * Drives the activity LED and the RGB LED, which shows the host's keyboard
+ * lock state.
+ */
+class LEDController : public usb::LockStateClient {
  public:
   explicit LEDController(gpio_num_t activity_gpio);
   ~LEDController();
@@ -42,12 +50,21 @@ class LEDController {
                  uint8_t blue,
                  uint8_t intensity = 255);
 
+  // usb::LockStateClient:
+  void LockStateChanged(uint8_t lock_state) override;
+
  private:
   static void IRAM_ATTR ActivityTimerCb(void*);
+  static void LockStateTimerCb(void*);
 
   esp_err_t CreateActivityTimer();
+  esp_err_t CreateLockStateTimer();
+  void ShowLockState();
 
   gpio_num_t activity_gpio_;
   esp_timer_handle_t led_off_timer_;
+  // Sets the RGB LED on the timer task, so the USB task never waits for SPI.
+  esp_timer_handle_t lock_state_timer_;
+  std::atomic<uint8_t> lock_state_;  // KEYBOARD_LED_* bits.
   APA102 rgbled_;  // For Feather S2.
 };
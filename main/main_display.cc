@@ -9,6 +9,7 @@
 #include <lvgl_touch/touch_driver.h>
 
 #include "main_screen.h"
+#include "trackpad_task.h"
 
 namespace {
 constexpr char TAG[] = "MainDisp";
@@ -59,7 +60,9 @@ esp_err_t MainDisplay::InitializeDisplayDriver() {
 esp_err_t MainDisplay::InitializeTouchPanelDriver() {
 #if CONFIG_LV_TOUCH_CONTROLLER != TOUCH_CONTROLLER_NONE
   lv_indev_drv_init(&indev_drv_);
-  indev_drv_.read_cb = touch_driver_read;
+  // Reads go through the trackpad, which shares the panel. In trackpad mode
+  // LVGL keeps this input device but sees no touches.
+  indev_drv_.read_cb = TrackpadTask::TouchReadCb;
   indev_drv_.feedback_cb = TouchDriverFeedback;
   indev_drv_.type = LV_INDEV_TYPE_POINTER;
   input_device_ = lv_indev_drv_register(&indev_drv_);
@@ -14,6 +14,7 @@
 #include "images/wifi_offline.h"
 #include "images/wifi_online.h"
 #include "main_display.h"
+#include "trackpad_task.h"
 
 namespace {
 constexpr char TAG[] = "MainScreen";
@@ -153,9 +154,22 @@ esp_err_t MainScreen::LoadGearImage() {
   lv_img_set_src(img_gear_, &gear);
   lv_obj_set_pos(img_gear_, 2, 0);
   lv_obj_set_size(img_gear_, kStatusBarIconWidth, kStatusBarIconHeight);
+  lv_obj_set_click(img_gear_, true);
+  lv_obj_set_event_cb(img_gear_, GearEventCb);
   return ESP_OK;
 }
 
+// static
+void MainScreen::GearEventCb(lv_obj_t* obj, lv_event_t event) {
+  if (event == LV_EVENT_CLICKED)
+    ESP_ERROR_CHECK_WITHOUT_ABORT(TrackpadTask::SetEnabled(true));
+}
+
+void MainScreen::SetTrackpadMode(bool enabled) {
+  if (lbl_trackpad_)
+    lv_obj_set_hidden(lbl_trackpad_, !enabled);
+}
+
 esp_err_t MainScreen::LoadSpotifyImage() {
   img_spotify_ = lv_img_create(disp().lv_screen(), nullptr);
   if (!img_spotify_)
@@ -166,6 +180,29 @@ esp_err_t MainScreen::LoadSpotifyImage() {
   return ESP_OK;
 }
 
+esp_err_t MainScreen::CreateLockStateLabel() {
+  lbl_lock_state_ = lv_label_create(disp().lv_screen(), nullptr);
+  if (!lbl_lock_state_)
+    return ESP_FAIL;
+  lv_label_set_text(lbl_lock_state_, "");
+  lv_obj_set_pos(lbl_lock_state_, kStatusBarIconWidth + 8, 2);
+
+  lbl_trackpad_ = lv_label_create(disp().lv_screen(), nullptr);
+  if (!lbl_trackpad_)
+    return ESP_FAIL;
+  lv_label_set_text(lbl_trackpad_, "Trackpad: hold here to exit");
+  lv_obj_set_pos(lbl_trackpad_, kStatusBarIconWidth + 8, kStatusBarHeight);
+  lv_obj_set_hidden(lbl_trackpad_, true);
+  return ESP_OK;
+}
+
+void MainScreen::SetLockState(bool num_lock, bool caps_lock, bool scroll_lock) {
+  if (!lbl_lock_state_)
+    return;
+  lv_label_set_text_fmt(lbl_lock_state_, "%s%s%s", caps_lock ? "A " : "",
+                        num_lock ? "1 " : "", scroll_lock ? "S" : "");
+}
+
 esp_err_t MainScreen::CreateTimeLabel() {
   constexpr lv_coord_t kTimeWidth = 105;
 
@@ -223,6 +260,10 @@ esp_err_t MainScreen::InitializeStatusBar() {
     return err;
   UpdateTime();
 
+  err = CreateLockStateLabel();
+  if (err != ESP_OK)
+    return err;
+
   return ESP_OK;
 }
 
@@ -233,23 +274,22 @@ esp_err_t MainScreen::CreateSongDataLabels() {
   lv_coord_t top = kStatusBarHeight - 12;
   lv_obj_t* screen = disp().lv_screen();
 
-  lbl_test_ = lv_label_create(screen, nullptr);
-  if (!lbl_test_)
+  lbl_artist_ = lv_label_create(screen, nullptr);
+  if (!lbl_artist_)
     return ESP_FAIL;
-  lv_label_set_text(lbl_test_, "Artist: <Name of artist>");
-  lv_obj_set_pos(lbl_test_, kMargin, top += kLineHeight);
+  lv_obj_set_pos(lbl_artist_, kMargin, top += kLineHeight);
 
-  lv_obj_t* album = lv_label_create(screen, nullptr);
-  if (!album)
+  lbl_album_ = lv_label_create(screen, nullptr);
+  if (!lbl_album_)
     return ESP_FAIL;
-  lv_label_set_text(album, "Album: <Name of album>");
-  lv_obj_set_pos(album, kMargin, top += kLineHeight);
+  lv_obj_set_pos(lbl_album_, kMargin, top += kLineHeight);
 
-  lv_obj_t* song = lv_label_create(screen, nullptr);
-  if (!song)
+  lbl_song_ = lv_label_create(screen, nullptr);
+  if (!lbl_song_)
     return ESP_FAIL;
-  lv_label_set_text(song, "Song: <Name of song>");
-  lv_obj_set_pos(song, kMargin, top += kLineHeight);
+  lv_obj_set_pos(lbl_song_, kMargin, top += kLineHeight);
+
+  SetTrackInfo("<Name of artist>", "<Name of album>", "<Name of song>");
   return ESP_OK;
 }
 
@@ -259,6 +299,17 @@ void MainScreen::SetDebugString(const char* str) {
 }
 #endif
 
+void MainScreen::SetTrackInfo(const std::string& artist,
+                              const std::string& album,
+                              const std::string& title) {
+  if (lbl_artist_)
+    lv_label_set_text_fmt(lbl_artist_, "Artist: %s", artist.c_str());
+  if (lbl_album_)
+    lv_label_set_text_fmt(lbl_album_, "Album: %s", album.c_str());
+  if (lbl_song_)
+    lv_label_set_text_fmt(lbl_song_, "Song: %s", title.c_str());
+}
+
 void MainScreen::SetAlbumArtwork(lv_img_dsc_t image) {
   if (!img_album_)
     return;
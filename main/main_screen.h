@@ -26,22 +26,34 @@ class MainScreen : public Screen {
   void SetDebugString(const char* str);
 #endif
   void SetAlbumArtwork(lv_img_dsc_t image);
+  void SetLockState(bool num_lock, bool caps_lock, bool scroll_lock);
+  void SetTrackpadMode(bool enabled);
+  void SetTrackInfo(const std::string& artist,
+                    const std::string& album,
+                    const std::string& title);
 
  private:
   esp_err_t InitializeStatusBar();
   void UpdateWiFi();
   esp_err_t LoadWiFiImages();
+  static void GearEventCb(lv_obj_t* obj, lv_event_t event);
+
   esp_err_t LoadGearImage();
   esp_err_t LoadSpotifyImage();
   esp_err_t CreateTimeLabel();
+  esp_err_t CreateLockStateLabel();
   esp_err_t CreateSongDataLabels();
   esp_err_t CreateAlbumArtwork();
   void UpdateRating();
   esp_err_t LoadRatingImages();
 
   lv_img_dsc_t album_cover_image_;
-  lv_obj_t* lbl_test_ = nullptr;
+  lv_obj_t* lbl_artist_ = nullptr;
+  lv_obj_t* lbl_album_ = nullptr;
+  lv_obj_t* lbl_song_ = nullptr;
   lv_obj_t* lbl_time_ = nullptr;
+  lv_obj_t* lbl_lock_state_ = nullptr;
+  lv_obj_t* lbl_trackpad_ = nullptr;
 #ifdef DEBUG_STRING
   lv_obj_t* lbl_debug_msg_ = nullptr;
 #endif
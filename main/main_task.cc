@@ -1,19 +1,25 @@
 #include "main_task.h"
 
+#include <algorithm>
+
 #define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
 #include <esp_log.h>
 #include <esp_sntp.h>
+#include <esp_timer.h>
 #include <i2clib/master.h>
 #include <nvs_flash/include/nvs_flash.h>
 
 #include "config_reader.h"
 #include "event_ids.h"
 #include "gpio_pins.h"
-#include "keyboard_simulator_task.h"
+#include "http_client.h"
 #include "keyboard_task.h"
+#include "notify_benchmark_task.h"
+#include "trackpad_task.h"
 #include "ui_task.h"
 #include "usb_device.h"
 #include "usb_hid.h"
+#include "usb_host_channel.h"
 #include "usb_task.h"
 #include "volume_task.h"
 
@@ -21,6 +27,14 @@ namespace {
 
 constexpr char TAG[] = "MainTask";
 
+// After resuming the bus the host waits 10 ms (TRSMRCY) before using the
+// device, so everything paused while suspended should be running by then.
+constexpr int64_t kResumeBudgetUsec = 10 * 1000;
+
+// Idle HTTP connections are closed between one and 1.5 idle timeouts after
+// their last request.
+constexpr int64_t kIdleSweepPeriodUsec = HTTPClient::kIdleTimeoutUsec / 2;
+
 MainTask* g_main_task;
 
 esp_err_t InitNVRAM() {
@@ -42,13 +56,16 @@ void SNTPSyncEventHandler(struct timeval* tv) {
 
 MainTask::MainTask()
     : led_controller_(kActivityGPIO),
-      event_group_(xEventGroupCreate()),
-      wifi_(event_group_),
-      spotify_(&config_, &https_server_, &wifi_, event_group_) {}
+      wifi_(&notifier_),
+      spotify_(&config_, &https_server_, &wifi_, &notifier_) {}
 
 MainTask::~MainTask() {
-  if (event_group_)
-    vEventGroupDelete(event_group_);
+  if (poll_timer_)
+    esp_timer_delete(poll_timer_);
+  if (idle_sweep_timer_) {
+    esp_timer_stop(idle_sweep_timer_);
+    esp_timer_delete(idle_sweep_timer_);
+  }
   g_main_task = nullptr;
 }
 
@@ -75,6 +92,31 @@ esp_err_t MainTask::Start() {
   return g_main_task->Initialize();
 }
 
+void MainTask::MediaKeyPressed(uint16_t usage) {
+  // Only keys which change what is playing (rather than, say, the volume)
+  // need a poll.
+  switch (usage) {
+    case HID_USAGE_CONSUMER_PLAY_PAUSE:
+    case HID_USAGE_CONSUMER_SCAN_NEXT:
+    case HID_USAGE_CONSUMER_SCAN_PREVIOUS:
+    case HID_USAGE_CONSUMER_STOP:
+      notifier_.Notify(EVENT_MEDIA_KEY);
+      break;
+    default:
+      break;
+  }
+}
+
+// static
+void MainTask::PollTimerCb(void* arg) {
+  static_cast<MainTask*>(arg)->notifier_.Notify(EVENT_SPOTIFY_POLL);
+}
+
+// static
+void MainTask::IdleSweepTimerCb(void* arg) {
+  static_cast<MainTask*>(arg)->notifier_.Notify(EVENT_HTTP_IDLE_SWEEP);
+}
+
 /**
  * Initialize SNTP and get the current time.
  *
@@ -138,9 +180,6 @@ esp_err_t MainTask::Initialize() {
 
   esp_err_t err;
 
-  if (!event_group_)
-    return ESP_FAIL;
-
   err = InitNVRAM();
   if (err != ESP_OK)
     return err;
@@ -169,22 +208,62 @@ esp_err_t MainTask::Initialize() {
 
   ESP_ERROR_CHECK_WITHOUT_ABORT(SetTimezone());
 
+  const esp_timer_create_args_t poll_timer_args = {
+    .callback = PollTimerCb,
+    .arg = this,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "SpotifyPoll",
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+    .skip_unhandled_events = true,
+#endif
+  };
+  err = esp_timer_create(&poll_timer_args, &poll_timer_);
+  if (err != ESP_OK)
+    return err;
+
+  const esp_timer_create_args_t idle_sweep_timer_args = {
+    .callback = IdleSweepTimerCb,
+    .arg = this,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "HTTPIdleSweep",
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+    .skip_unhandled_events = true,
+#endif
+  };
+  err = esp_timer_create(&idle_sweep_timer_args, &idle_sweep_timer_);
+  if (err != ESP_OK)
+    return err;
+  err = esp_timer_start_periodic(idle_sweep_timer_, kIdleSweepPeriodUsec);
+  if (err != ESP_OK)
+    return err;
+
   err = led_controller_.Initialize();
   if (err != ESP_OK)
     return err;
 
+  usb::Device::SetPowerStateClient(this);
+  usb::HID::SetLockStateClient(&led_controller_);
+  usb::HID::SetKeyboardReportMode(config_.keyboard.nkro
+                                      ? usb::KeyboardReportMode::NKRO
+                                      : usb::KeyboardReportMode::Boot);
+  if (config_.usb.host_channel)
+    usb::HostChannel::Enable(UITask::now_playing_client());
   err = USBTask::Start();
   if (err != ESP_OK)
     return err;
 
-  err = KeyboardTask::Start();
+  KeyboardTask::SetMediaKeyClient(this);
+  err = KeyboardTask::Start(config_.keyboard.scan_profile,
+                            config_.keyboard.macro);
   if (err != ESP_OK)
     return err;
 
-#if 0
-  // Just for testing.
-  KeyboardSimulatorTask::Start();
-#endif
+  err = TrackpadTask::Start(config_.touch.trackpad);
+  if (err != ESP_OK)
+    return err;
+
+  if (config_.debug.notify_benchmark)
+    ESP_ERROR_CHECK_WITHOUT_ABORT(NotifyBenchmarkTask::Start());
 
   err = VolumeTask::Start();
   if (err != ESP_OK)
@@ -198,10 +277,67 @@ esp_err_t MainTask::Initialize() {
   if (err != ESP_OK)
     return err;
 
-  return xTaskCreate(TaskFunc, TAG, kStackDepthWords, this,
-                     tskIDLE_PRIORITY + 1, &task_) == pdPASS
-             ? ESP_OK
-             : ESP_FAIL;
+  if (xTaskCreate(TaskFunc, TAG, kStackDepthWords, this, tskIDLE_PRIORITY + 1,
+                  &task_) != pdPASS) {
+    return ESP_FAIL;
+  }
+  // Wi-Fi events since connecting are delivered now.
+  notifier_.SetTask(task_);
+  return ESP_OK;
+}
+
+void MainTask::USBSuspended(bool /*remote_wakeup_enabled*/) {
+  usb_suspended_ = true;
+  notifier_.Notify(EVENT_USB_POWER_STATE);
+}
+
+void MainTask::USBResumed() {
+  usb_resume_time_us_ = esp_timer_get_time();
+  usb_suspended_ = false;
+  notifier_.Notify(EVENT_USB_POWER_STATE);
+}
+
+void MainTask::UpdatePowerState() {
+  // Only the latest state matters if the host suspended and resumed since
+  // the last update.
+  const bool suspended = usb_suspended_;
+  switch (power_state_) {
+    case PowerState::Active:
+      if (!suspended)
+        return;
+      ESP_LOGI(TAG, "USB suspended, pausing UI and network.");
+      power_state_ = PowerState::Suspended;
+      UITask::Suspend();
+      VolumeTask::Suspend();
+      // Nothing is requested while suspended, so free every connection's
+      // buffers now rather than waking to sweep them.
+      esp_timer_stop(idle_sweep_timer_);
+      HTTPClient::CloseIdleConnections(/*min_idle_us=*/0);
+      ESP_ERROR_CHECK_WITHOUT_ABORT(wifi_.SetLowPower(true));
+      break;
+    case PowerState::Suspended: {
+      if (suspended)
+        return;
+      power_state_ = PowerState::Active;
+      ESP_ERROR_CHECK_WITHOUT_ABORT(wifi_.SetLowPower(false));
+      VolumeTask::Resume();
+      UITask::Resume();
+      ESP_ERROR_CHECK_WITHOUT_ABORT(
+          esp_timer_start_periodic(idle_sweep_timer_, kIdleSweepPeriodUsec));
+      const int64_t resume_usec = esp_timer_get_time() - usb_resume_time_us_;
+      if (resume_usec > kResumeBudgetUsec) {
+        ESP_LOGW(TAG, "Resumed in %lld usec, over budget (%lld usec).",
+                 resume_usec, kResumeBudgetUsec);
+      } else {
+        ESP_LOGI(TAG, "Resumed in %lld usec.", resume_usec);
+      }
+      if (spotify_update_pending_) {
+        spotify_update_pending_ = false;
+        UpdateSpotify();
+      }
+      break;
+    }
+  }
 }
 
 // TODO: Clean this up. Make Spotify manage it's state and
@@ -209,10 +345,20 @@ esp_err_t MainTask::Initialize() {
 void MainTask::UpdateSpotify() {
   if (!online_)
     return;
+  if (power_state_ == PowerState::Suspended) {
+    spotify_update_pending_ = true;
+    return;
+  }
   if (!spotify_.initialized()) {
     ESP_ERROR_CHECK_WITHOUT_ABORT(spotify_.Initialize());
-    std::string auth_start_url = spotify_.GetAuthStartURL();
-    ESP_LOGI(TAG, "To login to Spotify navigate to %s", auth_start_url.c_str());
+    if (spotify_.HaveRefreshToken()) {
+      // Logged in on an earlier boot, no need to wait for the user.
+      spotify_need_access_token_refresh_ = true;
+    } else {
+      std::string auth_start_url = spotify_.GetAuthStartURL();
+      ESP_LOGI(TAG, "To login to Spotify navigate to %s",
+               auth_start_url.c_str());
+    }
   }
 
   if (spotify_.initialized()) {
@@ -222,27 +368,71 @@ void MainTask::UpdateSpotify() {
     } else if (spotify_need_access_token_refresh_) {
       spotify_need_access_token_refresh_ = false;
       spotify_.RefreshAccessToken();
-    } else if (!started_spotify_currently_playing_ &&
-               spotify_.HaveAccessToken()) {
-      ESP_LOGD(TAG, "Getting Spotify currently playing info.");
-      started_spotify_currently_playing_ = true;
-      ESP_ERROR_CHECK_WITHOUT_ABORT(spotify_.GetCurrentlyPlaying());
+    } else if (spotify_.HaveAccessToken()) {
+      PollCurrentlyPlaying();
+    }
+  }
+}
+
+/**
+ * Poll Spotify if the PollScheduler says a poll is due, and set the timer
+ * for the next one.
+ */
+void MainTask::PollCurrentlyPlaying() {
+  if (esp_timer_get_time() >= poll_scheduler_.next_poll_us()) {
+    ESP_LOGD(TAG, "Getting Spotify currently playing info.");
+    Spotify::Playback playback;
+    const esp_err_t err = spotify_.GetCurrentlyPlaying(&playback);
+    const int64_t now = esp_timer_get_time();
+    if (err == ESP_OK) {
+      if (!logged_first_playback_) {
+        logged_first_playback_ = true;
+        ESP_LOGI(TAG, "Boot to first currently playing response: %lld msec.",
+                 now / 1000);
+      }
+      UITask::SetArtworkURL(playback.artwork_url);
+      const PollScheduler::Playback state = {
+          .is_player_active = playback.is_player_active,
+          .is_playing = playback.is_playing,
+          .progress_ms = playback.progress_ms,
+          .duration_ms = playback.duration_ms,
+      };
+      poll_scheduler_.PollSucceeded(now, state);
+    } else {
+      poll_scheduler_.PollFailed(
+          now, static_cast<int64_t>(playback.retry_after_secs) * 1000 * 1000);
     }
   }
+  SchedulePoll();
+}
+
+void MainTask::SchedulePoll() {
+  const int64_t delay_us =
+      poll_scheduler_.next_poll_us() - esp_timer_get_time();
+  ESP_LOGD(TAG, "Next Spotify poll in %lld msec.", delay_us / 1000);
+  esp_timer_stop(poll_timer_);  // Fails if not running, which is fine.
+  ESP_ERROR_CHECK_WITHOUT_ABORT(esp_timer_start_once(
+      poll_timer_, static_cast<uint64_t>(std::max<int64_t>(delay_us, 0))));
 }
 
 void IRAM_ATTR MainTask::Run() {
   ESP_LOGW(TAG, "In Wi-Fi status task handler.");
   while (true) {
-    EventBits_t bits =
-        xEventGroupWaitBits(event_group_, EVENT_ALL, /*xClearOnExit=*/pdTRUE,
-                            /*xWaitForAllBits=*/pdFALSE, portMAX_DELAY);
+    const uint32_t bits = notifier_.Wait(portMAX_DELAY);
+    if (bits & EVENT_USB_POWER_STATE)
+      UpdatePowerState();
+    if (bits & EVENT_HTTP_IDLE_SWEEP)
+      HTTPClient::CloseIdleConnections();
     if (bits & EVENT_NETWORK_GOT_IP) {
       ESP_LOGD(TAG, "Wi-Fi is connected.");
       online_ = true;
       UITask::SetWiFiStatus(WiFiStatus::Online);
-      if (!sntp_initialized_)
+      // SNTP syncs in the background while a saved login's access token is
+      // refreshed, which doesn't need the time.
+      if (!sntp_initialized_) {
+        ESP_LOGI(TAG, "Boot to IP: %lld msec.", esp_timer_get_time() / 1000);
         InitializSNTP();
+      }
       UpdateSpotify();
     } else if (bits & EVENT_NETWORK_DISCONNECTED) {
       ESP_LOGW(TAG, "Wi-Fi connection failed.");
@@ -258,10 +448,25 @@ void IRAM_ATTR MainTask::Run() {
       ESP_LOGD(TAG, "Have access token");
       UpdateSpotify();
     }
+    if (bits & EVENT_SPOTIFY_ACCESS_TOKEN_FAILURE) {
+      // A rejected refresh token is forgotten, so log in again.
+      if (!spotify_.HaveRefreshToken()) {
+        std::string auth_start_url = spotify_.GetAuthStartURL();
+        ESP_LOGI(TAG, "To login to Spotify navigate to %s",
+                 auth_start_url.c_str());
+      }
+    }
     if (bits & EVENT_SPOTIFY_ACCESS_TOKEN_EXPIRE) {
       ESP_LOGD(TAG, "Access token needs refresh");
+      spotify_need_access_token_refresh_ = true;
       UpdateSpotify();
     }
+    if (bits & EVENT_MEDIA_KEY) {
+      poll_scheduler_.UserInput(esp_timer_get_time());
+      UpdateSpotify();
+    }
+    if (bits & EVENT_SPOTIFY_POLL)
+      UpdateSpotify();
   }
 }
 
@@ -1,16 +1,22 @@
 #pragma once
 
+#include <atomic>
+
 #include <freertos/include/freertos/FreeRTOS.h>
-#include <freertos/include/freertos/event_groups.h>
 #include <freertos/include/freertos/task.h>
 
 #include <esp_err.h>
+#include <esp_timer.h>
 
 #include "config.h"
 #include "filesystem.h"
 #include "http_server.h"
+#include "keyboard_task.h"
 #include "led_controller.h"
+#include "poll_scheduler.h"
 #include "spotify.h"
+#include "task_notifier.h"
+#include "usb_device.h"
 #include "wifi.h"
 
 /**
@@ -19,21 +25,38 @@
  * Responsible for starting all other tasks, maintaining application
  * state, and distributing state to other tasks when necessary.
  */
-class MainTask {
+class MainTask : public usb::PowerStateClient, public MediaKeyClient {
  public:
   static esp_err_t Start();
 
+  // MediaKeyClient:
+  void MediaKeyPressed(uint16_t usage) override;
+
+  // usb::PowerStateClient:
+  void USBSuspended(bool remote_wakeup_enabled) override;
+  void USBResumed() override;
+
  private:
   static void IRAM_ATTR TaskFunc(void* arg);
+  static void PollTimerCb(void* arg);
+  static void IdleSweepTimerCb(void* arg);
 
  public:
   static esp_err_t InitializeI2C();
 
  private:
+  enum class PowerState {
+    Active,     // Normal operation.
+    Suspended,  // USB host suspended, UI and network work paused.
+  };
+
   MainTask();
   ~MainTask();
 
+  void UpdatePowerState();
   void UpdateSpotify();
+  void PollCurrentlyPlaying();
+  void SchedulePoll();
   esp_err_t SetTimezone();
   esp_err_t InitializSNTP();
   esp_err_t Initialize();
@@ -43,12 +66,21 @@ class MainTask {
   Filesystem filesystem_;           // Filesystem object.
   HTTPServer https_server_;         // Local HTTPS server.
   LEDController led_controller_;    // Set all LED's.
-  EventGroupHandle_t event_group_;  // Application events.
+  TaskNotifier notifier_;           // Application events.
   WiFi wifi_;                       // Controls WiFi.
   Spotify spotify_;                 // Interface with Spotify.
   TaskHandle_t task_ = nullptr;     // Event task.
   bool online_ = false;             // Is device on the network?
-  bool started_spotify_currently_playing_ = false;
   bool spotify_need_access_token_refresh_ = false;
+  PollScheduler poll_scheduler_;             // When to poll Spotify.
+  esp_timer_handle_t poll_timer_ = nullptr;  // Fires when a poll is due.
+  // Periodically closes idle HTTP connections.
+  esp_timer_handle_t idle_sweep_timer_ = nullptr;
   bool sntp_initialized_ = false;
+  bool logged_first_playback_ = false;  // Boot to playback time logged.
+  PowerState power_state_ = PowerState::Active;
+  bool spotify_update_pending_ = false;  // Deferred while suspended.
+  // Set on the USB task, applied by UpdatePowerState().
+  std::atomic<bool> usb_suspended_{false};
+  std::atomic<int64_t> usb_resume_time_us_{0};
 };
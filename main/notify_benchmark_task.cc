@@ -0,0 +1,196 @@
+#include "notify_benchmark_task.h"
+
+#include <algorithm>
+
+#define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+#include <driver/gpio.h>
+#include <esp_idf_version.h>
+#include <esp_log.h>
+
+#include "gpio_pins.h"
+
+namespace {
+constexpr char TAG[] = "NotifyBench";
+constexpr int ESP_INTR_FLAG_DEFAULT = 0x0;  // No flags set.
+constexpr uint32_t EVENT_WAKE = BIT0;
+
+constexpr size_t kNumSamples = 1000;  // Per mechanism.
+// Delay from waiting until the interrupt, so the task is blocked.
+constexpr uint64_t kTriggerDelayUsec = 1000;
+constexpr TickType_t kWakeTimeout = pdMS_TO_TICKS(100);
+constexpr TickType_t kBenchmarkPeriod = pdMS_TO_TICKS(10 * 1000);
+}  // namespace
+
+NotifyBenchmarkTask::NotifyBenchmarkTask()
+    : event_group_(xEventGroupCreate()) {
+  samples_.reserve(kNumSamples);
+}
+
+NotifyBenchmarkTask::~NotifyBenchmarkTask() {
+  if (trigger_timer_)
+    esp_timer_delete(trigger_timer_);
+  if (event_group_)
+    vEventGroupDelete(event_group_);
+}
+
+// static
+esp_err_t NotifyBenchmarkTask::Start() {
+  static NotifyBenchmarkTask* task = nullptr;
+
+  ESP_LOGD(TAG, "Starting notify benchmark task");
+  if (task)
+    return ESP_FAIL;
+
+  task = new NotifyBenchmarkTask();
+  return task->Initialize();
+}
+
+esp_err_t NotifyBenchmarkTask::Initialize() {
+  // https://www.freertos.org/FAQMem.html#StackSize
+  constexpr uint32_t kStackDepthWords = 2048;
+
+  if (!event_group_)
+    return ESP_FAIL;
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = TriggerTimerCb,
+      .arg = this,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "NotifyBenchTrigger",
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+      .skip_unhandled_events = false,
+#endif
+  };
+  esp_err_t err = esp_timer_create(&timer_args, &trigger_timer_);
+  if (err != ESP_OK)
+    return err;
+
+  err = InstallISR();
+  if (err != ESP_OK)
+    return err;
+
+  // Same priority as KeyboardTask.
+  if (xTaskCreate(TaskFunc, TAG, kStackDepthWords, this, tskIDLE_PRIORITY + 1,
+                  &task_) != pdPASS) {
+    return ESP_FAIL;
+  }
+  notifier_.SetTask(task_);
+  return ESP_OK;
+}
+
+esp_err_t NotifyBenchmarkTask::InstallISR() {
+  constexpr gpio_config_t io_conf = {
+      .pin_bit_mask = 1ULL << kBenchmarkGPIO,
+      .mode = GPIO_MODE_INPUT_OUTPUT,
+      .pull_up_en = GPIO_PULLUP_DISABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = GPIO_INTR_POSEDGE,
+  };
+
+  esp_err_t err = gpio_config(&io_conf);
+  if (err != ESP_OK)
+    return err;
+  gpio_set_level(kBenchmarkGPIO, 0);
+
+  // Already installed if the keyboard task is running.
+  err = gpio_install_isr_service(ESP_INTR_FLAG_DEFAULT);
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    return err;
+
+  return gpio_isr_handler_add(kBenchmarkGPIO, BenchmarkISR, this);
+}
+
+void NotifyBenchmarkTask::Measure(Mechanism mechanism) {
+  mechanism_ = mechanism;
+  samples_.clear();
+  uint32_t num_timeouts = 0;
+
+  for (size_t i = 0; i < kNumSamples; i++) {
+    gpio_set_level(kBenchmarkGPIO, 0);
+    isr_time_us_ = 0;
+    esp_timer_start_once(trigger_timer_, kTriggerDelayUsec);
+
+    bool woken;
+    if (mechanism == Mechanism::EventGroup) {
+      woken = xEventGroupWaitBits(event_group_, EVENT_WAKE,
+                                  /*xClearOnExit=*/pdTRUE,
+                                  /*xWaitForAllBits=*/pdFALSE, kWakeTimeout) &
+              EVENT_WAKE;
+    } else {
+      woken = notifier_.Wait(kWakeTimeout) & EVENT_WAKE;
+    }
+    const int64_t now = esp_timer_get_time();
+    if (!woken || !isr_time_us_) {
+      num_timeouts++;
+      esp_timer_stop(trigger_timer_);
+      continue;
+    }
+    samples_.push_back(static_cast<uint32_t>(now - isr_time_us_));
+  }
+
+  LogResults(mechanism, num_timeouts);
+}
+
+void NotifyBenchmarkTask::LogResults(Mechanism mechanism,
+                                     uint32_t num_timeouts) {
+  const char* name =
+      mechanism == Mechanism::EventGroup ? "Event group" : "TaskNotifier";
+  if (samples_.empty()) {
+    ESP_LOGE(TAG, "%s: no wakes, %u timeouts.", name, num_timeouts);
+    return;
+  }
+
+  std::sort(samples_.begin(), samples_.end());
+  uint64_t total_us = 0;
+  for (uint32_t sample : samples_)
+    total_us += sample;
+  ESP_LOGI(TAG,
+           "%s ISR to task: min %u, median %u, mean %llu, p99 %u, max %u usec "
+           "(%zu wakes, %u timeouts).",
+           name, samples_.front(), samples_[samples_.size() / 2],
+           total_us / samples_.size(), samples_[samples_.size() * 99 / 100],
+           samples_.back(), samples_.size(), num_timeouts);
+}
+
+void IRAM_ATTR NotifyBenchmarkTask::Run() {
+  ESP_LOGW(TAG, "In notify benchmark task.");
+  while (true) {
+    Measure(Mechanism::EventGroup);
+    Measure(Mechanism::TaskNotifier);
+    vTaskDelay(kBenchmarkPeriod);
+  }
+}
+
+// static
+void NotifyBenchmarkTask::TriggerTimerCb(void* arg) {
+  gpio_set_level(kBenchmarkGPIO, 1);
+}
+
+// static
+void IRAM_ATTR NotifyBenchmarkTask::TaskFunc(void* arg) {
+  static_cast<NotifyBenchmarkTask*>(arg)->Run();
+}
+
+// static
+void IRAM_ATTR NotifyBenchmarkTask::BenchmarkISR(void* arg) {
+  NotifyBenchmarkTask* task = static_cast<NotifyBenchmarkTask*>(arg);
+
+  task->isr_time_us_ = esp_timer_get_time();
+  if (task->mechanism_ == Mechanism::TaskNotifier) {
+    task->notifier_.NotifyFromISR(EVENT_WAKE);
+    return;
+  }
+
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  BaseType_t xResult = xEventGroupSetBitsFromISR(
+      task->event_group_, EVENT_WAKE, &xHigherPriorityTaskWoken);
+
+  if (xResult != pdFAIL) {
+    // See https://www.freertos.org/xEventGroupSetBitsFromISR.html
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+#else
+    portYIELD_FROM_ISR();
+#endif
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <freertos/include/freertos/FreeRTOS.h>
+#include <freertos/include/freertos/event_groups.h>
+#include <freertos/include/freertos/task.h>
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#include "task_notifier.h"
+
+/**
+ * Task used only for testing, which measures the latency from an ISR waking
+ * a task until that task runs, for an event group and a TaskNotifier.
+ * Started with notify_benchmark = true in the [debug] section of config.ini.
+ *
+ * The interrupt is a GPIO edge raised by software on kBenchmarkGPIO, so no
+ * wiring is needed. The task runs at the keyboard task's priority so the
+ * results match waking it from the keyboard ISR.
+ */
+class NotifyBenchmarkTask {
+ public:
+  static esp_err_t Start();
+
+ private:
+  enum class Mechanism {
+    EventGroup,
+    TaskNotifier,
+  };
+
+  static void IRAM_ATTR TaskFunc(void* arg);
+  static void IRAM_ATTR BenchmarkISR(void* arg);
+  static void TriggerTimerCb(void* arg);
+
+  NotifyBenchmarkTask();
+  ~NotifyBenchmarkTask();
+
+  esp_err_t Initialize();
+  esp_err_t InstallISR();
+  void Measure(Mechanism mechanism);
+  void LogResults(Mechanism mechanism, uint32_t num_timeouts);
+  void IRAM_ATTR Run();
+
+  EventGroupHandle_t event_group_;
+  TaskNotifier notifier_;
+  TaskHandle_t task_ = nullptr;                  // This task.
+  esp_timer_handle_t trigger_timer_ = nullptr;   // Raises the GPIO edge.
+  volatile Mechanism mechanism_ = Mechanism::EventGroup;  // Used by the ISR.
+  volatile int64_t isr_time_us_ = 0;  // When the ISR last ran.
+  std::vector<uint32_t> samples_;     // Latency, in usec, of each wake.
+};
@@ -0,0 +1,52 @@
+#include "poll_scheduler.h"
+
+#include <algorithm>
+
+void PollScheduler::PollSucceeded(int64_t now_us, const Playback& playback) {
+  backoff_us_ = 0;
+  not_before_us_ = 0;
+  if (!playback.is_player_active) {
+    scheduled_us_ = now_us + kInactiveIntervalUsec;
+  } else if (!playback.is_playing) {
+    scheduled_us_ = now_us + kPausedIntervalUsec;
+  } else {
+    const int64_t remaining_us =
+        playback.progress_ms < playback.duration_ms
+            ? (playback.duration_ms - playback.progress_ms) * 1000LL
+            : 0;
+    scheduled_us_ = now_us + std::min(remaining_us + kTrackEndMarginUsec,
+                                      kMaxPlayingIntervalUsec);
+  }
+  PollDone(now_us);
+}
+
+void PollScheduler::PollFailed(int64_t now_us, int64_t retry_after_us) {
+  backoff_us_ = backoff_us_ ? std::min(backoff_us_ * 2, kMaxBackoffUsec)
+                            : kMinBackoffUsec;
+  not_before_us_ = now_us + std::max(backoff_us_, retry_after_us);
+  scheduled_us_ = not_before_us_;
+  PollDone(now_us);
+}
+
+void PollScheduler::UserInput(int64_t now_us) {
+  input_poll_us_ = now_us + kUserInputDelayUsec;
+  input_until_us_ = now_us + kUserInputWindowUsec;
+}
+
+int64_t PollScheduler::next_poll_us() const {
+  int64_t next_us = scheduled_us_;
+  if (input_poll_us_ >= 0)
+    next_us = std::min(next_us, input_poll_us_);
+  return std::max(next_us, not_before_us_);
+}
+
+void PollScheduler::PollDone(int64_t now_us) {
+  // Keep polling quickly until the end of the input window, as the change
+  // may not have been visible yet.
+  if (input_poll_us_ >= 0 &&
+      now_us + kUserInputIntervalUsec <= input_until_us_) {
+    input_poll_us_ = now_us + kUserInputIntervalUsec;
+  } else {
+    input_poll_us_ = -1;
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Decides when to next poll the Spotify currently-playing state.
+ *
+ * While a track plays the next poll is just after its predicted end, which
+ * is when the track normally changes. Skips made on another device are
+ * caught within kMaxPlayingIntervalUsec. While paused, or with no active
+ * player, polls are slow. Local input which may change the track (media
+ * keys) polls quickly for a short time. Failed polls back off
+ * exponentially, and for at least the server's Retry-After.
+ *
+ * All times are esp_timer_get_time() microseconds.
+ */
+class PollScheduler {
+ public:
+  // After the predicted end of a track, allowing for the next to start.
+  static constexpr int64_t kTrackEndMarginUsec = 2 * 1000 * 1000;
+  static constexpr int64_t kMaxPlayingIntervalUsec = 60 * 1000 * 1000;
+  static constexpr int64_t kPausedIntervalUsec = 60 * 1000 * 1000;
+  static constexpr int64_t kInactiveIntervalUsec = 120 * 1000 * 1000;
+  // Spotify takes a moment to reflect a change made by a media key.
+  static constexpr int64_t kUserInputDelayUsec = 1000 * 1000;
+  static constexpr int64_t kUserInputIntervalUsec = 2 * 1000 * 1000;
+  static constexpr int64_t kUserInputWindowUsec = 10 * 1000 * 1000;
+  static constexpr int64_t kMinBackoffUsec = 5 * 1000 * 1000;
+  static constexpr int64_t kMaxBackoffUsec = 10 * 60 * 1000 * 1000LL;
+
+  /**
+   * The playback state returned by a successful poll.
+   */
+  struct Playback {
+    bool is_player_active;
+    bool is_playing;
+    uint32_t progress_ms;
+    uint32_t duration_ms;
+  };
+
+  PollScheduler() = default;
+
+  /**
+   * A poll completed at |now_us|.
+   */
+  void PollSucceeded(int64_t now_us, const Playback& playback);
+
+  /**
+   * A poll failed at |now_us|.
+   *
+   * @param retry_after_us The server's Retry-After, or zero if none.
+   */
+  void PollFailed(int64_t now_us, int64_t retry_after_us);
+
+  /**
+   * The user did something at |now_us| which may change what is playing.
+   */
+  void UserInput(int64_t now_us);
+
+  /**
+   * When the next poll is due. Zero before the first poll.
+   */
+  int64_t next_poll_us() const;
+
+ private:
+  void PollDone(int64_t now_us);
+
+  int64_t scheduled_us_ = 0;    // Due to the last poll result.
+  int64_t input_poll_us_ = -1;  // Due to user input, if >= 0.
+  int64_t input_until_us_ = 0;  // End of the user input window.
+  int64_t not_before_us_ = 0;   // End of any backoff.
+  int64_t backoff_us_ = 0;      // Zero unless the last poll failed.
+};
@@ -27,11 +27,10 @@ struct IODEV {
 };
 
 constexpr char TAG[] = "Fetcher";
-constexpr EventBits_t FETCH_EVENT = BIT0;
-constexpr EventBits_t FETCH_EVENT_ALL = BIT0;
+constexpr uint32_t FETCH_EVENT = BIT0;
 
 bool IsJpeg(const std::string& mime_type) {
-  return mime_type == "image/jpeg";
+  return mime_type.compare(0, 10, "image/jpeg") == 0;
 }
 
 std::string GetFileExtension(const std::string& file_name) {
@@ -184,7 +183,6 @@ esp_err_t TJpgDecErrToEspErr(JRESULT err) {
 
 ResourceFetcher::ResourceFetcher(ResourceFetchClient* fetch_client)
     : mutex_(xSemaphoreCreateMutex()),
-      event_group_(xEventGroupCreate()),
       fetch_client_(fetch_client) {
   configASSERT(fetch_client);
 }
@@ -214,13 +212,15 @@ esp_err_t ResourceFetcher::Initialize() {
   // https://www.freertos.org/FAQMem.html#StackSize
   constexpr uint32_t kStackDepthWords = 8 * 1024;
 
-  if (!event_group_)
+  if (!mutex_)
     return ESP_FAIL;
 
-  return xTaskCreate(TaskFunc, TAG, kStackDepthWords, this,
-                     tskIDLE_PRIORITY + 1, &task_) == pdPASS
-             ? ESP_OK
-             : ESP_FAIL;
+  if (xTaskCreate(TaskFunc, TAG, kStackDepthWords, this, tskIDLE_PRIORITY + 1,
+                  &task_) != pdPASS) {
+    return ESP_FAIL;
+  }
+  notifier_.SetTask(task_);
+  return ESP_OK;
 }
 
 void ResourceFetcher::QueueFetch(uint32_t request_id, std::string url) {
@@ -228,7 +228,7 @@ void ResourceFetcher::QueueFetch(uint32_t request_id, std::string url) {
     return;
   requests_.emplace(request_id, url);
   xSemaphoreGive(mutex_);
-  xEventGroupSetBits(event_group_, FETCH_EVENT);
+  notifier_.Notify(FETCH_EVENT);
 }
 
 void ResourceFetcher::DecodeAndScaleJPEG(RequestData request_data,
@@ -315,8 +315,10 @@ void ResourceFetcher::DownloadResource(RequestData request_data) {
     fetch_client_->FetchError(request_data.request_id, err);
     return;
   }
-  // TODO: Get the content-type from the HTTP response.
-  std::string mime_type = GetContentTypeFromUrl(request_data.url);
+  // Spotify's artwork URLs have no file extension.
+  std::string mime_type = https_client.content_type();
+  if (mime_type.empty())
+    mime_type = GetContentTypeFromUrl(request_data.url);
   if (status_code != HttpStatus_Ok) {
     fetch_client_->FetchResult(request_data.request_id, status_code,
                                std::move(response), std::move(mime_type));
@@ -337,23 +339,21 @@ void ResourceFetcher::DownloadResource(RequestData request_data) {
 
 void IRAM_ATTR ResourceFetcher::Run() {
   while (true) {
-    EventBits_t bits = xEventGroupWaitBits(
-        event_group_, FETCH_EVENT_ALL, /*xClearOnExit=*/pdFALSE,
-        /*xWaitForAllBits=*/pdFALSE, portMAX_DELAY);
-    if (bits & FETCH_EVENT) {
+    const uint32_t bits = notifier_.Wait(portMAX_DELAY);
+    if (!(bits & FETCH_EVENT))
+      continue;
+    // One notification may be for several requests, so drain the queue.
+    while (true) {
       if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
         return;
-      configASSERT(!requests_.empty());
+      if (requests_.empty()) {
+        xSemaphoreGive(mutex_);
+        break;
+      }
       RequestData request_data = requests_.front();
       requests_.pop();
       xSemaphoreGive(mutex_);
       DownloadResource(std::move(request_data));
-
-      if (xSemaphoreTake(mutex_, portMAX_DELAY) == pdTRUE) {
-        if (requests_.empty())
-          xEventGroupClearBits(event_group_, FETCH_EVENT);
-        xSemaphoreGive(mutex_);
-      }
     }
   }
 }
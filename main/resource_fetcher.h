@@ -7,7 +7,6 @@
 #include <vector>
 
 #include <freertos/include/freertos/FreeRTOS.h>
-#include <freertos/include/freertos/event_groups.h>
 #include <freertos/include/freertos/semphr.h>
 #include <freertos/include/freertos/task.h>
 
@@ -15,6 +14,8 @@
 #include <esp_http_client/include/esp_http_client.h>
 #include <lvgl.h>
 
+#include "task_notifier.h"
+
 /**
  * Clients using ResourceFetcher must implement this interface for
  * async fetch results.
@@ -86,7 +87,7 @@ class ResourceFetcher {
   esp_err_t Initialize();
 
   SemaphoreHandle_t mutex_;
-  EventGroupHandle_t event_group_;    // Fetch events.
+  TaskNotifier notifier_;             // Fetch events.
   std::queue<RequestData> requests_;  // Outstanding requests.
   ResourceFetchClient* fetch_client_;
   TaskHandle_t task_ = nullptr;
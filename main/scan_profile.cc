@@ -0,0 +1,44 @@
+#include "scan_profile.h"
+
+#include <array>
+#include <cstring>
+
+namespace {
+
+// clang-format off
+constexpr std::array<ScanProfile, 3> kProfiles = {{
+  // Fastest clock and scan rate, no debounce: lowest latency.
+  {"gaming",    500, 10, false},
+  // Fastest clock and scan rate with debounce. The IC reset defaults.
+  {"balanced",  500, 10, true},
+  // Slowest clock and scan rate: lowest idle current.
+  {"low_power",  50, 40, true},
+}};
+// clang-format on
+
+constexpr size_t kDefaultProfileIdx = 1;
+
+}  // namespace
+
+// static
+const ScanProfile* ScanProfile::Find(const char* name) {
+  for (const ScanProfile& profile : kProfiles) {
+    if (!strcmp(profile.name, name))
+      return &profile;
+  }
+  return nullptr;
+}
+
+// static
+const ScanProfile& ScanProfile::Default() {
+  return kProfiles[kDefaultProfileIdx];
+}
+
+// static
+const ScanProfile& ScanProfile::Next(const ScanProfile& profile) {
+  for (size_t i = 0; i < kProfiles.size(); i++) {
+    if (&kProfiles[i] == &profile)
+      return kProfiles[(i + 1) % kProfiles.size()];
+  }
+  return Default();
+}
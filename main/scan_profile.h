@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Keyboard IC key scanning settings, trading key latency for idle current.
+ */
+struct ScanProfile {
+  const char* name;
+  uint16_t core_frequency_khz;  // 50, 100, 200, or 500.
+  uint8_t key_poll_time_ms;     // Idle time between scans: 10, 20, 30, or 40.
+  bool debounce;                // Debounce the key matrix pins.
+
+  /**
+   * The built-in profile named |name|, nullptr if there is none.
+   */
+  static const ScanProfile* Find(const char* name);
+
+  static const ScanProfile& Default();
+
+  /**
+   * The built-in profile after |profile|, wrapping around to the first.
+   */
+  static const ScanProfile& Next(const ScanProfile& profile);
+};
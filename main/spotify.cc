@@ -2,6 +2,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <memory>
 #include <string>
 
@@ -12,32 +13,28 @@
 #include <mbedtls/mbedtls/include/mbedtls/base64.h>
 
 #include "config.h"
+#include "currently_playing_parser.h"
 #include "event_ids.h"
 #include "http_client.h"
 #include "http_server.h"
+#include "json_stream.h"
+#include "task_notifier.h"
+#include "token_store.h"
 #include "wifi.h"
 
 using std::string;
 
 namespace {
 
-struct RequestData {
-  struct {
-    uint32_t progress_ms;
-    uint32_t duration_ms;
-  } times;
-  bool is_playing;
-  bool is_player_active;
-  string artist_name;
-  string song_title;
-  struct {
-    string url_640;
-    string url_300;
-    string url_64;
-  } image;
-};
-
 constexpr char TAG[] = "Spotify";
+// Not in esp_http_client's HttpStatus_Code.
+constexpr int kHttpStatusNoContent = 204;
+constexpr int kHttpStatusBadRequest = 400;
+constexpr int kHttpStatusTooManyRequests = 429;
+// Retry a failed refresh (e.g. no network) after this long.
+constexpr uint32_t kRefreshRetrySecs = 60;
+// Before this the clock has not been set (by SNTP).
+constexpr time_t kMinValidTime = 1609459200;  // 2021-01-01.
 constexpr char kApiHost[] = "api.spotify.com";
 constexpr char kCurrentlyPlayingResource[] = "/v1/me/player/currently-playing";
 constexpr char kRootURI[] = "/";
@@ -154,10 +151,10 @@ esp_err_t Spotify::CallbackHandler(httpd_req_t* request) {
 Spotify::Spotify(const Config* config,
                  HTTPServer* https_server,
                  WiFi* wifi,
-                 EventGroupHandle_t event_group)
+                 TaskNotifier* notifier)
     : config_(config),
       https_server_(https_server),
-      event_group_(event_group),
+      notifier_(notifier),
       wifi_(wifi),
       initialized_(false),
       token_refresh_timer_(nullptr),
@@ -165,7 +162,7 @@ Spotify::Spotify(const Config* config,
   assert(config != nullptr);
   assert(https_server != nullptr);
   assert(wifi != nullptr);
-  assert(event_group != nullptr);
+  assert(notifier != nullptr);
 }
 
 Spotify::~Spotify() {
@@ -180,8 +177,8 @@ Spotify::~Spotify() {
 // static:
 void Spotify::TokenRefreshCb(void* arg) {
   ESP_LOGD(TAG, "Timer fired to refresh access token");
-  xEventGroupSetBits(static_cast<Spotify*>(arg)->event_group_,
-                     EVENT_SPOTIFY_ACCESS_TOKEN_EXPIRE);
+  static_cast<Spotify*>(arg)->notifier_->Notify(
+      EVENT_SPOTIFY_ACCESS_TOKEN_EXPIRE);
 }
 
 esp_err_t Spotify::Initialize() {
@@ -220,6 +217,8 @@ esp_err_t Spotify::Initialize() {
   if (err != ESP_OK)
     return err;
 
+  LoadSavedLogin();
+
   initialized_ = true;
   return ESP_OK;
 }
@@ -273,7 +272,7 @@ esp_err_t Spotify::HandleCallbackRequest(httpd_req_t* request) {
   // Now that we have the authorization code, notify the application so that
   // it can update any UI (if desired) and continue the process of connecting
   // to Spotify.
-  xEventGroupSetBits(event_group_, EVENT_SPOTIFY_GOT_AUTHORIZATION_CODE);
+  notifier_->Notify(EVENT_SPOTIFY_GOT_AUTHORIZATION_CODE);
 
   constexpr char kCallbackSuccess[] =
       "<html><head></head><body>Succesfully authentiated this device with "
@@ -291,25 +290,28 @@ esp_err_t Spotify::GetRedirectURL(string* url) const {
   return ESP_OK;
 }
 
-esp_err_t Spotify::GetCurrentlyPlaying() {
+esp_err_t Spotify::GetCurrentlyPlaying(Playback* playback) {
   constexpr char kCurrentlyPlayingURL[] =
       "https://api.spotify.com/v1/me/player/currently-playing";
 
+  *playback = {};
   if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
     return ESP_FAIL;
   const std::vector<HTTPClient::HeaderValue> header_values = {
       {"Authorization", "Bearer " + auth_data_.access_token},
-      {"Connection", "close"},
   };
   xSemaphoreGive(mutex_);
 
-  std::string response;
+  CurrentlyPlayingParser::RequestData playing = {};
+  CurrentlyPlayingParser parser(&playing);
+  JSONStream json(&parser);
   HTTPClient https_client;
   int status_code(0);
   esp_err_t err = https_client.DoGET(
       kCurrentlyPlayingURL, header_values,
-      [&response](const void* data, int data_len) {
-        response.append(static_cast<const char*>(data), data_len);
+      [&json](const void* data, int data_len) {
+        // A parse error is reported once the status code is known.
+        json.Feed(static_cast<const char*>(data), data_len);
         return ESP_OK;
       },
       &status_code);
@@ -317,24 +319,39 @@ esp_err_t Spotify::GetCurrentlyPlaying() {
   if (err != ESP_OK)
     return ESP_FAIL;
 
-  if (status_code != HttpStatus_Ok) {
-    ESP_LOGE(TAG, "Request error: %d", status_code);
-    return ESP_FAIL;
+  if (status_code == kHttpStatusNoContent) {
+    ESP_LOGI(TAG, "No active player.");
+    return ESP_OK;
   }
 
-  if (response.empty()) {
-    ESP_LOGE(TAG, "Got empty response.");
+  if (status_code != HttpStatus_Ok) {
+    playback->retry_after_secs = https_client.retry_after_secs();
+    if (status_code == kHttpStatusTooManyRequests) {
+      ESP_LOGW(TAG, "Rate limited, retry after %u secs.",
+               static_cast<unsigned>(playback->retry_after_secs));
+    } else {
+      ESP_LOGE(TAG, "Request error: %d", status_code);
+    }
     return ESP_FAIL;
   }
-  cJSON* json = cJSON_Parse(response.c_str());
-  if (!json) {
-    ESP_LOGE(TAG, "Failure parsing JSON response.");
+
+  err = json.Finish();
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failure parsing JSON response: %s", esp_err_to_name(err));
     return ESP_FAIL;
   }
-
-  cJSON_Delete(json);
-
-  ESP_LOGI(TAG, "Got currently-playing response.");
+  playing.is_player_active = true;
+
+  ESP_LOGI(TAG, "Currently %s \"%s\" by %s (%u of %u ms).",
+           playing.is_playing ? "playing" : "paused",
+           playing.song_title.c_str(), playing.artist_name.c_str(),
+           static_cast<unsigned>(playing.times.progress_ms),
+           static_cast<unsigned>(playing.times.duration_ms));
+  playback->is_player_active = playing.is_player_active;
+  playback->is_playing = playing.is_playing;
+  playback->progress_ms = playing.times.progress_ms;
+  playback->duration_ms = playing.times.duration_ms;
+  playback->artwork_url = std::move(playing.image.url_300);
   return ESP_OK;
 }
 
@@ -371,7 +388,6 @@ esp_err_t Spotify::GetAccessToken(TokenGrantType grant_type, string code) {
        "Basic " + Base64Encode(config_->spotify.client_id + ":" +
                                config_->spotify.client_secret)},
       {"Content-Type", "application/x-www-form-urlencoded"},
-      {"Connection", "close"},
   };
   string content;
   std::string access_token;
@@ -399,6 +415,12 @@ esp_err_t Spotify::GetAccessToken(TokenGrantType grant_type, string code) {
     goto exit;
   if (status_code != HttpStatus_Ok) {
     ESP_LOGE(TAG, "Invalid status: %d", status_code);
+    err = ESP_FAIL;
+    // invalid_grant: the refresh token was revoked.
+    if (grant_type == TokenGrantType::Refresh &&
+        status_code == kHttpStatusBadRequest) {
+      ForgetLogin();
+    }
     goto exit;
   }
   if (response.empty()) {
@@ -431,6 +453,7 @@ esp_err_t Spotify::GetAccessToken(TokenGrantType grant_type, string code) {
   if (give_mutex)
     xSemaphoreGive(mutex_);
   expires_in_secs = GetJSONNumber(json, "expires_in");
+  SaveLogin(expires_in_secs);
   if (expires_in_secs > kMaxTokenRefreshDurationSecs)
     expires_in_secs -= kMaxTokenRefreshDurationSecs;
 
@@ -443,9 +466,16 @@ esp_err_t Spotify::GetAccessToken(TokenGrantType grant_type, string code) {
                        static_cast<uint64_t>(expires_in_secs) * 1000 * 1000);
 
 exit:
-  xEventGroupSetBits(event_group_, err == ESP_OK
-                                       ? EVENT_SPOTIFY_ACCESS_TOKEN_GOOD
-                                       : EVENT_SPOTIFY_ACCESS_TOKEN_FAILURE);
+  if (err != ESP_OK && grant_type == TokenGrantType::Refresh &&
+      HaveRefreshToken()) {
+    ESP_LOGW(TAG, "Retrying access token refresh in %u secs.",
+             static_cast<unsigned>(kRefreshRetrySecs));
+    esp_timer_start_once(
+        token_refresh_timer_,
+        static_cast<uint64_t>(kRefreshRetrySecs) * 1000 * 1000);
+  }
+  notifier_->Notify(err == ESP_OK ? EVENT_SPOTIFY_ACCESS_TOKEN_GOOD
+                                  : EVENT_SPOTIFY_ACCESS_TOKEN_FAILURE);
   return err;
 }
 
@@ -487,3 +517,60 @@ bool Spotify::HaveAccessToken() const {
   xSemaphoreGive(mutex_);
   return have_it;
 }
+
+bool Spotify::HaveRefreshToken() const {
+  if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    return false;
+  const bool have_it = !auth_data_.refresh_token.empty();
+  xSemaphoreGive(mutex_);
+  return have_it;
+}
+
+void Spotify::LoadSavedLogin() {
+  TokenStore::Tokens tokens;
+  const esp_err_t err =
+      TokenStore(config_->spotify.client_secret).Load(&tokens);
+  if (err == ESP_ERR_NVS_NOT_FOUND)
+    return;
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Can't load saved login: %s", esp_err_to_name(err));
+    return;
+  }
+  ESP_LOGI(TAG, "Loaded saved login, last access token expiry: %lld.",
+           tokens.expires_at);
+  if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    return;
+  auth_data_.refresh_token = std::move(tokens.refresh_token);
+  auth_data_.scope = std::move(tokens.scope);
+  xSemaphoreGive(mutex_);
+}
+
+void Spotify::SaveLogin(uint32_t expires_in_secs) {
+  TokenStore::Tokens tokens;
+  const time_t now = time(nullptr);
+  if (now >= kMinValidTime)
+    tokens.expires_at = now + expires_in_secs;
+  if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    return;
+  tokens.refresh_token = auth_data_.refresh_token;
+  tokens.scope = auth_data_.scope;
+  xSemaphoreGive(mutex_);
+  if (tokens.refresh_token.empty())
+    return;
+  const esp_err_t err =
+      TokenStore(config_->spotify.client_secret).Save(tokens);
+  if (err != ESP_OK)
+    ESP_LOGW(TAG, "Can't save login: %s", esp_err_to_name(err));
+}
+
+void Spotify::ForgetLogin() {
+  ESP_LOGW(TAG, "Refresh token rejected, log in again.");
+  bool give_mutex = xSemaphoreTake(mutex_, portMAX_DELAY) == pdTRUE;
+  auth_data_.access_token.clear();
+  auth_data_.refresh_token.clear();
+  auth_data_.scope.clear();
+  if (give_mutex)
+    xSemaphoreGive(mutex_);
+  ESP_ERROR_CHECK_WITHOUT_ABORT(
+      TokenStore(config_->spotify.client_secret).Erase());
+}
@@ -6,19 +6,31 @@
 #include <esp_http_server/include/esp_http_server.h>
 #include <esp_timer.h>
 #include <freertos/include/freertos/FreeRTOS.h>
-#include <freertos/include/freertos/event_groups.h>
 #include <freertos/include/freertos/semphr.h>
 
 class Config;
 class HTTPServer;
+class TaskNotifier;
 class WiFi;
 
 class Spotify {
  public:
+  /**
+   * The playback state from GetCurrentlyPlaying().
+   */
+  struct Playback {
+    bool is_player_active = false;  // False if no device is active.
+    bool is_playing = false;
+    uint32_t progress_ms = 0;
+    uint32_t duration_ms = 0;
+    uint32_t retry_after_secs = 0;  // From a failed request, else zero.
+    std::string artwork_url;  // The 300x300 album artwork, empty if none.
+  };
+
   Spotify(const Config* config,
           HTTPServer* https_server,
           WiFi* wifi,
-          EventGroupHandle_t event_group);
+          TaskNotifier* notifier);
   ~Spotify();
 
   /**
@@ -37,8 +49,11 @@ class Spotify {
 
   /**
    * Retrieve the Spotify currently playing track information.
+   *
+   * @param playback Receives the playback state, and on failure any
+   *                 Retry-After sent by Spotify.
    */
-  esp_err_t GetCurrentlyPlaying();
+  esp_err_t GetCurrentlyPlaying(Playback* playback);
 
   // Was this instance *successfully* initialized?
   bool initialized() const { return initialized_; }
@@ -51,6 +66,13 @@ class Spotify {
 
   bool HaveAccessToken() const;
 
+  /**
+   * Is there a refresh token, either from logging in or saved by an earlier
+   * boot? If so RefreshAccessToken() can get an access token without the
+   * user logging in.
+   */
+  bool HaveRefreshToken() const;
+
   /**
    * Refresh the access token.
    *
@@ -105,6 +127,23 @@ class Spotify {
    */
   esp_err_t GetAccessToken(TokenGrantType grant_type, std::string code);
 
+  /**
+   * Load the refresh token saved in NVS by an earlier boot, if any.
+   */
+  void LoadSavedLogin();
+
+  /**
+   * Save the refresh token to NVS.
+   *
+   * @param expires_in_secs Lifetime of the current access token.
+   */
+  void SaveLogin(uint32_t expires_in_secs);
+
+  /**
+   * Forget the refresh token, in RAM and NVS, so the user must log in again.
+   */
+  void ForgetLogin();
+
   /**
    * Create the URL to have Spotify redirect to after user successfully
    * authenticates and approves access to this client.
@@ -125,7 +164,7 @@ class Spotify {
 
   const Config* config_;            // Application config data.
   HTTPServer* https_server_;        // Accept inbound requests for auth.
-  EventGroupHandle_t event_group_;  // Used to inform owner of events.
+  TaskNotifier* notifier_;          // Used to inform owner of events.
   WiFi* wifi_;                      // Object used to controll Wi-Fi network.
   bool initialized_;                // Is this instance initialized?
   esp_timer_handle_t token_refresh_timer_;  // Used to refresh access token.
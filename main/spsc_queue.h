@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Lock-free single-producer/single-consumer FIFO queue.
+ *
+ * One task may call Push() while another calls Front()/Pop(). Neither side
+ * ever blocks, so the producer can run on a latency sensitive task without
+ * waiting on the consumer.
+ *
+ * @note N must be a power of two.
+ */
+template <typename T, size_t N>
+class SPSCQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+ public:
+  SPSCQueue() : head_(0), tail_(0) {}
+
+  /**
+   * Add |value| to the back of the queue.
+   *
+   * @note Only call from the producer.
+   *
+   * @return false if the queue is full.
+   */
+  bool Push(const T& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == N)
+      return false;
+    items_[tail & (N - 1)] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * The item at the front of the queue, or nullptr if empty.
+   *
+   * @note Only call from the consumer.
+   */
+  const T* Front() const {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return nullptr;
+    return &items_[head & (N - 1)];
+  }
+
+  /**
+   * Remove the item at the front of the queue.
+   *
+   * @note Only call from the consumer, and only when Front() is non-null.
+   */
+  void Pop() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  /**
+   * The number of items that can be pushed before the queue is full.
+   *
+   * @note Only call from the producer.
+   */
+  size_t available() const {
+    return N - (tail_.load(std::memory_order_relaxed) -
+                head_.load(std::memory_order_acquire));
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::array<T, N> items_;
+  std::atomic<size_t> head_;  // Index of next item to consume.
+  std::atomic<size_t> tail_;  // Index of next item to produce.
+};
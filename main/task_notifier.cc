@@ -0,0 +1,82 @@
+#include "task_notifier.h"
+
+#include <climits>
+
+#include <esp_idf_version.h>
+
+TaskNotifier::TaskNotifier()
+    : task_(nullptr), lock_(portMUX_INITIALIZER_UNLOCKED), early_bits_(0) {}
+
+void TaskNotifier::SetTask(TaskHandle_t task) {
+  taskENTER_CRITICAL(&lock_);
+  task_ = task;
+  const uint32_t bits = early_bits_;
+  early_bits_ = 0;
+  taskEXIT_CRITICAL(&lock_);
+
+  if (bits)
+    xTaskNotify(task, bits, eSetBits);
+}
+
+void TaskNotifier::Notify(uint32_t bits) {
+  TaskHandle_t task = task_;
+  if (!task) {
+    taskENTER_CRITICAL(&lock_);
+    // Recheck, SetTask() may have run since.
+    task = task_;
+    if (!task)
+      early_bits_ |= bits;
+    taskEXIT_CRITICAL(&lock_);
+    if (!task)
+      return;
+  }
+  xTaskNotify(task, bits, eSetBits);
+}
+
+void IRAM_ATTR TaskNotifier::NotifyFromISR(uint32_t bits) {
+  TaskHandle_t task = task_;
+  if (!task) {
+    taskENTER_CRITICAL_ISR(&lock_);
+    task = task_;
+    if (!task)
+      early_bits_ |= bits;
+    taskEXIT_CRITICAL_ISR(&lock_);
+    if (!task)
+      return;
+  }
+
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  xTaskNotifyFromISR(task, bits, eSetBits, &xHigherPriorityTaskWoken);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+#else
+  if (xHigherPriorityTaskWoken)
+    portYIELD_FROM_ISR();
+#endif
+}
+
+void TaskNotifier::Clear(uint32_t bits) {
+  taskENTER_CRITICAL(&lock_);
+  early_bits_ &= ~bits;
+  TaskHandle_t task = task_;
+  taskEXIT_CRITICAL(&lock_);
+
+  if (task) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+    ulTaskNotifyValueClear(task, bits);
+#else
+    // Older FreeRTOS can't clear only some bits of another task's value,
+    // so only bits notified before SetTask() are cleared.
+#endif
+  }
+}
+
+uint32_t TaskNotifier::Wait(TickType_t timeout) {
+  uint32_t bits = 0;
+  if (xTaskNotifyWait(/*ulBitsToClearOnEntry=*/0,
+                      /*ulBitsToClearOnExit=*/ULONG_MAX, &bits,
+                      timeout) != pdTRUE) {
+    return 0;
+  }
+  return bits;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <freertos/include/freertos/FreeRTOS.h>
+#include <freertos/include/freertos/task.h>
+
+/**
+ * Wakes a single task with a set of event bits, like an event group, using
+ * the task's notification value.
+ *
+ * xEventGroupSetBitsFromISR() defers setting the bits to the timer daemon
+ * task, adding a context switch and a timer queue wait to every wake from an
+ * ISR. xTaskNotifyFromISR() unblocks the waiting task directly.
+ *
+ * Bits notified before the task is set with SetTask() are held and delivered
+ * when it is, so the notifier can be used before the task is created.
+ *
+ * @note The notification value of the task belongs to this notifier, nothing
+ *       else may notify the task.
+ */
+class TaskNotifier {
+ public:
+  TaskNotifier();
+
+  /**
+   * Set the task to notify, delivering any bits notified before now.
+   */
+  void SetTask(TaskHandle_t task);
+
+  /**
+   * Set |bits| in the task's notification value, waking it if waiting.
+   */
+  void Notify(uint32_t bits);
+
+  /**
+   * ISR safe version of Notify(). Yields to the task if it is of higher
+   * priority than the interrupted task.
+   */
+  void IRAM_ATTR NotifyFromISR(uint32_t bits);
+
+  /**
+   * Clear |bits| if set and not yet received by Wait().
+   *
+   * @note Before ESP-IDF 4.3 only bits notified before SetTask() are cleared.
+   */
+  void Clear(uint32_t bits);
+
+  /**
+   * Wait for any bit to be set.
+   *
+   * @note Only call from the notified task.
+   *
+   * @return The bits set since the last call, all of which are cleared, or
+   *         zero if |timeout| elapsed first.
+   */
+  uint32_t Wait(TickType_t timeout);
+
+ private:
+  std::atomic<TaskHandle_t> task_;
+  portMUX_TYPE lock_;    // Guards |early_bits_| and setting |task_|.
+  uint32_t early_bits_;  // Bits notified before |task_| was set.
+};
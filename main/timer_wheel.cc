@@ -0,0 +1,45 @@
+#include "timer_wheel.h"
+
+TimerWheel::TimerWheel(uint32_t tick_usec)
+    : tick_usec_(tick_usec), current_tick_(0), num_active_(0), slots_() {}
+
+void TimerWheel::Schedule(Timer* timer, int64_t expiry_us) {
+  Cancel(timer);
+
+  int64_t expiry_tick = (expiry_us + tick_usec_ - 1) / tick_usec_;
+  if (expiry_tick < current_tick_)
+    expiry_tick = current_tick_;
+
+  Timer*& head = slots_[expiry_tick % kNumSlots];
+  timer->expiry_tick = expiry_tick;
+  timer->prev = nullptr;
+  timer->next = head;
+  if (head)
+    head->prev = timer;
+  head = timer;
+  timer->active = true;
+  num_active_++;
+}
+
+void TimerWheel::Cancel(Timer* timer) {
+  if (!timer->active)
+    return;
+  if (timer->prev)
+    timer->prev->next = timer->next;
+  else
+    slots_[timer->expiry_tick % kNumSlots] = timer->next;
+  if (timer->next)
+    timer->next->prev = timer->prev;
+  timer->next = timer->prev = nullptr;
+  timer->active = false;
+  num_active_--;
+}
+
+// static
+TimerWheel::Timer* TimerWheel::FindExpired(Timer* head, int64_t now_tick) {
+  for (Timer* timer = head; timer; timer = timer->next) {
+    if (timer->expiry_tick <= now_tick)
+      return timer;
+  }
+  return nullptr;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Hashed timer wheel.
+ *
+ * Timers are owned by the caller and linked into one of kNumSlots slot lists
+ * by their expiry tick, so scheduling and cancelling are constant time and
+ * never allocate. Advancing visits at most kNumSlots slots no matter how much
+ * time has passed.
+ *
+ * @note Not thread safe. All calls must be made from the same task.
+ */
+class TimerWheel {
+ public:
+  static constexpr size_t kNumSlots = 32;
+
+  struct Timer {
+    Timer* next = nullptr;
+    Timer* prev = nullptr;
+    int64_t expiry_tick = 0;
+    uint8_t id = 0;  // Caller defined.
+    bool active = false;
+  };
+
+  explicit TimerWheel(uint32_t tick_usec);
+
+  /**
+   * Schedule |timer| to expire at |expiry_us|, rescheduling it if active.
+   */
+  void Schedule(Timer* timer, int64_t expiry_us);
+
+  /**
+   * Cancel |timer|. Does nothing if the timer is not active.
+   */
+  void Cancel(Timer* timer);
+
+  /**
+   * Expire all timers due at or before |now_us|.
+   *
+   * @param expired Called with each expired timer, which is no longer
+   *                active and may be rescheduled.
+   */
+  template <typename F>
+  void Advance(int64_t now_us, F&& expired) {
+    const int64_t now_tick = now_us / tick_usec_;
+    if (now_tick < current_tick_)
+      return;
+    // Every slot is visited once the gap reaches kNumSlots.
+    const int64_t first_tick =
+        now_tick - current_tick_ >= static_cast<int64_t>(kNumSlots)
+            ? now_tick - kNumSlots + 1
+            : current_tick_;
+    // Timers rescheduled by |expired| land after |now_tick|.
+    current_tick_ = now_tick + 1;
+    for (int64_t tick = first_tick; tick <= now_tick; tick++) {
+      // Rescan from the head after each expiry as |expired| may schedule or
+      // cancel other timers in this slot.
+      Timer* timer;
+      while ((timer = FindExpired(slots_[tick % kNumSlots], now_tick))) {
+        Cancel(timer);
+        expired(timer);
+      }
+    }
+  }
+
+  bool empty() const { return !num_active_; }
+
+ private:
+  static Timer* FindExpired(Timer* head, int64_t now_tick);
+
+  const uint32_t tick_usec_;
+  int64_t current_tick_;  // Next tick to process.
+  size_t num_active_;
+  Timer* slots_[kNumSlots];
+};
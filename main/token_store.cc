@@ -0,0 +1,196 @@
+#include "token_store.h"
+
+#include <cstring>
+#include <memory>
+
+#define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+#include <esp_log.h>
+#include <esp_system.h>
+#include <json/cJSON/cJSON.h>
+#include <mbedtls/mbedtls/include/mbedtls/gcm.h>
+#include <mbedtls/mbedtls/include/mbedtls/md.h>
+#include <mbedtls/mbedtls/include/mbedtls/platform_util.h>
+#include <nvs_flash/include/nvs.h>
+
+namespace {
+
+constexpr char TAG[] = "TokenStore";
+constexpr char kNamespace[] = "spotify";
+constexpr char kKey[] = "tokens";
+
+// Stored as: version, IV, tag, then the encrypted JSON.
+constexpr uint8_t kVersion = 1;
+constexpr size_t kIVSize = 12;
+constexpr size_t kTagSize = 16;
+constexpr size_t kHeaderSize = 1 + kIVSize + kTagSize;
+constexpr size_t kMaxBlobSize = 1024;
+
+// Distinguishes this key from any other derived from the same secret.
+constexpr char kKeyLabel[] = "display-keyboard spotify tokens";
+
+/**
+ * Encrypt or decrypt |len| bytes with AES-256-GCM. The version byte is
+ * authenticated too.
+ */
+esp_err_t Crypt(int mode,
+                const uint8_t* key,
+                const uint8_t* iv,
+                uint8_t* tag,
+                const uint8_t* input,
+                size_t len,
+                uint8_t* output) {
+  mbedtls_gcm_context gcm;
+  mbedtls_gcm_init(&gcm);
+  int ret = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, 256);
+  if (ret == 0) {
+    if (mode == MBEDTLS_GCM_ENCRYPT) {
+      ret = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, len, iv,
+                                      kIVSize, &kVersion, 1, input, output,
+                                      kTagSize, tag);
+    } else {
+      ret = mbedtls_gcm_auth_decrypt(&gcm, len, iv, kIVSize, &kVersion, 1,
+                                     tag, kTagSize, input, output);
+    }
+  }
+  mbedtls_gcm_free(&gcm);
+  if (ret == MBEDTLS_ERR_GCM_AUTH_FAILED)
+    return ESP_ERR_INVALID_CRC;
+  return ret == 0 ? ESP_OK : ESP_FAIL;
+}
+
+std::string GetJSONString(const cJSON* json, const char* name) {
+  const cJSON* item = cJSON_GetObjectItemCaseSensitive(json, name);
+  return cJSON_IsString(item) ? item->valuestring : std::string();
+}
+
+}  // namespace
+
+TokenStore::TokenStore(const std::string& secret) : secret_(secret) {}
+
+esp_err_t TokenStore::DeriveKey(uint8_t key[kKeySize]) const {
+  uint8_t mac[6];
+  esp_err_t err = esp_efuse_mac_get_default(mac);
+  if (err != ESP_OK)
+    return err;
+
+  uint8_t input[sizeof(kKeyLabel) + sizeof(mac)];
+  memcpy(input, kKeyLabel, sizeof(kKeyLabel));
+  memcpy(input + sizeof(kKeyLabel), mac, sizeof(mac));
+  const int ret = mbedtls_md_hmac(
+      mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+      reinterpret_cast<const uint8_t*>(secret_.data()), secret_.size(), input,
+      sizeof(input), key);
+  return ret == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t TokenStore::Load(Tokens* tokens) const {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(kNamespace, NVS_READONLY, &handle);
+  if (err != ESP_OK)
+    return err;
+  uint8_t blob[kMaxBlobSize];
+  size_t blob_size = sizeof(blob);
+  err = nvs_get_blob(handle, kKey, blob, &blob_size);
+  nvs_close(handle);
+  if (err != ESP_OK)
+    return err;
+  if (blob_size <= kHeaderSize || blob[0] != kVersion)
+    return ESP_ERR_INVALID_VERSION;
+
+  uint8_t key[kKeySize];
+  err = DeriveKey(key);
+  if (err != ESP_OK)
+    return err;
+  const size_t json_size = blob_size - kHeaderSize;
+  std::unique_ptr<char[]> json_text(new char[json_size + 1]);
+  err = Crypt(MBEDTLS_GCM_DECRYPT, key, blob + 1, blob + 1 + kIVSize,
+              blob + kHeaderSize, json_size,
+              reinterpret_cast<uint8_t*>(json_text.get()));
+  mbedtls_platform_zeroize(key, sizeof(key));
+  if (err != ESP_OK) {
+    mbedtls_platform_zeroize(json_text.get(), json_size);
+    return err;
+  }
+  json_text[json_size] = '\0';
+
+  cJSON* json = cJSON_Parse(json_text.get());
+  mbedtls_platform_zeroize(json_text.get(), json_size);
+  if (!json)
+    return ESP_ERR_INVALID_RESPONSE;
+  tokens->refresh_token = GetJSONString(json, "refresh_token");
+  tokens->scope = GetJSONString(json, "scope");
+  const cJSON* expires_at =
+      cJSON_GetObjectItemCaseSensitive(json, "expires_at");
+  tokens->expires_at =
+      cJSON_IsNumber(expires_at) ? static_cast<int64_t>(expires_at->valuedouble)
+                                 : 0;
+  cJSON_Delete(json);
+  return tokens->refresh_token.empty() ? ESP_ERR_INVALID_RESPONSE : ESP_OK;
+}
+
+esp_err_t TokenStore::Save(const Tokens& tokens) const {
+  cJSON* json = cJSON_CreateObject();
+  if (!json)
+    return ESP_ERR_NO_MEM;
+  cJSON_AddStringToObject(json, "refresh_token",
+                          tokens.refresh_token.c_str());
+  cJSON_AddStringToObject(json, "scope", tokens.scope.c_str());
+  cJSON_AddNumberToObject(json, "expires_at",
+                          static_cast<double>(tokens.expires_at));
+  char* json_text = cJSON_PrintUnformatted(json);
+  cJSON_Delete(json);
+  if (!json_text)
+    return ESP_ERR_NO_MEM;
+  const size_t json_size = strlen(json_text);
+
+  esp_err_t err = ESP_OK;
+  uint8_t key[kKeySize];
+  uint8_t blob[kMaxBlobSize];
+  if (kHeaderSize + json_size > sizeof(blob)) {
+    err = ESP_ERR_INVALID_SIZE;
+    goto exit;
+  }
+  err = DeriveKey(key);
+  if (err != ESP_OK)
+    goto exit;
+  blob[0] = kVersion;
+  esp_fill_random(blob + 1, kIVSize);  // Never reuse an IV with one key.
+  err = Crypt(MBEDTLS_GCM_ENCRYPT, key, blob + 1, blob + 1 + kIVSize,
+              reinterpret_cast<const uint8_t*>(json_text), json_size,
+              blob + kHeaderSize);
+  mbedtls_platform_zeroize(key, sizeof(key));
+  if (err != ESP_OK)
+    goto exit;
+
+  nvs_handle_t handle;
+  err = nvs_open(kNamespace, NVS_READWRITE, &handle);
+  if (err != ESP_OK)
+    goto exit;
+  err = nvs_set_blob(handle, kKey, blob, kHeaderSize + json_size);
+  if (err == ESP_OK)
+    err = nvs_commit(handle);
+  nvs_close(handle);
+  if (err == ESP_OK)
+    ESP_LOGD(TAG, "Saved tokens.");
+
+exit:
+  mbedtls_platform_zeroize(json_text, json_size);
+  cJSON_free(json_text);
+  return err;
+}
+
+esp_err_t TokenStore::Erase() const {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(kNamespace, NVS_READWRITE, &handle);
+  if (err != ESP_OK)
+    return err;
+  err = nvs_erase_key(handle, kKey);
+  if (err == ESP_ERR_NVS_NOT_FOUND)
+    err = ESP_OK;
+  if (err == ESP_OK)
+    err = nvs_commit(handle);
+  nvs_close(handle);
+  if (err == ESP_OK)
+    ESP_LOGI(TAG, "Erased tokens.");
+  return err;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <esp_err.h>
+
+/**
+ * Keeps the Spotify refresh token in NVS so that a reboot does not need the
+ * user to log in again.
+ *
+ * The tokens are sealed with AES-256-GCM under a key derived (HMAC-SHA256)
+ * from the Spotify client secret and the device's base MAC address. A copy
+ * of the NVS partition alone, or moved to another device, reveals nothing
+ * and fails authentication. Without flash encryption it does not protect
+ * against someone with the whole flash, which includes the client secret.
+ */
+class TokenStore {
+ public:
+  struct Tokens {
+    std::string refresh_token;
+    std::string scope;
+    // Access token expiry (Unix time), 0 if unknown. Only logged: the
+    // access token is not saved, and at boot the clock is not yet set.
+    int64_t expires_at = 0;
+  };
+
+  /**
+   * @param secret The Spotify client secret, from which the key is derived.
+   */
+  explicit TokenStore(const std::string& secret);
+
+  /**
+   * Read the saved tokens.
+   *
+   * @return ESP_ERR_NVS_NOT_FOUND if none are saved, ESP_ERR_INVALID_CRC if
+   *         they fail authentication (such as after the client secret
+   *         changed), else ESP_OK or another error.
+   */
+  esp_err_t Load(Tokens* tokens) const;
+
+  esp_err_t Save(const Tokens& tokens) const;
+
+  esp_err_t Erase() const;
+
+ private:
+  static constexpr size_t kKeySize = 32;  // AES-256.
+
+  esp_err_t DeriveKey(uint8_t key[kKeySize]) const;
+
+  const std::string secret_;
+};
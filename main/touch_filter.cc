@@ -0,0 +1,51 @@
+#include "touch_filter.h"
+
+namespace {
+
+int16_t Median(int16_t a, int16_t b, int16_t c) {
+  if (a > b) {
+    const int16_t tmp = a;
+    a = b;
+    b = tmp;
+  }
+  // a <= b.
+  if (c <= a)
+    return a;
+  if (c >= b)
+    return b;
+  return c;
+}
+
+}  // namespace
+
+TouchFilter::TouchFilter(uint8_t iir_shift) : iir_shift_(iir_shift) {
+  Reset({0, 0});
+}
+
+void TouchFilter::Reset(Point p) {
+  x_.Reset(p.x);
+  y_.Reset(p.y);
+}
+
+TouchFilter::Point TouchFilter::Filter(Point p) {
+  return {x_.Filter(p.x, iir_shift_), y_.Filter(p.y, iir_shift_)};
+}
+
+void TouchFilter::Axis::Reset(int16_t value) {
+  history[0] = history[1] = history[2] = value;
+  iir = static_cast<int32_t>(value) << kFracBits;
+}
+
+int16_t TouchFilter::Axis::Filter(int16_t value, uint8_t iir_shift) {
+  history[0] = history[1];
+  history[1] = history[2];
+  history[2] = value;
+  const int32_t median = static_cast<int32_t>(
+                             Median(history[0], history[1], history[2]))
+                         << kFracBits;
+  // Arithmetic shift of a negative step rounds toward -infinity, so the
+  // output can settle one LSB (1/256 pixel) below a falling input. That is
+  // removed by rounding the output to whole pixels.
+  iir += (median - iir) >> iir_shift;
+  return static_cast<int16_t>((iir + (1 << (kFracBits - 1))) >> kFracBits);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Smooths touch panel samples for use as a pointer.
+ *
+ * Each axis is passed through a three sample median, which removes the
+ * single sample spikes touch panels produce, then a first order IIR
+ * low-pass filter for the remaining jitter:
+ *
+ *   y[n] = y[n-1] + (x[n] - y[n-1]) / 2^iir_shift
+ *
+ * All arithmetic is fixed-point (8 fractional bits). The median delays the
+ * output by one sample and the IIR by about 2^iir_shift - 1 samples.
+ */
+class TouchFilter {
+ public:
+  struct Point {
+    int16_t x;
+    int16_t y;
+  };
+
+  static constexpr uint8_t kDefaultIIRShift = 2;
+
+  explicit TouchFilter(uint8_t iir_shift = kDefaultIIRShift);
+
+  /**
+   * Start filtering a new touch at |p|.
+   */
+  void Reset(Point p);
+
+  /**
+   * Filter the next sample of the current touch.
+   */
+  Point Filter(Point p);
+
+ private:
+  static constexpr int kFracBits = 8;
+
+  struct Axis {
+    void Reset(int16_t value);
+    int16_t Filter(int16_t value, uint8_t iir_shift);
+
+    int16_t history[3];  // The last three samples, oldest first.
+    int32_t iir;         // Filter output with kFracBits fractional bits.
+  };
+
+  const uint8_t iir_shift_;
+  Axis x_;
+  Axis y_;
+};
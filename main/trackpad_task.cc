@@ -0,0 +1,247 @@
+#include "trackpad_task.h"
+
+#include <cstdlib>
+
+#define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+#include <esp_idf_version.h>
+#include <esp_log.h>
+#include <freertos/include/freertos/semphr.h>
+#include <lvgl_touch/touch_driver.h>
+
+#include "usb_hid.h"
+
+namespace {
+
+constexpr char TAG[] = "Trackpad";
+
+constexpr uint32_t EVENT_MODE = BIT0;    // Trackpad mode enabled/disabled.
+constexpr uint32_t EVENT_SAMPLE = BIT1;  // Time to sample the panel.
+
+// The HID endpoint's poll interval, sampling faster only adds reports the
+// host won't read any sooner.
+constexpr uint64_t kSamplePeriodUsec = 2000;
+
+// Pointer movement per pixel of touch movement, kGainFracBits fixed-point.
+constexpr int kGainFracBits = 8;
+constexpr int32_t kGain = 2 << kGainFracBits;
+
+// A touch no longer or further than this is a tap (left click).
+constexpr int64_t kTapMaxUsec = 200 * 1000;
+constexpr uint32_t kTapMaxTravel = 6;
+
+// Holding still this long inside the top left corner leaves trackpad mode.
+constexpr int16_t kExitCornerSize = 40;
+constexpr int64_t kExitHoldUsec = 1500 * 1000;
+
+TrackpadTask* g_trackpad_task = nullptr;
+std::atomic<bool> g_enabled(false);
+// The LVGL touch driver, which reads the panel.
+std::atomic<lv_indev_drv_t*> g_indev_drv(nullptr);
+
+// Serializes panel reads between LVGL and this task while switching modes.
+SemaphoreHandle_t PanelMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+bool ReadPanel(lv_indev_drv_t* drv, lv_indev_data_t* data) {
+#if CONFIG_LV_TOUCH_CONTROLLER != TOUCH_CONTROLLER_NONE
+  if (xSemaphoreTake(PanelMutex(), portMAX_DELAY) != pdTRUE)
+    return false;
+  const bool more = touch_driver_read(drv, data);
+  xSemaphoreGive(PanelMutex());
+  return more;
+#else
+  data->state = LV_INDEV_STATE_REL;
+  return false;
+#endif
+}
+
+int8_t ClampToInt8(int32_t value) {
+  if (value > INT8_MAX)
+    return INT8_MAX;
+  if (value < INT8_MIN)
+    return INT8_MIN;
+  return value;
+}
+
+}  // namespace
+
+TrackpadTask::TrackpadTask() = default;
+
+TrackpadTask::~TrackpadTask() {
+  if (sample_timer_)
+    esp_timer_delete(sample_timer_);
+}
+
+// static
+esp_err_t TrackpadTask::Start(bool enabled) {
+  ESP_LOGD(TAG, "Starting trackpad task");
+  if (g_trackpad_task)
+    return ESP_FAIL;
+
+  g_trackpad_task = new TrackpadTask();
+  esp_err_t err = g_trackpad_task->Initialize();
+  if (err != ESP_OK)
+    return err;
+  return SetEnabled(enabled);
+}
+
+// static
+esp_err_t TrackpadTask::SetEnabled(bool enabled) {
+  if (!g_trackpad_task)
+    return ESP_ERR_INVALID_STATE;
+  g_enabled = enabled;
+  g_trackpad_task->notifier_.Notify(EVENT_MODE);
+  return ESP_OK;
+}
+
+// static
+bool TrackpadTask::enabled() {
+  return g_enabled;
+}
+
+// static
+bool TrackpadTask::TouchReadCb(lv_indev_drv_t* drv, lv_indev_data_t* data) {
+  g_indev_drv = drv;
+  if (g_enabled) {
+    data->state = LV_INDEV_STATE_REL;
+    return false;
+  }
+  return ReadPanel(drv, data);
+}
+
+esp_err_t TrackpadTask::Initialize() {
+  // https://www.freertos.org/FAQMem.html#StackSize
+  constexpr uint32_t kStackDepthWords = 2048;
+
+  if (!PanelMutex())
+    return ESP_ERR_NO_MEM;
+
+  const esp_timer_create_args_t timer_args = {
+    .callback = SampleTimerCb,
+    .arg = this,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "TrackpadSample",
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+    .skip_unhandled_events = true,
+#endif
+  };
+  esp_err_t err = esp_timer_create(&timer_args, &sample_timer_);
+  if (err != ESP_OK)
+    return err;
+
+  if (xTaskCreate(TaskFunc, TAG, kStackDepthWords, this, tskIDLE_PRIORITY + 1,
+                  &task_) != pdPASS) {
+    return ESP_FAIL;
+  }
+  notifier_.SetTask(task_);
+  return ESP_OK;
+}
+
+void TrackpadTask::StartSampling() {
+  ESP_LOGI(TAG, "Trackpad mode.");
+  touching_ = false;
+  // Fails harmlessly if already started.
+  esp_timer_start_periodic(sample_timer_, kSamplePeriodUsec);
+}
+
+void TrackpadTask::StopSampling() {
+  ESP_LOGI(TAG, "UI mode.");
+  esp_timer_stop(sample_timer_);
+  notifier_.Clear(EVENT_SAMPLE);
+  touching_ = false;
+}
+
+void TrackpadTask::Sample() {
+  lv_indev_drv_t* drv = g_indev_drv;
+  if (!drv)
+    return;  // LVGL has not read the panel yet.
+  lv_indev_data_t data = {};
+  ReadPanel(drv, &data);
+  const int64_t now = esp_timer_get_time();
+  const bool pressed = data.state == LV_INDEV_STATE_PR;
+  // For recording samples to replay with test/touch_replay.cc.
+  ESP_LOGV(TAG, "sample %lld %d %d %d", now, data.point.x, data.point.y,
+           pressed);
+
+  const TouchFilter::Point p = {data.point.x, data.point.y};
+  if (!pressed) {
+    if (touching_)
+      TouchUp(now);
+  } else if (!touching_) {
+    TouchDown(p, now);
+  } else {
+    TouchMove(p, now);
+  }
+}
+
+void TrackpadTask::TouchDown(TouchFilter::Point p, int64_t now) {
+  filter_.Reset(p);
+  last_ = p;
+  touching_ = true;
+  touch_start_us_ = now;
+  travel_ = 0;
+  remainder_x_ = 0;
+  remainder_y_ = 0;
+}
+
+void TrackpadTask::TouchMove(TouchFilter::Point p, int64_t now) {
+  const TouchFilter::Point filtered = filter_.Filter(p);
+  const int32_t dx = filtered.x - last_.x;
+  const int32_t dy = filtered.y - last_.y;
+  last_ = filtered;
+  travel_ += std::abs(dx) + std::abs(dy);
+
+  if (travel_ <= kTapMaxTravel && p.x < kExitCornerSize &&
+      p.y < kExitCornerSize && now - touch_start_us_ >= kExitHoldUsec) {
+    g_enabled = false;
+    StopSampling();
+    return;
+  }
+
+  remainder_x_ += dx * kGain;
+  remainder_y_ += dy * kGain;
+  const int8_t report_x = ClampToInt8(remainder_x_ >> kGainFracBits);
+  const int8_t report_y = ClampToInt8(remainder_y_ >> kGainFracBits);
+  if (!report_x && !report_y)
+    return;
+  // If the queue is full the movement is kept and sent with the next report.
+  if (usb::HID::QueueMouseReport(0, report_x, report_y) != ESP_OK)
+    return;
+  remainder_x_ -= report_x * (1 << kGainFracBits);
+  remainder_y_ -= report_y * (1 << kGainFracBits);
+}
+
+void TrackpadTask::TouchUp(int64_t now) {
+  touching_ = false;
+  if (now - touch_start_us_ > kTapMaxUsec || travel_ > kTapMaxTravel)
+    return;
+  usb::HID::QueueMouseReport(MOUSE_BUTTON_LEFT, 0, 0);
+  usb::HID::QueueMouseReport(0, 0, 0);
+}
+
+void IRAM_ATTR TrackpadTask::Run() {
+  ESP_LOGW(TAG, "In trackpad task.");
+  while (true) {
+    const uint32_t bits = notifier_.Wait(portMAX_DELAY);
+    if (bits & EVENT_MODE) {
+      if (g_enabled)
+        StartSampling();
+      else
+        StopSampling();
+    }
+    if ((bits & EVENT_SAMPLE) && g_enabled)
+      Sample();
+  }
+}
+
+// static
+void TrackpadTask::SampleTimerCb(void* arg) {
+  static_cast<TrackpadTask*>(arg)->notifier_.Notify(EVENT_SAMPLE);
+}
+
+// static
+void IRAM_ATTR TrackpadTask::TaskFunc(void* arg) {
+  static_cast<TrackpadTask*>(arg)->Run();
+}
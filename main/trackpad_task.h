@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <freertos/include/freertos/FreeRTOS.h>
+#include <freertos/include/freertos/task.h>
+
+#include <esp_err.h>
+#include <esp_timer.h>
+#include <lvgl.h>
+
+#include "task_notifier.h"
+#include "touch_filter.h"
+
+/**
+ * Task which, in trackpad mode, uses the touch panel as a USB HID mouse.
+ *
+ * The panel is sampled at the HID endpoint's poll interval. Samples are
+ * smoothed by a TouchFilter and sent as relative mouse reports, and a short
+ * tap is a left click. Holding a finger still over the top left corner
+ * (where the gear icon is) returns to UI mode.
+ *
+ * LVGL keeps its input device registered in both modes, reading the panel
+ * through TouchReadCb(), which reports no touch while in trackpad mode.
+ */
+class TrackpadTask {
+ public:
+  /**
+   * Start the trackpad task.
+   *
+   * @param enabled Start in trackpad mode, else in UI mode.
+   */
+  static esp_err_t Start(bool enabled);
+
+  /**
+   * Switch between trackpad and UI mode.
+   *
+   * @note Thread-safe.
+   */
+  static esp_err_t SetEnabled(bool enabled);
+
+  static bool enabled();
+
+  /**
+   * The LVGL touch panel read callback.
+   */
+  static bool TouchReadCb(lv_indev_drv_t* drv, lv_indev_data_t* data);
+
+ private:
+  static void IRAM_ATTR TaskFunc(void* arg);
+  static void SampleTimerCb(void* arg);
+
+  TrackpadTask();
+  ~TrackpadTask();
+
+  esp_err_t Initialize();
+  void IRAM_ATTR Run();
+  void StartSampling();
+  void StopSampling();
+
+  /**
+   * Read and handle one touch panel sample.
+   */
+  void Sample();
+  void TouchDown(TouchFilter::Point p, int64_t now);
+  void TouchMove(TouchFilter::Point p, int64_t now);
+  void TouchUp(int64_t now);
+
+  TaskNotifier notifier_;
+  TaskHandle_t task_ = nullptr;  // This task.
+  esp_timer_handle_t sample_timer_ = nullptr;
+  TouchFilter filter_;
+  bool touching_ = false;
+  TouchFilter::Point last_;      // Last filtered position.
+  int64_t touch_start_us_ = 0;   // When the current touch began.
+  uint32_t travel_ = 0;          // Filtered movement of this touch, pixels.
+  int32_t remainder_x_ = 0;      // Unsent movement, kGainFracBits fraction.
+  int32_t remainder_y_ = 0;
+};
@@ -12,6 +12,8 @@
 #include "main_display.h"
 #include "main_screen.h"
 #include "resource_fetcher.h"
+#include "trackpad_task.h"
+#include "usb_hid.h"
 
 namespace {
 
@@ -19,6 +21,8 @@ constexpr uint32_t kStackDepthWords = 4 * 1024;
 constexpr uint64_t kMaxMainLoopWaitMSecs = 100;
 constexpr uint32_t kMinMainLoopWaitMSecs = 10;
 constexpr uint64_t kTickTimerPeriodUsec = 1000;
+constexpr uint64_t kUpdateTimePeriodUsec = 1000000;  // every second.
+constexpr uint32_t EVENT_RESUME = BIT0;
 constexpr char TAG[] = "UITask";
 
 // Make sure min wait time is at least one tick.
@@ -29,7 +33,9 @@ UITask* g_ui_task = nullptr;
 
 }  // namespace
 
-UITask::UITask() : mutex_(xSemaphoreCreateMutex()) {}
+UITask::UITask()
+    : mutex_(xSemaphoreCreateMutex()),
+      now_playing_mutex_(xSemaphoreCreateMutex()) {}
 
 // static
 esp_err_t UITask::Start() {
@@ -40,6 +46,12 @@ esp_err_t UITask::Start() {
   return g_ui_task->Initialize();
 }
 
+// static
+usb::NowPlayingClient* UITask::now_playing_client() {
+  configASSERT(g_ui_task);
+  return g_ui_task;
+}
+
 void UITask::Tick() {
   int64_t now = esp_timer_get_time();
   uint32_t tick_period = last_tick_time_ == -1 ? 0 : now - last_tick_time_;
@@ -101,7 +113,6 @@ esp_err_t UITask::CreateUpdateTimeTimer() {
     ESP_LOGE(TAG, "Unable to create the periodic tick timer");
     return err;
   }
-  constexpr uint64_t kUpdateTimePeriodUsec = 1000000;  // every second.
   err = esp_timer_start_periodic(time_update_timer_, kUpdateTimePeriodUsec);
   if (err != ESP_OK)
     ESP_LOGE(TAG, "Unable to start the time update timer");
@@ -111,7 +122,7 @@ esp_err_t UITask::CreateUpdateTimeTimer() {
 esp_err_t UITask::Initialize() {
   ESP_LOGD(TAG, "Initializing UI task");
 
-  if (!mutex_)
+  if (!mutex_ || !now_playing_mutex_)
     return ESP_FAIL;
 
   const esp_timer_create_args_t cover_art_timer_args = {
@@ -133,11 +144,13 @@ esp_err_t UITask::Initialize() {
   // Create a new task for LVGL drawing. Don't believe this needs to
   // be pinned to a single core, but doing so on a dual-core MCU
   // will reserve the other core for WiFi and other activities.
-  return pdPASS == xTaskCreatePinnedToCore(TaskFunc, "UI", kStackDepthWords,
-                                           this, tskIDLE_PRIORITY + 1, &task_,
-                                           tskNO_AFFINITY)
-             ? ESP_OK
-             : ESP_FAIL;
+  if (xTaskCreatePinnedToCore(TaskFunc, "UI", kStackDepthWords, this,
+                              tskIDLE_PRIORITY + 1, &task_,
+                              tskNO_AFFINITY) != pdPASS) {
+    return ESP_FAIL;
+  }
+  notifier_.SetTask(task_);
+  return ESP_OK;
 }
 
 void UITask::SetDarkMode() {
@@ -171,9 +184,21 @@ void IRAM_ATTR UITask::Run() {
   xSemaphoreGive(mutex_);
 
   while (true) {
+    if (suspended_) {
+      notifier_.Wait(portMAX_DELAY);
+      continue;
+    }
     uint32_t wait_msecs = kMinMainLoopWaitMSecs;
     if (xSemaphoreTake(mutex_, portMAX_DELAY) == pdTRUE) {
+      ApplyNowPlaying();
+      UpdateLockState();
+      UpdateTrackpadMode();
       wait_msecs = lv_task_handler() / 1000;
+      if (resume_time_us_) {
+        ESP_LOGD(TAG, "First frame %lld usec after resume.",
+                 esp_timer_get_time() - resume_time_us_);
+        resume_time_us_ = 0;
+      }
       xSemaphoreGive(mutex_);
       if (wait_msecs < kMinMainLoopWaitMSecs)
         wait_msecs = kMinMainLoopWaitMSecs;
@@ -200,6 +225,62 @@ void UITask::SetWiFiStatus(WiFiStatus status) {
   xSemaphoreGive(g_ui_task->mutex_);
 }
 
+// static
+void UITask::SetArtworkURL(const std::string& url) {
+  configASSERT(g_ui_task);
+  if (url.empty())
+    return;
+  if (xSemaphoreTake(g_ui_task->mutex_, portMAX_DELAY) != pdTRUE)
+    return;
+  if (!g_ui_task->host_artwork_ &&
+      (url != g_ui_task->artwork_url_ || !g_ui_task->artwork_fetch_id_)) {
+    g_ui_task->artwork_url_ = url;
+    g_ui_task->artwork_fetch_id_ = g_ui_task->next_fetch_id_++;
+    esp_timer_stop(g_ui_task->test_cover_art_timer_);
+    g_ui_task->fetcher_->QueueFetch(g_ui_task->artwork_fetch_id_, url);
+  }
+  xSemaphoreGive(g_ui_task->mutex_);
+}
+
+// static
+void UITask::Suspend() {
+  configASSERT(g_ui_task);
+  if (xSemaphoreTake(g_ui_task->mutex_, portMAX_DELAY) != pdTRUE)
+    return;
+  if (!g_ui_task->suspended_) {
+    g_ui_task->suspended_ = true;
+    // Timers which were never started (before Run()) fail harmlessly.
+    esp_timer_stop(g_ui_task->tick_timer_);
+    esp_timer_stop(g_ui_task->time_update_timer_);
+    esp_timer_stop(g_ui_task->test_cover_art_timer_);
+  }
+  xSemaphoreGive(g_ui_task->mutex_);
+}
+
+// static
+void UITask::Resume() {
+  configASSERT(g_ui_task);
+  if (xSemaphoreTake(g_ui_task->mutex_, portMAX_DELAY) != pdTRUE)
+    return;
+  if (g_ui_task->suspended_) {
+    g_ui_task->suspended_ = false;
+    g_ui_task->resume_time_us_ = esp_timer_get_time();
+    if (g_ui_task->tick_timer_) {
+      // LVGL time stands still while suspended, rather than jumping ahead.
+      g_ui_task->last_tick_time_ = -1;
+      esp_timer_start_periodic(g_ui_task->tick_timer_, kTickTimerPeriodUsec);
+    }
+    if (g_ui_task->time_update_timer_) {
+      esp_timer_start_periodic(g_ui_task->time_update_timer_,
+                               kUpdateTimePeriodUsec);
+    }
+    if (g_ui_task->showing_test_covers())
+      g_ui_task->StartTestCoverArtTimer(1);
+    g_ui_task->notifier_.Notify(EVENT_RESUME);
+  }
+  xSemaphoreGive(g_ui_task->mutex_);
+}
+
 std::string UITask::GetTestCoverArtURL() const {
   char* tmp(nullptr);
   if (asprintf(&tmp, "http://10.0.9.120/album_covers/album_%u_cover.jpg",
@@ -219,6 +300,11 @@ void UITask::TestCoverArtTimerCb(void* arg) {
   if (xSemaphoreTake(task->mutex_, portMAX_DELAY) != pdTRUE)
     return;
 
+  if (!task->showing_test_covers()) {
+    xSemaphoreGive(task->mutex_);
+    return;
+  }
+
   if (task->wifi_status_ != WiFiStatus::Online) {
     task->StartTestCoverArtTimer(1);
     xSemaphoreGive(task->mutex_);
@@ -235,6 +321,8 @@ void UITask::TestCoverArtTimerCb(void* arg) {
 }
 
 esp_err_t UITask::StartTestCoverArtTimer(uint32_t timer_seconds) {
+  if (suspended_)
+    return ESP_OK;  // Restarted by Resume().
   const uint64_t timeout_us = timer_seconds * 1000 * 1000;
   return esp_timer_start_once(test_cover_art_timer_, timeout_us);
 }
@@ -243,6 +331,21 @@ void UITask::FetchImageResult(uint32_t request_id, lv_img_dsc_t image) {
   configASSERT(main_display_.screen());
   if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
     return;
+  if (!showing_test_covers()) {
+    if (!host_artwork_ && request_id == artwork_fetch_id_) {
+      main_display_.screen()->SetAlbumArtwork(std::move(image));
+      if (!logged_first_artwork_) {
+        logged_first_artwork_ = true;
+        ESP_LOGI(TAG, "Boot to first Spotify artwork: %lld msec.",
+                 esp_timer_get_time() / 1000);
+      }
+    } else {
+      // A test cover, or artwork since replaced.
+      delete[] image.data;
+    }
+    xSemaphoreGive(mutex_);
+    return;
+  }
   char msg[30];
   snprintf(msg, sizeof(msg), "Got cover %u (fetch #%u).",
            test_cover_art_img_idx_, request_id);
@@ -258,7 +361,7 @@ void UITask::FetchResult(uint32_t request_id,
                          int http_status_code,
                          std::vector<uint8_t> resource_data,
                          std::string mime_type) {
-  if (xSemaphoreTake(mutex_, portMAX_DELAY) == pdTRUE)
+  if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
     return;
 
   char msg[30];
@@ -271,9 +374,13 @@ void UITask::FetchResult(uint32_t request_id,
   }
   msg[sizeof(msg) - 1] = '\0';
   main_display_.screen()->SetDebugString(msg);
-  if (++test_cover_art_img_idx_ > 9)
-    test_cover_art_img_idx_ = 1;
-  StartTestCoverArtTimer(5);
+  if (request_id == artwork_fetch_id_) {
+    artwork_fetch_id_ = 0;  // Fetch it again on the next poll.
+  } else if (showing_test_covers()) {
+    if (++test_cover_art_img_idx_ > 9)
+      test_cover_art_img_idx_ = 1;
+    StartTestCoverArtTimer(5);
+  }
   xSemaphoreGive(mutex_);
 }
 
@@ -287,6 +394,94 @@ void UITask::FetchError(uint32_t request_id, esp_err_t err) {
            esp_err_to_name(err));
   msg[sizeof(msg) - 1] = '\0';
   main_display_.screen()->SetDebugString(msg);
-  StartTestCoverArtTimer(3);
+  if (request_id == artwork_fetch_id_)
+    artwork_fetch_id_ = 0;  // Fetch it again on the next poll.
+  else if (showing_test_covers())
+    StartTestCoverArtTimer(3);
   xSemaphoreGive(mutex_);
 }
+
+esp_err_t UITask::NowPlayingTrack(std::string artist,
+                                  std::string album,
+                                  std::string title) {
+  if (xSemaphoreTake(now_playing_mutex_, portMAX_DELAY) != pdTRUE)
+    return ESP_FAIL;
+  std::swap(pending_artist_, artist);
+  std::swap(pending_album_, album);
+  std::swap(pending_title_, title);
+  track_pending_ = true;
+  xSemaphoreGive(now_playing_mutex_);
+  // Any replaced strings are freed here, outside of the lock.
+  return ESP_OK;
+}
+
+esp_err_t UITask::NowPlayingArtwork(std::unique_ptr<uint8_t[]> pixels,
+                                    uint16_t width,
+                                    uint16_t height) {
+  if (width != kAlbumArtworkWidth || height != kAlbumArtworkHeight)
+    return ESP_ERR_INVALID_SIZE;
+  if (xSemaphoreTake(now_playing_mutex_, portMAX_DELAY) != pdTRUE)
+    return ESP_FAIL;
+  // An undisplayed frame is replaced by this newer one.
+  std::swap(pending_artwork_, pixels);
+  xSemaphoreGive(now_playing_mutex_);
+  return ESP_OK;
+}
+
+void UITask::UpdateLockState() {
+  const uint8_t lock_state = usb::HID::lock_state();
+  if (lock_state == lock_state_ || !main_display_.screen())
+    return;
+  lock_state_ = lock_state;
+  main_display_.screen()->SetLockState(lock_state & KEYBOARD_LED_NUMLOCK,
+                                       lock_state & KEYBOARD_LED_CAPSLOCK,
+                                       lock_state & KEYBOARD_LED_SCROLLLOCK);
+}
+
+void UITask::UpdateTrackpadMode() {
+  const bool trackpad_mode = TrackpadTask::enabled();
+  if (trackpad_mode == trackpad_mode_ || !main_display_.screen())
+    return;
+  trackpad_mode_ = trackpad_mode;
+  main_display_.screen()->SetTrackpadMode(trackpad_mode);
+}
+
+void UITask::ApplyNowPlaying() {
+  std::string artist, album, title;
+  std::unique_ptr<uint8_t[]> artwork;
+  bool track_changed;
+  if (xSemaphoreTake(now_playing_mutex_, portMAX_DELAY) != pdTRUE)
+    return;
+  track_changed = track_pending_;
+  track_pending_ = false;
+  if (track_changed) {
+    std::swap(artist, pending_artist_);
+    std::swap(album, pending_album_);
+    std::swap(title, pending_title_);
+  }
+  std::swap(artwork, pending_artwork_);
+  xSemaphoreGive(now_playing_mutex_);
+
+  if (!main_display_.screen())
+    return;
+  if (track_changed)
+    main_display_.screen()->SetTrackInfo(artist, album, title);
+  if (!artwork)
+    return;
+
+  // Pixels are already in the display's format, so use them as they are.
+  lv_img_dsc_t image;
+  bzero(&image, sizeof(image));
+  image.header.always_zero = 0;
+  image.header.cf = LV_IMG_CF_TRUE_COLOR;
+  image.header.w = kAlbumArtworkWidth;
+  image.header.h = kAlbumArtworkHeight;
+  image.data_size =
+      kAlbumArtworkWidth * kAlbumArtworkHeight * sizeof(lv_color_t);
+  image.data = artwork.release();
+  main_display_.screen()->SetAlbumArtwork(std::move(image));
+  if (!host_artwork_) {
+    host_artwork_ = true;
+    esp_timer_stop(test_cover_art_timer_);
+  }
+}
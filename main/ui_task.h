@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -13,14 +15,21 @@
 #include "event_ids.h"
 #include "main_display.h"
 #include "resource_fetcher.h"
+#include "task_notifier.h"
+#include "usb_host_channel.h"
 
 /**
  * The task responsible for doing **all** UI rendering to screens.
  */
-class UITask : public ResourceFetchClient {
+class UITask : public ResourceFetchClient, public usb::NowPlayingClient {
  public:
   static esp_err_t Start();
 
+  /**
+   * The client which displays now playing data pushed over USB.
+   */
+  static usb::NowPlayingClient* now_playing_client();
+
   /**
    * Set WiFi status.
    *
@@ -28,6 +37,30 @@ class UITask : public ResourceFetchClient {
    */
   static void SetWiFiStatus(WiFiStatus status);
 
+  /**
+   * Display the album artwork at |url|, of Spotify's currently playing
+   * track. It is only fetched when the URL changes, and artwork sent by the
+   * USB host takes precedence.
+   *
+   * thread-safe.
+   */
+  static void SetArtworkURL(const std::string& url);
+
+  /**
+   * Stop the LVGL tick, the UI loop, and the UI timers, for when the USB host
+   * is suspended. Nothing is drawn until Resume().
+   *
+   * thread-safe.
+   */
+  static void Suspend();
+
+  /**
+   * Restart everything stopped by Suspend().
+   *
+   * thread-safe.
+   */
+  static void Resume();
+
   // ResourceFetchClient:
   void FetchImageResult(uint32_t request_id, lv_img_dsc_t image) override;
   void FetchResult(uint32_t request_id,
@@ -36,6 +69,14 @@ class UITask : public ResourceFetchClient {
                    std::string mime_type) override;
   void FetchError(uint32_t request_id, esp_err_t err) override;
 
+  // usb::NowPlayingClient:
+  esp_err_t NowPlayingTrack(std::string artist,
+                            std::string album,
+                            std::string title) override;
+  esp_err_t NowPlayingArtwork(std::unique_ptr<uint8_t[]> pixels,
+                              uint16_t width,
+                              uint16_t height) override;
+
  private:
   static void IRAM_ATTR TaskFunc(void* arg);
   static void IRAM_ATTR TickTimerCb(void* arg);
@@ -45,24 +86,50 @@ class UITask : public ResourceFetchClient {
   UITask();
 
   esp_err_t StartTestCoverArtTimer(uint32_t timer_seconds);
+  bool showing_test_covers() const {
+    return !host_artwork_ && artwork_url_.empty();
+  }
   std::string GetTestCoverArtURL() const;
   void SetDarkMode();
   void UpdateTime();
   esp_err_t CreateUpdateTimeTimer();
   esp_err_t CreateTickTimer();
   void Tick();
+  void ApplyNowPlaying();
+  void UpdateLockState();
+  void UpdateTrackpadMode();
   esp_err_t Initialize();
   void IRAM_ATTR Run();
 
   SemaphoreHandle_t mutex_;
   MainDisplay main_display_;
   TaskHandle_t task_ = nullptr;
+  TaskNotifier notifier_;  // Wakes the UI loop on Resume().
+  std::atomic<bool> suspended_{false};
+  int64_t resume_time_us_ = 0;  // When Resume() was called.
   esp_timer_handle_t tick_timer_ = nullptr;
   esp_timer_handle_t time_update_timer_ = nullptr;
   WiFiStatus wifi_status_ = WiFiStatus::Offline;
+  uint8_t lock_state_ = 0;  // Last displayed usb::HID::lock_state().
+  bool trackpad_mode_ = false;  // Last displayed TrackpadTask::enabled().
   int64_t last_tick_time_ = -1;
   uint8_t test_cover_art_img_idx_ = 1;  // Just for testing.
   esp_timer_handle_t test_cover_art_timer_ = nullptr;
   ResourceFetcher* fetcher_;
   uint32_t next_fetch_id_ = 1;
+  // Spotify artwork, once set replacing the test covers.
+  std::string artwork_url_;
+  uint32_t artwork_fetch_id_ = 0;  // The fetch of |artwork_url_|, 0 if failed.
+  bool logged_first_artwork_ = false;  // Boot to artwork time logged.
+
+  // Now playing data from the USB task, waiting to be displayed. Guarded by
+  // |now_playing_mutex_|, which is never held while drawing, so the USB task
+  // does not wait for LVGL.
+  SemaphoreHandle_t now_playing_mutex_;
+  bool track_pending_ = false;
+  std::string pending_artist_;
+  std::string pending_album_;
+  std::string pending_title_;
+  std::unique_ptr<uint8_t[]> pending_artwork_;
+  bool host_artwork_ = false;  // Host sent artwork, stop the test covers.
 };
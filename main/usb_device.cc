@@ -1,13 +1,13 @@
 #include "usb_device.h"
 
-#include <cstring>
-
 #define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/task.h>
 #include <tusb.h>
 #include "usb_board.h"
 #include "usb_hid.h"
+#include "usb_host_channel.h"
 #include "usb_misc.h"
 #include "usb_string_ids.h"
 
@@ -15,21 +15,6 @@ namespace usb {
 
 namespace {
 
-struct ConfigDescriptors {
-  tusb_desc_configuration_t device;
-  uint8_t hid[sizeof(HID::kHIDDescriptorConfig)];
-};
-
-// Character 1 = (length) + (string type).
-// Characters 2..n = descriptor string (not null terminated).
-constexpr uint8_t kMaxDescriptorStringLen = 32;
-typedef uint16_t DescriptorString[1 + kMaxDescriptorStringLen];
-
-// Make sure compiler didn't pack any space in between the members.
-static_assert(sizeof(ConfigDescriptors) ==
-              sizeof(tusb_desc_configuration_t) +
-                  sizeof(HID::kHIDDescriptorConfig));
-
 constexpr char TAG[] = "USB";
 // TODO: These are from random.org. Need to get actual VID/PID numbers to
 //       avoid conflicts with other products.
@@ -42,6 +27,9 @@ constexpr char kDeviceManufacturer[] = "Awesome Keyboard Co.";
 constexpr char kProduct[] = "Super Display Keyboard";
 constexpr uint16_t kLanguage = 0x0409;  // = English
 constexpr uint8_t kMaxPower = 150;      // 2 mA units (i.e., 50 = 100 mA).
+
+PowerStateClient* g_power_state_client = nullptr;
+
 constexpr tusb_desc_device_t kDeviceDescriptor = {
     .bLength = sizeof(tusb_desc_device_t),
     .bDescriptorType = TUSB_DESC_DEVICE,
@@ -61,57 +49,131 @@ constexpr tusb_desc_device_t kDeviceDescriptor = {
     .iSerialNumber = STRID_SERIAL,
     .bNumConfigurations = 0x01,
 };
-constexpr tusb_desc_configuration_t kDeviceDescriptorConfig = {
-    .bLength = sizeof(tusb_desc_configuration_t),
-    .bDescriptorType = TUSB_DESC_CONFIGURATION,
-    .wTotalLength = sizeof(ConfigDescriptors),
-    .bNumInterfaces = 1,
-    .bConfigurationValue = 1,
-    .iConfiguration = 0x00,
-    .bmAttributes = TU_BIT(7) | TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP,
-    .bMaxPower = TUSB_DESC_CONFIG_POWER_MA(kMaxPower),
+
+struct ConfigDescriptors {
+  tusb_desc_configuration_t config;
+  uint8_t hid[HID::kHIDDescriptorConfigLen];
+  uint8_t vendor[HostChannel::kDescriptorConfigLen];  // Only when enabled.
 };
 
-static_assert(sizeof(kDeviceManufacturer) <= kMaxDescriptorStringLen);
-static_assert(sizeof(kProduct) <= kMaxDescriptorStringLen);
-static_assert(sizeof(kDeviceSerialNumber) <= kMaxDescriptorStringLen);
-static_assert(sizeof(HID::kInterfaceName) <= kMaxDescriptorStringLen);
+// Make sure compiler didn't pack any space in between the members.
+static_assert(sizeof(ConfigDescriptors) ==
+              sizeof(tusb_desc_configuration_t) +
+                  HID::kHIDDescriptorConfigLen +
+                  HostChannel::kDescriptorConfigLen);
+
+/**
+ * Check that the bLength fields of the descriptors in |desc| add up to
+ * exactly |len| bytes.
+ */
+constexpr bool DescriptorLengthsValid(const uint8_t* desc, size_t len) {
+  size_t offset = 0;
+  while (offset < len) {
+    if (desc[offset] < 2)
+      return false;
+    offset += desc[offset];
+  }
+  return offset == len;
+}
+
+/**
+ * The report descriptor length (wDescriptorLength) in the HID descriptor of
+ * a TUD_HID_DESCRIPTOR, which follows its interface descriptor.
+ */
+constexpr uint16_t HIDReportDescriptorLength(const uint8_t* desc) {
+  const uint8_t* hid_desc = desc + desc[0];
+  return hid_desc[7] | (hid_desc[8] << 8);
+}
+
+constexpr ConfigDescriptors MakeConfigDescriptors(const uint8_t* hid_desc,
+                                                  bool host_channel) {
+  ConfigDescriptors desc = {
+      .config =
+          {
+              .bLength = sizeof(tusb_desc_configuration_t),
+              .bDescriptorType = TUSB_DESC_CONFIGURATION,
+              // The vendor descriptor is last, so is left off the end.
+              .wTotalLength = static_cast<uint16_t>(
+                  host_channel ? sizeof(ConfigDescriptors)
+                               : sizeof(ConfigDescriptors) -
+                                     HostChannel::kDescriptorConfigLen),
+              .bNumInterfaces = static_cast<uint8_t>(host_channel ? 2 : 1),
+              .bConfigurationValue = 1,
+              .iConfiguration = 0x00,
+              .bmAttributes = TU_BIT(7) | TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP,
+              .bMaxPower = TUSB_DESC_CONFIG_POWER_MA(kMaxPower),
+          },
+      .hid = {},
+      .vendor = {},
+  };
+  for (size_t i = 0; i < HID::kHIDDescriptorConfigLen; i++)
+    desc.hid[i] = hid_desc[i];
+  for (size_t i = 0; host_channel && i < HostChannel::kDescriptorConfigLen;
+       i++) {
+    desc.vendor[i] = HostChannel::kDescriptorConfig[i];
+  }
+  return desc;
+}
+
+static_assert(HID::kHIDDescriptorConfigBoot[1] == TUSB_DESC_INTERFACE);
+static_assert(HID::kHIDDescriptorConfigNKRO[1] == TUSB_DESC_INTERFACE);
+static_assert(HostChannel::kDescriptorConfig[1] == TUSB_DESC_INTERFACE);
+static_assert(DescriptorLengthsValid(HID::kHIDDescriptorConfigBoot,
+                                     HID::kHIDDescriptorConfigLen));
+static_assert(DescriptorLengthsValid(HID::kHIDDescriptorConfigNKRO,
+                                     HID::kHIDDescriptorConfigLen));
+static_assert(DescriptorLengthsValid(HostChannel::kDescriptorConfig,
+                                     HostChannel::kDescriptorConfigLen));
+static_assert(HIDReportDescriptorLength(HID::kHIDDescriptorConfigBoot) ==
+              sizeof(HID::kHIDDescriptorReportBoot));
+static_assert(HIDReportDescriptorLength(HID::kHIDDescriptorConfigNKRO) ==
+              sizeof(HID::kHIDDescriptorReportNKRO));
+
+// Every configuration, by report mode and whether HostChannel is enabled.
+constexpr ConfigDescriptors kConfigBoot =
+    MakeConfigDescriptors(HID::kHIDDescriptorConfigBoot, false);
+constexpr ConfigDescriptors kConfigBootHostChannel =
+    MakeConfigDescriptors(HID::kHIDDescriptorConfigBoot, true);
+constexpr ConfigDescriptors kConfigNKRO =
+    MakeConfigDescriptors(HID::kHIDDescriptorConfigNKRO, false);
+constexpr ConfigDescriptors kConfigNKROHostChannel =
+    MakeConfigDescriptors(HID::kHIDDescriptorConfigNKRO, true);
+
+static_assert(kConfigNKRO.config.wTotalLength ==
+              sizeof(tusb_desc_configuration_t) +
+                  HID::kHIDDescriptorConfigLen);
+static_assert(kConfigNKROHostChannel.config.wTotalLength ==
+              sizeof(ConfigDescriptors));
+
+const ConfigDescriptors& GetConfigDescriptors() {
+  if (HID::GetKeyboardReportMode() == KeyboardReportMode::NKRO)
+    return HostChannel::enabled() ? kConfigNKROHostChannel : kConfigNKRO;
+  return HostChannel::enabled() ? kConfigBootHostChannel : kConfigBoot;
+}
 
-ConfigDescriptors g_config_descriptors;
-DescriptorString g_descriptor_strings[STRID_NUM];
-DescriptorString g_unknown_descriptor_string;
+// The language string descriptor is a list of language IDs, not text.
+constexpr uint16_t kLanguageDescriptor[] = {(TUSB_DESC_STRING << 8) | 4,
+                                            kLanguage};
+constexpr char kUnknownString[] = "<unknown>";
 
-const char* GetDescriptorString(StringID id) {
+const uint16_t* GetDescriptorString(StringID id) {
   switch (id) {
+    case STRID_LANGUAGE:
+      return kLanguageDescriptor;
     case STRID_MANUFACTURER:
-      return kDeviceManufacturer;
+      return kStringDescriptor<kDeviceManufacturer>.data;
     case STRID_PRODUCT:
-      return kProduct;
+      return kStringDescriptor<kProduct>.data;
     case STRID_SERIAL:
-      return kDeviceSerialNumber;
+      return kStringDescriptor<kDeviceSerialNumber>.data;
     case STRID_HID:
-      return HID::kInterfaceName;
-    case STRID_LANGUAGE:
-      // fallthrough - handled differently.
+      return kStringDescriptor<HID::kInterfaceName>.data;
+    case STRID_HOST_CHANNEL:
+      return kStringDescriptor<HostChannel::kInterfaceName>.data;
     case STRID_NUM:
-      // fallthrough
       break;
   }
-  return nullptr;
-}
-
-uint16_t CreateDecStringHeader(uint8_t num_chars) {
-  // Byte #1 = length. Byte #2 = string type.
-  return (TUSB_DESC_STRING << 8) | (2 + 2 * num_chars);
-}
-
-void InitializeDescriptorString(DescriptorString dst, const char* src) {
-  const int num_chars = strcpy_utf16(dst + 1, src, kMaxDescriptorStringLen);
-  dst[0] = CreateDecStringHeader(num_chars);
-}
-
-void InitializeDescriptorString(StringID id) {
-  InitializeDescriptorString(g_descriptor_strings[id], GetDescriptorString(id));
+  return kStringDescriptor<kUnknownString>.data;
 }
 
 extern "C" {
@@ -126,7 +188,7 @@ uint8_t const* tud_descriptor_device_cb(void) {
 // Application return pointer to descriptor, whose contents must exist long
 // enough for transfer to complete
 uint8_t const* tud_descriptor_configuration_cb(uint8_t /*index*/) {
-  return reinterpret_cast<uint8_t const*>(&g_config_descriptors);
+  return reinterpret_cast<uint8_t const*>(&GetConfigDescriptors());
 }
 
 // Invoked when received GET STRING DESCRIPTOR request
@@ -136,14 +198,48 @@ uint8_t const* tud_descriptor_configuration_cb(uint8_t /*index*/) {
 // https://docs.microsoft.com/en-us/windows-hardware/drivers/usbcon/microsoft-defined-usb-descriptors
 uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t /*langid*/) {
   if (index < STRID_NUM)
-    return g_descriptor_strings[index];
-  return g_unknown_descriptor_string;
+    return GetDescriptorString(static_cast<StringID>(index));
+  return kStringDescriptor<kUnknownString>.data;
+}
+
+// Invoked when the device is mounted (configured).
+void tud_mount_cb(void) {
+  ESP_LOGI(TAG, "Mounted %lld ms after boot.", esp_timer_get_time() / 1000);
+}
+
+// Invoked when the device is unmounted.
+void tud_umount_cb(void) {
+  if (HostChannel::enabled())
+    HostChannel::Reset();
+}
+
+// Invoked when the bus has been idle for 3 ms.
+void tud_suspend_cb(bool remote_wakeup_en) {
+  ESP_LOGI(TAG, "Suspended, remote wakeup %s.",
+           remote_wakeup_en ? "enabled" : "disabled");
+  if (g_power_state_client)
+    g_power_state_client->USBSuspended(remote_wakeup_en);
+}
+
+// Invoked when the bus resumes.
+void tud_resume_cb(void) {
+  ESP_LOGI(TAG, "Resumed.");
+  if (g_power_state_client)
+    g_power_state_client->USBResumed();
+  // Send what was queued while suspended, including any key which woke the
+  // host.
+  HID::ScheduleSend();
 }
 
 }  // extern C
 
 }  // namespace
 
+// static
+void Device::SetPowerStateClient(PowerStateClient* client) {
+  g_power_state_client = client;
+}
+
 // static
 bool Device::Mounted() {
   return tud_mounted();
@@ -151,25 +247,18 @@ bool Device::Mounted() {
 
 // static
 esp_err_t Device::Initialize() {
-  g_config_descriptors.device = kDeviceDescriptorConfig;
-  std::memcpy(g_config_descriptors.hid, HID::kHIDDescriptorConfig,
-              sizeof(HID::kHIDDescriptorConfig));
-  static_assert(HID::kHIDDescriptorConfig[1] == TUSB_DESC_INTERFACE);
-
-  for (int i = 0; i < STRID_NUM; i++) {
-    if (i != STRID_LANGUAGE)
-      InitializeDescriptorString(static_cast<StringID>(i));
-  }
-  g_descriptor_strings[STRID_LANGUAGE][1] = ((uint16_t)((uint32_t)kLanguage));
-  g_descriptor_strings[STRID_LANGUAGE][0] = CreateDecStringHeader(1);
-  InitializeDescriptorString(g_unknown_descriptor_string, "<unknown>");
+  const int64_t start_us = esp_timer_get_time();
+  esp_err_t err = HID::Initialize();
+  if (err != ESP_OK)
+    return err;
 
   board_init();
 
   if (!tusb_init())
     return ESP_FAIL;
 
-  ESP_LOGI(TAG, "USB device is initialized");
+  ESP_LOGI(TAG, "USB device is initialized (%lld usec).",
+           esp_timer_get_time() - start_us);
   return ESP_OK;
 }
 
@@ -194,8 +283,11 @@ esp_err_t Device::Disconnect() {
 }
 
 // static
-void Device::Tick() {
-  tud_task();
+void Device::Run() {
+  // tud_task() blocks on TinyUSB's event queue, returning only in some
+  // TinyUSB versions, after handling the queued events.
+  while (true)
+    tud_task();
 }
 
 }  // namespace usb
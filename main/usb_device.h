@@ -9,6 +9,33 @@
 
 namespace usb {
 
+/**
+ * Implemented to be told when the host suspends and resumes the bus.
+ */
+class PowerStateClient {
+ public:
+  /**
+   * Called on the USB task when the host suspends the bus.
+   *
+   * @param remote_wakeup_enabled The host allows RemoteWakup().
+   *
+   * @warning Must not block.
+   */
+  virtual void USBSuspended(bool remote_wakeup_enabled) = 0;
+
+  /**
+   * Called on the USB task when the host resumes the bus, or the device
+   * resumed it with RemoteWakup().
+   *
+   * @warning Must not block.
+   */
+  virtual void USBResumed() = 0;
+
+ protected:
+  PowerStateClient() = default;
+  ~PowerStateClient() = default;
+};
+
 class Device {
  public:
   Device() = delete;
@@ -19,6 +46,13 @@ class Device {
    */
   static esp_err_t Initialize();
 
+  /**
+   * Set the client told of bus suspend and resume.
+   *
+   * @note Call before Initialize().
+   */
+  static void SetPowerStateClient(PowerStateClient* client);
+
   /**
    * Is the device connected and configured.
    */
@@ -39,9 +73,12 @@ class Device {
   static esp_err_t Disconnect();
 
   /**
-   * Give time to the USB stack to do work.
+   * Run the USB stack, never returning.
+   *
+   * Sleeps until the device controller driver or the application (see
+   * HID::ScheduleSend()) posts an event to TinyUSB's queue.
    */
-  static void Tick();
+  static void Run();
 };
 
 }  // namespace usb
@@ -1,23 +1,142 @@
 #include "usb_hid.h"
 
+#include <atomic>
+#include <cstring>
+
 #define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
 #include <freertos/include/freertos/FreeRTOS.h>
 
 #include <class/hid/hid_device.h>
+#include <device/usbd_pvt.h>
+#include <esp_idf_version.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <tusb.h>
+#include "keystroke_latency.h"
+#include "spsc_queue.h"
 #include "usb_device.h"
+#include "usb_text_injector.h"
 
 namespace usb {
 
-constexpr uint8_t HID::kHIDDescriptorReport[];
+constexpr uint8_t HID::kHIDDescriptorReportBoot[];
+constexpr uint8_t HID::kHIDDescriptorReportNKRO[];
 constexpr char HID::kInterfaceName[];
-constexpr uint8_t HID::kHIDDescriptorConfig[];
+constexpr uint8_t HID::kHIDDescriptorConfigBoot[];
+constexpr uint8_t HID::kHIDDescriptorConfigNKRO[];
 
 namespace {
 
 constexpr char TAG[] = "HID";
-constexpr uint8_t kASCII2KeyCode[128][2] = {HID_ASCII_TO_KEYCODE};
+constexpr uint8_t kNumBootKeyCodes = 6;
+constexpr uint8_t kKeyErrorRollOver = 0x01;  // HID usage "ErrorRollOver".
+
+KeyboardReportMode g_report_mode = KeyboardReportMode::NKRO;
+
+struct QueuedKeyboardReport {
+  KeyState key_state;
+  int64_t interrupt_time_us;  // esp_timer_get_time() of keyboard interrupt.
+  int64_t enqueue_time_us;    // esp_timer_get_time() when queued.
+};
+
+// The last keyboard report given to TinyUSB, used to time its transfer.
+struct SubmittedKeyboardReport {
+  int64_t interrupt_time_us;  // Zero if no report is in flight.
+  int64_t submit_time_us;
+};
+
+// How often to check for IN transfer completion while the endpoint is busy.
+// This TinyUSB has no report complete callback.
+constexpr uint64_t kBusyPollUsec = 1000;
+
+constexpr size_t kReportQueueSize = 32;
+constexpr size_t kConsumerQueueSize = 8;
+constexpr size_t kMouseQueueSize = 8;
+SPSCQueue<QueuedKeyboardReport, kReportQueueSize> g_report_queue;
+SPSCQueue<uint16_t, kConsumerQueueSize> g_consumer_queue;
+SPSCQueue<hid_mouse_report_t, kMouseQueueSize> g_mouse_queue;
+bool g_consumer_turn = false;  // A consumer report goes before a keyboard one.
+bool g_mouse_turn = false;     // A mouse report goes before the others.
+SubmittedKeyboardReport g_submitted_report = {0, 0};
+KeyState g_physical_state;  // Physical keys of the last keyboard report sent.
+bool g_in_flight = false;  // A report was sent and not seen to complete.
+
+// Host lock state, KEYBOARD_LED_* bits of the LED output report.
+constexpr uint8_t kLockStateMask =
+    KEYBOARD_LED_NUMLOCK | KEYBOARD_LED_CAPSLOCK | KEYBOARD_LED_SCROLLLOCK;
+std::atomic<uint8_t> g_lock_state(0);
+LockStateClient* g_lock_state_client = nullptr;
+
+// A send is posted to the USB task's event queue and not yet run.
+std::atomic<bool> g_send_scheduled(false);
+esp_timer_handle_t g_busy_timer = nullptr;  // Polls a busy endpoint.
+
+// USB task activity caused by this module, for LogActivity().
+uint32_t g_num_sends = 0;     // Times SendQueuedReports() ran.
+int64_t g_send_time_us = 0;  // Time spent in SendQueuedReports().
+int64_t g_activity_start_us = 0;
+
+// Remote wakeup signaling takes the host a while to act on, don't repeat it
+// for every key pressed meanwhile.
+constexpr int64_t kRemoteWakeupIntervalUsec = 500 * 1000;
+int64_t g_remote_wakeup_time_us = 0;  // Last Device::RemoteWakup().
+
+void FlushQueuedReports() {
+  while (g_report_queue.Front())
+    g_report_queue.Pop();
+  while (g_consumer_queue.Front())
+    g_consumer_queue.Pop();
+  while (g_mouse_queue.Front())
+    g_mouse_queue.Pop();
+  TextInjector::Flush();
+  g_physical_state.Clear();
+  g_submitted_report.interrupt_time_us = 0;
+  g_in_flight = false;
+}
+
+// Wake the suspended host for the queued reports, which are sent once it
+// resumes (see tud_resume_cb()).
+void WakeHost() {
+  const int64_t now = esp_timer_get_time();
+  if (g_remote_wakeup_time_us &&
+      now - g_remote_wakeup_time_us < kRemoteWakeupIntervalUsec) {
+    return;
+  }
+  if (Device::RemoteWakup() != ESP_OK) {
+    // The host has not enabled remote wakeup, so it is asleep on purpose.
+    // Don't type these keys whenever it does resume.
+    ESP_LOGD(TAG, "Remote wakeup not allowed, dropping reports.");
+    FlushQueuedReports();
+    return;
+  }
+  ESP_LOGI(TAG, "Waking host.");
+  g_remote_wakeup_time_us = now;
+}
+
+// Run on the USB task by tud_task().
+void SendQueuedReportsFunc(void* /*param*/) {
+  g_send_scheduled = false;
+  const int64_t start_us = esp_timer_get_time();
+  HID::SendQueuedReports();
+  g_num_sends++;
+  g_send_time_us += esp_timer_get_time() - start_us;
+}
+
+void BusyTimerCb(void* /*arg*/) {
+  HID::ScheduleSend();
+}
+
+void SetLockState(uint8_t led_report) {
+  const uint8_t lock_state = led_report & kLockStateMask;
+  if (g_lock_state.exchange(lock_state) == lock_state)
+    return;
+  ESP_LOGD(TAG, "Lock state: NUM %c, CAPS %c, SCROLL %c",
+           lock_state & KEYBOARD_LED_NUMLOCK ? 'Y' : 'N',
+           lock_state & KEYBOARD_LED_CAPSLOCK ? 'Y' : 'N',
+           lock_state & KEYBOARD_LED_SCROLLLOCK ? 'Y' : 'N');
+  if (g_lock_state_client)
+    g_lock_state_client->LockStateChanged(lock_state);
+}
 
 extern "C" {
 
@@ -25,7 +144,12 @@ extern "C" {
 // Application return pointer to descriptor, whose contents must exist long
 // enough for transfer to complete
 uint8_t const* tud_hid_descriptor_report_cb() {
-  return HID::kHIDDescriptorReport;
+  return HID::GetDescriptorReport();
+}
+
+// Invoked when received SET_PROTOCOL request ( mode switch Boot <-> Report )
+void tud_hid_boot_mode_cb(uint8_t boot_mode) {
+  ESP_LOGI(TAG, "Host selected %s protocol", boot_mode ? "boot" : "report");
 }
 
 // Invoked when received GET_REPORT control request
@@ -46,14 +170,20 @@ void tud_hid_set_report_cb(uint8_t report_id,
                            uint16_t bufsize) {
   if (report_type != HID_REPORT_TYPE_OUTPUT)
     return;
+  // The keyboard LED report is the only output report. In report protocol
+  // the data may start with the report ID, in boot protocol there is none.
+  if (report_id) {
+    if (report_id != REPORT_ID_KEYBOARD)
+      return;
+    if (bufsize >= 2 && buffer[0] == report_id) {
+      buffer++;
+      bufsize--;
+    }
+  }
   if (bufsize < 1)
     return;
 
-  const uint8_t num_lock = buffer[KEYBOARD_LED_NUMLOCK];
-  const uint8_t caps_lock = buffer[KEYBOARD_LED_CAPSLOCK];
-
-  ESP_LOGI(TAG, "NUM LOCK: %c, CAPS LOCK: %c", num_lock ? 'Y' : 'N',
-           caps_lock ? 'Y' : 'N');
+  SetLockState(buffer[0]);
 }
 
 }  // extern "C"
@@ -61,32 +191,210 @@ void tud_hid_set_report_cb(uint8_t report_id,
 }  // namespace
 
 // static
-esp_err_t HID::KeyboardReport(uint8_t report_id,
-                              uint8_t modifier,
-                              const uint8_t keycode[6]) {
-  return tud_hid_keyboard_report(report_id, modifier,
-                                 const_cast<uint8_t*>(keycode))
+esp_err_t HID::Initialize() {
+  const esp_timer_create_args_t timer_args = {
+    .callback = BusyTimerCb,
+    .arg = nullptr,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "HIDBusyPoll",
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+    .skip_unhandled_events = true,
+#endif
+  };
+  g_activity_start_us = esp_timer_get_time();
+  return esp_timer_create(&timer_args, &g_busy_timer);
+}
+
+// static
+void HID::SetKeyboardReportMode(KeyboardReportMode mode) {
+  g_report_mode = mode;
+}
+
+// static
+KeyboardReportMode HID::GetKeyboardReportMode() {
+  return g_report_mode;
+}
+
+// static
+void HID::SetLockStateClient(LockStateClient* client) {
+  g_lock_state_client = client;
+}
+
+// static
+uint8_t HID::lock_state() {
+  return g_lock_state.load(std::memory_order_relaxed);
+}
+
+// static
+const uint8_t* HID::GetDescriptorConfig() {
+  return g_report_mode == KeyboardReportMode::NKRO ? kHIDDescriptorConfigNKRO
+                                                   : kHIDDescriptorConfigBoot;
+}
+
+// static
+const uint8_t* HID::GetDescriptorReport() {
+  return g_report_mode == KeyboardReportMode::NKRO ? kHIDDescriptorReportNKRO
+                                                   : kHIDDescriptorReportBoot;
+}
+
+// static
+esp_err_t HID::KeyboardReport(uint8_t report_id, const KeyState& key_state) {
+  const bool boot_protocol = tud_hid_boot_mode();
+  if (g_report_mode == KeyboardReportMode::NKRO && !boot_protocol) {
+    NKROReport report;
+    report.modifier = key_state.modifiers();
+    // Little-endian, so bit N of the KeyState words is bit N of the report.
+    std::memcpy(report.keys, key_state.keys().data(), sizeof(report.keys));
+    return tud_hid_report(report_id, &report, sizeof(report)) ? ESP_OK
+                                                              : ESP_FAIL;
+  }
+
+  uint8_t keycode[kNumBootKeyCodes];
+  const size_t num_pressed = key_state.GetKeyCodes(keycode, sizeof(keycode));
+  if (num_pressed > sizeof(keycode)) {
+    ESP_LOGW(TAG, "Boot report rollover: %zu keys pressed, max %u",
+             num_pressed, kNumBootKeyCodes);
+    std::memset(keycode, kKeyErrorRollOver, sizeof(keycode));
+  }
+  if (boot_protocol)
+    report_id = 0;  // Boot protocol reports have no report ID.
+  return tud_hid_keyboard_report(report_id, key_state.modifiers(), keycode)
              ? ESP_OK
              : ESP_FAIL;
 }
 
 // static
-esp_err_t HID::KeyboardPress(uint8_t report_id, char ch) {
-  uint8_t keycode[6] = {HID_KEY_NONE};
-  uint8_t modifier = 0;
+esp_err_t HID::QueueKeyboardReport(const KeyState& key_state,
+                                   int64_t interrupt_time_us) {
+  if (!g_report_queue.Push(
+          {key_state, interrupt_time_us, esp_timer_get_time()})) {
+    return ESP_ERR_NO_MEM;
+  }
+  ScheduleSend();
+  return ESP_OK;
+}
+
+// static
+esp_err_t HID::QueueConsumerReport(uint16_t usage) {
+  if (!g_consumer_queue.Push(usage))
+    return ESP_ERR_NO_MEM;
+  ScheduleSend();
+  return ESP_OK;
+}
+
+// static
+esp_err_t HID::QueueMouseReport(uint8_t buttons, int8_t dx, int8_t dy) {
+  if (!g_mouse_queue.Push({buttons, dx, dy, 0, 0}))
+    return ESP_ERR_NO_MEM;
+  ScheduleSend();
+  return ESP_OK;
+}
+
+// static
+void HID::ScheduleSend() {
+  // At most one send is queued, a send handles everything queued before it.
+  if (!g_send_scheduled.exchange(true))
+    usbd_defer_func(SendQueuedReportsFunc, nullptr, /*in_isr=*/false);
+}
+
+// static
+void HID::SendQueuedReports() {
+  if (!tud_mounted()) {
+    // Don't replay stale key presses once the host connects.
+    FlushQueuedReports();
+    return;
+  }
 
-  const int idx = static_cast<int>(ch);
-  if (kASCII2KeyCode[idx][0])
-    modifier = KEYBOARD_MODIFIER_LEFTSHIFT;
-  keycode[0] = kASCII2KeyCode[idx][1];
+  while (tud_hid_ready()) {
+    g_in_flight = false;
+    const int64_t now = esp_timer_get_time();
+    if (g_submitted_report.interrupt_time_us) {
+      // The endpoint is only ready once the previous IN transfer completes,
+      // so this is accurate to kBusyPollUsec.
+      KeystrokeLatency::Record(KeystrokeLatency::Stage::SubmitToComplete,
+                               now - g_submitted_report.submit_time_us);
+      KeystrokeLatency::Record(KeystrokeLatency::Stage::Total,
+                               now - g_submitted_report.interrupt_time_us);
+      g_submitted_report.interrupt_time_us = 0;
+    }
 
-  return tud_hid_keyboard_report(report_id, modifier, keycode) ? ESP_OK
-                                                               : ESP_FAIL;
+    const QueuedKeyboardReport* report = g_report_queue.Front();
+    const uint16_t* usage = g_consumer_queue.Front();
+    const hid_mouse_report_t* mouse = g_mouse_queue.Front();
+    if (mouse && (g_mouse_turn || (!report && !usage))) {
+      g_mouse_turn = false;
+      if (!tud_hid_boot_mode()) {
+        hid_mouse_report_t value = *mouse;
+        if (!tud_hid_report(REPORT_ID_MOUSE, &value, sizeof(value)))
+          break;
+        g_in_flight = true;
+      }
+      g_mouse_queue.Pop();
+      continue;
+    }
+    g_mouse_turn = true;
+
+    if (usage && (g_consumer_turn || !report)) {
+      g_consumer_turn = false;
+      if (!tud_hid_boot_mode()) {
+        uint16_t value = *usage;
+        if (!tud_hid_report(REPORT_ID_CONSUMER_CONTROL, &value, sizeof(value)))
+          break;
+        g_in_flight = true;
+      }
+      g_consumer_queue.Pop();
+      continue;
+    }
+    g_consumer_turn = true;
+
+    if (!report) {
+      // Injected text only uses the endpoint when no key reports are queued.
+      KeyState key_state;
+      if (!TextInjector::NextReport(&key_state))
+        break;
+      key_state.Merge(g_physical_state);
+      if (KeyboardReport(REPORT_ID_KEYBOARD, key_state) != ESP_OK) {
+        ESP_LOGW(TAG, "Failure sending injected text report.");
+        break;
+      }
+      g_in_flight = true;
+      continue;
+    }
+    KeyState key_state = report->key_state;
+    key_state.Merge(TextInjector::pressed_keys());
+    if (KeyboardReport(REPORT_ID_KEYBOARD, key_state) != ESP_OK)
+      break;
+    g_physical_state = report->key_state;
+    g_in_flight = true;
+    KeystrokeLatency::Record(KeystrokeLatency::Stage::QueueToSubmit,
+                             now - report->enqueue_time_us);
+    g_submitted_report = {report->interrupt_time_us, now};
+    g_report_queue.Pop();
+  }
+
+  // The endpoint is busy, or a report could not be sent. Check back to time
+  // our transfer and to send anything still queued. Fails harmlessly if
+  // already started.
+  const bool queued = g_report_queue.Front() || g_consumer_queue.Front() ||
+                      g_mouse_queue.Front();
+  if (g_in_flight || (queued && !tud_suspended()))
+    esp_timer_start_once(g_busy_timer, kBusyPollUsec);
+  if (queued && tud_suspended())
+    WakeHost();
 }
 
 // static
-esp_err_t HID::KeyboardRelease(uint8_t report_id) {
-  return tud_hid_keyboard_report(report_id, 0, nullptr) ? ESP_OK : ESP_FAIL;
+void HID::LogActivity() {
+  const int64_t now = esp_timer_get_time();
+  const int64_t elapsed_us = now - g_activity_start_us;
+  if (elapsed_us <= 0)
+    return;
+  ESP_LOGI(TAG, "USB task sends: %u (%lld/sec), busy %lld usec (%lld ppm).",
+           g_num_sends, g_num_sends * 1000000LL / elapsed_us, g_send_time_us,
+           g_send_time_us * 1000000LL / elapsed_us);
+  g_num_sends = 0;
+  g_send_time_us = 0;
+  g_activity_start_us = now;
 }
 
 // static
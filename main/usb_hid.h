@@ -7,51 +7,271 @@
 #include <device/usbd.h>
 #include <tinyusb/tinyusb/src/class/hid/hid.h>
 #include <tinyusb/tinyusb/src/class/hid/hid_device.h>
+#include "key_state.h"
 #include "usb_string_ids.h"
 
+// Number of keycodes (0x00..0xDF) in the N-key rollover report bitmap. The
+// modifier keys (0xE0..0xE7) are reported in the separate modifier byte.
+#define NKRO_NUM_KEYCODES 224
+
+// N-key rollover keyboard report descriptor: a modifier byte followed by a
+// bitmap with one bit per keycode, and the same LED output report as
+// TUD_HID_REPORT_DESC_KEYBOARD.
+// clang-format off
+#define TUD_HID_REPORT_DESC_NKRO_KEYBOARD(...) \
+  HID_USAGE_PAGE ( HID_USAGE_PAGE_DESKTOP )                    ,\
+  HID_USAGE      ( HID_USAGE_DESKTOP_KEYBOARD )                ,\
+  HID_COLLECTION ( HID_COLLECTION_APPLICATION )                ,\
+    /* Report ID if any */\
+    __VA_ARGS__ \
+    /* 8 bits Modifier Keys (Shift, Control, Alt) */ \
+    HID_USAGE_PAGE ( HID_USAGE_PAGE_KEYBOARD )                 ,\
+      HID_USAGE_MIN    ( 224                                  ) ,\
+      HID_USAGE_MAX    ( 231                                  ) ,\
+      HID_LOGICAL_MIN  ( 0                                    ) ,\
+      HID_LOGICAL_MAX  ( 1                                    ) ,\
+      HID_REPORT_COUNT ( 8                                    ) ,\
+      HID_REPORT_SIZE  ( 1                                    ) ,\
+      HID_INPUT        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ) ,\
+    /* Output 5-bit LED Indicator Kana | Compose | ScrollLock | CapsLock | NumLock */ \
+    HID_USAGE_PAGE  ( HID_USAGE_PAGE_LED                   )   ,\
+      HID_USAGE_MIN    ( 1                                 ) ,\
+      HID_USAGE_MAX    ( 5                                 ) ,\
+      HID_REPORT_COUNT ( 5                                 ) ,\
+      HID_REPORT_SIZE  ( 1                                 ) ,\
+      HID_OUTPUT       ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ) ,\
+      /* led padding */ \
+      HID_REPORT_COUNT ( 1                                 ) ,\
+      HID_REPORT_SIZE  ( 3                                 ) ,\
+      HID_OUTPUT       ( HID_CONSTANT                      ) ,\
+    /* One bit per keycode */ \
+    HID_USAGE_PAGE ( HID_USAGE_PAGE_KEYBOARD )                 ,\
+      HID_USAGE_MIN    ( 0                                    ) ,\
+      HID_USAGE_MAX    ( NKRO_NUM_KEYCODES - 1                ) ,\
+      HID_LOGICAL_MIN  ( 0                                    ) ,\
+      HID_LOGICAL_MAX  ( 1                                    ) ,\
+      HID_REPORT_COUNT ( NKRO_NUM_KEYCODES                    ) ,\
+      HID_REPORT_SIZE  ( 1                                    ) ,\
+      HID_INPUT        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ) ,\
+  HID_COLLECTION_END \
+// clang-format on
+
 namespace usb {
 
-enum { REPORT_ID_KEYBOARD = 1, REPORT_ID_MOUSE };
+enum { REPORT_ID_KEYBOARD = 1, REPORT_ID_MOUSE, REPORT_ID_CONSUMER_CONTROL };
+
+/**
+ * The layout of the keyboard input report.
+ */
+enum class KeyboardReportMode {
+  Boot,  // Six keycode array, as defined by the HID boot protocol.
+  NKRO,  // N-key rollover bitmap with one bit per keycode.
+};
+
+/**
+ * Implemented to be told when the host changes the keyboard lock state.
+ */
+class LockStateClient {
+ public:
+  /**
+   * Called on the USB task with the new lock state, a combination of the
+   * KEYBOARD_LED_NUMLOCK, KEYBOARD_LED_CAPSLOCK, and KEYBOARD_LED_SCROLLLOCK
+   * bits.
+   *
+   * @warning Must not block.
+   */
+  virtual void LockStateChanged(uint8_t lock_state) = 0;
+
+ protected:
+  LockStateClient() = default;
+  ~LockStateClient() = default;
+};
 
 class HID {
  private:
-  constexpr static uint8_t kBootProtocol = HID_PROTOCOL_NONE;
+  // Declaring boot keyboard support allows the host to select the boot
+  // protocol via SET_PROTOCOL, which is always the 6-key layout.
+  constexpr static uint8_t kBootProtocol = HID_PROTOCOL_KEYBOARD;
   constexpr static uint8_t kEndpointAddress = TUSB_DIR_IN_MASK + 1;
   constexpr static uint8_t kEndpointIntervalMs = 2;
   constexpr static uint8_t kInterfaceNumber = 0;  // IF #'s are zero based.
 
+  // The NKRO report: report ID, modifiers, then the keycode bitmap.
+  struct NKROReport {
+    uint8_t modifier;
+    uint8_t keys[NKRO_NUM_KEYCODES / 8];
+  } __attribute__((packed));
+  static_assert(NKRO_NUM_KEYCODES % KeyState::kBitsPerWord == 0);
+  static_assert(1 + sizeof(NKROReport) <= CFG_TUD_HID_EP_BUFSIZE);
+
  public:
   constexpr static char kInterfaceName[] = "Keyboard HID";
-  constexpr static uint8_t kHIDDescriptorReport[] = {
-      TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(HID_PROTOCOL_KEYBOARD))};
-  constexpr static uint8_t kHIDDescriptorConfig[] = {
+  // Both report descriptors also have a Consumer Control (media key) report
+  // holding a single 16-bit usage, and a relative mouse report for the
+  // touch panel's trackpad mode.
+  constexpr static uint8_t kHIDDescriptorReportBoot[] = {
+      TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(REPORT_ID_KEYBOARD)),
+      TUD_HID_REPORT_DESC_CONSUMER(HID_REPORT_ID(REPORT_ID_CONSUMER_CONTROL)),
+      TUD_HID_REPORT_DESC_MOUSE(HID_REPORT_ID(REPORT_ID_MOUSE))};
+  constexpr static uint8_t kHIDDescriptorReportNKRO[] = {
+      TUD_HID_REPORT_DESC_NKRO_KEYBOARD(HID_REPORT_ID(REPORT_ID_KEYBOARD)),
+      TUD_HID_REPORT_DESC_CONSUMER(HID_REPORT_ID(REPORT_ID_CONSUMER_CONTROL)),
+      TUD_HID_REPORT_DESC_MOUSE(HID_REPORT_ID(REPORT_ID_MOUSE))};
+  constexpr static uint8_t kHIDDescriptorConfigBoot[] = {
       TUD_HID_DESCRIPTOR(kInterfaceNumber,
                          STRID_HID,
                          kBootProtocol,
-                         sizeof(kHIDDescriptorReport),
+                         sizeof(kHIDDescriptorReportBoot),
                          kEndpointAddress,
                          CFG_TUD_HID_EP_BUFSIZE,
                          kEndpointIntervalMs)};
+  constexpr static uint8_t kHIDDescriptorConfigNKRO[] = {
+      TUD_HID_DESCRIPTOR(kInterfaceNumber,
+                         STRID_HID,
+                         kBootProtocol,
+                         sizeof(kHIDDescriptorReportNKRO),
+                         kEndpointAddress,
+                         CFG_TUD_HID_EP_BUFSIZE,
+                         kEndpointIntervalMs)};
+  static_assert(sizeof(kHIDDescriptorConfigBoot) ==
+                sizeof(kHIDDescriptorConfigNKRO));
+  constexpr static size_t kHIDDescriptorConfigLen =
+      sizeof(kHIDDescriptorConfigBoot);
 
   HID() = delete;
   ~HID() = delete;
 
   /**
-   * Standard HID Boot Protocol Keyboard Report.
+   * Initialize HID state.
+   *
+   * @note Must be called before the USB device is initialized.
+   */
+  static esp_err_t Initialize();
+
+  /**
+   * Set the keyboard report layout.
    *
-   * @param report_id // Can be zero.
-   * @param modifier  // Keyboard modifier (KEYBOARD_MODIFIER_* masks).
-   * @param keycode   // Key codes of the currently pressed keys.
+   * @note Must be called before the USB device is initialized.
+   */
+  static void SetKeyboardReportMode(KeyboardReportMode mode);
+
+  static KeyboardReportMode GetKeyboardReportMode();
+
+  /**
+   * The HID configuration descriptor for the current report mode.
+   */
+  static const uint8_t* GetDescriptorConfig();
+
+  /**
+   * The HID report descriptor for the current report mode.
+   */
+  static const uint8_t* GetDescriptorReport();
+
+  /**
+   * Set the client told of lock state changes.
+   *
+   * @note Must be called before the USB device is initialized.
+   */
+  static void SetLockStateClient(LockStateClient* client);
+
+  /**
+   * The last lock state (Num/Caps/Scroll Lock) set by the host with the
+   * keyboard LED output report, as KEYBOARD_LED_* bits.
+   *
+   * Lock-free and cheap enough to poll from any task.
+   */
+  static uint8_t lock_state();
+
+  /**
+   * Report the state of all keys to the host.
+   *
+   * Uses the NKRO bitmap, or the six key boot layout if either configured
+   * to do so or the host has selected the boot protocol. When more than six
+   * keys are pressed in the boot layout all keycodes are reported as
+   * ErrorRollOver per the HID specification.
+   *
+   * @param report_id // Ignored (zero) when using the boot protocol.
+   * @param key_state // The state of all keys.
    *
    * @return ESP_OK on success, else other error code.
    */
-  static esp_err_t KeyboardReport(uint8_t report_id,
-                                  uint8_t modifier,
-                                  const uint8_t keycode[6]);
+  static esp_err_t KeyboardReport(uint8_t report_id, const KeyState& key_state);
 
-  static esp_err_t KeyboardPress(uint8_t report_id, char ch);
+  /**
+   * Queue a keyboard report to be sent from the USB task.
+   *
+   * Each queued state is sent as its own report, in order, so that a press
+   * and release of the same key are both seen by the host.
+   *
+   * @note Lock-free, but only a single task may queue reports.
+   *
+   * @param key_state         The state of all keys.
+   * @param interrupt_time_us When the keyboard interrupt for this state
+   *                          fired. Used to measure keystroke latency.
+   *
+   * @return ESP_ERR_NO_MEM if the queue is full.
+   */
+  static esp_err_t QueueKeyboardReport(const KeyState& key_state,
+                                       int64_t interrupt_time_us);
 
-  static esp_err_t KeyboardRelease(uint8_t report_id);
+  /**
+   * Queue a Consumer Control report to be sent from the USB task.
+   *
+   * Consumer reports are dropped while the host uses the boot protocol,
+   * which only has the keyboard report.
+   *
+   * @note Lock-free, but only a single task may queue reports.
+   *
+   * @param usage The HID Consumer page usage pressed, zero for none.
+   *
+   * @return ESP_ERR_NO_MEM if the queue is full.
+   */
+  static esp_err_t QueueConsumerReport(uint16_t usage);
+
+  /**
+   * Queue a relative mouse report to be sent from the USB task.
+   *
+   * Mouse reports are dropped while the host uses the boot protocol.
+   *
+   * @note Lock-free, but only a single task may queue reports.
+   *
+   * @param buttons MOUSE_BUTTON_* bits of the pressed buttons.
+   * @param dx      Horizontal movement.
+   * @param dy      Vertical movement.
+   *
+   * @return ESP_ERR_NO_MEM if the queue is full.
+   */
+  static esp_err_t QueueMouseReport(uint8_t buttons, int8_t dx, int8_t dy);
+
+  /**
+   * Have the USB task call SendQueuedReports().
+   *
+   * The call is posted to TinyUSB's event queue, so the USB task wakes
+   * immediately rather than at its next poll.
+   *
+   * @note Not ISR safe.
+   */
+  static void ScheduleSend();
+
+  /**
+   * Send queued keyboard and consumer reports, then any injected text, while
+   * the HID endpoint is ready.
+   *
+   * When keyboard, consumer, and mouse reports are queued they take turns,
+   * so none can starve the others.
+   *
+   * While the endpoint is busy this is rescheduled every kBusyPollUsec,
+   * until all reports are sent and the last transfer has completed.
+   *
+   * @note Only call from the USB task.
+   */
+  static void SendQueuedReports();
+
+  /**
+   * Log the USB task wakeups and time spent sending reports since the last
+   * call.
+   */
+  static void LogActivity();
 
   static bool Ready();
 };
@@ -0,0 +1,240 @@
+#include "usb_host_channel.h"
+
+#include <cstring>
+#include <new>
+
+#define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <tusb.h>
+
+namespace usb {
+
+constexpr char HostChannel::kInterfaceName[];
+constexpr uint8_t HostChannel::kDescriptorConfig[];
+
+namespace {
+
+constexpr char TAG[] = "HostChannel";
+constexpr char kMagic[2] = {'N', 'P'};
+
+enum class State {
+  Header,       // Reading a MessageHeader.
+  ArtworkSize,  // Reading the artwork width and height.
+  Payload,      // Reading the payload into |g_payload|.
+  Discard,      // Skipping a rejected payload.
+};
+
+struct ArtworkSize {
+  uint16_t width;
+  uint16_t height;
+} __attribute__((packed));
+
+NowPlayingClient* g_client = nullptr;
+
+// Receive state, only used on the USB task.
+State g_state = State::Header;
+HostChannel::MessageHeader g_header;
+ArtworkSize g_artwork_size;
+size_t g_num_read;  // Bytes of the current state's item read so far.
+std::unique_ptr<uint8_t[]> g_payload;
+uint32_t g_payload_len;  // Size of |g_payload|.
+esp_err_t g_discard_err;  // Acked once the discarded payload is skipped.
+int64_t g_start_time_us;  // When the header was complete.
+
+void SendAck(esp_err_t err) {
+  const HostChannel::Ack ack = {
+      .type = g_header.type,
+      .reserved = {0, 0, 0},
+      .err = err,
+      .receive_usec =
+          static_cast<uint32_t>(esp_timer_get_time() - g_start_time_us),
+  };
+  if (tud_vendor_write(&ack, sizeof(ack)) != sizeof(ack))
+    ESP_LOGW(TAG, "Unable to send ack.");
+}
+
+void StartPayload(uint32_t len) {
+  g_payload_len = len;
+  g_payload.reset(new (std::nothrow) uint8_t[len]);
+  g_num_read = 0;
+  g_state = State::Payload;
+}
+
+void StartDiscard(uint32_t len, esp_err_t err) {
+  ESP_LOGW(TAG, "Rejecting type %u message of %u bytes: %s.",
+           static_cast<uint8_t>(g_header.type), g_header.length,
+           esp_err_to_name(err));
+  g_payload_len = len;
+  g_payload.reset();
+  g_discard_err = err;
+  g_num_read = 0;
+  g_state = State::Discard;
+}
+
+esp_err_t HandleTrack() {
+  // Three NUL terminated strings.
+  const char* str = reinterpret_cast<const char*>(g_payload.get());
+  const char* end = str + g_payload_len;
+  std::string fields[3];
+  for (std::string& field : fields) {
+    const char* nul = static_cast<const char*>(memchr(str, '\0', end - str));
+    if (!nul)
+      return ESP_ERR_INVALID_ARG;
+    field.assign(str, nul);
+    str = nul + 1;
+  }
+  return g_client->NowPlayingTrack(std::move(fields[0]), std::move(fields[1]),
+                                   std::move(fields[2]));
+}
+
+void FinishMessage() {
+  esp_err_t err = ESP_ERR_INVALID_ARG;
+  switch (g_header.type) {
+    case HostChannel::MessageType::Track:
+      err = HandleTrack();
+      break;
+    case HostChannel::MessageType::Artwork: {
+      const int64_t elapsed_us = esp_timer_get_time() - g_start_time_us;
+      err = g_client->NowPlayingArtwork(std::move(g_payload),
+                                        g_artwork_size.width,
+                                        g_artwork_size.height);
+      ESP_LOGI(TAG, "Artwork %ux%u, %u bytes in %lld usec (%lld KB/s).",
+               g_artwork_size.width, g_artwork_size.height, g_header.length,
+               elapsed_us,
+               elapsed_us ? g_header.length * 1000000LL / 1024 / elapsed_us
+                          : 0);
+    } break;
+  }
+  g_payload.reset();
+  SendAck(err);
+  g_num_read = 0;
+  g_state = State::Header;
+}
+
+void StartMessage() {
+  g_start_time_us = esp_timer_get_time();
+  if (memcmp(g_header.magic, kMagic, sizeof(kMagic))) {
+    // Lost sync with the host, drop everything received.
+    ESP_LOGE(TAG, "Invalid message header.");
+    uint8_t buf[64];
+    while (tud_vendor_available())
+      tud_vendor_read(buf, sizeof(buf));
+    SendAck(ESP_ERR_INVALID_STATE);
+    g_num_read = 0;  // Read the next header from its start.
+    return;
+  }
+  if (g_header.length > HostChannel::kMaxPayload) {
+    StartDiscard(g_header.length, ESP_ERR_INVALID_SIZE);
+    return;
+  }
+
+  switch (g_header.type) {
+    case HostChannel::MessageType::Track:
+      StartPayload(g_header.length);
+      break;
+    case HostChannel::MessageType::Artwork:
+      if (g_header.length < sizeof(ArtworkSize)) {
+        StartDiscard(g_header.length, ESP_ERR_INVALID_SIZE);
+        return;
+      }
+      g_num_read = 0;
+      g_state = State::ArtworkSize;
+      return;
+    default:
+      StartDiscard(g_header.length, ESP_ERR_NOT_SUPPORTED);
+      return;
+  }
+  if (!g_payload)
+    StartDiscard(g_header.length, ESP_ERR_NO_MEM);
+  else if (!g_payload_len)
+    FinishMessage();
+}
+
+void StartArtworkPixels() {
+  const uint32_t len = g_header.length - sizeof(ArtworkSize);
+  if (len != g_artwork_size.width * g_artwork_size.height * 2u) {
+    StartDiscard(len, ESP_ERR_INVALID_SIZE);
+    return;
+  }
+  // Read straight into the buffer given to the client.
+  StartPayload(len);
+  if (!g_payload)
+    StartDiscard(len, ESP_ERR_NO_MEM);
+  else if (!len)
+    FinishMessage();
+}
+
+/**
+ * Read into |dst| until |len| bytes of the current item are read.
+ *
+ * @return true if the item is complete.
+ */
+bool ReadItem(void* dst, size_t len) {
+  g_num_read += tud_vendor_read(static_cast<uint8_t*>(dst) + g_num_read,
+                                len - g_num_read);
+  return g_num_read == len;
+}
+
+extern "C" {
+
+// Invoked when data is received on the OUT endpoint.
+void tud_vendor_rx_cb(uint8_t /*itf*/) {
+  HostChannel::HandleReceive();
+}
+
+}  // extern "C"
+
+}  // namespace
+
+// static
+void HostChannel::Enable(NowPlayingClient* client) {
+  g_client = client;
+}
+
+// static
+bool HostChannel::enabled() {
+  return g_client != nullptr;
+}
+
+// static
+void HostChannel::Reset() {
+  g_payload.reset();
+  g_num_read = 0;
+  g_state = State::Header;
+}
+
+// static
+void HostChannel::HandleReceive() {
+  if (!g_client)
+    return;
+  while (tud_vendor_available()) {
+    switch (g_state) {
+      case State::Header:
+        if (ReadItem(&g_header, sizeof(g_header)))
+          StartMessage();
+        break;
+      case State::ArtworkSize:
+        if (ReadItem(&g_artwork_size, sizeof(g_artwork_size)))
+          StartArtworkPixels();
+        break;
+      case State::Payload:
+        if (ReadItem(g_payload.get(), g_payload_len))
+          FinishMessage();
+        break;
+      case State::Discard: {
+        uint8_t buf[64];
+        const uint32_t remaining = g_payload_len - g_num_read;
+        g_num_read += tud_vendor_read(
+            buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+        if (g_num_read == g_payload_len) {
+          SendAck(g_discard_err);
+          g_num_read = 0;
+          g_state = State::Header;
+        }
+      } break;
+    }
+  }
+}
+
+}  // namespace usb
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <esp_err.h>
+
+#include <device/usbd.h>
+#include "usb_string_ids.h"
+
+namespace usb {
+
+/**
+ * Clients of HostChannel implement this interface to receive the now
+ * playing data pushed by the host.
+ *
+ * @warning Called on the USB task, so must not block.
+ */
+class NowPlayingClient {
+ public:
+  /**
+   * Called when the host sends new track metadata.
+   */
+  virtual esp_err_t NowPlayingTrack(std::string artist,
+                                    std::string album,
+                                    std::string title) = 0;
+
+  /**
+   * Called when the host sends a complete artwork frame.
+   *
+   * @param pixels |width| * |height| lv_color_t (byte swapped RGB565)
+   *               pixels, allocated with new[].
+   *
+   * @return ESP_ERR_INVALID_SIZE if not the album artwork size.
+   */
+  virtual esp_err_t NowPlayingArtwork(std::unique_ptr<uint8_t[]> pixels,
+                                      uint16_t width,
+                                      uint16_t height) = 0;
+
+ protected:
+  NowPlayingClient() = default;
+  ~NowPlayingClient() = default;
+};
+
+/**
+ * An optional vendor class USB interface with one bulk endpoint pair, over
+ * which a host daemon (see scripts/now_playing.py) pushes now playing data.
+ *
+ * Artwork is sent pre-scaled in the display's pixel format, so frames are
+ * read from the endpoint directly into the buffer given to the client with
+ * no decode or scaling, and no network.
+ *
+ * Messages on the OUT endpoint (little-endian):
+ *
+ *   magic[2]     "NP"
+ *   type         MessageType (uint8_t)
+ *   reserved     0
+ *   length       uint32_t, payload bytes following, at most kMaxPayload.
+ *   payload:
+ *     Track:     artist, album, and title as NUL terminated UTF-8 strings.
+ *     Artwork:   width (uint16_t), height (uint16_t), then width * height
+ *                big-endian RGB565 pixels, at the album artwork size.
+ *
+ * Each message is answered on the IN endpoint with an Ack, which includes
+ * the time the device took to receive it, for measuring throughput.
+ */
+class HostChannel {
+ private:
+  constexpr static uint8_t kInterfaceNumber = 1;  // After the HID interface.
+  constexpr static uint8_t kEndpointOut = 0x02;
+  constexpr static uint8_t kEndpointIn = TUSB_DIR_IN_MASK | 0x02;
+  constexpr static uint8_t kEndpointSize = 64;  // Full speed bulk maximum.
+
+ public:
+  constexpr static char kInterfaceName[] = "Now Playing";
+  constexpr static uint8_t kDescriptorConfig[] = {
+      TUD_VENDOR_DESCRIPTOR(kInterfaceNumber,
+                            STRID_HOST_CHANNEL,
+                            kEndpointOut,
+                            kEndpointIn,
+                            kEndpointSize)};
+  constexpr static size_t kDescriptorConfigLen = sizeof(kDescriptorConfig);
+  constexpr static uint32_t kMaxPayload = 64 * 1024;
+
+  enum class MessageType : uint8_t {
+    Track = 1,
+    Artwork = 2,
+  };
+
+  struct MessageHeader {
+    char magic[2];
+    MessageType type;
+    uint8_t reserved;
+    uint32_t length;
+  } __attribute__((packed));
+
+  struct Ack {
+    MessageType type;
+    uint8_t reserved[3];
+    int32_t err;            // esp_err_t, ESP_OK if the message was accepted.
+    uint32_t receive_usec;  // From the header until the last payload byte.
+  } __attribute__((packed));
+
+  HostChannel() = delete;
+  ~HostChannel() = delete;
+
+  /**
+   * Add the vendor interface to the USB configuration, sending messages to
+   * |client|.
+   *
+   * @note Must be called before the USB device is initialized.
+   */
+  static void Enable(NowPlayingClient* client);
+
+  static bool enabled();
+
+  /**
+   * Drop any partially received message, when the host goes away.
+   *
+   * @note Only call from the USB task.
+   */
+  static void Reset();
+
+  /**
+   * Handle data received on the OUT endpoint.
+   *
+   * @note Only call from the USB task.
+   */
+  static void HandleReceive();
+};
+
+}  // namespace usb
@@ -1,9 +1,113 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
+#include <tusb.h>
+
 namespace usb {
 
-int strcpy_utf16(uint16_t* buf, const char* s, int bufsize);
+namespace internal {
+
+/**
+ * Decode the UTF-8 sequence at |s| into |codepoint|.
+ *
+ * @return The length of the sequence in bytes, or -1 if not valid UTF-8
+ *         (including overlong encodings and UTF-16 surrogate halves).
+ */
+constexpr int DecodeUTF8(const char* s, uint32_t* codepoint) {
+  const uint8_t lead = static_cast<uint8_t>(s[0]);
+  int len = 0;
+  uint32_t cp = 0;
+  if (lead < 0x80) {
+    len = 1;
+    cp = lead;
+  } else if ((lead & 0xe0) == 0xc0) {
+    len = 2;
+    cp = lead & 0x1f;
+  } else if ((lead & 0xf0) == 0xe0) {
+    len = 3;
+    cp = lead & 0x0f;
+  } else if ((lead & 0xf8) == 0xf0) {
+    len = 4;
+    cp = lead & 0x07;
+  } else {
+    return -1;
+  }
+  for (int i = 1; i < len; i++) {
+    if ((static_cast<uint8_t>(s[i]) & 0xc0) != 0x80)
+      return -1;  // Also stops at the NUL terminator.
+    cp = (cp << 6) | (static_cast<uint8_t>(s[i]) & 0x3f);
+  }
+  constexpr uint32_t kMinCodepoint[] = {0, 0, 0x80, 0x800, 0x10000};
+  if (cp < kMinCodepoint[len] || cp > 0x10ffff ||
+      (cp >= 0xd800 && cp <= 0xdfff)) {
+    return -1;
+  }
+  *codepoint = cp;
+  return len;
+}
+
+}  // namespace internal
+
+/**
+ * The number of UTF-16 code units needed for the NUL terminated UTF-8
+ * string |s|, or -1 if |s| is not valid UTF-8.
+ */
+constexpr int UTF16Length(const char* s) {
+  int num_units = 0;
+  while (*s) {
+    uint32_t codepoint = 0;
+    const int len = internal::DecodeUTF8(s, &codepoint);
+    if (len < 0)
+      return -1;
+    num_units += codepoint > 0xffff ? 2 : 1;  // Surrogate pair if > 0xffff.
+    s += len;
+  }
+  return num_units;
+}
+
+/**
+ * A USB string descriptor: a header word (length and descriptor type)
+ * followed by |kNumUnits| UTF-16 code units, with no NUL terminator.
+ */
+template <int kNumUnits>
+struct DescriptorString {
+  // bLength is a byte, so at most 126 code units.
+  static_assert(kNumUnits >= 0, "Descriptor string is not valid UTF-8");
+  static_assert(2 + 2 * kNumUnits <= UINT8_MAX, "Descriptor string too long");
+
+  uint16_t data[1 + kNumUnits];
+};
+
+/**
+ * Create the string descriptor for |utf8| at compile time.
+ */
+template <int kNumUnits>
+constexpr DescriptorString<kNumUnits> MakeDescriptorString(const char* utf8) {
+  DescriptorString<kNumUnits> desc = {};
+  desc.data[0] = (TUSB_DESC_STRING << 8) | (2 + 2 * kNumUnits);
+  int i = 1;
+  while (*utf8) {
+    uint32_t codepoint = 0;
+    utf8 += internal::DecodeUTF8(utf8, &codepoint);
+    if (codepoint <= 0xffff) {
+      desc.data[i++] = codepoint;
+    } else {
+      codepoint -= 0x10000;
+      desc.data[i++] = (codepoint >> 10) + 0xd800;
+      desc.data[i++] = (codepoint & 0x3ff) + 0xdc00;
+    }
+  }
+  return desc;
+}
+
+/**
+ * The string descriptor for the NUL terminated UTF-8 string |kUTF8|, which
+ * must have static storage, e.g. usb::kStringDescriptor<kProduct>.
+ */
+template <const char* kUTF8>
+constexpr DescriptorString<UTF16Length(kUTF8)> kStringDescriptor =
+    MakeDescriptorString<UTF16Length(kUTF8)>(kUTF8);
 
 }  // namespace usb
@@ -8,7 +8,8 @@ enum StringID {
   STRID_PRODUCT = 2,
   STRID_SERIAL = 3,
   STRID_HID = 4,
-  STRID_NUM = 5,
+  STRID_HOST_CHANNEL = 5,
+  STRID_NUM = 6,
 };
 
 }  // namespace usb
@@ -5,6 +5,7 @@
 #undef LOG_LOCAL_LEVEL
 #endif
 #define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+#include <esp_idf_version.h>
 #include <esp_log.h>
 
 #include "usb_device.h"
@@ -12,7 +13,8 @@
 
 namespace {
 constexpr char TAG[] = "USBTask";
-}
+constexpr uint64_t kActivityLogPeriodUsec = 60 * 1000 * 1000;
+}  // namespace
 
 USBTask::USBTask() = default;
 
@@ -36,32 +38,35 @@ esp_err_t USBTask::Initialize() {
   if (err != ESP_OK)
     return err;
 
+  const esp_timer_create_args_t timer_args = {
+    .callback = ActivityLogTimerCb,
+    .arg = nullptr,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "USBActivityLog",
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+    .skip_unhandled_events = true,
+#endif
+  };
+  err = esp_timer_create(&timer_args, &activity_log_timer_);
+  if (err != ESP_OK)
+    return err;
+  err = esp_timer_start_periodic(activity_log_timer_, kActivityLogPeriodUsec);
+  if (err != ESP_OK)
+    return err;
+
   return xTaskCreate(TaskFunc, "usb-tick", kStackDepthWords, this,
                      tskIDLE_PRIORITY + 1, &task_) == pdPASS
              ? ESP_OK
              : ESP_FAIL;
 }
 
+// static
+void USBTask::ActivityLogTimerCb(void* /*arg*/) {
+  usb::HID::LogActivity();
+}
+
 // static
 void IRAM_ATTR USBTask::TaskFunc(void* arg) {
-  while (true) {
-    // Doing this at such a high frequency causes problems.
-    // Also, not sure it is necessary, keyboard simulator seems to run
-    // fine without it.
-#if 0
-    if (usb::Device::Suspended()) {
-      if (usb::Device::RemoteWakup() != ESP_OK)
-        ESP_LOGE(TAG, "Error waking up");
-      vTaskDelay(pdMS_TO_TICKS(500));
-      continue;
-    }
-    if (!usb::HID::Ready()) {
-      ESP_LOGV(TAG, "USB not ready.");
-      vTaskDelay(pdMS_TO_TICKS(1000));
-      continue;
-    }
-#endif
-    usb::Device::Tick();
-    vTaskDelay(pdMS_TO_TICKS(1));
-  }
+  // HID reports are sent from within the stack, see HID::ScheduleSend().
+  usb::Device::Run();
 }
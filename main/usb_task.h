@@ -4,6 +4,7 @@
 #include <freertos/include/freertos/task.h>
 
 #include <esp_err.h>
+#include <esp_timer.h>
 
 class USBTask {
  public:
@@ -11,10 +12,12 @@ class USBTask {
 
  private:
   static void IRAM_ATTR TaskFunc(void* arg);
+  static void ActivityLogTimerCb(void* arg);
 
   USBTask();
 
   esp_err_t Initialize();
 
   TaskHandle_t task_ = nullptr;
+  esp_timer_handle_t activity_log_timer_ = nullptr;  // Logs USB task work.
 };
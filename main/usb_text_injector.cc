@@ -0,0 +1,120 @@
+#include "usb_text_injector.h"
+
+#include <cstring>
+
+#define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+#include <class/hid/hid.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "spsc_queue.h"
+#include "usb_hid.h"
+
+namespace usb {
+
+namespace {
+
+constexpr char TAG[] = "TextInjector";
+constexpr uint8_t kASCII2KeyCode[128][2] = {HID_ASCII_TO_KEYCODE};
+
+SPSCQueue<char, TextInjector::kMaxQueuedChars> g_text_queue;
+
+// Consumer (USB task) state.
+KeyState g_sent_state;      // The last report sent.
+bool g_active = false;      // Typing is in progress.
+int64_t g_start_time_us;    // When the first report of this text was sent.
+uint32_t g_num_chars_sent;  // Characters typed since |g_start_time_us|.
+
+void LogTypingRate() {
+  const int64_t elapsed_us = esp_timer_get_time() - g_start_time_us;
+  if (!elapsed_us)
+    return;
+  ESP_LOGI(TAG, "Typed %u chars in %lld usec (%lld chars/sec).",
+           g_num_chars_sent, elapsed_us,
+           g_num_chars_sent * 1000000LL / elapsed_us);
+}
+
+}  // namespace
+
+// static
+esp_err_t TextInjector::Inject(const char* text) {
+  const size_t len = strlen(text);
+  if (len > g_text_queue.available())
+    return ESP_ERR_NO_MEM;
+  for (size_t i = 0; i < len; i++)
+    g_text_queue.Push(text[i]);
+  HID::ScheduleSend();
+  return ESP_OK;
+}
+
+// static
+bool TextInjector::NextReport(KeyState* key_state) {
+  const char* ch;
+  uint8_t keycode = HID_KEY_NONE;
+  bool shift = false;
+  // Skip characters that can't be typed.
+  while ((ch = g_text_queue.Front())) {
+    const uint8_t idx = static_cast<uint8_t>(*ch) & 0x7F;
+    shift = kASCII2KeyCode[idx][0];
+    keycode = kASCII2KeyCode[idx][1];
+    if (keycode != HID_KEY_NONE)
+      break;
+    g_text_queue.Pop();
+  }
+
+  if (!ch) {
+    if (!g_active)
+      return false;
+    // Finished, release all keys.
+    g_active = false;
+    LogTypingRate();
+    g_sent_state.Clear();
+    *key_state = g_sent_state;
+    return true;
+  }
+
+  if (!g_active) {
+    g_active = true;
+    g_start_time_us = esp_timer_get_time();
+    g_num_chars_sent = 0;
+    g_sent_state.Clear();
+  }
+
+  KeyState next;
+  next.Set(HID_KEY_SHIFT_LEFT, shift);
+  if (shift != g_sent_state.IsPressed(HID_KEY_SHIFT_LEFT) ||
+      g_sent_state.IsPressed(keycode)) {
+    // Change shift, or release a repeated key, before pressing the key so
+    // the host can't apply the wrong shift state or miss the repeat.
+    if (next != g_sent_state) {
+      g_sent_state = next;
+      *key_state = g_sent_state;
+      return true;
+    }
+  }
+
+  next.Set(keycode, true);
+  g_text_queue.Pop();
+  g_num_chars_sent++;
+  g_sent_state = next;
+  *key_state = g_sent_state;
+  return true;
+}
+
+// static
+const KeyState& TextInjector::pressed_keys() {
+  return g_sent_state;
+}
+
+// static
+void TextInjector::Flush() {
+  while (g_text_queue.Front())
+    g_text_queue.Pop();
+  if (g_active) {
+    g_active = false;
+    LogTypingRate();
+  }
+  g_sent_state.Clear();
+}
+
+}  // namespace usb
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <esp_err.h>
+
+#include "key_state.h"
+
+namespace usb {
+
+/**
+ * Types text on the host by streaming keyboard reports.
+ *
+ * Each character is normally a single report: pressing the next key in the
+ * same report that releases the previous one. An extra report is only sent
+ * when the shift state changes, or the same key is typed twice in a row, so
+ * consecutive characters sharing a modifier keep it held.
+ *
+ * Reports are sent by the USB task one per completed IN transfer, so text is
+ * typed at the endpoint polling rate (kEndpointIntervalMs) without dropping
+ * characters. Reports from physical keys take priority.
+ *
+ * Injected keys are added to the physically held keys, never replacing
+ * them, so the host sees no spurious key releases. Modifiers held while
+ * typing also apply to the typed text.
+ */
+class TextInjector {
+ public:
+  static constexpr size_t kMaxQueuedChars = 256;
+
+  TextInjector() = delete;
+  ~TextInjector() = delete;
+
+  /**
+   * Queue |text| to be typed. Characters without a US keyboard keycode are
+   * skipped.
+   *
+   * @note Lock-free, but only a single task may inject text.
+   *
+   * @return ESP_ERR_NO_MEM, without queuing anything, if there is not room
+   *         for all of |text|.
+   */
+  static esp_err_t Inject(const char* text);
+
+  /**
+   * Get the injected keys of the next report to send.
+   *
+   * @note Only call from the USB task, when the HID endpoint is ready.
+   *
+   * @return true if |key_state| was set to the injected keys to send, which
+   *         must be merged with the physically held keys.
+   */
+  static bool NextReport(KeyState* key_state);
+
+  /**
+   * The injected keys currently pressed, to merge into physical key reports.
+   *
+   * @note Only call from the USB task.
+   */
+  static const KeyState& pressed_keys();
+
+  /**
+   * Discard all queued text.
+   *
+   * @note Only call from the USB task.
+   */
+  static void Flush();
+};
+
+}  // namespace usb
@@ -34,6 +34,15 @@ void VolumeDisplay::SetVolume(uint8_t volume) {
   SSD1306_Update(&ssd_device_);
 }
 
+void VolumeDisplay::SetDisplayOn(bool on) {
+  if (!volume_widget_)
+    return;
+  if (on)
+    SSD1306_DisplayOn(&ssd_device_);
+  else
+    SSD1306_DisplayOff(&ssd_device_);
+}
+
 esp_err_t VolumeDisplay::Initialize() {
   if (!SSD1306_I2CMasterInitDefault()) {
     ESP_LOGE(TAG, "Unable to initialize tarablessd1306 library.");
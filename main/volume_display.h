@@ -18,6 +18,11 @@ class VolumeDisplay {
    * @param volume The volume (0..100). Values outide of range will be clamped.
    */
   void SetVolume(uint8_t volume);
+
+  /**
+   * Turn the display panel on or off, keeping its contents.
+   */
+  void SetDisplayOn(bool on);
   esp_err_t Initialize();
 
  private:
@@ -5,26 +5,40 @@
 #undef LOG_LOCAL_LEVEL
 #endif
 #define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+#include <esp_bit_defs.h>
 #include <esp_log.h>
 
 #include "led_controller.h"
 
 namespace {
 constexpr char TAG[] = "VolTask";
-}
+constexpr uint32_t EVENT_RESUME = BIT0;
+VolumeTask* g_volume_task = nullptr;
+}  // namespace
 
 VolumeTask::VolumeTask() = default;
 
 // static
 esp_err_t VolumeTask::Start() {
-  static VolumeTask* task = nullptr;
-
   ESP_LOGD(TAG, "Starting Volume task");
-  if (task)
+  if (g_volume_task)
     return ESP_FAIL;
 
-  task = new VolumeTask();
-  return task->Initialize();
+  g_volume_task = new VolumeTask();
+  return g_volume_task->Initialize();
+}
+
+// static
+void VolumeTask::Suspend() {
+  if (g_volume_task)
+    g_volume_task->suspended_ = true;
+}
+
+// static
+void VolumeTask::Resume() {
+  if (!g_volume_task || !g_volume_task->suspended_.exchange(false))
+    return;
+  g_volume_task->notifier_.Notify(EVENT_RESUME);
 }
 
 esp_err_t VolumeTask::Initialize() {
@@ -35,10 +49,12 @@ esp_err_t VolumeTask::Initialize() {
   if (err != ESP_OK)
     return err;
 
-  return xTaskCreate(TaskFunc, TAG, kStackDepthWords, this,
-                     tskIDLE_PRIORITY + 1, &task_) == pdPASS
-             ? ESP_OK
-             : ESP_FAIL;
+  if (xTaskCreate(TaskFunc, TAG, kStackDepthWords, this, tskIDLE_PRIORITY + 1,
+                  &task_) != pdPASS) {
+    return ESP_FAIL;
+  }
+  notifier_.SetTask(task_);
+  return ESP_OK;
 }
 
 void VolumeTask::Run() {
@@ -48,6 +64,13 @@ void VolumeTask::Run() {
 
   LEDController* led_controller = nullptr;
   while (true) {
+    if (suspended_) {
+      volume_display_.SetDisplayOn(false);
+      while (suspended_)
+        notifier_.Wait(portMAX_DELAY);
+      volume_display_.SetDisplayOn(true);
+    }
+
     // Simple test to bounce volume up and down.
     vol += vol_increment;
     if (vol < 0) {
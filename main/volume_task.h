@@ -1,10 +1,13 @@
 #pragma once
 
+#include <atomic>
+
 #include <freertos/include/freertos/FreeRTOS.h>
 #include <freertos/include/freertos/task.h>
 
 #include <esp_err.h>
 
+#include "task_notifier.h"
 #include "volume_display.h"
 
 /**
@@ -19,6 +22,17 @@ class VolumeTask {
  public:
   static esp_err_t Start();
 
+  /**
+   * Stop updating the volume display, and turn it off, while the USB host is
+   * suspended.
+   */
+  static void Suspend();
+
+  /**
+   * Turn the volume display back on after Suspend().
+   */
+  static void Resume();
+
  private:
   static void IRAM_ATTR TaskFunc(void* arg);
 
@@ -28,5 +42,7 @@ class VolumeTask {
   esp_err_t Initialize();
 
   TaskHandle_t task_ = nullptr;
+  TaskNotifier notifier_;  // Wakes the task on Resume().
+  std::atomic<bool> suspended_{false};
   VolumeDisplay volume_display_;
 };
@@ -122,7 +122,7 @@ void WiFi::HandleWiFiEvent(wifi_event_t event_id, void* event_data) {
         retry_num_++;
       } else {
         ESP_LOGW(TAG, "Connection failed");
-        xEventGroupSetBits(wifi_event_group_, EVENT_NETWORK_DISCONNECTED);
+        notifier_->Notify(EVENT_NETWORK_DISCONNECTED);
       }
       break;
     default:
@@ -142,7 +142,7 @@ void WiFi::HandleIPEvent(ip_event_t event_id, void* event_data) {
       ESP_LOGI(TAG, "Hostname: \"%s\"", hostname.c_str());
 
       retry_num_ = 0;
-      xEventGroupSetBits(wifi_event_group_, EVENT_NETWORK_GOT_IP);
+      notifier_->Notify(EVENT_NETWORK_GOT_IP);
     } break;
     default:
       break;
@@ -163,8 +163,8 @@ void WiFi::EventHandler(void* arg,
   }
 }
 
-WiFi::WiFi(EventGroupHandle_t wifi_event_group)
-    : wifi_event_group_(wifi_event_group),
+WiFi::WiFi(TaskNotifier* notifier)
+    : notifier_(notifier),
       instance_any_id_(nullptr),
       instance_got_ip_(nullptr),
       retry_num_(0),
@@ -218,9 +218,9 @@ esp_err_t WiFi::InitiateConnection(const std::string& ssid,
 
   esp_wifi_stop();
   // TODO: Is clearing events necessary, or is this done automatically?
-  constexpr EventBits_t kAllNetworkEvents =
+  constexpr uint32_t kAllNetworkEvents =
       EVENT_NETWORK_GOT_IP | EVENT_NETWORK_DISCONNECTED;
-  xEventGroupClearBits(wifi_event_group_, kAllNetworkEvents);
+  notifier_->Clear(kAllNetworkEvents);
 
   retry_num_ = 0;
 
@@ -274,6 +274,10 @@ esp_err_t WiFi::InitiateConnection(const std::string& ssid,
   return err;
 }
 
+esp_err_t WiFi::SetLowPower(bool low_power) {
+  return esp_wifi_set_ps(low_power ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM);
+}
+
 esp_err_t WiFi::GetHostname(std::string* hostname) const {
   return ::GetHostname(netif_, hostname);
 }
@@ -4,16 +4,21 @@
 
 #include <esp_err.h>
 #include <esp_event.h>
-#include <freertos/include/freertos/FreeRTOS.h>
-#include <freertos/include/freertos/event_groups.h>
+
+#include "task_notifier.h"
 
 class WiFi {
  public:
-  explicit WiFi(EventGroupHandle_t wifi_event_group);
+  explicit WiFi(TaskNotifier* notifier);
   ~WiFi();
 
   esp_err_t Inititialize();
   esp_err_t InitiateConnection(const std::string& ssid, const std::string& key);
+  /**
+   * Use the most power saving (max modem) mode, which sleeps through
+   * several AP beacons at a time, or return to the default (min modem) mode.
+   */
+  esp_err_t SetLowPower(bool low_power);
   esp_err_t GetHostname(std::string* hostname) const;
   esp_err_t GetIPAddress(esp_ip4_addr_t* addr) const;
 
@@ -25,7 +30,7 @@ class WiFi {
   void HandleWiFiEvent(wifi_event_t event_id, void* event_data);
   void HandleIPEvent(ip_event_t event_id, void* event_data);
 
-  EventGroupHandle_t wifi_event_group_;
+  TaskNotifier* notifier_;  // Used to inform owner of network events.
   esp_event_handler_instance_t instance_any_id_;
   esp_event_handler_instance_t instance_got_ip_;
   int retry_num_;
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Compile a keyboard event trace into the binary form replayed on the host.
+
+Usage: kbdtrace.py <input.trace> <output.bin>
+       kbdtrace.py --from-log <device.log> <output.trace>
+
+The output is replayed through the keyboard code by the keyboard_replay host
+test (see test/keyboard_replay.cc).
+
+Input format, one ADP5589 FIFO event per line in time order:
+
+    # Comment.
+    <time_ms> <event> <down|up>
+
+Event names are those of the ADP5589 (see genmap.py). Events with the same
+time are replayed as a single FIFO read (at most 16).
+
+--from-log converts the events recorded in a device log into a trace. They
+are logged, with the Keyboard log level set to verbose
+(esp_log_level_set("Keyboard", ESP_LOG_VERBOSE)), as lines of:
+
+    event <interrupt_time_us> <fifo>
+
+Trace times are relative to the first event, and events read together keep
+the same time.
+"""
+
+import re
+import struct
+import sys
+
+from keymap import event_names
+
+MAGIC = b'KTRC'
+VERSION = 1
+
+EVENT_RE = re.compile(r'event (\d+) 0x([0-9a-fA-F]{2})')
+
+
+def compile_trace(lines):
+    events = event_names()
+    records = []
+    prev_time_us = 0
+    for line_num, line in enumerate(lines, 1):
+        line = line.split('#', 1)[0].strip()
+        if not line:
+            continue
+        try:
+            time_ms, event, state = line.split()
+            time_us = int(round(float(time_ms) * 1000))
+            if time_us < prev_time_us:
+                raise ValueError('events must be in time order')
+            if event not in events:
+                raise ValueError('unknown event "%s"' % event)
+            if state not in ('down', 'up'):
+                raise ValueError('state must be "down" or "up"')
+        except ValueError as e:
+            raise SystemExit('line %d: %s' % (line_num, e))
+        fifo = events[event] | (0x80 if state == 'down' else 0)
+        records.append(struct.pack('<IB', time_us, fifo))
+        prev_time_us = time_us
+
+    if not records:
+        raise SystemExit('no events')
+    return MAGIC + struct.pack('<B3xI', VERSION, len(records)) + \
+        b''.join(records)
+
+
+def trace_from_log(lines):
+    """Convert the event lines of a device log into trace lines."""
+    names = {idx: name for name, idx in event_names().items()}
+    trace = ['# Recorded from a device log by kbdtrace.py --from-log.']
+    start_us = None
+    for line in lines:
+        m = EVENT_RE.search(line)
+        if not m:
+            continue
+        time_us = int(m.group(1))
+        fifo = int(m.group(2), 16)
+        if start_us is None:
+            start_us = time_us
+        trace.append('%.3f %s %s' % ((time_us - start_us) / 1000.0,
+                                     names[fifo & 0x7F],
+                                     'down' if fifo & 0x80 else 'up'))
+    if start_us is None:
+        raise SystemExit('no keyboard events in log')
+    return '\n'.join(trace) + '\n'
+
+
+def main():
+    args = sys.argv[1:]
+    if len(args) == 3 and args[0] == '--from-log':
+        with open(args[1], errors='replace') as f:
+            trace = trace_from_log(f)
+        with open(args[2], 'w') as f:
+            f.write(trace)
+        return
+    if len(args) != 2:
+        raise SystemExit('usage: %s [--from-log] <input> <output>' %
+                         sys.argv[0])
+    with open(args[0]) as f:
+        data = compile_trace(f)
+    with open(args[1], 'wb') as f:
+        f.write(data)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""Compile a human-readable keymap into the binary form loaded by Keymap.
+
+Usage: keymap.py <input.keymap> <output.bin>
+
+Input format:
+
+    # Comment.
+    [layer 0]
+    R0_C0 = E
+    R1_C4 = MO(1)    # Activate layer 1 while held.
+
+    R1_C5 = OSM(SHIFT_LEFT)  # One-shot: shift the next key press.
+    R1_C6 = MEDIA_PLAY_PAUSE # Sent to the host OS as Consumer Control.
+    R1_C7 = NEXT_SCAN_PROFILE  # Acted on by the keyboard itself.
+    R1_C8 = TYPE_MACRO       # Type the macro text in config.ini.
+
+    [layer 1]
+    R0_C0 = F1
+    R0_C1 = ___      # Transparent: use the code from the layer below.
+
+    [hold]           # Dual-role keys, in every layer.
+    R1_C2 = CONTROL_LEFT     # Tap for the layer code, hold for control.
+
+Event names are those of the ADP5589 (see genmap.py) and key names are the
+TinyUSB HID_KEY_* names with the prefix removed (HID_KEY_ prefix optional).
+Unassigned events are NONE in layer 0 and transparent in all other layers.
+A hold may be any key name or MO(n).
+"""
+
+import re
+import struct
+import sys
+
+MAGIC = b'KMAP'
+VERSION = 2
+NUM_EVENTS = 128
+MAX_LAYERS = 8
+KEY_ONE_SHOT_BASE = 0xE8
+KEY_LAYER_BASE = 0xF0
+KEY_MEDIA_BASE = 0xF8
+KEY_TRANSPARENT = 0xFF
+KEY_FUNCTION_BASE = 0xA5
+# In the order of Keymap::GetMediaUsage().
+MEDIA_KEYS = ['MEDIA_PLAY_PAUSE', 'MEDIA_NEXT', 'MEDIA_PREVIOUS', 'MEDIA_STOP',
+              'MEDIA_MUTE', 'MEDIA_VOLUME_UP', 'MEDIA_VOLUME_DOWN']
+assert KEY_MEDIA_BASE + len(MEDIA_KEYS) == KEY_TRANSPARENT
+# In the order of Keymap::Function.
+FUNCTION_KEYS = ['NEXT_SCAN_PROFILE', 'TYPE_MACRO']
+
+
+def event_names():
+    names = ['NONE']
+    for r in range(8):
+        for c in range(11):
+            names.append('R%d_C%d' % (r, c))
+    for r in range(8):
+        names.append('R%d_GND' % r)
+    names.extend(['GPI%d' % i for i in range(1, 20)])
+    names.extend(['LOGIC_1', 'LOGIC_2'])
+    names.extend(['UNUSED_%d' % i for i in range(9)])
+    names.append('UNLOCK_WILDCARD')
+    assert len(names) == NUM_EVENTS
+    return {name: idx for idx, name in enumerate(names)}
+
+
+def key_codes():
+    codes = {'NONE': 0x00}
+    for i in range(26):
+        codes[chr(ord('A') + i)] = 0x04 + i
+    for i in range(1, 10):
+        codes[str(i)] = 0x1E + i - 1
+    codes['0'] = 0x27
+    for i in range(1, 13):
+        codes['F%d' % i] = 0x3A + i - 1
+    for i in range(13, 25):
+        codes['F%d' % i] = 0x68 + i - 13
+    names = [
+        (0x28, 'ENTER'), (0x29, 'ESCAPE'), (0x2A, 'BACKSPACE'), (0x2B, 'TAB'),
+        (0x2C, 'SPACE'), (0x2D, 'MINUS'), (0x2E, 'EQUAL'),
+        (0x2F, 'BRACKET_LEFT'), (0x30, 'BRACKET_RIGHT'), (0x31, 'BACKSLASH'),
+        (0x32, 'EUROPE_1'), (0x33, 'SEMICOLON'), (0x34, 'APOSTROPHE'),
+        (0x35, 'GRAVE'), (0x36, 'COMMA'), (0x37, 'PERIOD'), (0x38, 'SLASH'),
+        (0x39, 'CAPS_LOCK'), (0x46, 'PRINT_SCREEN'), (0x47, 'SCROLL_LOCK'),
+        (0x48, 'PAUSE'), (0x49, 'INSERT'), (0x4A, 'HOME'), (0x4B, 'PAGE_UP'),
+        (0x4C, 'DELETE'), (0x4D, 'END'), (0x4E, 'PAGE_DOWN'),
+        (0x4F, 'ARROW_RIGHT'), (0x50, 'ARROW_LEFT'), (0x51, 'ARROW_DOWN'),
+        (0x52, 'ARROW_UP'), (0x53, 'NUM_LOCK'), (0x54, 'KEYPAD_DIVIDE'),
+        (0x55, 'KEYPAD_MULTIPLY'), (0x56, 'KEYPAD_SUBTRACT'),
+        (0x57, 'KEYPAD_ADD'), (0x58, 'KEYPAD_ENTER'), (0x63, 'KEYPAD_DECIMAL'),
+        (0x64, 'EUROPE_2'), (0x65, 'APPLICATION'), (0x66, 'POWER'),
+        (0x67, 'KEYPAD_EQUAL'), (0x7F, 'MUTE'), (0x80, 'VOLUME_UP'),
+        (0x81, 'VOLUME_DOWN'), (0xE0, 'CONTROL_LEFT'), (0xE1, 'SHIFT_LEFT'),
+        (0xE2, 'ALT_LEFT'), (0xE3, 'GUI_LEFT'), (0xE4, 'CONTROL_RIGHT'),
+        (0xE5, 'SHIFT_RIGHT'), (0xE6, 'ALT_RIGHT'), (0xE7, 'GUI_RIGHT'),
+    ]
+    for code, name in names:
+        codes[name] = code
+    for i in range(1, 10):
+        codes['KEYPAD_%d' % i] = 0x59 + i - 1
+    codes['KEYPAD_0'] = 0x62
+    for i, name in enumerate(MEDIA_KEYS):
+        codes[name] = KEY_MEDIA_BASE + i
+    for i, name in enumerate(FUNCTION_KEYS):
+        codes[name] = KEY_FUNCTION_BASE + i
+    return codes
+
+
+def parse_code(value, codes):
+    if value in ('___', 'TRANSPARENT'):
+        return KEY_TRANSPARENT
+    m = re.fullmatch(r'OSM\((\w+)\)', value)
+    if m:
+        code = parse_code(m.group(1), codes)
+        if not codes['CONTROL_LEFT'] <= code <= codes['GUI_RIGHT']:
+            raise ValueError('OSM() requires a modifier')
+        return KEY_ONE_SHOT_BASE + code - codes['CONTROL_LEFT']
+    m = re.fullmatch(r'MO\((\d+)\)', value)
+    if m:
+        layer = int(m.group(1))
+        if layer >= MAX_LAYERS:
+            raise ValueError('layer %d out of range' % layer)
+        return KEY_LAYER_BASE + layer
+    if value.startswith('HID_KEY_'):
+        value = value[len('HID_KEY_'):]
+    if value in codes:
+        return codes[value]
+    if re.fullmatch(r'0x[0-9A-Fa-f]{1,2}', value):
+        code = int(value, 16)
+        if code >= 0xE8:
+            raise ValueError('code %s is reserved' % value)
+        return code
+    raise ValueError('unknown key "%s"' % value)
+
+
+def is_valid_hold(code):
+    return code < KEY_ONE_SHOT_BASE or KEY_LAYER_BASE <= code < KEY_TRANSPARENT
+
+
+def compile_keymap(lines):
+    events = event_names()
+    codes = key_codes()
+    layers = []
+    holds = [0] * NUM_EVENTS
+    section = None
+    for line_num, line in enumerate(lines, 1):
+        line = line.split('#', 1)[0].strip()
+        if not line:
+            continue
+        try:
+            m = re.fullmatch(r'\[layer\s+(\d+)\]', line)
+            if m:
+                if int(m.group(1)) != len(layers):
+                    raise ValueError('layers must be numbered in order')
+                fill = 0 if not layers else KEY_TRANSPARENT
+                layers.append([fill] * NUM_EVENTS)
+                section = layers[-1]
+                continue
+            if line == '[hold]':
+                section = holds
+                continue
+            if section is None:
+                raise ValueError('assignment before first section')
+            event, _, value = (s.strip() for s in line.partition('='))
+            if event not in events:
+                raise ValueError('unknown event "%s"' % event)
+            code = parse_code(value.upper(), codes)
+            if section is holds and not is_valid_hold(code):
+                raise ValueError('invalid hold "%s"' % value)
+            section[events[event]] = code
+        except ValueError as e:
+            raise SystemExit('line %d: %s' % (line_num, e))
+
+    if not layers:
+        raise SystemExit('no layers defined')
+    if len(layers) > MAX_LAYERS:
+        raise SystemExit('too many layers (max %d)' % MAX_LAYERS)
+    sections = [('layer %d' % i, l) for i, l in enumerate(layers)]
+    sections.append(('hold', holds))
+    for name, codes in sections:
+        for code in codes:
+            if KEY_LAYER_BASE <= code < KEY_MEDIA_BASE and \
+                    code - KEY_LAYER_BASE >= len(layers):
+                raise SystemExit('%s: MO(%d) refers to a missing layer' %
+                                 (name, code - KEY_LAYER_BASE))
+
+    data = MAGIC + struct.pack('BBBB', VERSION, len(layers), NUM_EVENTS, 0)
+    for layer in layers:
+        data += bytes(layer)
+    data += bytes(holds)
+    return data
+
+
+def main():
+    if len(sys.argv) != 3:
+        raise SystemExit('usage: %s <input.keymap> <output.bin>' % sys.argv[0])
+    with open(sys.argv[1]) as f:
+        data = compile_keymap(f)
+    with open(sys.argv[2], 'wb') as f:
+        f.write(data)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Push now playing data and album artwork to the keyboard over USB.
+
+Usage: now_playing.py [--artwork <image>] [--output <file>]
+                      <artist> <album> <title>
+
+Requires pyusb, and Pillow for --artwork. The keyboard's vendor interface
+must be enabled with host_channel = true in the [usb] section of config.ini.
+
+Artwork is scaled to the display's album artwork size and converted to its
+pixel format here, so the device only copies it to the screen.
+
+With --output the messages are written to a file instead of the device,
+which is useful to check the encoding without a keyboard attached.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+VENDOR_ID = 0xae9b
+PRODUCT_ID = 0xe67a
+INTERFACE_CLASS_VENDOR = 0xff
+
+MAGIC = b'NP'
+TYPE_TRACK = 1
+TYPE_ARTWORK = 2
+MAX_PAYLOAD = 64 * 1024
+
+ARTWORK_WIDTH = 130
+ARTWORK_HEIGHT = 130
+
+HEADER = struct.Struct('<2sBBI')
+ACK = struct.Struct('<B3xiI')
+ARTWORK_SIZE = struct.Struct('<HH')
+
+
+def message(msg_type, payload):
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError('payload of %d bytes is too large' % len(payload))
+    return HEADER.pack(MAGIC, msg_type, 0, len(payload)) + payload
+
+
+def track_message(artist, album, title):
+    payload = b''.join(s.encode('utf-8') + b'\0'
+                       for s in (artist, album, title))
+    return message(TYPE_TRACK, payload)
+
+
+def artwork_message(path):
+    from PIL import Image
+
+    image = Image.open(path).convert('RGB')
+    image = image.resize((ARTWORK_WIDTH, ARTWORK_HEIGHT), Image.LANCZOS)
+    pixels = bytearray()
+    for r, g, b in image.getdata():
+        # RGB565, big-endian to match the display's byte swapped colors.
+        pixels += struct.pack('>H', (r >> 3) << 11 | (g >> 2) << 5 | b >> 3)
+    return message(TYPE_ARTWORK,
+                   ARTWORK_SIZE.pack(ARTWORK_WIDTH, ARTWORK_HEIGHT) + pixels)
+
+
+class Device:
+    """The vendor interface's bulk endpoints."""
+
+    def __init__(self):
+        import usb.core
+        import usb.util
+
+        self.dev = usb.core.find(idVendor=VENDOR_ID, idProduct=PRODUCT_ID)
+        if self.dev is None:
+            raise RuntimeError('keyboard not found')
+        intf = usb.util.find_descriptor(
+            self.dev.get_active_configuration(),
+            bInterfaceClass=INTERFACE_CLASS_VENDOR)
+        if intf is None:
+            raise RuntimeError('host channel is not enabled on the keyboard')
+        self.ep_out = usb.util.find_descriptor(
+            intf, custom_match=lambda e: usb.util.endpoint_direction(
+                e.bEndpointAddress) == usb.util.ENDPOINT_OUT)
+        self.ep_in = usb.util.find_descriptor(
+            intf, custom_match=lambda e: usb.util.endpoint_direction(
+                e.bEndpointAddress) == usb.util.ENDPOINT_IN)
+
+    def send(self, data):
+        start = time.monotonic()
+        self.ep_out.write(data, timeout=2000)
+        msg_type, err, receive_usec = ACK.unpack(
+            bytes(self.ep_in.read(ACK.size, timeout=2000)))
+        elapsed = time.monotonic() - start
+        if err:
+            raise RuntimeError('type %d message rejected: error 0x%x' %
+                               (msg_type, err & 0xffffffff))
+        return elapsed, receive_usec
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('artist')
+    parser.add_argument('album')
+    parser.add_argument('title')
+    parser.add_argument('--artwork', help='image file of the album cover')
+    parser.add_argument('--output', help='write messages to this file')
+    args = parser.parse_args()
+
+    messages = [('track', track_message(args.artist, args.album, args.title))]
+    if args.artwork:
+        messages.append(('artwork', artwork_message(args.artwork)))
+
+    if args.output:
+        with open(args.output, 'wb') as f:
+            for _, data in messages:
+                f.write(data)
+        return 0
+
+    device = Device()
+    for name, data in messages:
+        elapsed, receive_usec = device.send(data)
+        device_kbs = (len(data) / 1024 / (receive_usec / 1e6)
+                      if receive_usec else 0)
+        print('%s: %d bytes, %.1f ms round trip, %.1f KB/s on device' %
+              (name, len(data), elapsed * 1000, device_kbs))
+    return 0
+
+
+if __name__ == '__main__':
+    try:
+        sys.exit(main())
+    except (RuntimeError, ValueError) as e:
+        sys.exit('%s: %s' % (sys.argv[0], e))
@@ -0,0 +1,102 @@
+#include "currently_playing_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "json_stream.h"
+
+namespace {
+
+using RequestData = CurrentlyPlayingParser::RequestData;
+
+esp_err_t Parse(const std::string& json,
+                RequestData* data,
+                size_t chunk_size = std::string::npos) {
+  CurrentlyPlayingParser parser(data);
+  JSONStream stream(&parser);
+  for (size_t i = 0; i < json.size(); i += chunk_size) {
+    const size_t len = std::min(chunk_size, json.size() - i);
+    if (stream.Feed(json.data() + i, len) != ESP_OK)
+      break;
+  }
+  return stream.Finish();
+}
+
+std::string ReadResponse() {
+  std::ifstream f(TEST_DATA_DIR "/currently_playing.json", std::ios::binary);
+  EXPECT_TRUE(f.good());
+  return std::string((std::istreambuf_iterator<char>(f)),
+                     std::istreambuf_iterator<char>());
+}
+
+void ExpectResponseValues(const RequestData& data) {
+  EXPECT_EQ(84211u, data.times.progress_ms);
+  EXPECT_EQ(231573u, data.times.duration_ms);
+  EXPECT_TRUE(data.is_playing);
+  EXPECT_EQ("Song \"Title\" \xf0\x9f\x8e\xb5", data.song_title);
+  EXPECT_EQ("Synthetic Artist, Beyonc\xc3\xa9 Example", data.artist_name);
+  EXPECT_EQ(
+      "https://i.scdn.co/image/"
+      "ab67616d0000b273000000000000000000000000000000000001",
+      data.image.url_640);
+  EXPECT_EQ(
+      "https://i.scdn.co/image/"
+      "ab67616d00001e02000000000000000000000000000000000001",
+      data.image.url_300);
+  EXPECT_EQ(
+      "https://i.scdn.co/image/"
+      "ab67616d00004851000000000000000000000000000000000001",
+      data.image.url_64);
+}
+
+TEST(CurrentlyPlayingParserTest, Response) {
+  RequestData data = {};
+  ASSERT_EQ(ESP_OK, Parse(ReadResponse(), &data));
+  ExpectResponseValues(data);
+}
+
+TEST(CurrentlyPlayingParserTest, ResponseInChunks) {
+  const std::string response = ReadResponse();
+  for (size_t chunk_size : {1, 7, 512}) {
+    RequestData data = {};
+    ASSERT_EQ(ESP_OK, Parse(response, &data, chunk_size)) << chunk_size;
+    ExpectResponseValues(data);
+  }
+}
+
+// Only the item's name and artists are used, not those of the album.
+TEST(CurrentlyPlayingParserTest, IgnoresOtherNames) {
+  RequestData data = {};
+  ASSERT_EQ(ESP_OK, Parse(R"({"item": {"album": {"name": "A",
+                              "artists": [{"name": "X"}]},
+                              "artists": [{"name": "Y"}], "name": "T"}})",
+                          &data));
+  EXPECT_EQ("T", data.song_title);
+  EXPECT_EQ("Y", data.artist_name);
+}
+
+TEST(CurrentlyPlayingParserTest, ImageURLBeforeOrAfterWidth) {
+  RequestData data = {};
+  ASSERT_EQ(ESP_OK, Parse(R"({"item": {"album": {"images": [
+                              {"url": "a", "width": 300},
+                              {"width": 64, "height": 64, "url": "b"},
+                              {"url": "c", "width": 500}]}}})",
+                          &data));
+  EXPECT_EQ("", data.image.url_640);
+  EXPECT_EQ("a", data.image.url_300);
+  EXPECT_EQ("b", data.image.url_64);
+}
+
+TEST(CurrentlyPlayingParserTest, Paused) {
+  RequestData data = {};
+  ASSERT_EQ(ESP_OK, Parse(R"({"progress_ms": 5, "is_playing": false})",
+                          &data));
+  EXPECT_FALSE(data.is_playing);
+  EXPECT_EQ(5u, data.times.progress_ms);
+}
+
+}  // namespace
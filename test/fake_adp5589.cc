@@ -0,0 +1,86 @@
+#include "fake_adp5589.h"
+
+#include <algorithm>
+
+#include <kbdlib/adp5589.h>
+
+using kbd::adp5589::RegNum;
+
+namespace {
+
+constexpr uint8_t Reg(RegNum reg) {
+  return static_cast<uint8_t>(reg);
+}
+
+}  // namespace
+
+FakeADP5589::FakeADP5589() {
+  Reset();
+  num_resets_ = 0;
+}
+
+void FakeADP5589::Reset() {
+  regs_.fill(0);
+  regs_[Reg(RegNum::ID)] = kDeviceID;
+  fifo_.clear();
+  int_status_ = 0;
+  num_popped_ = 0;
+  num_resets_++;
+}
+
+void FakeADP5589::PushEvent(uint8_t event_id, bool pressed) {
+  if (fifo_.size() == kFIFOSize) {
+    int_status_ |= kOverflowIntFlag;
+    return;
+  }
+  fifo_.push_back((pressed ? 0x80 : 0x00) | (event_id & 0x7F));
+  int_status_ |= kEventIntFlag;
+}
+
+bool FakeADP5589::BeginTransaction() {
+  FakeDevice::BeginTransaction();
+  num_popped_ = 0;
+  if (num_failures_) {
+    num_failures_--;
+    return false;
+  }
+  return true;
+}
+
+void FakeADP5589::EndTransaction() {
+  // Reading a FIFO entry removes it once the read completes.
+  fifo_.erase(fifo_.begin(),
+              fifo_.begin() + std::min(num_popped_, fifo_.size()));
+  num_popped_ = 0;
+}
+
+bool FakeADP5589::Read(uint8_t reg, uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++, reg++) {
+    if (reg == Reg(RegNum::INT_STATUS)) {
+      data[i] = int_status_;
+    } else if (reg == Reg(RegNum::Status)) {
+      data[i] = static_cast<uint8_t>(fifo_.size());
+    } else if (reg >= Reg(RegNum::FIFO_1) && reg <= Reg(RegNum::FIFO_16)) {
+      const size_t idx = reg - Reg(RegNum::FIFO_1);
+      data[i] = idx < fifo_.size() ? fifo_[idx] : 0;
+      num_popped_ = std::max(num_popped_, idx + 1);
+    } else {
+      data[i] = regs_[reg];
+    }
+  }
+  return true;
+}
+
+bool FakeADP5589::Write(uint8_t reg, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++, reg++) {
+    if (reg == Reg(RegNum::INT_STATUS)) {
+      int_status_ &= ~data[i];
+      // EVENT_INT is asserted again while events remain.
+      if (fifo_.size() > num_popped_)
+        int_status_ |= kEventIntFlag;
+    } else {
+      regs_[reg] = data[i];
+    }
+  }
+  return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <i2clib/fake_device.h>
+
+/**
+ * A fake ADP5589 keyboard IC on the fake I2C bus.
+ *
+ * Models the registers Keyboard uses: the event FIFO (drained by reading
+ * it), the event count in Status, and the write-1-to-clear INT_STATUS bits.
+ * Events pushed beyond the 16 entry FIFO are lost and set OVRFLOW_INT, as
+ * on the real IC. Reset() returns the registers to their defaults.
+ */
+class FakeADP5589 : public i2c::FakeDevice {
+ public:
+  static constexpr uint8_t kFIFOSize = 16;
+  static constexpr uint8_t kEventIntFlag = 0x01;
+  static constexpr uint8_t kOverflowIntFlag = 0x04;
+  static constexpr uint8_t kDeviceID = 0x10;
+
+  FakeADP5589();
+
+  /**
+   * Queue a key event (a FIFO register value) as the IC would on a key
+   * press or release.
+   */
+  void PushEvent(uint8_t event_id, bool pressed);
+
+  /**
+   * Reset all registers and discard the FIFO, as the RST pin does.
+   */
+  void Reset();
+
+  /**
+   * Fail the next |count| transactions.
+   */
+  void FailTransactions(uint32_t count) { num_failures_ = count; }
+
+  uint8_t reg(uint8_t reg) const { return regs_[reg]; }
+  uint8_t int_status() const { return int_status_; }
+  size_t fifo_size() const { return fifo_.size(); }
+  uint32_t num_resets() const { return num_resets_; }
+
+  // i2c::FakeDevice:
+  bool BeginTransaction() override;
+  void EndTransaction() override;
+  bool Read(uint8_t reg, uint8_t* data, size_t len) override;
+  bool Write(uint8_t reg, const uint8_t* data, size_t len) override;
+
+ private:
+  std::array<uint8_t, 256> regs_;
+  std::deque<uint8_t> fifo_;
+  uint8_t int_status_;
+  size_t num_popped_;  // FIFO entries read by this transaction.
+  uint32_t num_failures_ = 0;
+  uint32_t num_resets_ = 0;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+// Host stand-in for TinyUSB's class/hid/hid.h, with the keyboard and
+// consumer usages used by the keyboard code and its tests.
+
+enum {
+  KEYBOARD_MODIFIER_LEFTCTRL = 1u << 0,
+  KEYBOARD_MODIFIER_LEFTSHIFT = 1u << 1,
+  KEYBOARD_MODIFIER_LEFTALT = 1u << 2,
+  KEYBOARD_MODIFIER_LEFTGUI = 1u << 3,
+  KEYBOARD_MODIFIER_RIGHTCTRL = 1u << 4,
+  KEYBOARD_MODIFIER_RIGHTSHIFT = 1u << 5,
+  KEYBOARD_MODIFIER_RIGHTALT = 1u << 6,
+  KEYBOARD_MODIFIER_RIGHTGUI = 1u << 7,
+};
+
+#define HID_KEY_NONE 0x00
+#define HID_KEY_A 0x04
+#define HID_KEY_B 0x05
+#define HID_KEY_C 0x06
+#define HID_KEY_D 0x07
+#define HID_KEY_E 0x08
+#define HID_KEY_F 0x09
+#define HID_KEY_G 0x0A
+#define HID_KEY_H 0x0B
+#define HID_KEY_I 0x0C
+#define HID_KEY_J 0x0D
+#define HID_KEY_K 0x0E
+#define HID_KEY_L 0x0F
+#define HID_KEY_M 0x10
+#define HID_KEY_N 0x11
+#define HID_KEY_O 0x12
+#define HID_KEY_P 0x13
+#define HID_KEY_Q 0x14
+#define HID_KEY_R 0x15
+#define HID_KEY_S 0x16
+#define HID_KEY_T 0x17
+#define HID_KEY_U 0x18
+#define HID_KEY_V 0x19
+#define HID_KEY_W 0x1A
+#define HID_KEY_X 0x1B
+#define HID_KEY_Y 0x1C
+#define HID_KEY_Z 0x1D
+#define HID_KEY_1 0x1E
+#define HID_KEY_2 0x1F
+#define HID_KEY_ENTER 0x28
+#define HID_KEY_ESCAPE 0x29
+#define HID_KEY_SPACE 0x2C
+#define HID_KEY_F1 0x3A
+#define HID_KEY_F2 0x3B
+#define HID_KEY_CONTROL_LEFT 0xE0
+#define HID_KEY_SHIFT_LEFT 0xE1
+#define HID_KEY_ALT_LEFT 0xE2
+#define HID_KEY_GUI_LEFT 0xE3
+#define HID_KEY_CONTROL_RIGHT 0xE4
+#define HID_KEY_SHIFT_RIGHT 0xE5
+#define HID_KEY_ALT_RIGHT 0xE6
+#define HID_KEY_GUI_RIGHT 0xE7
+
+enum {
+  HID_USAGE_CONSUMER_SCAN_NEXT = 0x00B5,
+  HID_USAGE_CONSUMER_SCAN_PREVIOUS = 0x00B6,
+  HID_USAGE_CONSUMER_STOP = 0x00B7,
+  HID_USAGE_CONSUMER_PLAY_PAUSE = 0x00CD,
+  HID_USAGE_CONSUMER_MUTE = 0x00E2,
+  HID_USAGE_CONSUMER_VOLUME_INCREMENT = 0x00E9,
+  HID_USAGE_CONSUMER_VOLUME_DECREMENT = 0x00EA,
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+// Host stand-in for TinyUSB's device/usbd.h, with the descriptor macros
+// used by HostChannel.
+
+#include <cstdint>
+
+enum {
+  TUSB_DESC_INTERFACE = 0x04,
+  TUSB_DESC_ENDPOINT = 0x05,
+};
+
+enum {
+  TUSB_CLASS_VENDOR_SPECIFIC = 0xFF,
+};
+
+enum {
+  TUSB_XFER_BULK = 2,
+};
+
+enum {
+  TUSB_DIR_IN_MASK = 0x80,
+};
+
+#define U16_TO_U8S_LE(_u16) \
+  static_cast<uint8_t>((_u16) & 0xFF), static_cast<uint8_t>((_u16) >> 8)
+
+#define TUD_VENDOR_DESC_LEN (9 + 7 + 7)
+
+#define TUD_VENDOR_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize)      \
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 2, TUSB_CLASS_VENDOR_SPECIFIC, 0x00,   \
+      0x00, _stridx, 7, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_BULK,          \
+      U16_TO_U8S_LE(_epsize), 0, 7, TUSB_DESC_ENDPOINT, _epin,               \
+      TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
@@ -0,0 +1,17 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF driver/gpio.h. Output levels are passed to
+// the handler set with fake_gpio_set_handler(), if any.
+
+#include <cstdint>
+#include <functional>
+
+#include <esp_err.h>
+#include <hal/gpio_types.h>
+
+esp_err_t gpio_config(const gpio_config_t* config);
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+int gpio_get_level(gpio_num_t gpio_num);
+
+void fake_gpio_set_handler(
+    std::function<void(gpio_num_t gpio_num, uint32_t level)> handler);
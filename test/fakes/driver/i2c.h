@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF driver/i2c.h.
+
+#include <driver/gpio.h>
+#include <freertos/include/freertos/FreeRTOS.h>
+#include <freertos/include/freertos/task.h>
+
+typedef enum {
+  I2C_NUM_0 = 0,
+  I2C_NUM_1,
+} i2c_port_t;
@@ -0,0 +1,3 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF esp_tls.h. Nothing is used directly.
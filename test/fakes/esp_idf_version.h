@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF esp_idf_version.h. Code with version
+// dependent paths can be built as a later release by defining
+// FAKE_ESP_IDF_VERSION_MINOR.
+
+#ifndef FAKE_ESP_IDF_VERSION_MINOR
+#define FAKE_ESP_IDF_VERSION_MINOR 3
+#endif
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) \
+  (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(4, FAKE_ESP_IDF_VERSION_MINOR, 0)
@@ -0,0 +1,29 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF esp_log.h. Errors and warnings go to
+// stderr, everything else is discarded.
+
+typedef enum {
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+void fake_log_write(esp_log_level_t level,
+                    const char* tag,
+                    const char* format,
+                    ...);
+
+#define ESP_LOGE(tag, format, ...) \
+  fake_log_write(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) \
+  fake_log_write(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) \
+  fake_log_write(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) \
+  fake_log_write(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) \
+  fake_log_write(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
@@ -0,0 +1,14 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF esp_system.h.
+//
+// The base MAC address is set by tests (see fake_nvs.h), and "random"
+// bytes come from std::random_device.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <esp_err.h>
+
+esp_err_t esp_efuse_mac_get_default(uint8_t* mac);
+void esp_fill_random(void* buf, size_t len);
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF esp_task_wdt.h.
+
+#include <esp_err.h>
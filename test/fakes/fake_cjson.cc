@@ -0,0 +1,290 @@
+// A minimal cJSON for the host tests: flat objects of strings, numbers,
+// booleans and null.
+
+#include <json/cJSON/cJSON.h>
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+namespace {
+
+char* Duplicate(const std::string& s) {
+  char* copy = static_cast<char*>(malloc(s.size() + 1));
+  memcpy(copy, s.c_str(), s.size() + 1);
+  return copy;
+}
+
+cJSON* NewItem(int type, const char* name) {
+  cJSON* item = static_cast<cJSON*>(calloc(1, sizeof(cJSON)));
+  item->type = type;
+  if (name)
+    item->string = Duplicate(name);
+  return item;
+}
+
+void Append(cJSON* object, cJSON* item) {
+  if (!object->child) {
+    object->child = item;
+    item->prev = item;  // cJSON keeps the last child in the first's prev.
+    return;
+  }
+  cJSON* last = object->child->prev;
+  last->next = item;
+  item->prev = last;
+  object->child->prev = item;
+}
+
+void PrintString(const char* s, std::string* out) {
+  out->push_back('"');
+  for (; *s; s++) {
+    const unsigned char c = *s;
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (c < 0x20) {
+      char escape[7];
+      snprintf(escape, sizeof(escape), "\\u%04x", c);
+      out->append(escape);
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+const char* SkipSpace(const char* p) {
+  while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+    p++;
+  return p;
+}
+
+void AppendUTF8(unsigned code, std::string* out) {
+  if (code < 0x80) {
+    out->push_back(code);
+  } else if (code < 0x800) {
+    out->push_back(0xc0 | (code >> 6));
+    out->push_back(0x80 | (code & 0x3f));
+  } else {
+    out->push_back(0xe0 | (code >> 12));
+    out->push_back(0x80 | ((code >> 6) & 0x3f));
+    out->push_back(0x80 | (code & 0x3f));
+  }
+}
+
+/**
+ * Parse the string starting after the opening quote at |p|, returning the
+ * end, or null if invalid. Surrogate pairs are not supported.
+ */
+const char* ParseString(const char* p, std::string* out) {
+  while (*p != '"') {
+    if (!*p || static_cast<unsigned char>(*p) < 0x20)
+      return nullptr;
+    if (*p != '\\') {
+      out->push_back(*p++);
+      continue;
+    }
+    p++;
+    switch (*p++) {
+      case '"':
+        out->push_back('"');
+        break;
+      case '\\':
+        out->push_back('\\');
+        break;
+      case '/':
+        out->push_back('/');
+        break;
+      case 'b':
+        out->push_back('\b');
+        break;
+      case 'f':
+        out->push_back('\f');
+        break;
+      case 'n':
+        out->push_back('\n');
+        break;
+      case 'r':
+        out->push_back('\r');
+        break;
+      case 't':
+        out->push_back('\t');
+        break;
+      case 'u': {
+        char hex[5] = {};
+        for (int i = 0; i < 4; i++) {
+          if (!isxdigit(static_cast<unsigned char>(p[i])))
+            return nullptr;
+          hex[i] = p[i];
+        }
+        p += 4;
+        AppendUTF8(strtoul(hex, nullptr, 16), out);
+        break;
+      }
+      default:
+        return nullptr;
+    }
+  }
+  return p + 1;
+}
+
+/**
+ * Parse the value at |p| into |item|, returning its end, or null if invalid.
+ */
+const char* ParseValue(const char* p, cJSON* item) {
+  if (*p == '"') {
+    std::string value;
+    p = ParseString(p + 1, &value);
+    if (!p)
+      return nullptr;
+    item->type = cJSON_String;
+    item->valuestring = Duplicate(value);
+    return p;
+  }
+  for (const auto& literal : {std::make_pair("true", cJSON_True),
+                              std::make_pair("false", cJSON_False),
+                              std::make_pair("null", cJSON_NULL)}) {
+    const size_t len = strlen(literal.first);
+    if (!strncmp(p, literal.first, len)) {
+      item->type = literal.second;
+      return p + len;
+    }
+  }
+  if (*p != '-' && !isdigit(static_cast<unsigned char>(*p)))
+    return nullptr;
+  char* end;
+  item->valuedouble = strtod(p, &end);
+  item->valueint = static_cast<int>(item->valuedouble);
+  item->type = cJSON_Number;
+  return end;
+}
+
+}  // namespace
+
+cJSON* cJSON_CreateObject() {
+  return NewItem(cJSON_Object, nullptr);
+}
+
+cJSON* cJSON_AddStringToObject(cJSON* object,
+                               const char* name,
+                               const char* string) {
+  cJSON* item = NewItem(cJSON_String, name);
+  item->valuestring = Duplicate(string);
+  Append(object, item);
+  return item;
+}
+
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+  cJSON* item = NewItem(cJSON_Number, name);
+  item->valuedouble = number;
+  item->valueint = static_cast<int>(number);
+  Append(object, item);
+  return item;
+}
+
+char* cJSON_PrintUnformatted(const cJSON* item) {
+  if (!item || item->type != cJSON_Object)
+    return nullptr;
+  std::string out = "{";
+  for (const cJSON* c = item->child; c; c = c->next) {
+    if (c != item->child)
+      out.push_back(',');
+    PrintString(c->string, &out);
+    out.push_back(':');
+    char number[32];
+    switch (c->type) {
+      case cJSON_String:
+        PrintString(c->valuestring, &out);
+        break;
+      case cJSON_Number:
+        if (std::trunc(c->valuedouble) == c->valuedouble)
+          snprintf(number, sizeof(number), "%.0f", c->valuedouble);
+        else
+          snprintf(number, sizeof(number), "%.17g", c->valuedouble);
+        out.append(number);
+        break;
+      case cJSON_True:
+        out.append("true");
+        break;
+      case cJSON_False:
+        out.append("false");
+        break;
+      default:
+        out.append("null");
+        break;
+    }
+  }
+  out.push_back('}');
+  return Duplicate(out);
+}
+
+cJSON* cJSON_Parse(const char* value) {
+  const char* p = SkipSpace(value);
+  if (*p++ != '{')
+    return nullptr;
+  cJSON* object = cJSON_CreateObject();
+  p = SkipSpace(p);
+  bool ok = *p == '}';
+  while (!ok) {
+    std::string name;
+    if (*p != '"' || !(p = ParseString(p + 1, &name)))
+      break;
+    p = SkipSpace(p);
+    if (*p++ != ':')
+      break;
+    cJSON* item = NewItem(cJSON_Invalid, name.c_str());
+    Append(object, item);
+    if (!(p = ParseValue(SkipSpace(p), item)))
+      break;
+    p = SkipSpace(p);
+    if (*p == '}')
+      ok = true;
+    else if (*p++ != ',')
+      break;
+    p = SkipSpace(p);
+  }
+  if (!ok || *SkipSpace(p + 1)) {
+    cJSON_Delete(object);
+    return nullptr;
+  }
+  return object;
+}
+
+cJSON* cJSON_GetObjectItemCaseSensitive(const cJSON* object,
+                                        const char* string) {
+  if (!object)
+    return nullptr;
+  for (cJSON* c = object->child; c; c = c->next) {
+    if (c->string && !strcmp(c->string, string))
+      return c;
+  }
+  return nullptr;
+}
+
+int cJSON_IsString(const cJSON* item) {
+  return item && item->type == cJSON_String;
+}
+
+int cJSON_IsNumber(const cJSON* item) {
+  return item && item->type == cJSON_Number;
+}
+
+void cJSON_Delete(cJSON* item) {
+  while (item) {
+    cJSON* next = item->next;
+    cJSON_Delete(item->child);
+    free(item->valuestring);
+    free(item->string);
+    free(item);
+    item = next;
+  }
+}
+
+void cJSON_free(void* object) {
+  free(object);
+}
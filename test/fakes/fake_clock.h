@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * The fake clock behind esp_timer_get_time(). It starts at zero and only
+ * moves when set, advanced, or by vTaskDelay().
+ */
+class FakeClock {
+ public:
+  FakeClock() = delete;
+  ~FakeClock() = delete;
+
+  static int64_t now_us();
+  static void Set(int64_t now_us);
+  static void Advance(int64_t usec);
+};
@@ -0,0 +1,231 @@
+// The fake esp_http_client, and the FakeHTTPServer it talks to.
+
+#include "fake_http_server.h"
+
+#include <set>
+
+#include "fake_clock.h"
+
+struct esp_http_client {
+  esp_http_client_config_t config;
+  std::string url;
+  esp_http_client_method_t method = HTTP_METHOD_GET;
+  std::map<std::string, std::string> headers;
+  std::string post_field;
+  int status_code = 0;
+  bool open = false;           // Connected.
+  bool server_closed = false;  // Closed by the server, not yet noticed.
+  bool has_session = false;    // A TLS session saved from the last connect.
+};
+
+namespace {
+
+FakeHTTPServer::Response g_response;
+FakeHTTPServer::Failure g_failure = FakeHTTPServer::Failure::None;
+std::vector<FakeHTTPServer::Request> g_requests;
+std::set<esp_http_client_handle_t> g_clients;
+uint32_t g_num_inits = 0;
+uint32_t g_num_cleanups = 0;
+uint32_t g_num_connects = 0;
+
+esp_err_t SendEvent(esp_http_client_handle_t client,
+                    esp_http_client_event_id_t event_id,
+                    const void* data = nullptr,
+                    int data_len = 0,
+                    const char* header_key = nullptr,
+                    const char* header_value = nullptr) {
+  if (!client->config.event_handler)
+    return ESP_OK;
+  esp_http_client_event_t evt = {};
+  evt.event_id = event_id;
+  evt.client = client;
+  evt.data = const_cast<void*>(data);
+  evt.data_len = data_len;
+  evt.user_data = client->config.user_data;
+  evt.header_key = const_cast<char*>(header_key);
+  evt.header_value = const_cast<char*>(header_value);
+  return client->config.event_handler(&evt);
+}
+
+bool SavesSession(esp_http_client_handle_t client) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
+  return client->config.save_client_session &&
+         !client->url.compare(0, 8, "https://");
+#else
+  (void)client;
+  return false;
+#endif
+}
+
+}  // namespace
+
+// static
+void FakeHTTPServer::Reset() {
+  g_response = Response();
+  g_failure = Failure::None;
+  g_requests.clear();
+  g_num_inits = 0;
+  g_num_cleanups = 0;
+  g_num_connects = 0;
+}
+
+// static
+void FakeHTTPServer::SetResponse(const Response& response) {
+  g_response = response;
+}
+
+// static
+void FakeHTTPServer::FailNextRequest(Failure failure) {
+  g_failure = failure;
+}
+
+// static
+void FakeHTTPServer::CloseIdleConnections() {
+  for (esp_http_client_handle_t client : g_clients) {
+    if (client->open)
+      client->server_closed = true;
+  }
+}
+
+// static
+const std::vector<FakeHTTPServer::Request>& FakeHTTPServer::requests() {
+  return g_requests;
+}
+
+// static
+uint32_t FakeHTTPServer::num_inits() {
+  return g_num_inits;
+}
+
+// static
+uint32_t FakeHTTPServer::num_cleanups() {
+  return g_num_cleanups;
+}
+
+// static
+uint32_t FakeHTTPServer::num_connects() {
+  return g_num_connects;
+}
+
+// static
+uint32_t FakeHTTPServer::num_open_connections() {
+  uint32_t count = 0;
+  for (esp_http_client_handle_t client : g_clients)
+    count += client->open && !client->server_closed;
+  return count;
+}
+
+esp_http_client_handle_t esp_http_client_init(
+    const esp_http_client_config_t* config) {
+  esp_http_client_handle_t client = new esp_http_client();
+  client->config = *config;
+  client->url = config->url ? config->url : "";
+  g_clients.insert(client);
+  g_num_inits++;
+  return client;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client) {
+  const FakeHTTPServer::Failure failure = g_failure;
+  g_failure = FakeHTTPServer::Failure::None;
+  client->status_code = 0;
+
+  if (client->open && client->server_closed) {
+    // The request is written to a connection the server has closed.
+    client->open = false;
+    client->server_closed = false;
+    return ESP_FAIL;
+  }
+
+  FakeHTTPServer::Request request = {client->url, client->method,
+                                     client->headers, client->post_field,
+                                     !client->open, false};
+  if (!client->open) {
+    if (failure == FakeHTTPServer::Failure::Connect) {
+      FakeClock::Advance(FakeHTTPServer::kConnectUsec);
+      return ESP_ERR_HTTP_CONNECT;
+    }
+    request.offered_session = client->has_session;
+    FakeClock::Advance(client->has_session
+                           ? FakeHTTPServer::kResumedConnectUsec
+                           : FakeHTTPServer::kConnectUsec);
+    client->open = true;
+    client->has_session = SavesSession(client);
+    g_num_connects++;
+    SendEvent(client, HTTP_EVENT_ON_CONNECTED);
+  }
+  g_requests.push_back(request);
+  SendEvent(client, HTTP_EVENT_HEADER_SENT);
+
+  FakeClock::Advance(FakeHTTPServer::kTTFBUsec);
+  client->status_code = g_response.status_code;
+  for (const auto& header : g_response.headers) {
+    SendEvent(client, HTTP_EVENT_ON_HEADER, nullptr, 0, header.first.c_str(),
+              header.second.c_str());
+  }
+  if (failure == FakeHTTPServer::Failure::AfterHeaders) {
+    client->open = false;
+    SendEvent(client, HTTP_EVENT_DISCONNECTED);
+    return ESP_FAIL;
+  }
+
+  FakeClock::Advance(FakeHTTPServer::kBodyUsec);
+  if (!g_response.body.empty()) {
+    esp_err_t err = SendEvent(client, HTTP_EVENT_ON_DATA,
+                              g_response.body.data(), g_response.body.size());
+    if (err != ESP_OK)
+      return err;
+  }
+  SendEvent(client, HTTP_EVENT_ON_FINISH);
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client,
+                                  const char* url) {
+  client->url = url;
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client,
+                                     esp_http_client_method_t method) {
+  client->method = method;
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client,
+                                     const char* key,
+                                     const char* value) {
+  client->headers[key] = value;
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client,
+                                        const char* key) {
+  client->headers.erase(key);
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client,
+                                         const char* data,
+                                         int len) {
+  client->post_field.assign(data ? data : "", data ? len : 0);
+  return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+  return client->status_code;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client) {
+  // The TLS session, if saved, is kept for the next connection.
+  client->open = false;
+  client->server_closed = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+  g_clients.erase(client);
+  delete client;
+  g_num_cleanups++;
+  return ESP_OK;
+}
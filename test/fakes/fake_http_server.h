@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <esp_http_client/include/esp_http_client.h>
+
+/**
+ * The server behind every fake esp_http_client, with the state and counts
+ * tests check.
+ *
+ * Connections stay open after a request (HTTP keep-alive) until closed by
+ * the client, or by CloseIdleConnections(). Time passes on the fake clock:
+ * each new connection takes kConnectUsec (kResumedConnectUsec if a saved
+ * TLS session is offered), then each response kTTFBUsec to the first header
+ * and kBodyUsec to the end of the body.
+ */
+class FakeHTTPServer {
+ public:
+  static constexpr int64_t kConnectUsec = 300 * 1000;
+  static constexpr int64_t kResumedConnectUsec = 100 * 1000;
+  static constexpr int64_t kTTFBUsec = 50 * 1000;
+  static constexpr int64_t kBodyUsec = 10 * 1000;
+
+  enum class Failure {
+    None,
+    Connect,       // Fail to connect (DNS, TCP, or TLS).
+    AfterHeaders,  // Drop the connection after the response headers.
+  };
+
+  struct Request {
+    std::string url;
+    esp_http_client_method_t method;
+    std::map<std::string, std::string> headers;
+    std::string body;
+    bool new_connection;   // Else sent on an open connection.
+    bool offered_session;  // A new TLS connection offering a saved session.
+  };
+
+  struct Response {
+    int status_code = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+  };
+
+  FakeHTTPServer() = delete;
+  ~FakeHTTPServer() = delete;
+
+  /**
+   * Forget the requests, counts, response and pending failure. Clients must
+   * be cleaned up first.
+   */
+  static void Reset();
+
+  /**
+   * The response to every following request.
+   */
+  static void SetResponse(const Response& response);
+
+  /**
+   * Fail the next request as |failure|.
+   */
+  static void FailNextRequest(Failure failure);
+
+  /**
+   * Close every open connection from the server end, as a server does to
+   * idle connections. The client only finds out when it next sends on one.
+   */
+  static void CloseIdleConnections();
+
+  static const std::vector<Request>& requests();
+  static uint32_t num_inits();     // esp_http_client_init() calls.
+  static uint32_t num_cleanups();  // esp_http_client_cleanup() calls.
+  static uint32_t num_connects();
+  static uint32_t num_open_connections();
+};
@@ -0,0 +1,141 @@
+// The mbedtls GCM and HMAC functions TokenStore uses, implemented with
+// OpenSSL so the host tests exercise real AES-256-GCM and HMAC-SHA256.
+
+#include <cstring>
+
+#include <mbedtls/mbedtls/include/mbedtls/gcm.h>
+#include <mbedtls/mbedtls/include/mbedtls/md.h>
+#include <mbedtls/mbedtls/include/mbedtls/platform_util.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+struct mbedtls_md_info_t {
+  mbedtls_md_type_t type;
+};
+
+namespace {
+
+constexpr mbedtls_md_info_t kSHA256Info = {MBEDTLS_MD_SHA256};
+
+/**
+ * Encrypt (or decrypt) |length| bytes, then get (or check) the tag.
+ */
+int GCM(const mbedtls_gcm_context* ctx,
+        bool encrypt,
+        size_t length,
+        const unsigned char* iv,
+        size_t iv_len,
+        const unsigned char* add,
+        size_t add_len,
+        const unsigned char* input,
+        unsigned char* output,
+        size_t tag_len,
+        unsigned char* tag) {
+  if (ctx->keybits != 256 || tag_len > 16)
+    return MBEDTLS_ERR_GCM_BAD_INPUT;
+  EVP_CIPHER_CTX* evp = EVP_CIPHER_CTX_new();
+  int out_len;
+  bool ok =
+      EVP_CipherInit_ex(evp, EVP_aes_256_gcm(), nullptr, nullptr, nullptr,
+                        encrypt) &&
+      EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_GCM_SET_IVLEN, iv_len, nullptr) &&
+      EVP_CipherInit_ex(evp, nullptr, nullptr, ctx->key, iv, encrypt) &&
+      (!add_len || EVP_CipherUpdate(evp, nullptr, &out_len, add, add_len)) &&
+      (!length || EVP_CipherUpdate(evp, output, &out_len, input, length));
+  if (ok && !encrypt)
+    ok = EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_GCM_SET_TAG, tag_len, tag);
+  int ret = MBEDTLS_ERR_GCM_BAD_INPUT;
+  if (ok) {
+    if (!EVP_CipherFinal_ex(evp, output + length, &out_len))
+      ret = encrypt ? MBEDTLS_ERR_GCM_BAD_INPUT : MBEDTLS_ERR_GCM_AUTH_FAILED;
+    else if (encrypt &&
+             !EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_GCM_GET_TAG, tag_len, tag))
+      ret = MBEDTLS_ERR_GCM_BAD_INPUT;
+    else
+      ret = 0;
+  }
+  EVP_CIPHER_CTX_free(evp);
+  if (ret == MBEDTLS_ERR_GCM_AUTH_FAILED)
+    memset(output, 0, length);  // As mbedtls does.
+  return ret;
+}
+
+}  // namespace
+
+void mbedtls_gcm_init(mbedtls_gcm_context* ctx) {
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_gcm_setkey(mbedtls_gcm_context* ctx,
+                       mbedtls_cipher_id_t cipher,
+                       const unsigned char* key,
+                       unsigned int keybits) {
+  if (cipher != MBEDTLS_CIPHER_ID_AES || keybits != 256)
+    return MBEDTLS_ERR_GCM_BAD_INPUT;
+  memcpy(ctx->key, key, keybits / 8);
+  ctx->keybits = keybits;
+  return 0;
+}
+
+int mbedtls_gcm_crypt_and_tag(mbedtls_gcm_context* ctx,
+                              int mode,
+                              size_t length,
+                              const unsigned char* iv,
+                              size_t iv_len,
+                              const unsigned char* add,
+                              size_t add_len,
+                              const unsigned char* input,
+                              unsigned char* output,
+                              size_t tag_len,
+                              unsigned char* tag) {
+  if (mode != MBEDTLS_GCM_ENCRYPT)
+    return MBEDTLS_ERR_GCM_BAD_INPUT;  // Decrypting needs a tag to check.
+  return GCM(ctx, /*encrypt=*/true, length, iv, iv_len, add, add_len, input,
+             output, tag_len, tag);
+}
+
+int mbedtls_gcm_auth_decrypt(mbedtls_gcm_context* ctx,
+                             size_t length,
+                             const unsigned char* iv,
+                             size_t iv_len,
+                             const unsigned char* add,
+                             size_t add_len,
+                             const unsigned char* tag,
+                             size_t tag_len,
+                             const unsigned char* input,
+                             unsigned char* output) {
+  unsigned char tag_copy[16];
+  if (tag_len > sizeof(tag_copy))
+    return MBEDTLS_ERR_GCM_BAD_INPUT;
+  memcpy(tag_copy, tag, tag_len);
+  return GCM(ctx, /*encrypt=*/false, length, iv, iv_len, add, add_len, input,
+             output, tag_len, tag_copy);
+}
+
+void mbedtls_gcm_free(mbedtls_gcm_context* ctx) {
+  mbedtls_platform_zeroize(ctx, sizeof(*ctx));
+}
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t md_type) {
+  return md_type == MBEDTLS_MD_SHA256 ? &kSHA256Info : nullptr;
+}
+
+int mbedtls_md_hmac(const mbedtls_md_info_t* md_info,
+                    const unsigned char* key,
+                    size_t keylen,
+                    const unsigned char* input,
+                    size_t ilen,
+                    unsigned char* output) {
+  if (md_info != &kSHA256Info)
+    return -1;
+  unsigned int out_len;
+  return HMAC(EVP_sha256(), key, static_cast<int>(keylen), input, ilen, output,
+              &out_len)
+             ? 0
+             : -1;
+}
+
+void mbedtls_platform_zeroize(void* buf, size_t len) {
+  OPENSSL_cleanse(buf, len);
+}
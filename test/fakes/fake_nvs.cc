@@ -0,0 +1,130 @@
+// The fake NVS and esp_system.h, and the FakeNVS state behind them.
+
+#include "fake_nvs.h"
+
+#include <cstring>
+#include <map>
+#include <random>
+
+#include <esp_system.h>
+#include <nvs_flash/include/nvs.h>
+
+namespace {
+
+constexpr uint8_t kDefaultMAC[6] = {0x7c, 0xdf, 0xa1, 0x00, 0x12, 0x34};
+
+struct OpenHandle {
+  std::string name;
+  nvs_open_mode_t mode;
+};
+
+// Namespace, then key.
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> g_nvs;
+std::map<nvs_handle_t, OpenHandle> g_handles;
+nvs_handle_t g_next_handle = 1;
+uint8_t g_mac[6] = {0x7c, 0xdf, 0xa1, 0x00, 0x12, 0x34};
+
+}  // namespace
+
+// static
+void FakeNVS::Reset() {
+  g_nvs.clear();
+  g_handles.clear();
+  memcpy(g_mac, kDefaultMAC, sizeof(g_mac));
+}
+
+// static
+std::vector<uint8_t>* FakeNVS::blob(const std::string& name,
+                                    const std::string& key) {
+  auto ns = g_nvs.find(name);
+  if (ns == g_nvs.end())
+    return nullptr;
+  auto value = ns->second.find(key);
+  return value == ns->second.end() ? nullptr : &value->second;
+}
+
+// static
+void FakeNVS::SetBaseMAC(const uint8_t mac[6]) {
+  memcpy(g_mac, mac, sizeof(g_mac));
+}
+
+// static
+uint32_t FakeNVS::num_open_handles() {
+  return g_handles.size();
+}
+
+esp_err_t esp_efuse_mac_get_default(uint8_t* mac) {
+  memcpy(mac, g_mac, sizeof(g_mac));
+  return ESP_OK;
+}
+
+void esp_fill_random(void* buf, size_t len) {
+  static std::random_device random;
+  uint8_t* bytes = static_cast<uint8_t*>(buf);
+  for (size_t i = 0; i < len; i++)
+    bytes[i] = static_cast<uint8_t>(random());
+}
+
+esp_err_t nvs_open(const char* name,
+                   nvs_open_mode_t open_mode,
+                   nvs_handle_t* out_handle) {
+  // As on the device, a namespace is created by opening it to write.
+  if (open_mode == NVS_READONLY && !g_nvs.count(name))
+    return ESP_ERR_NVS_NOT_FOUND;
+  g_nvs[name];
+  *out_handle = g_next_handle++;
+  g_handles[*out_handle] = {name, open_mode};
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle,
+                       const char* key,
+                       void* out_value,
+                       size_t* length) {
+  auto h = g_handles.find(handle);
+  if (h == g_handles.end())
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  const std::vector<uint8_t>* value = FakeNVS::blob(h->second.name, key);
+  if (!value)
+    return ESP_ERR_NVS_NOT_FOUND;
+  if (!out_value) {
+    *length = value->size();
+    return ESP_OK;
+  }
+  if (*length < value->size())
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  memcpy(out_value, value->data(), value->size());
+  *length = value->size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle,
+                       const char* key,
+                       const void* value,
+                       size_t length) {
+  auto h = g_handles.find(handle);
+  if (h == g_handles.end())
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  if (h->second.mode != NVS_READWRITE)
+    return ESP_ERR_NVS_READ_ONLY;
+  const uint8_t* bytes = static_cast<const uint8_t*>(value);
+  g_nvs[h->second.name][key].assign(bytes, bytes + length);
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+  auto h = g_handles.find(handle);
+  if (h == g_handles.end())
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  if (h->second.mode != NVS_READWRITE)
+    return ESP_ERR_NVS_READ_ONLY;
+  return g_nvs[h->second.name].erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  return g_handles.count(handle) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+void nvs_close(nvs_handle_t handle) {
+  g_handles.erase(handle);
+}
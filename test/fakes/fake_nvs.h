@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * The device state behind the fake nvs.h and esp_system.h: the NVS blobs,
+ * and the base MAC address.
+ */
+class FakeNVS {
+ public:
+  FakeNVS() = delete;
+  ~FakeNVS() = delete;
+
+  /**
+   * Erase every namespace, and restore the default MAC address.
+   */
+  static void Reset();
+
+  /**
+   * The blob stored as |key| in namespace |name|, or null if none.
+   */
+  static std::vector<uint8_t>* blob(const std::string& name,
+                                    const std::string& key);
+
+  static void SetBaseMAC(const uint8_t mac[6]);
+
+  static uint32_t num_open_handles();
+};
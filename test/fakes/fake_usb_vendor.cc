@@ -0,0 +1,64 @@
+// Host implementation of the TinyUSB vendor class functions declared by
+// tusb.h, as a loopback driven by FakeUSBVendor.
+
+#include "fake_usb_vendor.h"
+
+#include <algorithm>
+#include <deque>
+
+#include <tusb.h>
+
+namespace {
+
+std::deque<uint8_t> g_out;  // Received from the host.
+std::vector<uint8_t> g_in;  // Written by the device.
+
+}  // namespace
+
+// static
+void FakeUSBVendor::Reset() {
+  g_out.clear();
+  g_in.clear();
+}
+
+// static
+void FakeUSBVendor::HostWrite(const void* data,
+                              size_t len,
+                              size_t packet_size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  packet_size = std::min(std::max<size_t>(packet_size, 1), kMaxPacketSize);
+  for (size_t offset = 0; offset < len; offset += packet_size) {
+    const size_t n = std::min(packet_size, len - offset);
+    g_out.insert(g_out.end(), bytes + offset, bytes + offset + n);
+    tud_vendor_rx_cb(0);
+  }
+}
+
+// static
+std::vector<uint8_t> FakeUSBVendor::HostRead() {
+  std::vector<uint8_t> data;
+  data.swap(g_in);
+  return data;
+}
+
+// static
+size_t FakeUSBVendor::num_unread() {
+  return g_out.size();
+}
+
+uint32_t tud_vendor_available() {
+  return g_out.size();
+}
+
+uint32_t tud_vendor_read(void* buffer, uint32_t bufsize) {
+  const uint32_t n = std::min<size_t>(bufsize, g_out.size());
+  std::copy_n(g_out.begin(), n, static_cast<uint8_t*>(buffer));
+  g_out.erase(g_out.begin(), g_out.begin() + n);
+  return n;
+}
+
+uint32_t tud_vendor_write(const void* buffer, uint32_t bufsize) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(buffer);
+  g_in.insert(g_in.end(), bytes, bytes + bufsize);
+  return bufsize;
+}
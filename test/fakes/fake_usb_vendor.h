@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * The host side of the fake TinyUSB vendor endpoints (tusb.h).
+ *
+ * Data written by the host is received in packets of up to
+ * kMaxPacketSize bytes, calling tud_vendor_rx_cb() after each as TinyUSB
+ * does. The device's writes are kept until the host reads them.
+ */
+class FakeUSBVendor {
+ public:
+  static constexpr size_t kMaxPacketSize = 64;  // Full speed bulk maximum.
+
+  FakeUSBVendor() = delete;
+  ~FakeUSBVendor() = delete;
+
+  /**
+   * Discard any unread data in either direction.
+   */
+  static void Reset();
+
+  /**
+   * Send |len| bytes to the OUT endpoint, in packets of |packet_size|
+   * bytes (the last may be shorter).
+   */
+  static void HostWrite(const void* data,
+                        size_t len,
+                        size_t packet_size = kMaxPacketSize);
+
+  /**
+   * Take everything written by the device to the IN endpoint.
+   */
+  static std::vector<uint8_t> HostRead();
+
+  /**
+   * Bytes received on the OUT endpoint and not yet read by the device.
+   */
+  static size_t num_unread();
+};
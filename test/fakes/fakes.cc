@@ -0,0 +1,209 @@
+// Host implementations of the ESP-IDF, FreeRTOS, and i2clib functions
+// declared by the headers in this directory.
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include <driver/gpio.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/include/freertos/semphr.h>
+#include <freertos/include/freertos/task.h>
+#include <i2clib/fake_device.h>
+#include <i2clib/master.h>
+#include <i2clib/operation.h>
+
+#include "fake_clock.h"
+
+namespace {
+
+int64_t g_now_us = 0;
+std::function<void(gpio_num_t, uint32_t)> g_gpio_handler;
+
+}  // namespace
+
+// static
+int64_t FakeClock::now_us() {
+  return g_now_us;
+}
+
+// static
+void FakeClock::Set(int64_t now_us) {
+  g_now_us = now_us;
+}
+
+// static
+void FakeClock::Advance(int64_t usec) {
+  g_now_us += usec;
+}
+
+void fake_log_write(esp_log_level_t level,
+                    const char* tag,
+                    const char* format,
+                    ...) {
+  if (level > ESP_LOG_WARN)
+    return;
+  fprintf(stderr, "%c (%s) ", level == ESP_LOG_ERROR ? 'E' : 'W', tag);
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+int64_t esp_timer_get_time() {
+  return g_now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* /*create_args*/,
+                           esp_timer_handle_t* out_handle) {
+  *out_handle = nullptr;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t /*timer*/,
+                               uint64_t /*timeout_us*/) {
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t /*timer*/,
+                                   uint64_t /*period*/) {
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t /*timer*/) {
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t /*timer*/) {
+  return ESP_OK;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  g_now_us += static_cast<int64_t>(ticks) * portTICK_PERIOD_MS * 1000;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new std::mutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t /*ticks*/) {
+  static_cast<std::mutex*>(semaphore)->lock();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  static_cast<std::mutex*>(semaphore)->unlock();
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  delete static_cast<std::mutex*>(semaphore);
+}
+
+esp_err_t gpio_config(const gpio_config_t* /*config*/) {
+  return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+  if (g_gpio_handler)
+    g_gpio_handler(gpio_num, level);
+  return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t /*gpio_num*/) {
+  return 1;
+}
+
+void fake_gpio_set_handler(
+    std::function<void(gpio_num_t gpio_num, uint32_t level)> handler) {
+  g_gpio_handler = std::move(handler);
+}
+
+namespace i2c {
+
+Operation::Operation(FakeDevice* device, uint8_t reg, Address::Mode mode)
+    : device_(device) {
+  RestartReg(reg, mode);
+}
+
+bool Operation::RestartReg(uint8_t reg, Address::Mode mode) {
+  if (!device_)
+    return false;
+  accesses_.push_back({reg, mode, {}, nullptr, 0});
+  return true;
+}
+
+bool Operation::WriteByte(uint8_t value) {
+  if (accesses_.empty() || accesses_.back().mode != Address::Mode::WRITE)
+    return false;
+  accesses_.back().write_data.push_back(value);
+  return true;
+}
+
+bool Operation::Read(void* data, size_t len) {
+  if (accesses_.empty() || accesses_.back().mode != Address::Mode::READ ||
+      accesses_.back().read_data) {
+    return false;
+  }
+  accesses_.back().read_data = static_cast<uint8_t*>(data);
+  accesses_.back().read_len = len;
+  return true;
+}
+
+bool Operation::Execute() {
+  if (!device_ || !device_->BeginTransaction()) {
+    if (device_)
+      device_->EndTransaction();
+    return false;
+  }
+  bool ok = true;
+  for (const Access& access : accesses_) {
+    if (access.mode == Address::Mode::WRITE) {
+      ok = device_->Write(access.reg, access.write_data.data(),
+                          access.write_data.size());
+    } else {
+      ok = device_->Read(access.reg, access.read_data, access.read_len);
+    }
+    if (!ok)
+      break;
+  }
+  device_->EndTransaction();
+  accesses_.clear();
+  return ok;
+}
+
+Operation Master::CreateReadOp(uint8_t /*slave_addr*/,
+                               Address::Size /*addr_size*/,
+                               uint8_t reg,
+                               const char* /*op_name*/) {
+  return Operation(device_, reg, Address::Mode::READ);
+}
+
+Operation Master::CreateWriteOp(uint8_t /*slave_addr*/,
+                                Address::Size /*addr_size*/,
+                                uint8_t reg,
+                                const char* /*op_name*/) {
+  return Operation(device_, reg, Address::Mode::WRITE);
+}
+
+bool Master::ReadRegister(uint8_t slave_addr,
+                          Address::Size addr_size,
+                          uint8_t reg,
+                          uint8_t* value) {
+  Operation op = CreateReadOp(slave_addr, addr_size, reg, "read-reg");
+  return op.Read(value, 1) && op.Execute();
+}
+
+bool Master::WriteRegister(uint8_t slave_addr,
+                           Address::Size addr_size,
+                           uint8_t reg,
+                           uint8_t value) {
+  Operation op = CreateWriteOp(slave_addr, addr_size, reg, "write-reg");
+  return op.WriteByte(value) && op.Execute();
+}
+
+}  // namespace i2c
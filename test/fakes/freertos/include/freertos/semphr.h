@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS semphr.h, mutexes only.
+
+#include <freertos/include/freertos/FreeRTOS.h>
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
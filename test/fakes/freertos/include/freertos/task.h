@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS task.h used by ESP-IDF. vTaskDelay()
+// advances the fake clock rather than sleeping.
+
+#include <freertos/include/freertos/FreeRTOS.h>
+
+void vTaskDelay(TickType_t ticks);
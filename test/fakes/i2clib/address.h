@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for i2clib's address.h.
+
+namespace i2c {
+
+class Address {
+ public:
+  enum class Size { bit7, bit10 };
+  enum class Mode { READ, WRITE };
+};
+
+}  // namespace i2c
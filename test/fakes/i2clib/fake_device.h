@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace i2c {
+
+/**
+ * A device on the fake I2C bus behind the host i2c::Master.
+ *
+ * Each Master operation is a single bus transaction, made of one or more
+ * register accesses, and is counted by the device.
+ */
+class FakeDevice {
+ public:
+  virtual ~FakeDevice() = default;
+
+  /**
+   * Called at the start of each transaction.
+   *
+   * @return false to fail the transaction (as a NACK would).
+   */
+  virtual bool BeginTransaction() {
+    num_transactions_++;
+    return true;
+  }
+
+  /**
+   * Called at the end of each transaction, successful or not.
+   */
+  virtual void EndTransaction() {}
+
+  /**
+   * Read |len| auto-incrementing registers starting at |reg|.
+   */
+  virtual bool Read(uint8_t reg, uint8_t* data, size_t len) = 0;
+
+  /**
+   * Write |len| auto-incrementing registers starting at |reg|.
+   */
+  virtual bool Write(uint8_t reg, const uint8_t* data, size_t len) = 0;
+
+  uint32_t num_transactions() const { return num_transactions_; }
+
+ private:
+  uint32_t num_transactions_ = 0;
+};
+
+}  // namespace i2c
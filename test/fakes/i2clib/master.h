@@ -0,0 +1,42 @@
+#pragma once
+
+// Host stand-in for i2clib's master.h. Every operation goes to a single
+// FakeDevice, whatever the slave address.
+
+#include <cstdint>
+
+#include <driver/i2c.h>
+#include <i2clib/address.h>
+#include <i2clib/operation.h>
+
+namespace i2c {
+
+class FakeDevice;
+
+class Master {
+ public:
+  explicit Master(FakeDevice* device) : device_(device) {}
+
+  Operation CreateReadOp(uint8_t slave_addr,
+                         Address::Size addr_size,
+                         uint8_t reg,
+                         const char* op_name);
+  Operation CreateWriteOp(uint8_t slave_addr,
+                          Address::Size addr_size,
+                          uint8_t reg,
+                          const char* op_name);
+
+  bool ReadRegister(uint8_t slave_addr,
+                    Address::Size addr_size,
+                    uint8_t reg,
+                    uint8_t* value);
+  bool WriteRegister(uint8_t slave_addr,
+                     Address::Size addr_size,
+                     uint8_t reg,
+                     uint8_t value);
+
+ private:
+  FakeDevice* device_;
+};
+
+}  // namespace i2c
@@ -0,0 +1,56 @@
+#pragma once
+
+// Host stand-in for i2clib's operation.h, which performs the operation on a
+// FakeDevice.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <i2clib/address.h>
+
+namespace i2c {
+
+class FakeDevice;
+
+class Operation {
+ public:
+  Operation() = default;
+  Operation(FakeDevice* device, uint8_t reg, Address::Mode mode);
+
+  Operation(Operation&&) = default;
+  Operation& operator=(Operation&&) = default;
+
+  bool ready() const { return device_ != nullptr; }
+
+  /**
+   * Start a new register access at |reg|.
+   */
+  bool RestartReg(uint8_t reg, Address::Mode mode);
+
+  bool WriteByte(uint8_t value);
+
+  /**
+   * Read |len| bytes into |data| when the operation is executed.
+   */
+  bool Read(void* data, size_t len);
+
+  /**
+   * Perform all accesses in a single transaction.
+   */
+  bool Execute();
+
+ private:
+  struct Access {
+    uint8_t reg;
+    Address::Mode mode;
+    std::vector<uint8_t> write_data;
+    uint8_t* read_data;
+    size_t read_len;
+  };
+
+  FakeDevice* device_ = nullptr;
+  std::vector<Access> accesses_;
+};
+
+}  // namespace i2c
@@ -0,0 +1,40 @@
+#pragma once
+
+// Host stand-in for cJSON (see fake_cjson.cc), as used by TokenStore: flat
+// objects of strings and numbers. Nested objects and arrays fail to parse.
+
+#include <cstddef>
+
+#define cJSON_Invalid 0
+#define cJSON_False (1 << 0)
+#define cJSON_True (1 << 1)
+#define cJSON_NULL (1 << 2)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array (1 << 5)
+#define cJSON_Object (1 << 6)
+
+typedef struct cJSON {
+  struct cJSON* next;
+  struct cJSON* prev;
+  struct cJSON* child;
+  int type;
+  char* valuestring;
+  int valueint;
+  double valuedouble;
+  char* string;
+} cJSON;
+
+cJSON* cJSON_CreateObject();
+cJSON* cJSON_AddStringToObject(cJSON* object,
+                               const char* name,
+                               const char* string);
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number);
+char* cJSON_PrintUnformatted(const cJSON* item);
+cJSON* cJSON_Parse(const char* value);
+cJSON* cJSON_GetObjectItemCaseSensitive(const cJSON* object,
+                                        const char* string);
+int cJSON_IsString(const cJSON* item);
+int cJSON_IsNumber(const cJSON* item);
+void cJSON_Delete(cJSON* item);
+void cJSON_free(void* object);
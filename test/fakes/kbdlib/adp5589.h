@@ -0,0 +1,178 @@
+#pragma once
+
+// Host stand-in for kbdlib's adp5589.h, with the ADP5589 registers used by
+// Keyboard. Each register struct converts to its register value.
+
+#include <cstdint>
+
+namespace kbd {
+namespace adp5589 {
+
+enum class RegNum : uint8_t {
+  ID = 0x00,
+  INT_STATUS = 0x01,
+  Status = 0x02,
+  FIFO_1 = 0x03,
+  FIFO_16 = 0x12,
+  RPULL_CONFIG_A = 0x19,
+  RPULL_CONFIG_B = 0x1A,
+  RPULL_CONFIG_C = 0x1B,
+  RPULL_CONFIG_D = 0x1C,
+  RPULL_CONFIG_E = 0x1D,
+  DEBOUNCE_DIS_A = 0x27,
+  DEBOUNCE_DIS_B = 0x28,
+  DEBOUNCE_DIS_C = 0x29,
+  CLOCK_DIV_CFG = 0x43,
+  LOGIC_1_CFG = 0x44,
+  LOGIC_2_CFG = 0x45,
+  LOGIC_FF_CFG = 0x46,
+  LOGIC_INT_EVENT_EN = 0x47,
+  POLL_TIME_CFG = 0x48,
+  PIN_CONFIG_A = 0x49,
+  PIN_CONFIG_B = 0x4A,
+  PIN_CONFIG_C = 0x4B,
+  PIN_CONFIG_D = 0x4C,
+  GENERAL_CFG_B = 0x4D,
+  INT_EN = 0x4E,
+};
+
+enum class EventID : uint8_t {
+  NONE = 0,
+};
+
+enum class CoreFrequency : uint8_t {
+  kHz50 = 0,
+  kHz100 = 1,
+  kHz200 = 2,
+  kHz500 = 3,
+};
+
+inline const char* EventToName(EventID) {
+  return "";
+}
+
+namespace reg {
+
+struct ID {
+  uint8_t MAN;
+  uint8_t REV;
+};
+
+struct INT_STATUS {
+  bool LOGIC2_INT;
+  bool LOGIC1_INT;
+  bool LOCK_INT;
+  bool OVRFLOW_INT;
+  bool GPI_INT;
+  bool EVENT_INT;
+
+  constexpr operator uint8_t() const {
+    return LOGIC2_INT << 5 | LOGIC1_INT << 4 | LOCK_INT << 3 |
+           OVRFLOW_INT << 2 | GPI_INT << 1 | EVENT_INT;
+  }
+};
+
+struct Status {
+  bool LOGIC2_STAT;
+  bool LOGIC1_STAT;
+  bool LOCK_STAT;
+  uint8_t EC;
+};
+
+struct FIFO {
+  bool Event_State;
+  EventID IDENTIFIER;
+};
+
+struct GENERAL_CFG_B {
+  bool OSC_EN;
+  CoreFrequency CORE_FREQ;
+  uint8_t LCK_TRK_LOGIC;
+  uint8_t LCK_TRK_GPI;
+  uint8_t Unused;
+  uint8_t INT_CFG;
+  uint8_t RST_CFG;
+
+  constexpr operator uint8_t() const {
+    return OSC_EN << 7 | static_cast<uint8_t>(CORE_FREQ) << 5 |
+           LCK_TRK_LOGIC << 4 | LCK_TRK_GPI << 3 | INT_CFG << 1 | RST_CFG;
+  }
+};
+
+struct INT_EN {
+  uint8_t Reserved;
+  bool LOGIC2_IEN;
+  bool LOGIC1_IEN;
+  bool LOCK_IEN;
+  bool OVRFLOW_IEN;
+  bool GPI_IEN;
+  bool EVENT_IEN;
+
+  constexpr operator uint8_t() const {
+    return LOGIC2_IEN << 5 | LOGIC1_IEN << 4 | LOCK_IEN << 3 |
+           OVRFLOW_IEN << 2 | GPI_IEN << 1 | EVENT_IEN;
+  }
+};
+
+struct PIN_CONFIG_A {
+  bool R7_CONFIG;
+  bool R6_CONFIG;
+  bool R5_CONFIG;
+  bool R4_CONFIG;
+  bool R3_CONFIG;
+  bool R2_CONFIG;
+  bool R1_CONFIG;
+  bool R0_CONFIG;
+
+  constexpr operator uint8_t() const {
+    return R7_CONFIG << 7 | R6_CONFIG << 6 | R5_CONFIG << 5 | R4_CONFIG << 4 |
+           R3_CONFIG << 3 | R2_CONFIG << 2 | R1_CONFIG << 1 | R0_CONFIG;
+  }
+};
+
+struct PIN_CONFIG_B {
+  bool C7_CONFIG;
+  bool C6_CONFIG;
+  bool C5_CONFIG;
+  bool C4_CONFIG;
+  bool C3_CONFIG;
+  bool C2_CONFIG;
+  bool C1_CONFIG;
+  bool C0_CONFIG;
+
+  constexpr operator uint8_t() const {
+    return C7_CONFIG << 7 | C6_CONFIG << 6 | C5_CONFIG << 5 | C4_CONFIG << 4 |
+           C3_CONFIG << 3 | C2_CONFIG << 2 | C1_CONFIG << 1 | C0_CONFIG;
+  }
+};
+
+struct PIN_CONFIG_C {
+  uint8_t Reserved;
+  bool C10_CONFIG;
+  bool C9_CONFIG;
+  bool C8_CONFIG;
+
+  constexpr operator uint8_t() const {
+    return C10_CONFIG << 2 | C9_CONFIG << 1 | C8_CONFIG;
+  }
+};
+
+struct PIN_CONFIG_D {
+  bool PULL_SELECT;
+  bool C4_EXTEND_CFG;
+  bool R4_EXTEND_CFG;
+  bool C6_EXTEND_CFG;
+  bool R3_EXTEND_CFG;
+  bool C9_EXTEND_CFG;
+  bool R0_EXTEND_CFG;
+
+  constexpr operator uint8_t() const {
+    return PULL_SELECT << 7 | C4_EXTEND_CFG << 6 | R4_EXTEND_CFG << 5 |
+           C6_EXTEND_CFG << 4 | R3_EXTEND_CFG << 3 | C9_EXTEND_CFG << 2 |
+           R0_EXTEND_CFG;
+  }
+};
+
+}  // namespace reg
+}  // namespace adp5589
+}  // namespace kbd
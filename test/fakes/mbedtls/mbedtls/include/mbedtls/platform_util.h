@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for the mbedtls platform_util.h.
+
+#include <cstddef>
+
+void mbedtls_platform_zeroize(void* buf, size_t len);
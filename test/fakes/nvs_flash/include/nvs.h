@@ -0,0 +1,37 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF nvs.h: an in-memory store of blobs (see
+// fake_nvs.h). Only the functions TokenStore uses are provided.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <esp_err.h>
+
+#define ESP_ERR_NVS_BASE 0x1100
+#define ESP_ERR_NVS_NOT_FOUND (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_READ_ONLY (ESP_ERR_NVS_BASE + 0x04)
+#define ESP_ERR_NVS_INVALID_HANDLE (ESP_ERR_NVS_BASE + 0x07)
+#define ESP_ERR_NVS_INVALID_LENGTH (ESP_ERR_NVS_BASE + 0x0c)
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+  NVS_READONLY,
+  NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char* name,
+                   nvs_open_mode_t open_mode,
+                   nvs_handle_t* out_handle);
+esp_err_t nvs_get_blob(nvs_handle_t handle,
+                       const char* key,
+                       void* out_value,
+                       size_t* length);
+esp_err_t nvs_set_blob(nvs_handle_t handle,
+                       const char* key,
+                       const void* value,
+                       size_t length);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for TinyUSB's tusb.h, with the vendor class functions used
+// by HostChannel. The endpoints are a loopback driven by tests, see
+// fake_usb_vendor.h.
+
+#include <cstdint>
+
+#include <device/usbd.h>
+
+uint32_t tud_vendor_available();
+uint32_t tud_vendor_read(void* buffer, uint32_t bufsize);
+uint32_t tud_vendor_write(const void* buffer, uint32_t bufsize);
+
+// Implemented by the code under test, invoked for each OUT packet.
+extern "C" void tud_vendor_rx_cb(uint8_t itf);
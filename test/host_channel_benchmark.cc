@@ -0,0 +1,77 @@
+// Measures the host cost of receiving album artwork over the HostChannel,
+// sent in full speed bulk packets through the fake vendor endpoints.
+//
+//   host_channel_benchmark [iterations]
+//
+// Every frame must reach the client intact and be acked, or the benchmark
+// fails. This is the rate HostChannel could read on the host CPU, not the
+// USB bus: a full speed bulk endpoint moves at most 19 64 byte packets per
+// 1 ms frame (1188 KB/s), and the ESP32-S2 is not benchmarked here.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "fake_usb_vendor.h"
+#include "now_playing_messages.h"
+#include "usb_host_channel.h"
+
+namespace {
+
+// The display's album artwork size (kAlbumArtworkWidth/Height).
+constexpr uint16_t kArtworkWidth = 130;
+constexpr uint16_t kArtworkHeight = 130;
+
+// The most full speed bulk bytes per second.
+constexpr double kFullSpeedBulkBytesPerSec = 19 * 64 * 1000;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+  if (!iterations) {
+    fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const std::vector<uint8_t> payload =
+      ArtworkPayload(kArtworkWidth, kArtworkHeight);
+  const std::vector<uint8_t> message =
+      NowPlayingMessage(usb::HostChannel::MessageType::Artwork, payload);
+  RecordingNowPlayingClient client;
+  usb::HostChannel::Enable(&client);
+
+  size_t num_acks = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    FakeUSBVendor::HostWrite(message.data(), message.size());
+    num_acks +=
+        FakeUSBVendor::HostRead().size() / sizeof(usb::HostChannel::Ack);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  const double secs = std::chrono::duration<double>(elapsed).count();
+
+  bool ok = num_acks == iterations && client.artworks.size() == iterations;
+  for (const RecordingNowPlayingClient::Artwork& artwork : client.artworks) {
+    ok = ok && artwork.width == kArtworkWidth &&
+         artwork.height == kArtworkHeight &&
+         artwork.pixels.size() + 4 == payload.size() &&
+         !std::memcmp(artwork.pixels.data(), payload.data() + 4,
+                      artwork.pixels.size());
+  }
+
+  const double bytes_per_sec = message.size() * iterations / secs;
+  printf("%zu %ux%u artwork frames of %zu bytes in %zu byte packets.\n",
+         iterations, kArtworkWidth, kArtworkHeight, message.size(),
+         FakeUSBVendor::kMaxPacketSize);
+  printf("Host loopback: %.0f KB/s, %.1f usec per frame.\n",
+         bytes_per_sec / 1024, secs * 1e6 / iterations);
+  printf("Full speed bulk limit: %.0f KB/s, %.1f msec per frame.\n",
+         kFullSpeedBulkBytesPerSec / 1024,
+         message.size() * 1000 / kFullSpeedBulkBytesPerSec);
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,248 @@
+#include "usb_host_channel.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "fake_clock.h"
+#include "fake_usb_vendor.h"
+#include "now_playing_messages.h"
+
+namespace usb {
+namespace {
+
+using MessageType = HostChannel::MessageType;
+
+class HostChannelTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FakeUSBVendor::Reset();
+    FakeClock::Set(0);
+    HostChannel::Reset();
+    HostChannel::Enable(&client_);
+  }
+
+  void TearDown() override {
+    HostChannel::Enable(nullptr);
+    HostChannel::Reset();
+  }
+
+  static void Send(const std::vector<uint8_t>& message,
+                   size_t packet_size = FakeUSBVendor::kMaxPacketSize) {
+    FakeUSBVendor::HostWrite(message.data(), message.size(), packet_size);
+  }
+
+  static std::vector<HostChannel::Ack> ReadAcks() {
+    const std::vector<uint8_t> data = FakeUSBVendor::HostRead();
+    EXPECT_EQ(0u, data.size() % sizeof(HostChannel::Ack));
+    std::vector<HostChannel::Ack> acks(data.size() /
+                                       sizeof(HostChannel::Ack));
+    std::memcpy(acks.data(), data.data(),
+                acks.size() * sizeof(HostChannel::Ack));
+    return acks;
+  }
+
+  static void ExpectAck(MessageType type, esp_err_t err) {
+    const std::vector<HostChannel::Ack> acks = ReadAcks();
+    ASSERT_EQ(1u, acks.size());
+    EXPECT_EQ(type, acks[0].type);
+    EXPECT_EQ(err, acks[0].err);
+  }
+
+  void ExpectTrack(const char* artist, const char* album, const char* title) {
+    ASSERT_EQ(1u, client_.tracks.size());
+    EXPECT_EQ(artist, client_.tracks[0].artist);
+    EXPECT_EQ(album, client_.tracks[0].album);
+    EXPECT_EQ(title, client_.tracks[0].title);
+    client_.tracks.clear();
+  }
+
+  RecordingNowPlayingClient client_;
+};
+
+TEST_F(HostChannelTest, Track) {
+  Send(NowPlayingMessage(MessageType::Track,
+                         TrackPayload("Artist", "Album", "Title")));
+  ExpectTrack("Artist", "Album", "Title");
+  ExpectAck(MessageType::Track, ESP_OK);
+  EXPECT_EQ(0u, FakeUSBVendor::num_unread());
+}
+
+TEST_F(HostChannelTest, EmptyFields) {
+  Send(NowPlayingMessage(MessageType::Track, TrackPayload("", "", "")));
+  ExpectTrack("", "", "");
+  ExpectAck(MessageType::Track, ESP_OK);
+}
+
+// A message split at every byte, so the header is read in pieces.
+TEST_F(HostChannelTest, SplitTrack) {
+  Send(NowPlayingMessage(MessageType::Track,
+                         TrackPayload("Artist", "Album", "Title")),
+       /*packet_size=*/1);
+  ExpectTrack("Artist", "Album", "Title");
+  ExpectAck(MessageType::Track, ESP_OK);
+}
+
+TEST_F(HostChannelTest, TrackMissingNul) {
+  std::vector<uint8_t> payload = TrackPayload("Artist", "Album", "Title");
+  payload.pop_back();
+  Send(NowPlayingMessage(MessageType::Track, payload));
+  EXPECT_TRUE(client_.tracks.empty());
+  ExpectAck(MessageType::Track, ESP_ERR_INVALID_ARG);
+}
+
+TEST_F(HostChannelTest, Artwork) {
+  Send(NowPlayingMessage(MessageType::Artwork, ArtworkPayload(16, 8)));
+  ASSERT_EQ(1u, client_.artworks.size());
+  const RecordingNowPlayingClient::Artwork& artwork = client_.artworks[0];
+  EXPECT_EQ(16, artwork.width);
+  EXPECT_EQ(8, artwork.height);
+  // The pixels as sent, without the size.
+  const std::vector<uint8_t> payload = ArtworkPayload(16, 8);
+  EXPECT_EQ(std::vector<uint8_t>(payload.begin() + 4, payload.end()),
+            artwork.pixels);
+  ExpectAck(MessageType::Artwork, ESP_OK);
+}
+
+// Packets not aligned with the header, size, or pixels.
+TEST_F(HostChannelTest, SplitArtwork) {
+  for (size_t packet_size : {1, 3, 7, 10, 63}) {
+    SCOPED_TRACE(packet_size);
+    client_.artworks.clear();
+    Send(NowPlayingMessage(MessageType::Artwork, ArtworkPayload(5, 3)),
+         packet_size);
+    ASSERT_EQ(1u, client_.artworks.size());
+    EXPECT_EQ(5, client_.artworks[0].width);
+    EXPECT_EQ(3, client_.artworks[0].height);
+    EXPECT_EQ(0x0e, client_.artworks[0].pixels.back());
+    ExpectAck(MessageType::Artwork, ESP_OK);
+  }
+}
+
+TEST_F(HostChannelTest, ArtworkRejectedByClient) {
+  client_.set_artwork_err(ESP_ERR_INVALID_SIZE);
+  Send(NowPlayingMessage(MessageType::Artwork, ArtworkPayload(2, 2)));
+  EXPECT_EQ(1u, client_.artworks.size());
+  ExpectAck(MessageType::Artwork, ESP_ERR_INVALID_SIZE);
+}
+
+TEST_F(HostChannelTest, ArtworkSizeMismatch) {
+  std::vector<uint8_t> payload = ArtworkPayload(4, 4);
+  payload.push_back(0);
+  Send(NowPlayingMessage(MessageType::Artwork, payload));
+  EXPECT_TRUE(client_.artworks.empty());
+  ExpectAck(MessageType::Artwork, ESP_ERR_INVALID_SIZE);
+
+  // Too short for the width and height.
+  Send(NowPlayingMessage(MessageType::Artwork, {1, 0, 1}));
+  EXPECT_TRUE(client_.artworks.empty());
+  ExpectAck(MessageType::Artwork, ESP_ERR_INVALID_SIZE);
+}
+
+// Several messages in one write are each handled.
+TEST_F(HostChannelTest, Consecutive) {
+  std::vector<uint8_t> data =
+      NowPlayingMessage(MessageType::Track, TrackPayload("A", "B", "C"));
+  const std::vector<uint8_t> artwork =
+      NowPlayingMessage(MessageType::Artwork, ArtworkPayload(3, 3));
+  data.insert(data.end(), artwork.begin(), artwork.end());
+  data.insert(data.end(), artwork.begin(), artwork.end());
+  Send(data);
+  ExpectTrack("A", "B", "C");
+  EXPECT_EQ(2u, client_.artworks.size());
+  const std::vector<HostChannel::Ack> acks = ReadAcks();
+  ASSERT_EQ(3u, acks.size());
+  EXPECT_EQ(MessageType::Track, acks[0].type);
+  EXPECT_EQ(MessageType::Artwork, acks[1].type);
+  EXPECT_EQ(MessageType::Artwork, acks[2].type);
+}
+
+// Everything received with an invalid header is dropped, and the next
+// message is read from its start.
+TEST_F(HostChannelTest, InvalidHeader) {
+  std::vector<uint8_t> data = NowPlayingMessage(
+      MessageType::Track, TrackPayload("A", "B", "C"), /*magic=*/"XX");
+  const std::vector<uint8_t> track =
+      NowPlayingMessage(MessageType::Track, TrackPayload("D", "E", "F"));
+  data.insert(data.end(), track.begin(), track.end());
+  Send(data);
+  EXPECT_TRUE(client_.tracks.empty());
+  ExpectAck(MessageType::Track, ESP_ERR_INVALID_STATE);
+  EXPECT_EQ(0u, FakeUSBVendor::num_unread());
+
+  Send(track, /*packet_size=*/5);
+  ExpectTrack("D", "E", "F");
+  ExpectAck(MessageType::Track, ESP_OK);
+}
+
+// An oversize payload is skipped, and only then acked.
+TEST_F(HostChannelTest, Oversize) {
+  const std::vector<uint8_t> message = NowPlayingMessage(
+      MessageType::Track,
+      std::vector<uint8_t>(HostChannel::kMaxPayload + 1, 'a'));
+  Send(std::vector<uint8_t>(message.begin(), message.end() - 1));
+  EXPECT_TRUE(ReadAcks().empty());
+  Send(std::vector<uint8_t>(message.end() - 1, message.end()));
+  EXPECT_TRUE(client_.tracks.empty());
+  ExpectAck(MessageType::Track, ESP_ERR_INVALID_SIZE);
+
+  Send(NowPlayingMessage(MessageType::Track, TrackPayload("A", "B", "C")));
+  ExpectTrack("A", "B", "C");
+  ExpectAck(MessageType::Track, ESP_OK);
+}
+
+TEST_F(HostChannelTest, MaxPayload) {
+  std::vector<uint8_t> payload = TrackPayload("", "", "");
+  payload.resize(HostChannel::kMaxPayload, 'a');
+  Send(NowPlayingMessage(MessageType::Track, payload));
+  ExpectTrack("", "", "");
+  ExpectAck(MessageType::Track, ESP_OK);
+}
+
+TEST_F(HostChannelTest, UnknownType) {
+  Send(NowPlayingMessage(static_cast<MessageType>(9), {1, 2, 3, 4, 5}));
+  ExpectAck(static_cast<MessageType>(9), ESP_ERR_NOT_SUPPORTED);
+
+  Send(NowPlayingMessage(MessageType::Track, TrackPayload("A", "B", "C")));
+  ExpectTrack("A", "B", "C");
+  ExpectAck(MessageType::Track, ESP_OK);
+}
+
+// The ack has the time from the end of the header to the last byte.
+TEST_F(HostChannelTest, ReceiveTime) {
+  const std::vector<uint8_t> message =
+      NowPlayingMessage(MessageType::Artwork, ArtworkPayload(8, 8));
+  const size_t header_len = sizeof(HostChannel::MessageHeader);
+  FakeClock::Set(1000);
+  Send(std::vector<uint8_t>(message.begin(), message.begin() + header_len));
+  FakeClock::Advance(2500);
+  Send(std::vector<uint8_t>(message.begin() + header_len, message.end()));
+  const std::vector<HostChannel::Ack> acks = ReadAcks();
+  ASSERT_EQ(1u, acks.size());
+  EXPECT_EQ(ESP_OK, acks[0].err);
+  EXPECT_EQ(2500u, acks[0].receive_usec);
+}
+
+// Reset() drops a partial message, as when the host goes away.
+TEST_F(HostChannelTest, Reset) {
+  const std::vector<uint8_t> message =
+      NowPlayingMessage(MessageType::Artwork, ArtworkPayload(8, 8));
+  Send(std::vector<uint8_t>(message.begin(), message.begin() + 20));
+  HostChannel::Reset();
+  Send(NowPlayingMessage(MessageType::Track, TrackPayload("A", "B", "C")));
+  EXPECT_TRUE(client_.artworks.empty());
+  ExpectTrack("A", "B", "C");
+  ExpectAck(MessageType::Track, ESP_OK);
+}
+
+TEST_F(HostChannelTest, Disabled) {
+  HostChannel::Enable(nullptr);
+  EXPECT_FALSE(HostChannel::enabled());
+  Send(NowPlayingMessage(MessageType::Track, TrackPayload("A", "B", "C")));
+  EXPECT_TRUE(client_.tracks.empty());
+  EXPECT_TRUE(ReadAcks().empty());
+}
+
+}  // namespace
+}  // namespace usb
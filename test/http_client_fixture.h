@@ -0,0 +1,59 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "fake_clock.h"
+#include "fake_http_server.h"
+#include "http_client.h"
+
+constexpr char kAPI[] = "https://api.example.com";
+constexpr char kAccounts[] = "https://accounts.example.com";
+constexpr char kArtwork[] = "http://i.example.com:8080";
+constexpr char kOther[] = "https://other.example.com";
+
+/**
+ * Starts each test with an empty HTTPClient pool, a new FakeHTTPServer
+ * returning an empty JSON object, and the fake clock at one second.
+ */
+class HTTPClientFixture : public ::testing::Test {
+ protected:
+  using Failure = FakeHTTPServer::Failure;
+
+  void SetUp() override {
+    HTTPClient::ResetPoolForTesting();
+    FakeHTTPServer::Reset();
+    FakeClock::Set(1000 * 1000);
+    FakeHTTPServer::Response response;
+    response.headers = {{"Content-Type", "application/json"}};
+    response.body = "{}";
+    FakeHTTPServer::SetResponse(response);
+  }
+
+  void TearDown() override { HTTPClient::ResetPoolForTesting(); }
+
+  esp_err_t Get(HTTPClient* client,
+                const std::string& url,
+                const std::vector<HTTPClient::HeaderValue>& headers = {}) {
+    body_.clear();
+    return client->DoGET(
+        url, headers,
+        [this](const void* data, int len) {
+          body_.append(static_cast<const char*>(data), len);
+          return ESP_OK;
+        },
+        &status_code_);
+  }
+
+  esp_err_t Get(const std::string& url) { return Get(&client_, url); }
+
+  const FakeHTTPServer::Request& last_request() const {
+    return FakeHTTPServer::requests().back();
+  }
+
+  HTTPClient client_;
+  std::string body_;
+  int status_code_ = 0;
+};
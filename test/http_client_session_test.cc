@@ -0,0 +1,91 @@
+#include "http_client_fixture.h"
+
+#include <string>
+
+// Built as ESP-IDF 4.4 with CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS, so
+// HTTPClient keeps TLS sessions.
+
+namespace {
+
+using HTTPClientSessionTest = HTTPClientFixture;
+
+TEST_F(HTTPClientSessionTest, FirstConnectOffersNoSession) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  EXPECT_FALSE(last_request().offered_session);
+  EXPECT_FALSE(client_.timing().resumed);
+}
+
+// Idle connections are closed to free their TLS buffers, but the handle and
+// its session are kept to resume.
+TEST_F(HTTPClientSessionTest, ResumesAfterIdleClose) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  FakeClock::Advance(HTTPClient::kIdleTimeoutUsec + 1);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAccounts) + "/a"));
+  EXPECT_EQ(1u, FakeHTTPServer::num_open_connections());
+  EXPECT_EQ(0u, FakeHTTPServer::num_cleanups());
+
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_TRUE(last_request().new_connection);
+  EXPECT_TRUE(last_request().offered_session);
+  EXPECT_TRUE(client_.timing().resumed);
+  EXPECT_EQ(FakeHTTPServer::kResumedConnectUsec, client_.timing().connect_us);
+  EXPECT_EQ(2u, FakeHTTPServer::num_inits());
+}
+
+TEST_F(HTTPClientSessionTest, CloseIdleConnectionsKeepsSession) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  HTTPClient::CloseIdleConnections(/*min_idle_us=*/0);
+  EXPECT_EQ(0u, FakeHTTPServer::num_open_connections());
+  EXPECT_EQ(0u, FakeHTTPServer::num_cleanups());
+
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_TRUE(last_request().offered_session);
+  EXPECT_TRUE(client_.timing().resumed);
+}
+
+TEST_F(HTTPClientSessionTest, FailedRequestKeepsSession) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  FakeHTTPServer::FailNextRequest(Failure::AfterHeaders);
+  EXPECT_NE(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_EQ(0u, FakeHTTPServer::num_cleanups());
+
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/c"));
+  EXPECT_TRUE(last_request().offered_session);
+  EXPECT_EQ(1u, FakeHTTPServer::num_inits());
+}
+
+TEST_F(HTTPClientSessionTest, StaleRetryResumes) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  FakeHTTPServer::CloseIdleConnections();
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_EQ(1, client_.timing().retries);
+  EXPECT_TRUE(client_.timing().resumed);
+  EXPECT_TRUE(last_request().offered_session);
+}
+
+// Only TLS connections have a session worth keeping the handle for.
+TEST_F(HTTPClientSessionTest, PlainHTTPHandleNotKept) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kArtwork) + "/a.jpg"));
+  FakeClock::Advance(HTTPClient::kIdleTimeoutUsec + 1);
+  ASSERT_EQ(ESP_OK, Get(std::string(kArtwork) + "/b.jpg"));
+  EXPECT_EQ(1u, FakeHTTPServer::num_cleanups());
+  EXPECT_FALSE(last_request().offered_session);
+}
+
+TEST_F(HTTPClientSessionTest, EvictionDropsSession) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  FakeClock::Advance(1000);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAccounts) + "/a"));
+  FakeClock::Advance(1000);
+  ASSERT_EQ(ESP_OK, Get(std::string(kArtwork) + "/a"));
+  FakeClock::Advance(1000);
+  ASSERT_EQ(ESP_OK, Get(std::string(kOther) + "/a"));  // Evicts kAPI.
+  EXPECT_EQ(1u, FakeHTTPServer::num_cleanups());
+
+  FakeClock::Advance(1000);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_TRUE(last_request().new_connection);
+  EXPECT_FALSE(last_request().offered_session);
+}
+
+}  // namespace
@@ -0,0 +1,239 @@
+#include "http_client_fixture.h"
+
+#include <functional>
+#include <string>
+
+namespace {
+
+using HTTPClientTest = HTTPClientFixture;
+
+TEST_F(HTTPClientTest, ReusesConnection) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/v1/a"));
+  EXPECT_FALSE(client_.timing().reused);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/v1/b?q=1"));
+  EXPECT_TRUE(client_.timing().reused);
+  EXPECT_EQ(0, client_.timing().connect_us);
+  EXPECT_EQ(200, status_code_);
+  EXPECT_EQ("{}", body_);
+
+  ASSERT_EQ(2u, FakeHTTPServer::requests().size());
+  EXPECT_FALSE(FakeHTTPServer::requests()[1].new_connection);
+  EXPECT_EQ(std::string(kAPI) + "/v1/b?q=1", FakeHTTPServer::requests()[1].url);
+  EXPECT_EQ(1u, FakeHTTPServer::num_connects());
+  EXPECT_EQ(1u, FakeHTTPServer::num_inits());
+}
+
+TEST_F(HTTPClientTest, PoolSharedByClients) {
+  HTTPClient other;
+  ASSERT_EQ(ESP_OK, Get(&client_, std::string(kAPI) + "/a"));
+  ASSERT_EQ(ESP_OK, Get(&other, std::string(kAPI) + "/b"));
+  EXPECT_TRUE(other.timing().reused);
+  EXPECT_EQ(1u, FakeHTTPServer::num_connects());
+}
+
+TEST_F(HTTPClientTest, ConnectionPerOrigin) {
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+    ASSERT_EQ(ESP_OK, Get(std::string(kAccounts) + "/a"));
+    ASSERT_EQ(ESP_OK, Get(std::string(kArtwork) + "/a.jpg"));
+  }
+  EXPECT_EQ(3u, FakeHTTPServer::num_connects());
+  EXPECT_EQ(3u, FakeHTTPServer::num_open_connections());
+  EXPECT_EQ(0u, FakeHTTPServer::num_cleanups());
+}
+
+TEST_F(HTTPClientTest, EvictsLeastRecentlyUsed) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  FakeClock::Advance(1000);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAccounts) + "/a"));
+  FakeClock::Advance(1000);
+  ASSERT_EQ(ESP_OK, Get(std::string(kArtwork) + "/a"));
+  FakeClock::Advance(1000);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));  // kAccounts now LRU.
+  FakeClock::Advance(1000);
+
+  ASSERT_EQ(ESP_OK, Get(std::string(kOther) + "/a"));
+  EXPECT_EQ(1u, FakeHTTPServer::num_cleanups());
+  EXPECT_EQ(4u, FakeHTTPServer::num_connects());
+
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/c"));
+  EXPECT_TRUE(client_.timing().reused);
+  ASSERT_EQ(ESP_OK, Get(std::string(kArtwork) + "/c"));
+  EXPECT_TRUE(client_.timing().reused);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAccounts) + "/c"));
+  EXPECT_FALSE(client_.timing().reused);
+}
+
+TEST_F(HTTPClientTest, ClearsPreviousHeaders) {
+  ASSERT_EQ(ESP_OK, Get(&client_, std::string(kAPI) + "/a",
+                        {{"Authorization", "Bearer 1"}, {"X-Extra", "1"}}));
+  ASSERT_EQ(ESP_OK,
+            Get(&client_, std::string(kAPI) + "/b", {{"Authorization", "2"}}));
+  const auto& headers = FakeHTTPServer::requests()[1].headers;
+  ASSERT_EQ(1u, headers.size());
+  EXPECT_EQ("2", headers.at("Authorization"));
+}
+
+TEST_F(HTTPClientTest, PostThenGet) {
+  std::string body;
+  auto callback = [&body](const void* data, int len) {
+    body.append(static_cast<const char*>(data), len);
+    return ESP_OK;
+  };
+  ASSERT_EQ(ESP_OK, client_.DoPOST(std::string(kAccounts) + "/api/token",
+                                   "grant_type=refresh_token", {}, callback,
+                                   &status_code_));
+  ASSERT_EQ(ESP_OK, Get(std::string(kAccounts) + "/x"));
+
+  const auto& requests = FakeHTTPServer::requests();
+  EXPECT_EQ(HTTP_METHOD_POST, requests[0].method);
+  EXPECT_EQ("grant_type=refresh_token", requests[0].body);
+  EXPECT_EQ(HTTP_METHOD_GET, requests[1].method);
+  EXPECT_EQ("", requests[1].body);
+  EXPECT_FALSE(requests[1].new_connection);
+}
+
+TEST_F(HTTPClientTest, ClosesIdleConnections) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  FakeClock::Advance(HTTPClient::kIdleTimeoutUsec + 1);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_FALSE(client_.timing().reused);
+  EXPECT_EQ(1u, FakeHTTPServer::num_cleanups());
+  EXPECT_EQ(2u, FakeHTTPServer::num_connects());
+}
+
+// Idle connections are closed without waiting for another request.
+TEST_F(HTTPClientTest, CloseIdleConnections) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  FakeClock::Advance(1000);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAccounts) + "/a"));
+  FakeClock::Advance(HTTPClient::kIdleTimeoutUsec - 1000);
+  HTTPClient::CloseIdleConnections();
+  EXPECT_EQ(1u, FakeHTTPServer::num_cleanups());
+  EXPECT_EQ(1u, FakeHTTPServer::num_open_connections());
+
+  HTTPClient::CloseIdleConnections(/*min_idle_us=*/0);
+  EXPECT_EQ(2u, FakeHTTPServer::num_cleanups());
+  EXPECT_EQ(0u, FakeHTTPServer::num_open_connections());
+
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_FALSE(client_.timing().reused);
+}
+
+// A connection making a request is not closed.
+TEST_F(HTTPClientTest, CloseIdleConnectionsSkipsInUse) {
+  ASSERT_EQ(ESP_OK, client_.DoGET(
+                        std::string(kAPI) + "/a", {},
+                        [](const void*, int) {
+                          HTTPClient::CloseIdleConnections(0);
+                          return ESP_OK;
+                        },
+                        &status_code_));
+  EXPECT_EQ(0u, FakeHTTPServer::num_cleanups());
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_TRUE(client_.timing().reused);
+}
+
+// A connection the server closed while idle fails before any response,
+// and is retried once on a new connection.
+TEST_F(HTTPClientTest, RetriesStaleConnection) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  FakeHTTPServer::CloseIdleConnections();
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_EQ(1, client_.timing().retries);
+  EXPECT_FALSE(client_.timing().reused);
+  EXPECT_EQ("{}", body_);  // Delivered once.
+  EXPECT_EQ(2u, FakeHTTPServer::num_connects());
+  EXPECT_EQ(2u, FakeHTTPServer::requests().size());
+}
+
+// Part of the response may have been delivered, so it is not retried.
+TEST_F(HTTPClientTest, NoRetryAfterResponse) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  FakeHTTPServer::FailNextRequest(Failure::AfterHeaders);
+  EXPECT_NE(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_EQ(0, client_.timing().retries);
+  EXPECT_EQ(2u, FakeHTTPServer::requests().size());
+
+  // The failed connection is not reused.
+  EXPECT_EQ(1u, FakeHTTPServer::num_cleanups());
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/c"));
+  EXPECT_FALSE(client_.timing().reused);
+}
+
+TEST_F(HTTPClientTest, NoRetryOfNewConnection) {
+  FakeHTTPServer::FailNextRequest(Failure::Connect);
+  EXPECT_EQ(ESP_ERR_HTTP_CONNECT, Get(std::string(kAPI) + "/a"));
+  EXPECT_EQ(0, client_.timing().retries);
+  EXPECT_TRUE(FakeHTTPServer::requests().empty());
+}
+
+// When every pooled connection is busy a temporary one is used.
+TEST_F(HTTPClientTest, TemporaryConnectionWhenPoolBusy) {
+  HTTPClient clients[4];
+  const std::string urls[4] = {
+      std::string(kAPI) + "/a",
+      std::string(kAccounts) + "/a",
+      std::string(kArtwork) + "/a",
+      std::string(kAPI) + "/b",
+  };
+  int status;
+  // Each request is made while the previous ones are receiving data.
+  std::function<esp_err_t(int)> request = [&](int i) -> esp_err_t {
+    return clients[i].DoGET(
+        urls[i], {},
+        [&, i](const void*, int) {
+          return i + 1 < 4 ? request(i + 1) : ESP_OK;
+        },
+        &status);
+  };
+  ASSERT_EQ(ESP_OK, request(0));
+
+  EXPECT_FALSE(clients[3].timing().reused);
+  EXPECT_EQ(4u, FakeHTTPServer::num_connects());
+  EXPECT_EQ(1u, FakeHTTPServer::num_cleanups());  // The temporary one.
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/c"));
+  EXPECT_TRUE(client_.timing().reused);
+}
+
+TEST_F(HTTPClientTest, StatusAndRetryAfter) {
+  FakeHTTPServer::Response response;
+  response.status_code = 429;
+  response.headers = {{"retry-after", "7"}};
+  FakeHTTPServer::SetResponse(response);
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  EXPECT_EQ(429, status_code_);
+  EXPECT_EQ(7u, client_.retry_after_secs());
+
+  FakeHTTPServer::SetResponse(FakeHTTPServer::Response());
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  EXPECT_EQ(200, status_code_);
+  EXPECT_EQ(0u, client_.retry_after_secs());
+}
+
+TEST_F(HTTPClientTest, ContentType) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kArtwork) + "/image/ab67616d00001e02"));
+  EXPECT_EQ("application/json", client_.content_type());
+
+  FakeHTTPServer::SetResponse(FakeHTTPServer::Response());
+  ASSERT_EQ(ESP_OK, Get(std::string(kArtwork) + "/a"));
+  EXPECT_EQ("", client_.content_type());
+}
+
+TEST_F(HTTPClientTest, Timing) {
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/a"));
+  const HTTPClient::Timing& timing = client_.timing();
+  EXPECT_EQ(FakeHTTPServer::kConnectUsec, timing.connect_us);
+  EXPECT_EQ(FakeHTTPServer::kTTFBUsec, timing.ttfb_us);
+  EXPECT_EQ(FakeHTTPServer::kBodyUsec, timing.body_us);
+  EXPECT_EQ(FakeHTTPServer::kConnectUsec + FakeHTTPServer::kTTFBUsec +
+                FakeHTTPServer::kBodyUsec,
+            timing.total_us);
+
+  ASSERT_EQ(ESP_OK, Get(std::string(kAPI) + "/b"));
+  EXPECT_EQ(0, timing.connect_us);
+  EXPECT_EQ(FakeHTTPServer::kTTFBUsec + FakeHTTPServer::kBodyUsec,
+            timing.total_us);
+}
+
+}  // namespace
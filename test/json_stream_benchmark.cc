@@ -0,0 +1,257 @@
+// Compares parsing currently-playing responses with JSONStream and
+// CurrentlyPlayingParser, as Spotify::GetCurrentlyPlaying() does, against
+// buffering the whole response and parsing it with cJSON, as it did before.
+//
+//   json_stream_benchmark [--iterations <n>] <response.json> ...
+//
+// Responses are fed in 512 byte chunks, esp_http_client's default buffer
+// size. The heap is measured by counting the bytes allocated through the
+// global operator new, and cJSON's allocation hooks. cJSON is only compared
+// when built with CJSON_DIR (see CMakeLists.txt), otherwise the buffered
+// response alone is measured: a lower bound of the old peak heap. Fails if
+// JSONStream fails to parse a response, or finds different values to cJSON.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <string>
+
+#ifdef HAVE_CJSON
+#include <cJSON.h>
+#endif
+
+#include "currently_playing_parser.h"
+#include "json_stream.h"
+
+namespace {
+
+constexpr size_t kChunkSize = 512;
+
+// Allocations are prefixed with their size, keeping max_align_t alignment.
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+size_t g_heap_bytes = 0;
+size_t g_peak_heap_bytes = 0;
+
+void* CountingMalloc(size_t size) {
+  void* block = malloc(kHeaderSize + size);
+  if (!block)
+    return nullptr;
+  *static_cast<size_t*>(block) = size;
+  g_heap_bytes += size;
+  g_peak_heap_bytes = std::max(g_peak_heap_bytes, g_heap_bytes);
+  return static_cast<char*>(block) + kHeaderSize;
+}
+
+void CountingFree(void* ptr) {
+  if (!ptr)
+    return;
+  void* block = static_cast<char*>(ptr) - kHeaderSize;
+  g_heap_bytes -= *static_cast<size_t*>(block);
+  free(block);
+}
+
+using RequestData = CurrentlyPlayingParser::RequestData;
+
+esp_err_t ParseStream(const std::string& response, RequestData* playing) {
+  CurrentlyPlayingParser parser(playing);
+  JSONStream stream(&parser);
+  for (size_t i = 0; i < response.size(); i += kChunkSize) {
+    const size_t len = std::min(kChunkSize, response.size() - i);
+    if (stream.Feed(response.data() + i, len) != ESP_OK)
+      break;
+  }
+  return stream.Finish();
+}
+
+/**
+ * Append the response in chunks, as the old GetCurrentlyPlaying() did.
+ */
+std::string BufferResponse(const std::string& response) {
+  std::string buffer;
+  for (size_t i = 0; i < response.size(); i += kChunkSize)
+    buffer.append(response, i, kChunkSize);
+  return buffer;
+}
+
+#ifdef HAVE_CJSON
+bool operator==(const RequestData& a, const RequestData& b) {
+  return a.times.progress_ms == b.times.progress_ms &&
+         a.times.duration_ms == b.times.duration_ms &&
+         a.is_playing == b.is_playing && a.song_title == b.song_title &&
+         a.artist_name == b.artist_name &&
+         a.image.url_640 == b.image.url_640 &&
+         a.image.url_300 == b.image.url_300 && a.image.url_64 == b.image.url_64;
+}
+
+uint32_t GetNumber(const cJSON* json, const char* key) {
+  const cJSON* value = cJSON_GetObjectItem(json, key);
+  return cJSON_IsNumber(value) ? static_cast<uint32_t>(value->valuedouble) : 0;
+}
+
+std::string GetString(const cJSON* json, const char* key) {
+  const cJSON* value = cJSON_GetObjectItem(json, key);
+  return cJSON_IsString(value) ? value->valuestring : "";
+}
+
+bool ParseCJSON(const std::string& response, RequestData* playing) {
+  const std::string buffer = BufferResponse(response);
+  cJSON* json = cJSON_Parse(buffer.c_str());
+  if (!json)
+    return false;
+  playing->times.progress_ms = GetNumber(json, "progress_ms");
+  playing->is_playing = cJSON_IsTrue(cJSON_GetObjectItem(json, "is_playing"));
+  const cJSON* item = cJSON_GetObjectItem(json, "item");
+  playing->times.duration_ms = GetNumber(item, "duration_ms");
+  playing->song_title = GetString(item, "name");
+  const cJSON* artist;
+  cJSON_ArrayForEach(artist, cJSON_GetObjectItem(item, "artists")) {
+    if (!playing->artist_name.empty())
+      playing->artist_name += ", ";
+    playing->artist_name += GetString(artist, "name");
+  }
+  const cJSON* image;
+  cJSON_ArrayForEach(image, cJSON_GetObjectItem(
+                                cJSON_GetObjectItem(item, "album"), "images")) {
+    switch (GetNumber(image, "width")) {
+      case 640:
+        playing->image.url_640 = GetString(image, "url");
+        break;
+      case 300:
+        playing->image.url_300 = GetString(image, "url");
+        break;
+      case 64:
+        playing->image.url_64 = GetString(image, "url");
+        break;
+    }
+  }
+  cJSON_Delete(json);
+  return true;
+}
+#endif  // HAVE_CJSON
+
+/**
+ * Peak heap of one call of |parse|, and its mean host time over
+ * |iterations| calls.
+ */
+template <typename Parse>
+void Measure(Parse parse,
+             int iterations,
+             size_t* peak_heap_bytes,
+             double* usec) {
+  const size_t start_heap_bytes = g_heap_bytes;
+  g_peak_heap_bytes = g_heap_bytes;
+  parse();
+  *peak_heap_bytes = g_peak_heap_bytes - start_heap_bytes;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+    parse();
+  const std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  *usec = elapsed.count() / iterations;
+}
+
+bool Benchmark(const char* path, int iterations) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) {
+    fprintf(stderr, "Unable to open \"%s\".\n", path);
+    return false;
+  }
+  const std::string response((std::istreambuf_iterator<char>(f)),
+                             std::istreambuf_iterator<char>());
+  printf("%s: %zu bytes.\n", path, response.size());
+
+  RequestData stream_playing = {};
+  const esp_err_t err = ParseStream(response, &stream_playing);
+  if (err != ESP_OK) {
+    fprintf(stderr, "JSONStream error %d.\n", err);
+    return false;
+  }
+  size_t peak_heap_bytes;
+  double usec;
+  Measure(
+      [&response] {
+        RequestData playing = {};
+        ParseStream(response, &playing);
+      },
+      iterations, &peak_heap_bytes, &usec);
+  printf("  JSONStream:     %6zu bytes peak heap, %7.1f usec.\n",
+         peak_heap_bytes, usec);
+
+#ifdef HAVE_CJSON
+  RequestData cjson_playing = {};
+  if (!ParseCJSON(response, &cjson_playing)) {
+    fprintf(stderr, "cJSON failed to parse \"%s\".\n", path);
+    return false;
+  }
+  Measure(
+      [&response] {
+        RequestData playing = {};
+        ParseCJSON(response, &playing);
+      },
+      iterations, &peak_heap_bytes, &usec);
+  printf("  Buffer + cJSON: %6zu bytes peak heap, %7.1f usec.\n",
+         peak_heap_bytes, usec);
+  if (!(stream_playing == cjson_playing)) {
+    fprintf(stderr, "JSONStream and cJSON values differ.\n");
+    return false;
+  }
+#else
+  Measure([&response] { BufferResponse(response); }, iterations,
+          &peak_heap_bytes, &usec);
+  printf("  Buffer only:    %6zu bytes peak heap (cJSON not built).\n",
+         peak_heap_bytes);
+#endif
+  return true;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  void* ptr = CountingMalloc(size);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  CountingFree(ptr);
+}
+
+void operator delete(void* ptr, size_t /*size*/) noexcept {
+  CountingFree(ptr);
+}
+
+int main(int argc, char** argv) {
+  int iterations = 1000;
+  int first_path = 1;
+  if (argc > 2 && !strcmp(argv[1], "--iterations")) {
+    iterations = atoi(argv[2]);
+    first_path = 3;
+  }
+  if (first_path >= argc || iterations < 1) {
+    fprintf(stderr, "usage: %s [--iterations <n>] <response.json> ...\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+#ifdef HAVE_CJSON
+  cJSON_Hooks hooks = {CountingMalloc, CountingFree};
+  cJSON_InitHooks(&hooks);
+#endif
+
+  bool ok = true;
+  for (int i = first_path; i < argc; i++) {
+    if (!Benchmark(argv[i], iterations))
+      ok = false;
+  }
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
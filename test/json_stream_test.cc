@@ -0,0 +1,264 @@
+#include "json_stream.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Strings = std::vector<std::string>;
+
+/**
+ * Records each value as "<path>=<text>", with string values quoted, and the
+ * path of each object end.
+ */
+class RecordingClient : public JSONStreamClient {
+ public:
+  // JSONStreamClient:
+  bool WantString(const std::string& path) override {
+    return !skip_strings_ && path != skip_path_;
+  }
+
+  void OnValue(const std::string& path,
+               ValueType type,
+               const std::string& text) override {
+    if (type == ValueType::String)
+      values_.push_back(path + "=\"" + text + '"');
+    else
+      values_.push_back(path + '=' + text);
+  }
+
+  void OnObjectEnd(const std::string& path) override {
+    object_ends_.push_back(path);
+  }
+
+  bool skip_strings_ = false;
+  std::string skip_path_ = "-";
+  Strings values_;
+  Strings object_ends_;
+};
+
+/**
+ * Parse |json| in chunks of |chunk_size| bytes and return Finish().
+ */
+esp_err_t Parse(const std::string& json,
+                RecordingClient* client,
+                size_t chunk_size = std::string::npos) {
+  JSONStream stream(client);
+  for (size_t i = 0; i < json.size(); i += chunk_size) {
+    const size_t len = std::min(chunk_size, json.size() - i);
+    if (stream.Feed(json.data() + i, len) != ESP_OK)
+      break;
+  }
+  return stream.Finish();
+}
+
+/**
+ * Parse |json| and return its values.
+ */
+Strings Values(const std::string& json) {
+  RecordingClient client;
+  EXPECT_EQ(ESP_OK, Parse(json, &client)) << json;
+  return client.values_;
+}
+
+/**
+ * The single string value of |json|, as UTF-8.
+ */
+std::string StringValue(const std::string& json) {
+  const Strings values = Values(json);
+  if (values.size() != 1)
+    return "(" + std::to_string(values.size()) + " values)";
+  return values[0].substr(values[0].find('"'));
+}
+
+esp_err_t ParseError(const std::string& json) {
+  RecordingClient client;
+  return Parse(json, &client);
+}
+
+TEST(JSONStreamTest, Scalars) {
+  EXPECT_EQ(Strings({"a=1", "b=-2.5e+3", "c=true", "d=false", "e=null",
+                     "f=\"x\""}),
+            Values(R"({"a": 1, "b":-2.5e+3,"c":true,
+                       "d":false ,"e":null,"f":"x"})"));
+}
+
+TEST(JSONStreamTest, Paths) {
+  RecordingClient client;
+  ASSERT_EQ(ESP_OK,
+            Parse(R"({"a": {"b": [{"c": 1}, {"c": 2}], "d": [[3], 4]}})",
+                  &client));
+  EXPECT_EQ(Strings({"a.b[].c=1", "a.b[].c=2", "a.d[][]=3", "a.d[]=4"}),
+            client.values_);
+  EXPECT_EQ(Strings({"a.b[]", "a.b[]", "a", ""}), client.object_ends_);
+}
+
+TEST(JSONStreamTest, TopLevelArray) {
+  EXPECT_EQ(Strings({"[]=\"a\"", "[].b=1"}), Values(R"(["a", {"b": 1}])"));
+}
+
+TEST(JSONStreamTest, EmptyContainers) {
+  for (const char* json : {"{}", "[]", "{ }", "[ ]", " {\n} ", "[\t]"}) {
+    RecordingClient client;
+    EXPECT_EQ(ESP_OK, Parse(json, &client)) << json;
+    EXPECT_TRUE(client.values_.empty());
+  }
+
+  RecordingClient client;
+  ASSERT_EQ(ESP_OK, Parse(R"({"a": { }, "b": [ ], "c": [{}], "d": 1})",
+                          &client));
+  EXPECT_EQ(Strings({"d=1"}), client.values_);
+  EXPECT_EQ(Strings({"a", "c[]", ""}), client.object_ends_);
+}
+
+TEST(JSONStreamTest, Escapes) {
+  EXPECT_EQ("\"\" \\ / \t\b\f\n\r\t\"",
+            StringValue(R"({"s": "\" \\ \/ \t\b\f\n\r\t"})"));
+  EXPECT_EQ(Strings({"a\"b=1"}), Values(R"({"a\"b": 1})"));
+  EXPECT_EQ(Strings({"ab=1"}), Values(R"({"a\u0062": 1})"));
+}
+
+TEST(JSONStreamTest, UnicodeEscapes) {
+  EXPECT_EQ("\"A\"", StringValue(R"(["\u0041"])"));
+  EXPECT_EQ("\"\xc3\xa9\"", StringValue(R"(["\u00e9"])"));
+  EXPECT_EQ("\"\xc3\xa9\"", StringValue(R"(["\u00E9"])"));
+  EXPECT_EQ("\"\xe2\x82\xac\"", StringValue(R"(["\u20ac"])"));
+  // Unescaped UTF-8 is passed through.
+  EXPECT_EQ("\"\xe2\x82\xac\"", StringValue("[\"\xe2\x82\xac\"]"));
+}
+
+TEST(JSONStreamTest, SurrogatePairs) {
+  EXPECT_EQ("\"\xf0\x9f\x8e\xb5\"", StringValue(R"(["\ud83c\udfb5"])"));
+  EXPECT_EQ("\"a\xf0\x9f\x8e\xb5" "b\"",
+            StringValue(R"(["a\ud83c\udfb5b"])"));
+}
+
+// Unpaired surrogates are replaced by U+FFFD.
+TEST(JSONStreamTest, UnpairedSurrogates) {
+  constexpr char kReplacement[] = "\xef\xbf\xbd";
+  EXPECT_EQ("\"" + std::string(kReplacement) + "\"",
+            StringValue(R"(["\udfb5"])"));
+  EXPECT_EQ("\"" + std::string(kReplacement) + "\"",
+            StringValue(R"(["\ud83c"])"));
+  EXPECT_EQ("\"" + std::string(kReplacement) + "x\"",
+            StringValue(R"(["\ud83cx"])"));
+  EXPECT_EQ("\"" + std::string(kReplacement) + "A\"",
+            StringValue(R"(["\ud83cA"])"));
+  EXPECT_EQ("\"" + std::string(kReplacement) + "\xf0\x9f\x8e\xb5\"",
+            StringValue(R"(["\ud83c\ud83c\udfb5"])"));
+}
+
+TEST(JSONStreamTest, UnwantedStringsSkipped) {
+  RecordingClient client;
+  client.skip_path_ = "b[]";
+  ASSERT_EQ(ESP_OK,
+            Parse(R"({"a": "x", "b": ["\u00e9\"", "y"], "c": "z"})", &client));
+  EXPECT_EQ(Strings({"a=\"x\"", "c=\"z\""}), client.values_);
+
+  // Escapes in skipped strings are still checked.
+  client.skip_strings_ = true;
+  EXPECT_EQ(ESP_FAIL, Parse(R"(["\q"])", &client));
+  EXPECT_EQ(ESP_FAIL, Parse(R"(["\u12g4"])", &client));
+}
+
+TEST(JSONStreamTest, InvalidStrings) {
+  EXPECT_EQ(ESP_FAIL, ParseError(R"(["\x"])"));
+  EXPECT_EQ(ESP_FAIL, ParseError(R"(["\u12g4"])"));
+  EXPECT_EQ(ESP_FAIL, ParseError(R"(["\u12"])"));
+  EXPECT_EQ(ESP_FAIL, ParseError("[\"a\nb\"]"));
+  EXPECT_EQ(ESP_FAIL, ParseError("{\"a\tb\": 1}"));
+}
+
+TEST(JSONStreamTest, InvalidDocuments) {
+  for (const char* json :
+       {R"({"a":})", R"({"a" 1})", R"({"a":1,})", R"({"a":1]})", "[1,]",
+        "[1 2]", "[tru]", "[1x]", "{1: 2}", "{\"a\":1}}", "\"x\" y",
+        "]"}) {
+    EXPECT_EQ(ESP_FAIL, ParseError(json)) << json;
+  }
+}
+
+TEST(JSONStreamTest, Incomplete) {
+  for (const char* json :
+       {"", " ", "{", "[", R"({"a")", R"({"a":)", R"({"a":1)", R"({"a":1,)",
+        R"(["ab)", R"(["\)", R"(["\u00)", "[[]"}) {
+    EXPECT_EQ(ESP_ERR_INVALID_SIZE, ParseError(json)) << json;
+  }
+}
+
+TEST(JSONStreamTest, LiteralTooLong) {
+  EXPECT_EQ(ESP_OK, ParseError("[" + std::string(32, '1') + "]"));
+  EXPECT_EQ(ESP_ERR_INVALID_SIZE,
+            ParseError("[" + std::string(33, '1') + "]"));
+}
+
+TEST(JSONStreamTest, MaxDepth) {
+  const size_t max_depth = JSONStream::kMaxDepth;
+  EXPECT_EQ(ESP_OK, ParseError(std::string(max_depth, '[') +
+                               std::string(max_depth, ']')));
+  EXPECT_EQ(ESP_ERR_INVALID_SIZE,
+            ParseError(std::string(max_depth + 1, '[') +
+                       std::string(max_depth + 1, ']')));
+
+  std::string objects;
+  for (size_t i = 0; i <= max_depth; i++)
+    objects += "{\"a\":";
+  objects += "1" + std::string(max_depth + 1, '}');
+  EXPECT_EQ(ESP_ERR_INVALID_SIZE, ParseError(objects));
+}
+
+// After an error all further input is ignored.
+TEST(JSONStreamTest, ErrorIsFinal) {
+  RecordingClient client;
+  JSONStream stream(&client);
+  const std::string deep(JSONStream::kMaxDepth + 1, '[');
+  EXPECT_EQ(ESP_ERR_INVALID_SIZE, stream.Feed(deep.data(), deep.size()));
+  const std::string rest = std::string(deep.size(), ']') + R"({"a":1})";
+  EXPECT_EQ(ESP_ERR_INVALID_SIZE, stream.Feed(rest.data(), rest.size()));
+  EXPECT_EQ(ESP_ERR_INVALID_SIZE, stream.Finish());
+  EXPECT_TRUE(client.values_.empty());
+}
+
+TEST(JSONStreamTest, SplitInsideUnicodeEscape) {
+  RecordingClient client;
+  JSONStream stream(&client);
+  for (const char* chunk : {R"({"s": "\)", "u", "d8", R"(3c\)", R"(ud)",
+                            "fb", R"(5\u00)", R"(e9"})"}) {
+    ASSERT_EQ(ESP_OK, stream.Feed(chunk, strlen(chunk))) << chunk;
+  }
+  ASSERT_EQ(ESP_OK, stream.Finish());
+  EXPECT_EQ(Strings({"s=\"\xf0\x9f\x8e\xb5\xc3\xa9\""}), client.values_);
+}
+
+// Any split gives the same values as the whole document.
+TEST(JSONStreamTest, SplitAnywhere) {
+  const std::string json =
+      R"({"item": {"name": "Song \"Q\" \u00e9\ud83c\udfb5", "n": -12.5e3,)"
+      R"( "images": [{"url": "https://i/64", "w": 64}, {}],)"
+      R"( "empty": [ ], "ok": true, "none": null}})";
+  RecordingClient whole;
+  ASSERT_EQ(ESP_OK, Parse(json, &whole));
+  ASSERT_EQ(6u, whole.values_.size());
+
+  for (size_t chunk_size = 1; chunk_size < 8; chunk_size++) {
+    RecordingClient client;
+    ASSERT_EQ(ESP_OK, Parse(json, &client, chunk_size)) << chunk_size;
+    EXPECT_EQ(whole.values_, client.values_) << chunk_size;
+    EXPECT_EQ(whole.object_ends_, client.object_ends_) << chunk_size;
+  }
+  for (size_t split = 1; split < json.size(); split++) {
+    RecordingClient client;
+    JSONStream stream(&client);
+    ASSERT_EQ(ESP_OK, stream.Feed(json.data(), split)) << split;
+    ASSERT_EQ(ESP_OK, stream.Feed(json.data() + split, json.size() - split))
+        << split;
+    ASSERT_EQ(ESP_OK, stream.Finish()) << split;
+    EXPECT_EQ(whole.values_, client.values_) << split;
+  }
+}
+
+}  // namespace
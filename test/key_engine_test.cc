@@ -0,0 +1,345 @@
+#include "key_engine.h"
+
+#include <gtest/gtest.h>
+
+#include <ostream>
+#include <vector>
+
+#include <class/hid/hid.h>
+
+#include "keymap_file.h"
+
+namespace {
+
+// Event IDs of the test keymap.
+constexpr uint8_t kA = 1;          // A, 1 on layer 1, F1 on layer 2.
+constexpr uint8_t kB = 2;          // B, F2 on layer 2.
+constexpr uint8_t kLayer1 = 3;     // Layer 1 while held.
+constexpr uint8_t kLayer2 = 4;     // Layer 2 while held.
+constexpr uint8_t kEscCtrl = 5;    // Tap Escape, hold Left Control.
+constexpr uint8_t kOneShot = 6;    // One-shot Left Shift.
+constexpr uint8_t kSpaceL1 = 7;    // Tap Space, hold layer 1.
+
+// Usec from the start of a trace.
+constexpr int64_t kMs = 1000;
+
+struct Event {
+  int64_t time_us;
+  uint8_t event_id;
+  bool pressed;
+};
+
+struct Action {
+  int64_t time_us;
+  uint8_t keycode;
+  bool pressed;
+
+  bool operator==(const Action& other) const {
+    return time_us == other.time_us && keycode == other.keycode &&
+           pressed == other.pressed;
+  }
+};
+
+void PrintTo(const Action& action, std::ostream* os) {
+  *os << action.time_us / kMs << "ms 0x" << std::hex << int(action.keycode)
+      << std::dec << (action.pressed ? " down" : " up");
+}
+
+/**
+ * Replays timestamped key event traces through a KeyEngine, calling
+ * HandleTimers() every tick as the keyboard task does, and records the
+ * resulting key transitions with the time they were made.
+ */
+class KeyEngineTest : public ::testing::Test, public KeyActionClient {
+ protected:
+  KeyEngineTest() : engine_(this) {}
+
+  void SetUp() override {
+    Keymap::Layer base;
+    base.fill(HID_KEY_NONE);
+    base[kA] = HID_KEY_A;
+    base[kB] = HID_KEY_B;
+    base[kLayer1] = Keymap::kKeyLayerBase + 1;
+    base[kLayer2] = Keymap::kKeyLayerBase + 2;
+    base[kEscCtrl] = HID_KEY_ESCAPE;
+    base[kOneShot] = Keymap::kKeyOneShotBase + 1;
+    base[kSpaceL1] = HID_KEY_SPACE;
+
+    Keymap::Layer layer1;
+    layer1.fill(Keymap::kKeyTransparent);
+    layer1[kA] = HID_KEY_1;
+
+    Keymap::Layer layer2;
+    layer2.fill(Keymap::kKeyTransparent);
+    layer2[kA] = HID_KEY_F1;
+    layer2[kB] = HID_KEY_F2;
+
+    Keymap::Layer holds;
+    holds.fill(HID_KEY_NONE);
+    holds[kEscCtrl] = HID_KEY_CONTROL_LEFT;
+    holds[kSpaceL1] = Keymap::kKeyLayerBase + 1;
+
+    KeymapFile file(KeymapFile::Build({base, layer1, layer2}, holds));
+    ASSERT_EQ(ESP_OK, engine_.keymap().Load(file.path()));
+  }
+
+  // KeyActionClient:
+  void KeyAction(uint8_t keycode, bool pressed) override {
+    actions_.push_back({now_us_, keycode, pressed});
+  }
+
+  /**
+   * Replay |trace|, which must be in time order, then run the timers until
+   * none are pending.
+   */
+  std::vector<Action> Replay(const std::vector<Event>& trace) {
+    actions_.clear();
+    auto event = trace.begin();
+    while (event != trace.end() || engine_.timers_pending()) {
+      if (event != trace.end() && event->time_us < next_tick_us_) {
+        // As Keyboard::HandleFIFO(), timers due first, then the event.
+        now_us_ = event->time_us;
+        engine_.HandleTimers(now_us_);
+        engine_.HandleEvent(event->event_id, event->pressed, now_us_);
+        ++event;
+      } else {
+        now_us_ = next_tick_us_;
+        engine_.HandleTimers(now_us_);
+        next_tick_us_ += KeyEngine::kTimerTickUsec;
+      }
+    }
+    return actions_;
+  }
+
+  KeyEngine engine_;
+  std::vector<Action> actions_;
+  int64_t now_us_ = 0;
+  int64_t next_tick_us_ = 0;
+};
+
+TEST_F(KeyEngineTest, PlainKey) {
+  EXPECT_EQ((std::vector<Action>{
+                {0, HID_KEY_A, true},
+                {50 * kMs, HID_KEY_A, false},
+            }),
+            Replay({
+                {0, kA, true},
+                {50 * kMs, kA, false},
+            }));
+}
+
+TEST_F(KeyEngineTest, DualRoleTap) {
+  EXPECT_EQ((std::vector<Action>{
+                {120 * kMs, HID_KEY_ESCAPE, true},
+                {120 * kMs, HID_KEY_ESCAPE, false},
+            }),
+            Replay({
+                {0, kEscCtrl, true},
+                {120 * kMs, kEscCtrl, false},
+            }));
+}
+
+TEST_F(KeyEngineTest, DualRoleHoldAfterTapTerm) {
+  EXPECT_EQ((std::vector<Action>{
+                {KeyEngine::kTapTermUsec, HID_KEY_CONTROL_LEFT, true},
+                {300 * kMs, HID_KEY_CONTROL_LEFT, false},
+            }),
+            Replay({
+                {0, kEscCtrl, true},
+                {300 * kMs, kEscCtrl, false},
+            }));
+}
+
+// The tap term is timed from the press, not the tick it landed in.
+TEST_F(KeyEngineTest, DualRoleHoldBetweenTicks) {
+  EXPECT_EQ((std::vector<Action>{
+                {210 * kMs, HID_KEY_CONTROL_LEFT, true},
+                {400 * kMs, HID_KEY_CONTROL_LEFT, false},
+            }),
+            Replay({
+                {3 * kMs, kEscCtrl, true},
+                {400 * kMs, kEscCtrl, false},
+            }));
+}
+
+TEST_F(KeyEngineTest, DualRoleHoldOnOtherKey) {
+  EXPECT_EQ((std::vector<Action>{
+                {50 * kMs, HID_KEY_CONTROL_LEFT, true},
+                {50 * kMs, HID_KEY_A, true},
+                {80 * kMs, HID_KEY_A, false},
+                {120 * kMs, HID_KEY_CONTROL_LEFT, false},
+            }),
+            Replay({
+                {0, kEscCtrl, true},
+                {50 * kMs, kA, true},
+                {80 * kMs, kA, false},
+                {120 * kMs, kEscCtrl, false},
+            }));
+}
+
+TEST_F(KeyEngineTest, DualRoleLayerHold) {
+  EXPECT_EQ((std::vector<Action>{
+                {250 * kMs, HID_KEY_1, true},
+                {260 * kMs, HID_KEY_1, false},
+                {300 * kMs, HID_KEY_A, true},
+                {310 * kMs, HID_KEY_A, false},
+            }),
+            Replay({
+                {0, kSpaceL1, true},
+                {250 * kMs, kA, true},
+                {260 * kMs, kA, false},
+                {270 * kMs, kSpaceL1, false},
+                {300 * kMs, kA, true},
+                {310 * kMs, kA, false},
+            }));
+}
+
+TEST_F(KeyEngineTest, OneShotModifiesNextKey) {
+  EXPECT_EQ((std::vector<Action>{
+                {0, HID_KEY_SHIFT_LEFT, true},
+                {100 * kMs, HID_KEY_A, true},
+                {100 * kMs, HID_KEY_SHIFT_LEFT, false},
+                {150 * kMs, HID_KEY_A, false},
+                {200 * kMs, HID_KEY_B, true},
+                {210 * kMs, HID_KEY_B, false},
+            }),
+            Replay({
+                {0, kOneShot, true},
+                {50 * kMs, kOneShot, false},
+                {100 * kMs, kA, true},
+                {150 * kMs, kA, false},
+                {200 * kMs, kB, true},
+                {210 * kMs, kB, false},
+            }));
+}
+
+TEST_F(KeyEngineTest, OneShotTimeout) {
+  EXPECT_EQ((std::vector<Action>{
+                {0, HID_KEY_SHIFT_LEFT, true},
+                {50 * kMs + KeyEngine::kOneShotTimeoutUsec,
+                 HID_KEY_SHIFT_LEFT, false},
+            }),
+            Replay({
+                {0, kOneShot, true},
+                {50 * kMs, kOneShot, false},
+            }));
+}
+
+TEST_F(KeyEngineTest, OneShotHeldActsAsModifier) {
+  EXPECT_EQ((std::vector<Action>{
+                {0, HID_KEY_SHIFT_LEFT, true},
+                {50 * kMs, HID_KEY_A, true},
+                {60 * kMs, HID_KEY_A, false},
+                {70 * kMs, HID_KEY_SHIFT_LEFT, false},
+            }),
+            Replay({
+                {0, kOneShot, true},
+                {50 * kMs, kA, true},
+                {60 * kMs, kA, false},
+                {70 * kMs, kOneShot, false},
+            }));
+  EXPECT_FALSE(engine_.timers_pending());
+}
+
+// Releasing one of two held layer keys returns to the other's layer.
+TEST_F(KeyEngineTest, TwoLayerKeys) {
+  EXPECT_EQ((std::vector<Action>{
+                {10 * kMs, HID_KEY_1, true},
+                {20 * kMs, HID_KEY_1, false},
+                {40 * kMs, HID_KEY_F1, true},
+                {50 * kMs, HID_KEY_F1, false},
+                {70 * kMs, HID_KEY_1, true},
+                {80 * kMs, HID_KEY_1, false},
+                {100 * kMs, HID_KEY_A, true},
+                {110 * kMs, HID_KEY_A, false},
+            }),
+            Replay({
+                {0, kLayer1, true},
+                {10 * kMs, kA, true},
+                {20 * kMs, kA, false},
+                {30 * kMs, kLayer2, true},
+                {40 * kMs, kA, true},
+                {50 * kMs, kA, false},
+                {60 * kMs, kLayer2, false},
+                {70 * kMs, kA, true},
+                {80 * kMs, kA, false},
+                {90 * kMs, kLayer1, false},
+                {100 * kMs, kA, true},
+                {110 * kMs, kA, false},
+            }));
+}
+
+// The higher layer stays active while its key is held, whatever order the
+// layer keys were pressed or released in.
+TEST_F(KeyEngineTest, LowerLayerReleasedFirst) {
+  EXPECT_EQ((std::vector<Action>{
+                {30 * kMs, HID_KEY_F2, true},
+                {40 * kMs, HID_KEY_F2, false},
+                {60 * kMs, HID_KEY_B, true},
+                {70 * kMs, HID_KEY_B, false},
+            }),
+            Replay({
+                {0, kLayer2, true},
+                {10 * kMs, kLayer1, true},
+                {20 * kMs, kLayer1, false},
+                {30 * kMs, kB, true},
+                {40 * kMs, kB, false},
+                {50 * kMs, kLayer2, false},
+                {60 * kMs, kB, true},
+                {70 * kMs, kB, false},
+            }));
+}
+
+// Two keys holding the same layer, one of them dual-role.
+TEST_F(KeyEngineTest, SameLayerHeldTwice) {
+  EXPECT_EQ((std::vector<Action>{
+                {20 * kMs, HID_KEY_1, true},
+                {30 * kMs, HID_KEY_1, false},
+                {60 * kMs, HID_KEY_1, true},
+                {70 * kMs, HID_KEY_1, false},
+            }),
+            Replay({
+                {0, kLayer1, true},
+                {10 * kMs, kSpaceL1, true},
+                {20 * kMs, kA, true},  // Resolves kSpaceL1 as held.
+                {30 * kMs, kA, false},
+                {40 * kMs, kLayer1, false},
+                {60 * kMs, kA, true},
+                {70 * kMs, kA, false},
+                {80 * kMs, kSpaceL1, false},
+            }));
+  EXPECT_EQ(0, engine_.keymap().active_layer());
+}
+
+// A key is released as what it was pressed as, even if the layer changed.
+TEST_F(KeyEngineTest, ReleaseAfterLayerChange) {
+  EXPECT_EQ((std::vector<Action>{
+                {10 * kMs, HID_KEY_1, true},
+                {30 * kMs, HID_KEY_1, false},
+            }),
+            Replay({
+                {0, kLayer1, true},
+                {10 * kMs, kA, true},
+                {20 * kMs, kLayer1, false},
+                {30 * kMs, kA, false},
+            }));
+}
+
+TEST_F(KeyEngineTest, ResetForgetsKeys) {
+  Replay({
+      {0, kA, true},
+      {10 * kMs, kLayer2, true},
+      {20 * kMs, kEscCtrl, true},
+  });
+  engine_.Reset();
+  EXPECT_FALSE(engine_.timers_pending());
+  EXPECT_EQ(0, engine_.keymap().active_layer());
+  EXPECT_TRUE(Replay({
+                  {30 * kMs, kA, false},
+                  {40 * kMs, kLayer2, false},
+                  {50 * kMs, kEscCtrl, false},
+              })
+                  .empty());
+}
+
+}  // namespace
@@ -0,0 +1,168 @@
+// Measures the host cost of building a boot keyboard report after each key
+// transition, with KeyState against the implementation it replaced (a
+// 255 entry bool array scanned with a per-key modifier switch).
+//
+//   key_state_benchmark [iterations]
+//
+// Both implementations must produce identical reports, or the benchmark
+// fails. Host timings are only a relative measure, the ESP32-S2 is not
+// benchmarked here.
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <class/hid/hid.h>
+
+#include "key_state.h"
+
+namespace {
+
+constexpr size_t kNumBootKeyCodes = 6;
+
+struct Report {
+  uint8_t modifier;
+  uint8_t keycodes[kNumBootKeyCodes];
+
+  bool operator==(const Report& other) const {
+    return modifier == other.modifier &&
+           !std::memcmp(keycodes, other.keycodes, sizeof(keycodes));
+  }
+};
+
+struct Transition {
+  uint8_t keycode;
+  bool pressed;
+};
+
+// The key state and report code before KeyState.
+class LegacyKeyState {
+ public:
+  LegacyKeyState() : key_states_({false}) {}
+
+  void Set(uint8_t keycode, bool pressed) {
+    if (keycode < key_states_.size())
+      key_states_[keycode] = pressed;
+  }
+
+  void GetReport(Report* report) const {
+    uint8_t next_key_idx = 0;
+    report->modifier = 0;
+    std::memset(report->keycodes, HID_KEY_NONE, sizeof(report->keycodes));
+    for (uint8_t keycode = 0; keycode < key_states_.size(); keycode++) {
+      if (!key_states_[keycode])
+        continue;
+      uint8_t modifier_bit = GetModifierFlag(keycode);
+      if (modifier_bit) {
+        report->modifier |= modifier_bit;
+      } else if (next_key_idx < kNumBootKeyCodes) {
+        report->keycodes[next_key_idx++] = keycode;
+      }
+    }
+  }
+
+ private:
+  static uint8_t GetModifierFlag(uint8_t keycode) {
+    switch (keycode) {
+      case HID_KEY_SHIFT_LEFT:
+        return KEYBOARD_MODIFIER_LEFTSHIFT;
+      case HID_KEY_SHIFT_RIGHT:
+        return KEYBOARD_MODIFIER_RIGHTSHIFT;
+      case HID_KEY_CONTROL_LEFT:
+        return KEYBOARD_MODIFIER_LEFTCTRL;
+      case HID_KEY_CONTROL_RIGHT:
+        return KEYBOARD_MODIFIER_RIGHTCTRL;
+      case HID_KEY_ALT_LEFT:
+        return KEYBOARD_MODIFIER_LEFTALT;
+      case HID_KEY_ALT_RIGHT:
+        return KEYBOARD_MODIFIER_RIGHTALT;
+      case HID_KEY_GUI_LEFT:
+        return KEYBOARD_MODIFIER_LEFTGUI;
+      case HID_KEY_GUI_RIGHT:
+        return KEYBOARD_MODIFIER_RIGHTGUI;
+    }
+    return 0x0;
+  }
+
+  std::array<bool, 255> key_states_;  // true if depressed.
+};
+
+/**
+ * Typing with up to four keys held, and a modifier now and then.
+ */
+std::vector<Transition> MakeTransitions(size_t count) {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> letter(HID_KEY_A, HID_KEY_Z);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::vector<Transition> transitions;
+  std::vector<uint8_t> held;
+  while (transitions.size() < count) {
+    if (held.size() < 4 && (held.empty() || percent(rng) < 50)) {
+      const uint8_t keycode =
+          percent(rng) < 10 ? HID_KEY_SHIFT_LEFT : letter(rng);
+      held.push_back(keycode);
+      transitions.push_back({keycode, true});
+    } else {
+      const size_t idx = percent(rng) % held.size();
+      transitions.push_back({held[idx], false});
+      held.erase(held.begin() + idx);
+    }
+  }
+  return transitions;
+}
+
+template <typename Func>
+double NsPerReport(size_t iterations, size_t num_reports, Func func) {
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++)
+    func();
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         (iterations * num_reports);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+  const std::vector<Transition> transitions = MakeTransitions(1000);
+
+  std::vector<Report> legacy_reports(transitions.size());
+  std::vector<Report> new_reports(transitions.size());
+
+  const double legacy_ns = NsPerReport(iterations, transitions.size(), [&] {
+    LegacyKeyState state;
+    for (size_t i = 0; i < transitions.size(); i++) {
+      state.Set(transitions[i].keycode, transitions[i].pressed);
+      state.GetReport(&legacy_reports[i]);
+    }
+  });
+
+  const double new_ns = NsPerReport(iterations, transitions.size(), [&] {
+    KeyState state;
+    for (size_t i = 0; i < transitions.size(); i++) {
+      state.Set(transitions[i].keycode, transitions[i].pressed);
+      Report& report = new_reports[i];
+      report.modifier = state.modifiers();
+      state.GetKeyCodes(report.keycodes, kNumBootKeyCodes);
+    }
+  });
+
+  for (size_t i = 0; i < transitions.size(); i++) {
+    if (!(legacy_reports[i] == new_reports[i])) {
+      fprintf(stderr, "Report %zu differs from the legacy report.\n", i);
+      return EXIT_FAILURE;
+    }
+  }
+
+  printf("%zu reports x %zu iterations\n", transitions.size(), iterations);
+  printf("  bool array + switch: %7.1f ns/report\n", legacy_ns);
+  printf("  KeyState bitmap:     %7.1f ns/report\n", new_ns);
+  printf("  speedup:             %7.2fx\n", legacy_ns / new_ns);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include "key_state.h"
+
+#include <gtest/gtest.h>
+
+#include <class/hid/hid.h>
+
+namespace {
+
+TEST(KeyStateTest, StartsReleased) {
+  KeyState state;
+  EXPECT_EQ(0, state.modifiers());
+  for (int keycode = 0; keycode < 256; keycode++)
+    EXPECT_FALSE(state.IsPressed(keycode)) << keycode;
+}
+
+TEST(KeyStateTest, SetReturnsChange) {
+  KeyState state;
+  EXPECT_TRUE(state.Set(HID_KEY_A, true));
+  EXPECT_FALSE(state.Set(HID_KEY_A, true));
+  EXPECT_TRUE(state.IsPressed(HID_KEY_A));
+  EXPECT_TRUE(state.Set(HID_KEY_A, false));
+  EXPECT_FALSE(state.Set(HID_KEY_A, false));
+  EXPECT_EQ(KeyState(), state);
+}
+
+TEST(KeyStateTest, ModifiersAreKeptAsMask) {
+  KeyState state;
+  EXPECT_TRUE(state.Set(HID_KEY_SHIFT_LEFT, true));
+  EXPECT_TRUE(state.Set(HID_KEY_GUI_RIGHT, true));
+  EXPECT_EQ(KEYBOARD_MODIFIER_LEFTSHIFT | KEYBOARD_MODIFIER_RIGHTGUI,
+            state.modifiers());
+  EXPECT_TRUE(state.IsPressed(HID_KEY_SHIFT_LEFT));
+
+  // Modifiers are not reported as keycodes.
+  uint8_t keycodes[6];
+  EXPECT_EQ(0u, state.GetKeyCodes(keycodes, sizeof(keycodes)));
+
+  EXPECT_TRUE(state.Set(HID_KEY_SHIFT_LEFT, false));
+  EXPECT_EQ(KEYBOARD_MODIFIER_RIGHTGUI, state.modifiers());
+}
+
+TEST(KeyStateTest, EveryModifierFlag) {
+  constexpr struct {
+    uint8_t keycode;
+    uint8_t flag;
+  } kModifiers[] = {
+      {HID_KEY_CONTROL_LEFT, KEYBOARD_MODIFIER_LEFTCTRL},
+      {HID_KEY_SHIFT_LEFT, KEYBOARD_MODIFIER_LEFTSHIFT},
+      {HID_KEY_ALT_LEFT, KEYBOARD_MODIFIER_LEFTALT},
+      {HID_KEY_GUI_LEFT, KEYBOARD_MODIFIER_LEFTGUI},
+      {HID_KEY_CONTROL_RIGHT, KEYBOARD_MODIFIER_RIGHTCTRL},
+      {HID_KEY_SHIFT_RIGHT, KEYBOARD_MODIFIER_RIGHTSHIFT},
+      {HID_KEY_ALT_RIGHT, KEYBOARD_MODIFIER_RIGHTALT},
+      {HID_KEY_GUI_RIGHT, KEYBOARD_MODIFIER_RIGHTGUI},
+  };
+  for (const auto& modifier : kModifiers) {
+    KeyState state;
+    state.Set(modifier.keycode, true);
+    EXPECT_EQ(modifier.flag, state.modifiers()) << int(modifier.keycode);
+  }
+}
+
+TEST(KeyStateTest, GetKeyCodesInKeycodeOrder) {
+  KeyState state;
+  state.Set(HID_KEY_Z, true);
+  state.Set(HID_KEY_A, true);
+  state.Set(0xFF, true);  // Last bit of the last word.
+  state.Set(HID_KEY_SPACE, true);
+
+  uint8_t keycodes[6];
+  ASSERT_EQ(4u, state.GetKeyCodes(keycodes, sizeof(keycodes)));
+  const uint8_t kExpected[6] = {HID_KEY_A, HID_KEY_Z, HID_KEY_SPACE, 0xFF,
+                                HID_KEY_NONE, HID_KEY_NONE};
+  for (size_t i = 0; i < sizeof(keycodes); i++)
+    EXPECT_EQ(kExpected[i], keycodes[i]) << i;
+}
+
+TEST(KeyStateTest, GetKeyCodesCountsRollover) {
+  KeyState state;
+  for (uint8_t keycode = HID_KEY_A; keycode <= HID_KEY_H; keycode++)
+    state.Set(keycode, true);
+
+  uint8_t keycodes[6];
+  EXPECT_EQ(8u, state.GetKeyCodes(keycodes, sizeof(keycodes)));
+  for (size_t i = 0; i < sizeof(keycodes); i++)
+    EXPECT_EQ(HID_KEY_A + i, keycodes[i]);
+}
+
+TEST(KeyStateTest, ClearAndEquality) {
+  KeyState a;
+  KeyState b;
+  a.Set(HID_KEY_Q, true);
+  EXPECT_NE(a, b);
+  b.Set(HID_KEY_Q, true);
+  EXPECT_EQ(a, b);
+  a.Set(HID_KEY_CONTROL_LEFT, true);
+  EXPECT_NE(a, b);
+  a.Clear();
+  EXPECT_EQ(KeyState(), a);
+}
+
+TEST(KeyStateTest, Merge) {
+  KeyState a;
+  KeyState b;
+  a.Set(HID_KEY_A, true);
+  a.Set(HID_KEY_SHIFT_LEFT, true);
+  b.Set(HID_KEY_B, true);
+  b.Set(HID_KEY_ALT_RIGHT, true);
+  a.Merge(b);
+  EXPECT_TRUE(a.IsPressed(HID_KEY_A));
+  EXPECT_TRUE(a.IsPressed(HID_KEY_B));
+  EXPECT_EQ(KEYBOARD_MODIFIER_LEFTSHIFT | KEYBOARD_MODIFIER_RIGHTALT,
+            a.modifiers());
+}
+
+}  // namespace
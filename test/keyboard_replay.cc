@@ -0,0 +1,323 @@
+// Replays a keyboard IC trace, compiled by scripts/kbdtrace.py, through the
+// keyboard code on the host.
+//
+//   keyboard_replay [--keymap <keymap.bin>] [--expected <reports.txt>]
+//                   [--iterations <n>] <trace.bin>
+//
+// The trace is first replayed in (fake) real time: each batch of events is
+// pushed into a fake ADP5589 and read by Keyboard::HandleEvents(), with
+// key timeouts handled every tick in between. This fails if handling a
+// batch fails, if a report is duplicated or differs from the expected
+// reports, or if a key is left pressed.
+//
+// The expected reports file has one line per keyboard report:
+//
+//   <time_us> <modifiers> [<keycode> ...]
+//
+// in hex apart from the time. Without --expected the reports are printed in
+// that form.
+//
+// The trace is then replayed |iterations| times through
+// Keyboard::HandleFIFO() as fast as possible to measure the host cost per
+// event. Host timings are only a relative measure.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <esp_timer.h>
+
+#include "fake_adp5589.h"
+#include "fake_clock.h"
+#include "keyboard.h"
+
+namespace {
+
+constexpr char kTraceMagic[4] = {'K', 'T', 'R', 'C'};
+constexpr uint8_t kTraceVersion = 1;
+// Time after the last event for key timeouts (tap-hold, etc.) to expire.
+constexpr int64_t kTimeoutFlushUsec = 2 * 1000 * 1000;
+constexpr size_t kMaxKeyCodes = 6;
+
+struct TraceHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t reserved[3];
+  uint32_t num_records;
+};
+static_assert(sizeof(TraceHeader) == 12);
+
+struct Record {
+  uint32_t time_us;
+  uint8_t fifo;
+} __attribute__((packed));
+
+bool LoadTrace(const char* path, std::vector<Record>* trace) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Unable to open trace \"%s\".\n", path);
+    return false;
+  }
+  TraceHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      memcmp(header.magic, kTraceMagic, sizeof(kTraceMagic)) ||
+      header.version != kTraceVersion || !header.num_records) {
+    fprintf(stderr, "Invalid trace header in \"%s\".\n", path);
+    fclose(f);
+    return false;
+  }
+  trace->resize(header.num_records);
+  const size_t num_read =
+      fread(trace->data(), sizeof(Record), header.num_records, f);
+  fclose(f);
+  if (num_read != header.num_records) {
+    fprintf(stderr, "Truncated trace \"%s\".\n", path);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * The events of |trace| from |*idx| read by one FIFO read: those with the
+ * same time, at most a full FIFO.
+ */
+size_t NextBatch(const std::vector<Record>& trace,
+                 size_t* idx,
+                 uint8_t* fifo) {
+  size_t num_events = 0;
+  const uint32_t batch_time_us = trace[*idx].time_us;
+  while (*idx < trace.size() && num_events < Keyboard::kMaxFIFOEntries &&
+         trace[*idx].time_us == batch_time_us) {
+    fifo[num_events++] = trace[(*idx)++].fifo;
+  }
+  return num_events;
+}
+
+class ReplaySink : public KeyboardReportSink {
+ public:
+  // KeyboardReportSink:
+  esp_err_t QueueKeyboardReport(const KeyState& key_state,
+                                int64_t interrupt_time_us,
+                                int64_t /*read_time_us*/) override {
+    num_reports++;
+    if (num_reports > 1 && key_state == last_report)
+      num_duplicate_reports++;
+    last_report = key_state;
+    if (record_reports)
+      reports.push_back(Format(key_state, interrupt_time_us));
+    return ESP_OK;
+  }
+
+  esp_err_t QueueConsumerReport(uint16_t usage) override {
+    num_consumer_reports++;
+    consumer_usage = usage;
+    return ESP_OK;
+  }
+
+  static std::string Format(const KeyState& key_state, int64_t time_us) {
+    uint8_t keycodes[kMaxKeyCodes];
+    const size_t num_pressed =
+        key_state.GetKeyCodes(keycodes, sizeof(keycodes));
+    char buf[16];
+    std::string line = std::to_string(time_us);
+    snprintf(buf, sizeof(buf), " %02x", key_state.modifiers());
+    line += buf;
+    for (size_t i = 0; i < num_pressed && i < kMaxKeyCodes; i++) {
+      snprintf(buf, sizeof(buf), " %02x", keycodes[i]);
+      line += buf;
+    }
+    return line;
+  }
+
+  bool record_reports = true;
+  std::vector<std::string> reports;
+  uint32_t num_reports = 0;
+  uint32_t num_duplicate_reports = 0;
+  uint32_t num_consumer_reports = 0;
+  uint16_t consumer_usage = 0;  // Last consumer report, zero if released.
+  KeyState last_report;
+};
+
+/**
+ * Replay |trace| through the fake IC and Keyboard::HandleEvents(), paced by
+ * the fake clock.
+ */
+bool ReplayRealtime(const std::vector<Record>& trace,
+                    const char* keymap_path,
+                    ReplaySink* sink) {
+  FakeADP5589 device;
+  std::unique_ptr<Keyboard> keyboard(
+      new Keyboard(i2c::Master(&device), sink));
+  if (keymap_path && keyboard->LoadKeymap(keymap_path) != ESP_OK)
+    return false;
+  if (keyboard->Initialize() != ESP_OK)
+    return false;
+
+  FakeClock::Set(0);
+  bool ok = true;
+  size_t idx = 0;
+  while (idx < trace.size()) {
+    uint8_t fifo[Keyboard::kMaxFIFOEntries];
+    const int64_t batch_time_us = trace[idx].time_us;
+    const size_t num_events = NextBatch(trace, &idx, fifo);
+
+    // Expire key timeouts every tick until the events are due.
+    while (keyboard->timers_pending() &&
+           FakeClock::now_us() + KeyEngine::kTimerTickUsec <= batch_time_us) {
+      FakeClock::Advance(KeyEngine::kTimerTickUsec);
+      keyboard->HandleTimers(esp_timer_get_time());
+    }
+    FakeClock::Set(batch_time_us);
+
+    for (size_t i = 0; i < num_events; i++)
+      device.PushEvent(fifo[i] & 0x7F, fifo[i] & 0x80);
+    if (keyboard->HandleEvents(batch_time_us) != ESP_OK) {
+      fprintf(stderr, "Failure handling events at %lld usec.\n",
+              static_cast<long long>(batch_time_us));
+      ok = false;
+    }
+  }
+
+  const int64_t end_us = FakeClock::now_us() + kTimeoutFlushUsec;
+  while (keyboard->timers_pending() && FakeClock::now_us() < end_us) {
+    FakeClock::Advance(KeyEngine::kTimerTickUsec);
+    keyboard->HandleTimers(esp_timer_get_time());
+  }
+  if (keyboard->num_overflows()) {
+    fprintf(stderr, "%u FIFO overflows.\n", keyboard->num_overflows());
+    ok = false;
+  }
+  return ok;
+}
+
+/**
+ * Replay |trace| |iterations| times through Keyboard::HandleFIFO(), and
+ * return the host time spent in it.
+ */
+std::chrono::nanoseconds ReplayBenchmark(const std::vector<Record>& trace,
+                                         const char* keymap_path,
+                                         int iterations) {
+  FakeADP5589 device;
+  ReplaySink sink;
+  sink.record_reports = false;
+  std::unique_ptr<Keyboard> keyboard(
+      new Keyboard(i2c::Master(&device), &sink));
+  if (keymap_path)
+    keyboard->LoadKeymap(keymap_path);
+
+  std::chrono::nanoseconds elapsed(0);
+  int64_t start_us = 0;
+  for (int i = 0; i < iterations; i++) {
+    size_t idx = 0;
+    while (idx < trace.size()) {
+      uint8_t fifo[Keyboard::kMaxFIFOEntries];
+      const int64_t event_time_us = start_us + trace[idx].time_us;
+      const size_t num_events = NextBatch(trace, &idx, fifo);
+      const auto start = std::chrono::steady_clock::now();
+      keyboard->HandleFIFO(fifo, num_events, event_time_us, event_time_us);
+      elapsed += std::chrono::steady_clock::now() - start;
+    }
+    start_us += trace.back().time_us + kTimeoutFlushUsec;
+    keyboard->HandleTimers(start_us);
+  }
+  return elapsed;
+}
+
+bool CheckExpected(const char* path, const std::vector<std::string>& reports) {
+  std::ifstream f(path);
+  if (!f) {
+    fprintf(stderr, "Unable to open \"%s\".\n", path);
+    return false;
+  }
+  std::vector<std::string> expected;
+  std::string line;
+  while (std::getline(f, line)) {
+    line = line.substr(0, line.find('#'));
+    while (!line.empty() && isspace(line.back()))
+      line.pop_back();
+    if (!line.empty())
+      expected.push_back(line);
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i < std::max(expected.size(), reports.size()); i++) {
+    const char* want = i < expected.size() ? expected[i].c_str() : "(none)";
+    const char* got = i < reports.size() ? reports[i].c_str() : "(none)";
+    if (strcmp(want, got)) {
+      fprintf(stderr, "Report %zu: expected \"%s\", got \"%s\".\n", i, want,
+              got);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* keymap_path = nullptr;
+  const char* expected_path = nullptr;
+  const char* trace_path = nullptr;
+  int iterations = 1000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--keymap") && i + 1 < argc) {
+      keymap_path = argv[++i];
+    } else if (!strcmp(argv[i], "--expected") && i + 1 < argc) {
+      expected_path = argv[++i];
+    } else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (!trace_path) {
+      trace_path = argv[i];
+    } else {
+      trace_path = nullptr;
+      break;
+    }
+  }
+  if (!trace_path || iterations < 1) {
+    fprintf(stderr,
+            "usage: %s [--keymap <keymap.bin>] [--expected <reports.txt>] "
+            "[--iterations <n>] <trace.bin>\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<Record> trace;
+  if (!LoadTrace(trace_path, &trace))
+    return EXIT_FAILURE;
+
+  ReplaySink sink;
+  bool ok = ReplayRealtime(trace, keymap_path, &sink);
+  const bool keys_stuck = sink.last_report != KeyState() || sink.consumer_usage;
+  printf("Replayed %zu events, %.1f msec.\n", trace.size(),
+         trace.back().time_us / 1000.0);
+  printf("Reports: %u, duplicate: %u, consumer: %u, keys stuck: %s.\n",
+         sink.num_reports, sink.num_duplicate_reports,
+         sink.num_consumer_reports, keys_stuck ? "YES" : "no");
+  if (sink.num_duplicate_reports || keys_stuck)
+    ok = false;
+  if (expected_path) {
+    if (!CheckExpected(expected_path, sink.reports))
+      ok = false;
+  } else {
+    for (const std::string& report : sink.reports)
+      printf("%s\n", report.c_str());
+  }
+
+  const std::chrono::nanoseconds elapsed =
+      ReplayBenchmark(trace, keymap_path, iterations);
+  const double num_events = static_cast<double>(trace.size()) * iterations;
+  printf("HandleFIFO: %d iterations, %.0f events/sec, %.1f nsec/event.\n",
+         iterations, num_events * 1e9 / elapsed.count(),
+         elapsed.count() / num_events);
+
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
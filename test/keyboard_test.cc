@@ -0,0 +1,209 @@
+#include "keyboard.h"
+
+#include <gtest/gtest.h>
+
+#include <class/hid/hid.h>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+
+#include "fake_adp5589.h"
+#include "fake_clock.h"
+#include "gpio_pins.h"
+#include "recording_report_sink.h"
+
+namespace {
+
+// Event IDs of keys in the built-in keymap.
+constexpr uint8_t kKeyE = 1;  // R0_C0
+constexpr uint8_t kKeyW = 2;  // R0_C1
+constexpr uint8_t kKeyQ = 3;  // R0_C2
+
+class KeyboardTest : public ::testing::Test {
+ protected:
+  KeyboardTest() : keyboard_(i2c::Master(&device_), &sink_) {}
+
+  void SetUp() override {
+    FakeClock::Set(0);
+    // The IC is reset while its RST pin is held low.
+    fake_gpio_set_handler([this](gpio_num_t gpio_num, uint32_t level) {
+      if (gpio_num == kKeyboardResetGPIO && !level)
+        device_.Reset();
+    });
+    ASSERT_EQ(ESP_OK, keyboard_.Reset());
+    ASSERT_EQ(ESP_OK, keyboard_.Initialize());
+  }
+
+  void TearDown() override { fake_gpio_set_handler(nullptr); }
+
+  FakeADP5589 device_;
+  RecordingReportSink sink_;
+  Keyboard keyboard_;
+};
+
+TEST_F(KeyboardTest, InitializeEnablesInterrupts) {
+  // OVRFLOW_IEN | EVENT_IEN.
+  EXPECT_EQ(0x05, device_.reg(0x4E));
+  EXPECT_EQ(device_.num_transactions(), keyboard_.num_i2c_transactions());
+}
+
+TEST_F(KeyboardTest, HandleEventsReportsKeys) {
+  device_.PushEvent(kKeyE, true);
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  ASSERT_EQ(1u, sink_.reports.size());
+  EXPECT_TRUE(sink_.reports[0].key_state.IsPressed(HID_KEY_E));
+  EXPECT_EQ(0u, device_.fifo_size());
+  EXPECT_EQ(0, device_.int_status());
+
+  device_.PushEvent(kKeyE, false);
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  ASSERT_EQ(2u, sink_.reports.size());
+  EXPECT_EQ(KeyState(), sink_.reports[1].key_state);
+}
+
+TEST_F(KeyboardTest, HandleEventsWithEmptyFIFO) {
+  const uint32_t start = device_.num_transactions();
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  EXPECT_EQ(2u, device_.num_transactions() - start);
+  EXPECT_TRUE(sink_.reports.empty());
+}
+
+// Every batch is one read of INT_STATUS, Status, and the whole FIFO, then
+// one INT_STATUS write, whatever the number of events.
+TEST_F(KeyboardTest, TwoTransactionsPerBatch) {
+  constexpr uint8_t kKeys[] = {kKeyE, kKeyW, kKeyQ};
+  for (uint8_t num_events = 1; num_events <= FakeADP5589::kFIFOSize;
+       num_events++) {
+    SCOPED_TRACE(num_events);
+    for (uint8_t i = 0; i < num_events; i++) {
+      const uint8_t key = kKeys[(i / 2) % 3];
+      device_.PushEvent(key, i % 2 == 0);
+    }
+    const uint32_t device_start = device_.num_transactions();
+    const uint32_t keyboard_start = keyboard_.num_i2c_transactions();
+    ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+    EXPECT_EQ(2u, device_.num_transactions() - device_start);
+    EXPECT_EQ(2u, keyboard_.num_i2c_transactions() - keyboard_start);
+    EXPECT_EQ(0u, device_.fifo_size());
+
+    // Release any key left pressed by an odd number of events.
+    if (num_events % 2) {
+      device_.PushEvent(kKeys[((num_events - 1) / 2) % 3], false);
+      ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+    }
+    ASSERT_FALSE(sink_.reports.empty());
+    EXPECT_EQ(KeyState(), sink_.reports.back().key_state);
+  }
+  EXPECT_EQ(device_.num_transactions(), keyboard_.num_i2c_transactions());
+}
+
+// A tap within one FIFO batch must reach the host as two reports, not
+// cancel out.
+TEST_F(KeyboardTest, PressAndReleaseInOneBatch) {
+  device_.PushEvent(kKeyE, true);
+  device_.PushEvent(kKeyE, false);
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  ASSERT_EQ(2u, sink_.reports.size());
+  EXPECT_TRUE(sink_.reports[0].key_state.IsPressed(HID_KEY_E));
+  EXPECT_EQ(KeyState(), sink_.reports[1].key_state);
+}
+
+TEST_F(KeyboardTest, ReportPerTransitionInOneBatch) {
+  device_.PushEvent(kKeyE, true);
+  device_.PushEvent(kKeyW, true);
+  device_.PushEvent(kKeyE, false);
+  device_.PushEvent(kKeyQ, true);
+  device_.PushEvent(kKeyW, false);
+  device_.PushEvent(kKeyQ, false);
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  ASSERT_EQ(6u, sink_.reports.size());
+  EXPECT_TRUE(sink_.reports[1].key_state.IsPressed(HID_KEY_E));
+  EXPECT_TRUE(sink_.reports[1].key_state.IsPressed(HID_KEY_W));
+  EXPECT_FALSE(sink_.reports[2].key_state.IsPressed(HID_KEY_E));
+  EXPECT_TRUE(sink_.reports[3].key_state.IsPressed(HID_KEY_Q));
+  EXPECT_EQ(KeyState(), sink_.reports[5].key_state);
+}
+
+// When the report queue is full the latest state is queued with a later
+// batch, so the host is never left with a key pressed.
+TEST_F(KeyboardTest, FullReportQueueCoalesces) {
+  sink_.set_capacity(1);
+  device_.PushEvent(kKeyE, true);
+  device_.PushEvent(kKeyW, true);
+  device_.PushEvent(kKeyE, false);
+  device_.PushEvent(kKeyW, false);
+  EXPECT_NE(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  ASSERT_EQ(1u, sink_.reports.size());
+
+  sink_.set_capacity(SIZE_MAX);
+  device_.PushEvent(kKeyQ, true);
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  ASSERT_EQ(2u, sink_.reports.size());
+  KeyState expected;
+  expected.Set(HID_KEY_Q, true);
+  EXPECT_EQ(expected, sink_.reports[1].key_state);
+}
+
+// Events beyond the 16 entry FIFO are lost, so the keyboard resets the IC
+// and releases every key on the host.
+TEST_F(KeyboardTest, OverflowRecovery) {
+  device_.PushEvent(kKeyE, true);
+  device_.PushEvent(kKeyW, true);
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  ASSERT_EQ(2u, sink_.reports.size());
+
+  for (int i = 0; i < FakeADP5589::kFIFOSize + 1; i++)
+    device_.PushEvent(kKeyQ, i % 2 == 0);
+  ASSERT_TRUE(device_.int_status() & FakeADP5589::kOverflowIntFlag);
+  device_.PushEvent(kKeyE, false);  // Lost.
+
+  const uint32_t start_resets = device_.num_resets();
+  const uint32_t start_transactions = device_.num_transactions();
+  const int64_t start_us = esp_timer_get_time();
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(start_us));
+
+  EXPECT_EQ(1u, keyboard_.num_overflows());
+  EXPECT_EQ(start_resets + 1, device_.num_resets());
+  EXPECT_EQ(0u, device_.fifo_size());
+  EXPECT_EQ(0x05, device_.reg(0x4E));  // Interrupts enabled again.
+
+  // One report releasing everything, none of the lost events.
+  ASSERT_EQ(3u, sink_.reports.size());
+  EXPECT_EQ(KeyState(), sink_.reports[2].key_state);
+
+  // The cost is bounded: the event read, INT_STATUS write, ID read after
+  // reset, and the initialization write, plus the two reset delays.
+  EXPECT_EQ(4u, device_.num_transactions() - start_transactions);
+  EXPECT_EQ(device_.num_transactions(), keyboard_.num_i2c_transactions());
+  EXPECT_EQ(60000, esp_timer_get_time() - start_us);
+
+  // Keys still held are reported again by the IC after the reset.
+  device_.PushEvent(kKeyW, true);
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  ASSERT_EQ(4u, sink_.reports.size());
+  KeyState expected;
+  expected.Set(HID_KEY_W, true);
+  EXPECT_EQ(expected, sink_.reports[3].key_state);
+}
+
+TEST_F(KeyboardTest, OverflowWithNoKeysReported) {
+  for (int i = 0; i < FakeADP5589::kFIFOSize + 4; i++)
+    device_.PushEvent(kKeyQ, true);
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  EXPECT_EQ(1u, keyboard_.num_overflows());
+  // The host was never told of a key, so there is nothing to release.
+  EXPECT_TRUE(sink_.reports.empty());
+}
+
+TEST_F(KeyboardTest, ReadFailure) {
+  device_.PushEvent(kKeyE, true);
+  device_.FailTransactions(1);
+  EXPECT_NE(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  EXPECT_TRUE(sink_.reports.empty());
+
+  // The events are still in the FIFO for the next attempt.
+  ASSERT_EQ(ESP_OK, keyboard_.HandleEvents(esp_timer_get_time()));
+  ASSERT_EQ(1u, sink_.reports.size());
+  EXPECT_TRUE(sink_.reports[0].key_state.IsPressed(HID_KEY_E));
+}
+
+}  // namespace
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "keymap.h"
+
+/**
+ * A keymap file, in the format written by scripts/keymap.py, in a
+ * temporary file deleted on destruction.
+ */
+class KeymapFile {
+ public:
+  /**
+   * The contents of a keymap file holding |layers| and (if version 2 or
+   * later) |holds|.
+   */
+  static std::vector<uint8_t> Build(const std::vector<Keymap::Layer>& layers,
+                                    const Keymap::Layer& holds,
+                                    uint8_t version = Keymap::kFileVersion) {
+    std::vector<uint8_t> data = {'K', 'M', 'A', 'P', version,
+                                 static_cast<uint8_t>(layers.size()),
+                                 static_cast<uint8_t>(Keymap::kNumEvents), 0};
+    for (const Keymap::Layer& layer : layers)
+      data.insert(data.end(), layer.begin(), layer.end());
+    if (version >= 2)
+      data.insert(data.end(), holds.begin(), holds.end());
+    return data;
+  }
+
+  explicit KeymapFile(const std::vector<uint8_t>& data) {
+    char path[] = "/tmp/keymap_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0)
+      abort();
+    path_ = path;
+    FILE* f = fdopen(fd, "wb");
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+  }
+
+  ~KeymapFile() { unlink(path_.c_str()); }
+
+  const char* path() const { return path_.c_str(); }
+
+ private:
+  std::string path_;
+};
@@ -0,0 +1,127 @@
+#include "keymap.h"
+
+#include <gtest/gtest.h>
+
+#include <class/hid/hid.h>
+
+#include "keymap_file.h"
+
+namespace {
+
+Keymap::Layer Filled(uint8_t code) {
+  Keymap::Layer layer;
+  layer.fill(code);
+  return layer;
+}
+
+TEST(KeymapTest, BuiltInLayer) {
+  Keymap keymap;
+  EXPECT_EQ(1, keymap.num_layers());
+  EXPECT_EQ(HID_KEY_E, keymap.Lookup(1));
+  EXPECT_EQ(HID_KEY_SHIFT_LEFT, keymap.Lookup(4));
+  EXPECT_EQ(HID_KEY_NONE, keymap.Lookup(0));
+  EXPECT_EQ(HID_KEY_NONE, keymap.LookupHold(1));
+}
+
+TEST(KeymapTest, LoadFlattensTransparentKeys) {
+  Keymap::Layer base = Filled(HID_KEY_A);
+  Keymap::Layer upper = Filled(Keymap::kKeyTransparent);
+  upper[2] = HID_KEY_B;
+  Keymap::Layer holds = Filled(HID_KEY_NONE);
+  holds[3] = HID_KEY_CONTROL_LEFT;
+  KeymapFile file(KeymapFile::Build({base, upper}, holds));
+
+  Keymap keymap;
+  ASSERT_EQ(ESP_OK, keymap.Load(file.path()));
+  EXPECT_EQ(2, keymap.num_layers());
+  EXPECT_EQ(HID_KEY_CONTROL_LEFT, keymap.LookupHold(3));
+
+  keymap.SetActiveLayer(1);
+  EXPECT_EQ(1, keymap.active_layer());
+  EXPECT_EQ(HID_KEY_A, keymap.Lookup(1));
+  EXPECT_EQ(HID_KEY_B, keymap.Lookup(2));
+
+  keymap.SetActiveLayer(2);  // Out of range, ignored.
+  EXPECT_EQ(1, keymap.active_layer());
+}
+
+TEST(KeymapTest, TransparentBaseLayerIsNone) {
+  KeymapFile file(KeymapFile::Build({Filled(Keymap::kKeyTransparent)},
+                                    Filled(HID_KEY_NONE)));
+  Keymap keymap;
+  ASSERT_EQ(ESP_OK, keymap.Load(file.path()));
+  EXPECT_EQ(HID_KEY_NONE, keymap.Lookup(1));
+}
+
+TEST(KeymapTest, VersionOneHasNoHolds) {
+  KeymapFile file(KeymapFile::Build({Filled(HID_KEY_A)},
+                                    Filled(HID_KEY_CONTROL_LEFT), 1));
+  Keymap keymap;
+  ASSERT_EQ(ESP_OK, keymap.Load(file.path()));
+  EXPECT_EQ(HID_KEY_A, keymap.Lookup(5));
+  EXPECT_EQ(HID_KEY_NONE, keymap.LookupHold(5));
+}
+
+TEST(KeymapTest, InvalidCodesAreCleared) {
+  Keymap::Layer layer = Filled(HID_KEY_A);
+  layer[1] = Keymap::kKeyLayerBase + 1;  // Only one layer.
+  Keymap::Layer holds = Filled(HID_KEY_NONE);
+  holds[2] = Keymap::kKeyLayerBase + 3;   // No such layer.
+  holds[3] = Keymap::kKeyOneShotBase;     // One-shot holds are not allowed.
+  holds[4] = Keymap::kKeyMediaBase;       // Media holds are.
+  KeymapFile file(KeymapFile::Build({layer}, holds));
+
+  Keymap keymap;
+  ASSERT_EQ(ESP_OK, keymap.Load(file.path()));
+  EXPECT_EQ(HID_KEY_NONE, keymap.Lookup(1));
+  EXPECT_EQ(HID_KEY_NONE, keymap.LookupHold(2));
+  EXPECT_EQ(HID_KEY_NONE, keymap.LookupHold(3));
+  EXPECT_EQ(Keymap::kKeyMediaBase, keymap.LookupHold(4));
+}
+
+TEST(KeymapTest, LoadFailuresKeepCurrentLayers) {
+  Keymap keymap;
+
+  EXPECT_EQ(ESP_ERR_NOT_FOUND, keymap.Load("/nonexistent/keymap.bin"));
+
+  std::vector<uint8_t> data =
+      KeymapFile::Build({Filled(HID_KEY_Z)}, Filled(HID_KEY_NONE));
+  std::vector<uint8_t> bad_magic = data;
+  bad_magic[0] = 'X';
+  EXPECT_EQ(ESP_ERR_INVALID_VERSION, keymap.Load(KeymapFile(bad_magic).path()));
+
+  std::vector<uint8_t> bad_version = data;
+  bad_version[4] = Keymap::kFileVersion + 1;
+  EXPECT_EQ(ESP_ERR_INVALID_VERSION,
+            keymap.Load(KeymapFile(bad_version).path()));
+
+  std::vector<uint8_t> truncated(data.begin(), data.end() - 1);
+  EXPECT_EQ(ESP_ERR_INVALID_SIZE, keymap.Load(KeymapFile(truncated).path()));
+
+  EXPECT_EQ(1, keymap.num_layers());
+  EXPECT_EQ(HID_KEY_E, keymap.Lookup(1));
+}
+
+TEST(KeymapTest, CodeClassification) {
+  EXPECT_TRUE(Keymap::IsLayerKey(Keymap::kKeyLayerBase + 7));
+  EXPECT_FALSE(Keymap::IsLayerKey(Keymap::kKeyMediaBase));
+  EXPECT_EQ(2, Keymap::GetLayer(Keymap::kKeyLayerBase + 2));
+
+  EXPECT_TRUE(Keymap::IsOneShotKey(Keymap::kKeyOneShotBase));
+  EXPECT_EQ(HID_KEY_GUI_RIGHT,
+            Keymap::GetOneShotModifier(Keymap::kKeyOneShotBase + 7));
+
+  EXPECT_TRUE(Keymap::IsMediaKey(Keymap::kKeyMediaBase));
+  EXPECT_FALSE(Keymap::IsMediaKey(Keymap::kKeyTransparent));
+  EXPECT_EQ(HID_USAGE_CONSUMER_PLAY_PAUSE,
+            Keymap::GetMediaUsage(Keymap::kKeyMediaBase));
+  EXPECT_EQ(HID_USAGE_CONSUMER_VOLUME_DECREMENT,
+            Keymap::GetMediaUsage(Keymap::kKeyMediaBase + 6));
+
+  EXPECT_TRUE(Keymap::IsFunctionKey(Keymap::kKeyFunctionBase));
+  EXPECT_FALSE(Keymap::IsFunctionKey(HID_KEY_A));
+  EXPECT_EQ(Keymap::Function::TypeMacro,
+            Keymap::GetFunction(Keymap::kKeyFunctionBase + 1));
+}
+
+}  // namespace
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <esp_err.h>
+
+#include "usb_host_channel.h"
+
+/**
+ * A NowPlayingClient which keeps everything received, in place of UITask.
+ */
+class RecordingNowPlayingClient : public usb::NowPlayingClient {
+ public:
+  struct Track {
+    std::string artist;
+    std::string album;
+    std::string title;
+  };
+
+  struct Artwork {
+    std::vector<uint8_t> pixels;
+    uint16_t width;
+    uint16_t height;
+  };
+
+  /**
+   * Return |err| for each following artwork, which is still kept.
+   */
+  void set_artwork_err(esp_err_t err) { artwork_err_ = err; }
+
+  // usb::NowPlayingClient:
+  esp_err_t NowPlayingTrack(std::string artist,
+                            std::string album,
+                            std::string title) override {
+    tracks.push_back({std::move(artist), std::move(album), std::move(title)});
+    return ESP_OK;
+  }
+
+  esp_err_t NowPlayingArtwork(std::unique_ptr<uint8_t[]> pixels,
+                              uint16_t width,
+                              uint16_t height) override {
+    const size_t len = width * height * 2u;
+    artworks.push_back(
+        {std::vector<uint8_t>(pixels.get(), pixels.get() + len), width,
+         height});
+    return artwork_err_;
+  }
+
+  std::vector<Track> tracks;
+  std::vector<Artwork> artworks;
+
+ private:
+  esp_err_t artwork_err_ = ESP_OK;
+};
+
+/**
+ * A HostChannel message as sent by scripts/now_playing.py, with a valid
+ * header unless |magic| is given.
+ */
+inline std::vector<uint8_t> NowPlayingMessage(
+    usb::HostChannel::MessageType type,
+    const std::vector<uint8_t>& payload,
+    const char* magic = "NP") {
+  usb::HostChannel::MessageHeader header;
+  std::memcpy(header.magic, magic, sizeof(header.magic));
+  header.type = type;
+  header.reserved = 0;
+  header.length = payload.size();
+  std::vector<uint8_t> message(reinterpret_cast<const uint8_t*>(&header),
+                               reinterpret_cast<const uint8_t*>(&header + 1));
+  message.insert(message.end(), payload.begin(), payload.end());
+  return message;
+}
+
+inline std::vector<uint8_t> TrackPayload(const std::string& artist,
+                                         const std::string& album,
+                                         const std::string& title) {
+  std::vector<uint8_t> payload;
+  for (const std::string* field : {&artist, &album, &title}) {
+    payload.insert(payload.end(), field->begin(), field->end());
+    payload.push_back('\0');
+  }
+  return payload;
+}
+
+/**
+ * An artwork payload of |width| x |height| pixels, numbered from
+ * |first_pixel|.
+ */
+inline std::vector<uint8_t> ArtworkPayload(uint16_t width,
+                                           uint16_t height,
+                                           uint16_t first_pixel = 0) {
+  std::vector<uint8_t> payload = {
+      static_cast<uint8_t>(width), static_cast<uint8_t>(width >> 8),
+      static_cast<uint8_t>(height), static_cast<uint8_t>(height >> 8)};
+  for (uint32_t i = 0; i < width * height; i++) {
+    const uint16_t pixel = first_pixel + i;
+    payload.push_back(pixel >> 8);
+    payload.push_back(pixel);
+  }
+  return payload;
+}
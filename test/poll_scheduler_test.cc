@@ -0,0 +1,134 @@
+#include "poll_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr int64_t kSec = 1000 * 1000;
+constexpr int64_t kStartUsec = 1000 * kSec;
+
+using Playback = PollScheduler::Playback;
+
+constexpr Playback kPlaying = {/*is_player_active=*/true, /*is_playing=*/true,
+                               /*progress_ms=*/100 * 1000,
+                               /*duration_ms=*/130 * 1000};
+constexpr Playback kPaused = {true, false, 100 * 1000, 130 * 1000};
+constexpr Playback kInactive = {false, false, 0, 0};
+
+TEST(PollSchedulerTest, FirstPollDueImmediately) {
+  PollScheduler scheduler;
+  EXPECT_EQ(0, scheduler.next_poll_us());
+}
+
+TEST(PollSchedulerTest, PlayingPollsAfterTrackEnd) {
+  PollScheduler scheduler;
+  scheduler.PollSucceeded(kStartUsec, kPlaying);
+  EXPECT_EQ(kStartUsec + 30 * kSec + PollScheduler::kTrackEndMarginUsec,
+            scheduler.next_poll_us());
+}
+
+TEST(PollSchedulerTest, PlayingPollsAtLeastEveryMaxInterval) {
+  PollScheduler scheduler;
+  scheduler.PollSucceeded(kStartUsec, {true, true, 0, 300 * 1000});
+  EXPECT_EQ(kStartUsec + PollScheduler::kMaxPlayingIntervalUsec,
+            scheduler.next_poll_us());
+}
+
+TEST(PollSchedulerTest, ProgressPastDuration) {
+  PollScheduler scheduler;
+  scheduler.PollSucceeded(kStartUsec, {true, true, 140 * 1000, 130 * 1000});
+  EXPECT_EQ(kStartUsec + PollScheduler::kTrackEndMarginUsec,
+            scheduler.next_poll_us());
+}
+
+TEST(PollSchedulerTest, Paused) {
+  PollScheduler scheduler;
+  scheduler.PollSucceeded(kStartUsec, kPaused);
+  EXPECT_EQ(kStartUsec + PollScheduler::kPausedIntervalUsec,
+            scheduler.next_poll_us());
+}
+
+TEST(PollSchedulerTest, Inactive) {
+  PollScheduler scheduler;
+  scheduler.PollSucceeded(kStartUsec, kInactive);
+  EXPECT_EQ(kStartUsec + PollScheduler::kInactiveIntervalUsec,
+            scheduler.next_poll_us());
+}
+
+// After user input poll soon, then quickly until the end of the window.
+TEST(PollSchedulerTest, UserInputWindow) {
+  PollScheduler scheduler;
+  scheduler.PollSucceeded(kStartUsec, kPaused);
+  const int64_t scheduled_us = scheduler.next_poll_us();
+
+  const int64_t input_us = kStartUsec + 5 * kSec;
+  scheduler.UserInput(input_us);
+  int64_t poll_us = scheduler.next_poll_us();
+  EXPECT_EQ(input_us + PollScheduler::kUserInputDelayUsec, poll_us);
+
+  int num_polls = 1;
+  while (poll_us + PollScheduler::kUserInputIntervalUsec <=
+         input_us + PollScheduler::kUserInputWindowUsec) {
+    scheduler.PollSucceeded(poll_us, kPaused);
+    EXPECT_EQ(poll_us + PollScheduler::kUserInputIntervalUsec,
+              scheduler.next_poll_us());
+    poll_us = scheduler.next_poll_us();
+    num_polls++;
+  }
+  EXPECT_EQ(5, num_polls);  // 1, 3, 5, 7 and 9 seconds after the input.
+
+  // The window has ended, so back to the paused interval.
+  scheduler.PollSucceeded(poll_us, kPaused);
+  EXPECT_EQ(poll_us + PollScheduler::kPausedIntervalUsec,
+            scheduler.next_poll_us());
+  EXPECT_LT(scheduled_us, scheduler.next_poll_us());
+}
+
+TEST(PollSchedulerTest, UserInputDoesNotDelayPoll) {
+  PollScheduler scheduler;
+  scheduler.PollSucceeded(kStartUsec, {true, true, 129 * 1000, 130 * 1000});
+  const int64_t scheduled_us = scheduler.next_poll_us();
+  scheduler.UserInput(scheduled_us - 500 * 1000);
+  EXPECT_EQ(scheduled_us, scheduler.next_poll_us());
+}
+
+TEST(PollSchedulerTest, ExponentialBackoff) {
+  PollScheduler scheduler;
+  int64_t now_us = kStartUsec;
+  int64_t backoff_us = PollScheduler::kMinBackoffUsec;
+  for (int i = 0; i < 12; i++) {
+    scheduler.PollFailed(now_us, /*retry_after_us=*/0);
+    EXPECT_EQ(now_us + backoff_us, scheduler.next_poll_us()) << i;
+    now_us = scheduler.next_poll_us();
+    backoff_us = std::min(backoff_us * 2, PollScheduler::kMaxBackoffUsec);
+  }
+  EXPECT_EQ(PollScheduler::kMaxBackoffUsec, backoff_us);
+
+  // Success resets the backoff.
+  scheduler.PollSucceeded(now_us, kPlaying);
+  now_us = scheduler.next_poll_us();
+  scheduler.PollFailed(now_us, 0);
+  EXPECT_EQ(now_us + PollScheduler::kMinBackoffUsec, scheduler.next_poll_us());
+}
+
+TEST(PollSchedulerTest, RetryAfter) {
+  PollScheduler scheduler;
+  scheduler.PollFailed(kStartUsec, 30 * kSec);
+  EXPECT_EQ(kStartUsec + 30 * kSec, scheduler.next_poll_us());
+
+  // The backoff applies if longer.
+  scheduler.PollFailed(kStartUsec, 1 * kSec);
+  EXPECT_EQ(kStartUsec + 2 * PollScheduler::kMinBackoffUsec,
+            scheduler.next_poll_us());
+}
+
+TEST(PollSchedulerTest, UserInputWaitsForBackoff) {
+  PollScheduler scheduler;
+  scheduler.PollFailed(kStartUsec, 30 * kSec);
+  scheduler.UserInput(kStartUsec + kSec);
+  EXPECT_EQ(kStartUsec + 30 * kSec, scheduler.next_poll_us());
+}
+
+}  // namespace
@@ -0,0 +1,267 @@
+// Simulates polling Spotify for the currently playing track.
+//
+//   poll_simulator [--hours <n>] [--seed <n>] [--rate-limit <n>]
+//                  [--fixed <secs> ...]
+//
+// Plays a generated listening session and polls it with PollScheduler, as
+// used by MainTask, and with fixed-rate polling for comparison. Reports
+// requests/hour and the lag from each track change to the first poll which
+// sees it.
+//
+// The session alternates listening and paused periods. While listening,
+// tracks play to their end or are skipped, either with the keyboard's media
+// keys (which the scheduler is told about) or from another device (which it
+// is not). Every --rate-limit'th request is refused with a 429 and a
+// Retry-After.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "poll_scheduler.h"
+
+namespace {
+
+constexpr int64_t kSec = 1000 * 1000;
+// Time for a media key's change to be visible to the Web API.
+constexpr int64_t kAPIPropagationUsec = 500 * 1000;
+constexpr int64_t kRetryAfterUsec = 10 * kSec;
+
+/**
+ * A period during which |track| plays (or is paused) from |offset_ms| at
+ * |start_us|.
+ */
+struct Segment {
+  int64_t start_us;
+  int64_t end_us;
+  int track;
+  uint32_t duration_ms;
+  uint32_t offset_ms;
+  bool playing;
+  int64_t key_press_us;  // The media key press which started it, or -1.
+};
+
+/**
+ * The interface to the schedulers compared, with PollScheduler's.
+ */
+class Scheduler {
+ public:
+  virtual ~Scheduler() = default;
+
+  virtual void PollSucceeded(int64_t now_us,
+                             const PollScheduler::Playback& playback) = 0;
+  virtual void PollFailed(int64_t now_us, int64_t retry_after_us) = 0;
+  virtual void UserInput(int64_t now_us) = 0;
+  virtual int64_t next_poll_us() const = 0;
+};
+
+class AdaptiveScheduler : public Scheduler {
+ public:
+  // Scheduler:
+  void PollSucceeded(int64_t now_us,
+                     const PollScheduler::Playback& playback) override {
+    scheduler_.PollSucceeded(now_us, playback);
+  }
+  void PollFailed(int64_t now_us, int64_t retry_after_us) override {
+    scheduler_.PollFailed(now_us, retry_after_us);
+  }
+  void UserInput(int64_t now_us) override { scheduler_.UserInput(now_us); }
+  int64_t next_poll_us() const override { return scheduler_.next_poll_us(); }
+
+ private:
+  PollScheduler scheduler_;
+};
+
+/**
+ * Polls every |interval_us|, ignoring everything else.
+ */
+class FixedScheduler : public Scheduler {
+ public:
+  explicit FixedScheduler(int64_t interval_us) : interval_us_(interval_us) {}
+
+  // Scheduler:
+  void PollSucceeded(int64_t now_us,
+                     const PollScheduler::Playback& /*playback*/) override {
+    next_us_ = now_us + interval_us_;
+  }
+  void PollFailed(int64_t now_us, int64_t retry_after_us) override {
+    next_us_ = now_us + std::max(interval_us_, retry_after_us);
+  }
+  void UserInput(int64_t /*now_us*/) override {}
+  int64_t next_poll_us() const override { return next_us_; }
+
+ private:
+  const int64_t interval_us_;
+  int64_t next_us_ = 0;
+};
+
+std::vector<Segment> GenerateSession(double hours, std::mt19937* rng) {
+  auto uniform = [rng](double min, double max) {
+    return std::uniform_real_distribution<double>(min, max)(*rng);
+  };
+  std::vector<Segment> segments;
+  int64_t now_us = 0;
+  int track = 0;
+  uint32_t duration_ms = 0;
+  const int64_t end_us = static_cast<int64_t>(hours * 3600 * kSec);
+  while (now_us < end_us) {
+    // Listen for a while.
+    const int64_t listen_end_us =
+        now_us + static_cast<int64_t>(uniform(10, 60) * 60 * kSec);
+    int64_t key_press_us = -1;
+    while (now_us < listen_end_us) {
+      track++;
+      duration_ms = static_cast<uint32_t>(uniform(120, 300) * 1000);
+      int64_t length_us = duration_ms * 1000LL;
+      const double r = uniform(0, 1);
+      const bool key_skip = r < 0.1;
+      const bool remote_skip = !key_skip && r < 0.2;
+      if (key_skip || remote_skip)
+        length_us = static_cast<int64_t>(uniform(5, 60) * kSec);
+      segments.push_back({now_us, now_us + length_us, track, duration_ms, 0,
+                          true, key_press_us});
+      now_us += length_us;
+      key_press_us = key_skip ? now_us - kAPIPropagationUsec : -1;
+    }
+    // Then pause.
+    const int64_t pause_us = static_cast<int64_t>(uniform(1, 30) * 60 * kSec);
+    segments.push_back({now_us, now_us + pause_us, track, duration_ms,
+                        duration_ms, false, -1});
+    now_us += pause_us;
+  }
+  return segments;
+}
+
+/**
+ * Poll |segments| with |scheduler|, returning the number of requests and
+ * the track change detection lags.
+ */
+int Simulate(Scheduler* scheduler,
+             const std::vector<Segment>& segments,
+             int rate_limit,
+             std::vector<int64_t>* lags_us) {
+  std::vector<int64_t> key_presses_us;
+  for (const Segment& segment : segments) {
+    if (segment.key_press_us >= 0)
+      key_presses_us.push_back(segment.key_press_us);
+  }
+  int num_requests = 0;
+  size_t seg = 0;
+  size_t key = 0;
+  int seen_track = -1;
+  int64_t pending_change_us = -1;  // When an unseen track change happened.
+  const int64_t end_us = segments.back().end_us;
+  while (true) {
+    int64_t poll_us = scheduler->next_poll_us();
+    // Deliver media key presses made before the poll is due.
+    while (key < key_presses_us.size() && key_presses_us[key] <= poll_us) {
+      scheduler->UserInput(key_presses_us[key++]);
+      poll_us = scheduler->next_poll_us();
+    }
+    if (poll_us >= end_us)
+      break;
+    while (segments[seg].end_us <= poll_us) {
+      seg++;
+      if (segments[seg].track != segments[seg - 1].track &&
+          pending_change_us < 0) {
+        pending_change_us = segments[seg].start_us;
+      }
+    }
+    const Segment& segment = segments[seg];
+    num_requests++;
+    if (rate_limit && num_requests % rate_limit == 0) {
+      scheduler->PollFailed(poll_us, kRetryAfterUsec);
+      continue;
+    }
+    uint32_t progress_ms = segment.offset_ms;
+    if (segment.playing)
+      progress_ms += (poll_us - segment.start_us) / 1000;
+    if (segment.track != seen_track) {
+      if (pending_change_us >= 0)
+        lags_us->push_back(poll_us - pending_change_us);
+      seen_track = segment.track;
+    }
+    pending_change_us = -1;
+    scheduler->PollSucceeded(poll_us, {true, segment.playing, progress_ms,
+                                       segment.duration_ms});
+  }
+  return num_requests;
+}
+
+void Report(const char* name,
+            double hours,
+            int num_requests,
+            std::vector<int64_t> lags_us) {
+  printf("%-12s %7.1f requests/hour, ", name, num_requests / hours);
+  if (lags_us.empty()) {
+    printf("no track changes\n");
+    return;
+  }
+  std::sort(lags_us.begin(), lags_us.end());
+  double sum_us = 0;
+  for (int64_t lag_us : lags_us)
+    sum_us += lag_us;
+  const size_t p95 = std::min(lags_us.size() - 1, lags_us.size() * 95 / 100);
+  printf("lag mean %5.1f s, p95 %5.1f s, max %5.1f s\n",
+         sum_us / lags_us.size() / kSec,
+         static_cast<double>(lags_us[p95]) / kSec,
+         static_cast<double>(lags_us.back()) / kSec);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double hours = 24;
+  unsigned seed = 1;
+  int rate_limit = 0;
+  std::vector<double> fixed_secs = {5, 60};
+  bool usage = false;
+  for (int i = 1; i < argc && !usage; i++) {
+    if (!strcmp(argv[i], "--hours") && i + 1 < argc) {
+      hours = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--rate-limit") && i + 1 < argc) {
+      rate_limit = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--fixed")) {
+      fixed_secs.clear();
+      while (i + 1 < argc && argv[i + 1][0] != '-')
+        fixed_secs.push_back(atof(argv[++i]));
+    } else {
+      usage = true;
+    }
+  }
+  if (usage || hours <= 0 || rate_limit < 0) {
+    fprintf(stderr,
+            "usage: %s [--hours <n>] [--seed <n>] [--rate-limit <n>] "
+            "[--fixed <secs> ...]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::mt19937 rng(seed);
+  const std::vector<Segment> segments = GenerateSession(hours, &rng);
+  std::set<int> tracks;
+  for (const Segment& segment : segments)
+    tracks.insert(segment.track);
+  printf("%.0f hours, %zu track changes\n", hours, tracks.size() - 1);
+
+  std::vector<int64_t> lags_us;
+  AdaptiveScheduler adaptive;
+  int num_requests = Simulate(&adaptive, segments, rate_limit, &lags_us);
+  Report("adaptive", hours, num_requests, lags_us);
+  for (double secs : fixed_secs) {
+    FixedScheduler fixed(static_cast<int64_t>(secs * kSec));
+    lags_us.clear();
+    num_requests = Simulate(&fixed, segments, rate_limit, &lags_us);
+    char name[32];
+    snprintf(name, sizeof(name), "fixed %gs", secs);
+    Report(name, hours, num_requests, lags_us);
+  }
+  return EXIT_SUCCESS;
+}
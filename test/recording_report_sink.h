@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <esp_err.h>
+
+#include "key_state.h"
+#include "keyboard.h"
+
+/**
+ * A KeyboardReportSink which keeps every report, in place of the USB HID.
+ */
+class RecordingReportSink : public KeyboardReportSink {
+ public:
+  struct Report {
+    KeyState key_state;
+    int64_t interrupt_time_us;
+  };
+
+  /**
+   * Refuse reports (as a full queue does) after |capacity| more.
+   */
+  void set_capacity(size_t capacity) { capacity_ = capacity; }
+
+  // KeyboardReportSink:
+  esp_err_t QueueKeyboardReport(const KeyState& key_state,
+                                int64_t interrupt_time_us,
+                                int64_t /*read_time_us*/) override {
+    if (!capacity_)
+      return ESP_ERR_NO_MEM;
+    capacity_--;
+    reports.push_back({key_state, interrupt_time_us});
+    return ESP_OK;
+  }
+
+  esp_err_t QueueConsumerReport(uint16_t usage) override {
+    consumer_reports.push_back(usage);
+    return ESP_OK;
+  }
+
+  std::vector<Report> reports;
+  std::vector<uint16_t> consumer_reports;
+
+ private:
+  size_t capacity_ = SIZE_MAX;
+};
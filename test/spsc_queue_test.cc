@@ -0,0 +1,89 @@
+#include "spsc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+TEST(SPSCQueueTest, Empty) {
+  SPSCQueue<int, 4> queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(nullptr, queue.Front());
+  EXPECT_EQ(4u, queue.available());
+}
+
+TEST(SPSCQueueTest, FirstInFirstOut) {
+  SPSCQueue<int, 4> queue;
+  EXPECT_TRUE(queue.Push(1));
+  EXPECT_TRUE(queue.Push(2));
+  EXPECT_FALSE(queue.empty());
+  EXPECT_EQ(2u, queue.available());
+
+  ASSERT_NE(nullptr, queue.Front());
+  EXPECT_EQ(1, *queue.Front());
+  queue.Pop();
+  ASSERT_NE(nullptr, queue.Front());
+  EXPECT_EQ(2, *queue.Front());
+  queue.Pop();
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCQueueTest, FullQueueRefusesPush) {
+  SPSCQueue<int, 4> queue;
+  for (int i = 0; i < 4; i++)
+    EXPECT_TRUE(queue.Push(i));
+  EXPECT_EQ(0u, queue.available());
+  EXPECT_FALSE(queue.Push(4));
+
+  // The refused item did not overwrite the oldest.
+  EXPECT_EQ(0, *queue.Front());
+  queue.Pop();
+  EXPECT_TRUE(queue.Push(4));
+}
+
+TEST(SPSCQueueTest, WrapsAround) {
+  SPSCQueue<int, 4> queue;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_TRUE(queue.Push(i));
+    ASSERT_TRUE(queue.Push(i + 1000));
+    ASSERT_EQ(i, *queue.Front());
+    queue.Pop();
+    ASSERT_EQ(i + 1000, *queue.Front());
+    queue.Pop();
+    ASSERT_TRUE(queue.empty());
+  }
+}
+
+// One producer and one consumer thread, as the keyboard and USB tasks are.
+// Every item must arrive once, in order.
+TEST(SPSCQueueTest, ProducerConsumerThreads) {
+  constexpr uint32_t kNumItems = 200000;
+  SPSCQueue<uint32_t, 64> queue;
+
+  std::thread producer([&queue] {
+    for (uint32_t i = 0; i < kNumItems;) {
+      if (queue.Push(i))
+        i++;
+      else
+        std::this_thread::yield();
+    }
+  });
+
+  uint32_t expected = 0;
+  while (expected < kNumItems) {
+    const uint32_t* item = queue.Front();
+    if (!item) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(expected, *item);
+    queue.Pop();
+    expected++;
+  }
+  producer.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
@@ -0,0 +1,115 @@
+#include "timer_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kTickUsec = 10000;
+
+class TimerWheelTest : public ::testing::Test {
+ protected:
+  TimerWheelTest() : wheel_(kTickUsec) {}
+
+  // Advance to |now_us|, returning the IDs of the timers which expired.
+  std::vector<uint8_t> Advance(int64_t now_us) {
+    std::vector<uint8_t> expired;
+    wheel_.Advance(now_us, [&expired](TimerWheel::Timer* timer) {
+      expired.push_back(timer->id);
+    });
+    return expired;
+  }
+
+  TimerWheel wheel_;
+};
+
+TEST_F(TimerWheelTest, ExpiresAtDeadline) {
+  TimerWheel::Timer timer;
+  timer.id = 1;
+  wheel_.Schedule(&timer, 50000);
+  EXPECT_FALSE(wheel_.empty());
+  EXPECT_TRUE(Advance(49999).empty());
+  EXPECT_EQ(std::vector<uint8_t>{1}, Advance(50000));
+  EXPECT_FALSE(timer.active);
+  EXPECT_TRUE(wheel_.empty());
+}
+
+// A deadline between ticks is rounded up, never expiring early.
+TEST_F(TimerWheelTest, RoundsUpToTick) {
+  TimerWheel::Timer timer;
+  wheel_.Schedule(&timer, 15000);
+  EXPECT_TRUE(Advance(15000).empty());
+  EXPECT_EQ(1u, Advance(20000).size());
+}
+
+TEST_F(TimerWheelTest, Cancel) {
+  TimerWheel::Timer a;
+  TimerWheel::Timer b;
+  a.id = 1;
+  b.id = 2;
+  wheel_.Schedule(&a, 10000);
+  wheel_.Schedule(&b, 10000);
+  wheel_.Cancel(&a);
+  wheel_.Cancel(&a);  // Does nothing.
+  EXPECT_EQ(std::vector<uint8_t>{2}, Advance(10000));
+  EXPECT_TRUE(wheel_.empty());
+}
+
+TEST_F(TimerWheelTest, RescheduleMovesTimer) {
+  TimerWheel::Timer timer;
+  wheel_.Schedule(&timer, 10000);
+  wheel_.Schedule(&timer, 30000);
+  EXPECT_TRUE(Advance(20000).empty());
+  EXPECT_EQ(1u, Advance(30000).size());
+}
+
+// Timers sharing a slot but a lap (kNumSlots ticks) or more apart must
+// wait for their own deadline.
+TEST_F(TimerWheelTest, SameSlotLaterLap) {
+  TimerWheel::Timer near;
+  TimerWheel::Timer far;
+  near.id = 1;
+  far.id = 2;
+  wheel_.Schedule(&near, 1 * kTickUsec);
+  wheel_.Schedule(&far, (1 + TimerWheel::kNumSlots) * kTickUsec);
+  EXPECT_EQ(std::vector<uint8_t>{1}, Advance(1 * kTickUsec));
+  EXPECT_TRUE(Advance(TimerWheel::kNumSlots * kTickUsec).empty());
+  EXPECT_EQ(std::vector<uint8_t>{2},
+            Advance((1 + TimerWheel::kNumSlots) * kTickUsec));
+}
+
+// Advancing past many laps at once visits every slot once.
+TEST_F(TimerWheelTest, LargeAdvance) {
+  std::vector<TimerWheel::Timer> timers(TimerWheel::kNumSlots * 2);
+  for (size_t i = 0; i < timers.size(); i++) {
+    timers[i].id = i;
+    wheel_.Schedule(&timers[i], (i + 1) * kTickUsec);
+  }
+  EXPECT_EQ(timers.size(), Advance(1000 * kTickUsec).size());
+  EXPECT_TRUE(wheel_.empty());
+}
+
+TEST_F(TimerWheelTest, PastDeadlineExpiresNextAdvance) {
+  Advance(100000);
+  TimerWheel::Timer timer;
+  wheel_.Schedule(&timer, 50000);
+  EXPECT_EQ(1u, Advance(110000).size());
+}
+
+TEST_F(TimerWheelTest, RescheduleFromCallback) {
+  TimerWheel::Timer timer;
+  int count = 0;
+  wheel_.Schedule(&timer, 10000);
+  for (int64_t now_us = 0; now_us <= 50000; now_us += kTickUsec) {
+    wheel_.Advance(now_us, [&](TimerWheel::Timer* t) {
+      count++;
+      wheel_.Schedule(t, now_us + kTickUsec);
+    });
+  }
+  // Expires at 10, 20, 30, 40, and 50 ms, never twice in one Advance().
+  EXPECT_EQ(5, count);
+  EXPECT_TRUE(timer.active);
+}
+
+}  // namespace
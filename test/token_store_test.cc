@@ -0,0 +1,128 @@
+#include "token_store.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <nvs_flash/include/nvs.h>
+
+#include "fake_nvs.h"
+
+namespace {
+
+constexpr char kSecret[] = "0123456789abcdef0123456789abcdef";
+
+// The layout TokenStore saves: version, IV, tag, then the encrypted JSON.
+constexpr size_t kIVOffset = 1;
+constexpr size_t kTagOffset = kIVOffset + 12;
+constexpr size_t kCiphertextOffset = kTagOffset + 16;
+
+using Tokens = TokenStore::Tokens;
+
+class TokenStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override { FakeNVS::Reset(); }
+
+  void TearDown() override { EXPECT_EQ(0u, FakeNVS::num_open_handles()); }
+
+  static std::vector<uint8_t>* blob() {
+    return FakeNVS::blob("spotify", "tokens");
+  }
+
+  static Tokens TestTokens() {
+    Tokens tokens;
+    tokens.refresh_token = "AQD-refresh_token\"\\";
+    tokens.scope = "user-read-currently-playing user-read-playback-state";
+    tokens.expires_at = 1792310400;
+    return tokens;
+  }
+
+  TokenStore store_{kSecret};
+};
+
+TEST_F(TokenStoreTest, NotFound) {
+  Tokens tokens;
+  EXPECT_EQ(ESP_ERR_NVS_NOT_FOUND, store_.Load(&tokens));
+
+  // The namespace exists, but not the key.
+  ASSERT_EQ(ESP_OK, store_.Save(TestTokens()));
+  ASSERT_EQ(ESP_OK, store_.Erase());
+  EXPECT_EQ(ESP_ERR_NVS_NOT_FOUND, store_.Load(&tokens));
+  EXPECT_EQ(ESP_OK, store_.Erase());
+}
+
+TEST_F(TokenStoreTest, RoundTrip) {
+  const Tokens saved = TestTokens();
+  ASSERT_EQ(ESP_OK, store_.Save(saved));
+  Tokens loaded;
+  ASSERT_EQ(ESP_OK, TokenStore(kSecret).Load(&loaded));
+  EXPECT_EQ(saved.refresh_token, loaded.refresh_token);
+  EXPECT_EQ(saved.scope, loaded.scope);
+  EXPECT_EQ(saved.expires_at, loaded.expires_at);
+}
+
+TEST_F(TokenStoreTest, Encrypted) {
+  const Tokens saved = TestTokens();
+  ASSERT_EQ(ESP_OK, store_.Save(saved));
+  const std::string stored(blob()->begin(), blob()->end());
+  EXPECT_EQ(std::string::npos, stored.find("refresh_token"));
+  EXPECT_EQ(std::string::npos, stored.find(saved.scope));
+
+  // A new IV each time.
+  ASSERT_EQ(ESP_OK, store_.Save(saved));
+  EXPECT_NE(stored, std::string(blob()->begin(), blob()->end()));
+}
+
+TEST_F(TokenStoreTest, TamperedBlobFailsAuthentication) {
+  ASSERT_EQ(ESP_OK, store_.Save(TestTokens()));
+  const std::vector<uint8_t> saved = *blob();
+  for (size_t i : {kIVOffset, kTagOffset, kTagOffset + 15, kCiphertextOffset,
+                   saved.size() - 1}) {
+    *blob() = saved;
+    (*blob())[i] ^= 0x01;
+    Tokens tokens;
+    EXPECT_EQ(ESP_ERR_INVALID_CRC, store_.Load(&tokens)) << "byte " << i;
+    EXPECT_TRUE(tokens.refresh_token.empty());
+  }
+}
+
+TEST_F(TokenStoreTest, BadVersion) {
+  ASSERT_EQ(ESP_OK, store_.Save(TestTokens()));
+  (*blob())[0] = 2;
+  Tokens tokens;
+  EXPECT_EQ(ESP_ERR_INVALID_VERSION, store_.Load(&tokens));
+
+  blob()->resize(kCiphertextOffset);  // No ciphertext.
+  (*blob())[0] = 1;
+  EXPECT_EQ(ESP_ERR_INVALID_VERSION, store_.Load(&tokens));
+}
+
+TEST_F(TokenStoreTest, DifferentSecret) {
+  ASSERT_EQ(ESP_OK, store_.Save(TestTokens()));
+  Tokens tokens;
+  EXPECT_EQ(ESP_ERR_INVALID_CRC,
+            TokenStore("0123456789abcdef0123456789abcdeF").Load(&tokens));
+}
+
+// The NVS partition copied to another device.
+TEST_F(TokenStoreTest, DifferentMAC) {
+  ASSERT_EQ(ESP_OK, store_.Save(TestTokens()));
+  const uint8_t mac[6] = {0x7c, 0xdf, 0xa1, 0x00, 0x12, 0x35};
+  FakeNVS::SetBaseMAC(mac);
+  Tokens tokens;
+  EXPECT_EQ(ESP_ERR_INVALID_CRC, store_.Load(&tokens));
+}
+
+TEST_F(TokenStoreTest, Oversize) {
+  ASSERT_EQ(ESP_OK, store_.Save(TestTokens()));
+  Tokens tokens = TestTokens();
+  tokens.refresh_token.assign(1024, 'x');
+  EXPECT_EQ(ESP_ERR_INVALID_SIZE, store_.Save(tokens));
+
+  // The previous tokens are kept.
+  ASSERT_EQ(ESP_OK, store_.Load(&tokens));
+  EXPECT_EQ(TestTokens().refresh_token, tokens.refresh_token);
+}
+
+}  // namespace
@@ -0,0 +1,83 @@
+#include "touch_filter.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using Point = TouchFilter::Point;
+
+/**
+ * Filter |p| |n| times, returning the last output.
+ */
+Point FilterN(TouchFilter* filter, Point p, int n) {
+  Point out = {};
+  for (int i = 0; i < n; i++)
+    out = filter->Filter(p);
+  return out;
+}
+
+TEST(TouchFilterTest, StillTouchUnchanged) {
+  TouchFilter filter;
+  filter.Reset({100, 50});
+  for (int i = 0; i < 10; i++) {
+    const Point p = filter.Filter({100, 50});
+    EXPECT_EQ(100, p.x);
+    EXPECT_EQ(50, p.y);
+  }
+}
+
+// A single sample spike is removed by the median.
+TEST(TouchFilterTest, SpikeRemoved) {
+  TouchFilter filter;
+  filter.Reset({100, 100});
+  FilterN(&filter, {100, 100}, 3);
+  Point p = filter.Filter({140, 60});
+  EXPECT_EQ(100, p.x);
+  EXPECT_EQ(100, p.y);
+  p = filter.Filter({100, 100});
+  EXPECT_EQ(100, p.x);
+  EXPECT_EQ(100, p.y);
+}
+
+// The output reaches a new position exactly, rising or falling.
+TEST(TouchFilterTest, SettlesOnStep) {
+  TouchFilter filter;
+  filter.Reset({100, 100});
+  Point p = FilterN(&filter, {130, 70}, 40);
+  EXPECT_EQ(130, p.x);
+  EXPECT_EQ(70, p.y);
+  p = FilterN(&filter, {-5, 0}, 40);
+  EXPECT_EQ(-5, p.x);
+  EXPECT_EQ(0, p.y);
+}
+
+// The median delays a step by a sample, then the IIR moves 1/2^iir_shift of
+// the remaining distance each sample.
+TEST(TouchFilterTest, StepResponse) {
+  TouchFilter filter(/*iir_shift=*/2);
+  filter.Reset({0, 0});
+  EXPECT_EQ(0, filter.Filter({64, 0}).x);
+  EXPECT_EQ(16, filter.Filter({64, 0}).x);
+  EXPECT_EQ(28, filter.Filter({64, 0}).x);
+  EXPECT_EQ(37, filter.Filter({64, 0}).x);
+}
+
+TEST(TouchFilterTest, ZeroShiftIsMedianOnly) {
+  TouchFilter filter(/*iir_shift=*/0);
+  filter.Reset({0, 0});
+  EXPECT_EQ(0, filter.Filter({10, 0}).x);
+  EXPECT_EQ(10, filter.Filter({10, 0}).x);
+  EXPECT_EQ(10, filter.Filter({90, 0}).x);
+}
+
+TEST(TouchFilterTest, ResetForgetsHistory) {
+  TouchFilter filter;
+  filter.Reset({0, 0});
+  FilterN(&filter, {200, 200}, 5);
+  filter.Reset({10, 20});
+  const Point p = filter.Filter({10, 20});
+  EXPECT_EQ(10, p.x);
+  EXPECT_EQ(20, p.y);
+}
+
+}  // namespace
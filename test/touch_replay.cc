@@ -0,0 +1,211 @@
+// Replays touch panel samples from a device log through TouchFilter.
+//
+//   touch_replay [--iir-shift <n>] <device.log> ...
+//
+// Samples are recorded from the device log with the Trackpad log level set
+// to verbose, as lines containing:
+//
+//   sample <time_us> <x> <y> <pressed>
+//
+// Each touch is filtered as TrackpadTask does: the first sample resets the
+// filter, the rest are filtered. Reports the jitter of the raw and filtered
+// positions, and the latency the filter adds.
+//
+// Jitter is the RMS distance of each position from a centered moving
+// average (the slow, intended movement). Latency is the delay of the
+// filtered position behind that average while the finger moves. Fails if
+// the log has no samples, or if filtering doesn't reduce the jitter.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "touch_filter.h"
+
+namespace {
+
+constexpr int64_t kSamplePeriodUsec = 2000;
+constexpr size_t kTrendSamples = 21;  // Centered moving average, ~40 ms.
+constexpr size_t kHalfTrend = kTrendSamples / 2;
+constexpr int kMaxLagSamples = 50;
+// Slower trend movement (pixels per sample) is treated as still.
+constexpr double kMinMovement = 0.2;
+
+using Point = TouchFilter::Point;
+using Touch = std::vector<Point>;
+
+struct Trend {
+  double x;
+  double y;
+};
+
+bool ReadLog(const char* path, std::vector<Touch>* touches) {
+  std::ifstream f(path);
+  if (!f) {
+    fprintf(stderr, "Unable to open \"%s\".\n", path);
+    return false;
+  }
+  Touch touch;
+  std::string line;
+  while (std::getline(f, line)) {
+    const size_t pos = line.find("sample ");
+    if (pos == std::string::npos)
+      continue;
+    long long time_us;
+    int x, y, pressed;
+    if (sscanf(line.c_str() + pos, "sample %lld %d %d %d", &time_us, &x, &y,
+               &pressed) != 4) {
+      continue;
+    }
+    if (pressed) {
+      touch.push_back({static_cast<int16_t>(x), static_cast<int16_t>(y)});
+    } else if (!touch.empty()) {
+      touches->push_back(std::move(touch));
+      touch.clear();
+    }
+  }
+  if (!touch.empty())
+    touches->push_back(std::move(touch));
+  return true;
+}
+
+Touch FilterTouch(const Touch& touch, uint8_t iir_shift) {
+  TouchFilter filter(iir_shift);
+  filter.Reset(touch[0]);
+  Touch filtered = {touch[0]};
+  for (size_t i = 1; i < touch.size(); i++)
+    filtered.push_back(filter.Filter(touch[i]));
+  return filtered;
+}
+
+/**
+ * The centered moving average of |touch|, from sample kHalfTrend.
+ */
+std::vector<Trend> GetTrend(const Touch& touch) {
+  std::vector<Trend> trend;
+  for (size_t i = kHalfTrend; i + kHalfTrend < touch.size(); i++) {
+    Trend t = {0, 0};
+    for (size_t j = i - kHalfTrend; j <= i + kHalfTrend; j++) {
+      t.x += touch[j].x;
+      t.y += touch[j].y;
+    }
+    trend.push_back({t.x / kTrendSamples, t.y / kTrendSamples});
+  }
+  return trend;
+}
+
+/**
+ * Sum of the squared distances of |touch| from its trend.
+ */
+double SquaredJitter(const Touch& touch, size_t* num_samples) {
+  const std::vector<Trend> trend = GetTrend(touch);
+  double sum = 0;
+  for (size_t i = 0; i < trend.size(); i++) {
+    const Point& p = touch[i + kHalfTrend];
+    sum += std::pow(p.x - trend[i].x, 2) + std::pow(p.y - trend[i].y, 2);
+  }
+  *num_samples += trend.size();
+  return sum;
+}
+
+/**
+ * Sum of the distances of the filtered position from the raw trend |lag|
+ * samples earlier, over samples where the finger moves.
+ */
+double LagError(const std::vector<Trend>& trend,
+                const Touch& filtered,
+                int lag,
+                size_t* num_samples) {
+  double sum = 0;
+  for (size_t i = lag + 1; i < trend.size(); i++) {
+    if (std::abs(trend[i].x - trend[i - 1].x) +
+            std::abs(trend[i].y - trend[i - 1].y) <
+        kMinMovement) {
+      continue;
+    }
+    const Point& p = filtered[i + kHalfTrend];
+    sum += std::hypot(p.x - trend[i - lag].x, p.y - trend[i - lag].y);
+    (*num_samples)++;
+  }
+  return sum;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iir_shift = TouchFilter::kDefaultIIRShift;
+  int first_path = 1;
+  if (argc > 2 && !strcmp(argv[1], "--iir-shift")) {
+    iir_shift = atoi(argv[2]);
+    first_path = 3;
+  }
+  if (first_path >= argc || iir_shift < 0 || iir_shift > 8) {
+    fprintf(stderr, "usage: %s [--iir-shift <n>] <device.log> ...\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<Touch> touches;
+  for (int i = first_path; i < argc; i++) {
+    if (!ReadLog(argv[i], &touches))
+      return EXIT_FAILURE;
+  }
+  size_t num_samples = 0;
+  for (const Touch& touch : touches)
+    num_samples += touch.size();
+  if (!num_samples) {
+    fprintf(stderr, "No touch samples found.\n");
+    return EXIT_FAILURE;
+  }
+
+  double raw_jitter = 0;
+  double filtered_jitter = 0;
+  size_t num_jitter_samples = 0;
+  std::map<int, double> lag_errors;  // Mean distance at each lag.
+  size_t num_moving_samples = 0;
+  for (const Touch& touch : touches) {
+    const Touch filtered = FilterTouch(touch, iir_shift);
+    size_t n = 0;
+    raw_jitter += SquaredJitter(touch, &num_jitter_samples);
+    filtered_jitter += SquaredJitter(filtered, &n);
+    const std::vector<Trend> trend = GetTrend(touch);
+    for (int lag = 0; lag < kMaxLagSamples; lag++) {
+      size_t num_moving = 0;
+      lag_errors[lag] += LagError(trend, filtered, lag, &num_moving);
+      if (!lag)
+        num_moving_samples += num_moving;
+    }
+  }
+
+  printf("%zu samples in %zu touches, iir_shift %d.\n", num_samples,
+         touches.size(), iir_shift);
+  bool ok = true;
+  if (num_jitter_samples) {
+    raw_jitter = std::sqrt(raw_jitter / num_jitter_samples);
+    filtered_jitter = std::sqrt(filtered_jitter / num_jitter_samples);
+    printf("Jitter: raw %.2f px RMS, filtered %.2f px RMS.\n", raw_jitter,
+           filtered_jitter);
+    ok = filtered_jitter < raw_jitter;
+  }
+  if (num_moving_samples) {
+    const auto best = std::min_element(
+        lag_errors.begin(), lag_errors.end(),
+        [](const auto& a, const auto& b) { return a.second < b.second; });
+    printf(
+        "Latency: %.1f ms (%d samples) behind the movement, plus up to "
+        "%.1f ms until the host polls the report.\n",
+        best->first * kSamplePeriodUsec / 1000.0, best->first,
+        kSamplePeriodUsec / 1000.0);
+  } else {
+    printf("Latency: no movement in the samples.\n");
+  }
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}